@@ -0,0 +1,42 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Microbenchmark harness interface
+ *
+ * A kernel is measured over several input sizes, from cache-resident to
+ * DRAM-bound. The harness calls setup() once per size, run() many times and
+ * teardown() at the end; only run() is timed.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+
+/**
+ * @brief a benchmarked kernel
+ */
+
+struct bench_kernel {
+	const char *name;        /**< short name used for filtering and in the baseline */
+	const char *description; /**< what is measured */
+	/** prepares the kernel for num_samples samples; returns NULL on error */
+	void *(*setup)(const uint16_t *samples, uint32_t num_samples);
+	/** runs the kernel once over all samples; returns non-zero on error */
+	int (*run)(void *state);
+	/** frees the state returned by setup() */
+	void (*teardown)(void *state);
+};
+
+
+/** kernels measured by the harness */
+extern const struct bench_kernel bench_kernels[];
+
+/** number of kernels in bench_kernels */
+extern const unsigned int bench_num_kernels;
+
+#endif /* BENCH_H */
@@ -0,0 +1,187 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Decompression throughput benchmark
+ *
+ * Compresses synthetic AIRS-like frames with a few typical parameter sets
+ * and measures how fast the frames are decompressed again. The throughput is
+ * reported in MB/s of decompressed output.
+ *
+ * The Golomb parameters are the ones airspace --tune picks for these frames.
+ * Parameters far below the tuned ones make a large part of the samples escape
+ * symbols with codewords longer than the decoding table index, which are
+ * decoded one by one, so they are not representative.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <cmp.h>
+#include <cmp_decompress.h>
+#include <cmp_errors.h>
+#include "../programs/datagen.h"
+
+/** Size of a benchmarked frame */
+#define BENCH_FRAME_WIDTH 512
+#define BENCH_FRAME_HEIGHT 128
+#define BENCH_NUM_SAMPLES (BENCH_FRAME_WIDTH * BENCH_FRAME_HEIGHT)
+
+/** Minimum run time of a single benchmark in seconds */
+#define BENCH_MIN_TIME 0.5
+
+/** Number of frames of a model frame chain */
+#define BENCH_CHAIN_LEN 8
+
+
+struct bench_config {
+	const char *name;
+	struct cmp_params params;
+};
+
+
+static double now_seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+
+static int run_bench(const struct bench_config *cfg, const struct datagen *gen, uint16_t *data,
+		     uint16_t *out)
+{
+	static struct cmp_decompress_context dctx;
+	uint32_t const src_size = BENCH_NUM_SAMPLES * sizeof(*data);
+	uint32_t const bound = cmp_compress_bound(src_size);
+	uint32_t const dst_cap = (bound + 7) & ~7U; /* keep every frame 8-byte aligned */
+	struct cmp_context ctx;
+	uint8_t *frames = NULL;
+	uint32_t frame_size[BENCH_CHAIN_LEN];
+	uint32_t cmp_work_size, total_cmp_size = 0;
+	void *cmp_work = NULL, *dcmp_work = NULL;
+	unsigned long rounds = 0;
+	double start, elapsed;
+	uint32_t i, ret;
+	int err = 1;
+
+	cmp_work_size = cmp_cal_work_buf_size(&cfg->params, src_size);
+	if (cmp_is_error(cmp_work_size) || cmp_is_error(bound))
+		goto out;
+	cmp_work = malloc(cmp_work_size ? cmp_work_size : 1);
+	dcmp_work = malloc(src_size);
+	frames = malloc((size_t)dst_cap * BENCH_CHAIN_LEN);
+	if (!cmp_work || !dcmp_work || !frames)
+		goto out;
+
+	ret = cmp_initialise(&ctx, &cfg->params, cmp_work, cmp_work_size);
+	if (cmp_is_error(ret))
+		goto out;
+	for (i = 0; i < BENCH_CHAIN_LEN; i++) {
+		datagen_frame(gen, i, data);
+		ret = cmp_compress_u16(&ctx, frames + (size_t)i * dst_cap, dst_cap, data,
+				       src_size);
+		if (cmp_is_error(ret)) {
+			fprintf(stderr, "%s: compression failed: %s\n", cfg->name,
+				cmp_get_error_message(ret));
+			goto out;
+		}
+		frame_size[i] = ret;
+		total_cmp_size += ret;
+	}
+
+	ret = cmp_decompress_initialise(&dctx, dcmp_work, src_size);
+	if (cmp_is_error(ret))
+		goto out;
+	start = now_seconds();
+	do {
+		for (i = 0; i < BENCH_CHAIN_LEN; i++) {
+			ret = cmp_decompress_u16(&dctx, out, src_size,
+						 frames + (size_t)i * dst_cap, frame_size[i]);
+			if (cmp_is_error(ret)) {
+				fprintf(stderr, "%s: decompression failed: %s\n", cfg->name,
+					cmp_get_error_message(ret));
+				goto out;
+			}
+		}
+		rounds++;
+		elapsed = now_seconds() - start;
+	} while (elapsed < BENCH_MIN_TIME);
+
+	/* the last decompressed frame has to match the last compressed one */
+	if (memcmp(data, out, src_size) != 0) {
+		fprintf(stderr, "%s: decompressed data does not match\n", cfg->name);
+		goto out;
+	}
+
+	printf("%-24s ratio %5.2f  %8.1f MB/s\n", cfg->name,
+	       (double)src_size * BENCH_CHAIN_LEN / total_cmp_size,
+	       (double)src_size * BENCH_CHAIN_LEN * (double)rounds / elapsed / 1e6);
+	err = 0;
+out:
+	free(cmp_work);
+	free(dcmp_work);
+	free(frames);
+	return err;
+}
+
+
+int main(void)
+{
+	struct bench_config configs[4];
+	struct datagen_params gen_params;
+	struct datagen gen;
+	uint16_t *data = malloc(BENCH_NUM_SAMPLES * sizeof(*data));
+	uint16_t *out = malloc(BENCH_NUM_SAMPLES * sizeof(*out));
+	size_t i;
+	int err = 0;
+
+	datagen_default_params(&gen_params);
+	gen_params.width = BENCH_FRAME_WIDTH;
+	gen_params.height = BENCH_FRAME_HEIGHT;
+	if (!data || !out || datagen_init(&gen, &gen_params)) {
+		free(data);
+		free(out);
+		return EXIT_FAILURE;
+	}
+
+	memset(configs, 0, sizeof(configs));
+	configs[0].name = "diff golomb zero";
+	configs[0].params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	configs[0].params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	configs[0].params.primary_encoder_param = 96;
+
+	configs[1].name = "iwt golomb multi";
+	configs[1].params.primary_preprocessing = CMP_PREPROCESS_IWT;
+	configs[1].params.primary_encoder_type = CMP_ENCODER_GOLOMB_MULTI;
+	configs[1].params.primary_encoder_param = 192;
+	configs[1].params.primary_encoder_outlier = 2048;
+
+	configs[2].name = "diff + model";
+	configs[2].params = configs[0].params;
+	configs[2].params.secondary_iterations = BENCH_CHAIN_LEN - 1;
+	configs[2].params.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+	configs[2].params.secondary_encoder_type = CMP_ENCODER_GOLOMB_MULTI;
+	configs[2].params.secondary_encoder_param = 12;
+	configs[2].params.secondary_encoder_outlier = 128;
+	configs[2].params.model_rate = 8;
+
+	configs[3].name = "uncompressed + checksum";
+	configs[3].params.primary_preprocessing = CMP_PREPROCESS_NONE;
+	configs[3].params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	configs[3].params.checksum_enabled = 1;
+
+	for (i = 0; i < sizeof(configs) / sizeof(configs[0]); i++)
+		err |= run_bench(&configs[i], &gen, data, out);
+
+	datagen_free(&gen);
+	free(data);
+	free(out);
+	return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,197 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Workload of the instruction count benchmark
+ *
+ * Compresses frames of 16-bit big-endian samples with one of a fixed set of
+ * configurations, so icount.py can count the instructions executed in
+ * cmp_compress_u16_be() under Valgrind. The program is built with the
+ * flight-representative profile (32-bit, -O2, no SIMD) and only depends on the
+ * compression library, so it does not need a CLI library for the target.
+ *
+ * Usage: bench_icount --list
+ *	  bench_icount CONFIG FILE NUM_FRAMES
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lib/cmp.h"
+#include "../lib/cmp_errors.h"
+#include "../lib/cmp_header.h"
+
+#define ICOUNT_G_PAR 16
+#define ICOUNT_OUTLIER 300
+#define ICOUNT_MODEL_RATE 8
+
+
+struct icount_config {
+	const char *name;
+	enum cmp_preprocessing preprocessing;
+	enum cmp_encoder_type encoder_type;
+	int model;    /**< non-zero to compress the following frames against a model */
+	int checksum; /**< non-zero to append a checksum */
+};
+
+
+static const struct icount_config icount_configs[] = {
+	{ "uncompressed", CMP_PREPROCESS_NONE, CMP_ENCODER_UNCOMPRESSED, 0, 0 },
+	{ "none_zero", CMP_PREPROCESS_NONE, CMP_ENCODER_GOLOMB_ZERO, 0, 0 },
+	{ "diff_zero", CMP_PREPROCESS_DIFF, CMP_ENCODER_GOLOMB_ZERO, 0, 0 },
+	{ "diff_multi", CMP_PREPROCESS_DIFF, CMP_ENCODER_GOLOMB_MULTI, 0, 0 },
+	{ "diff_zero_checksum", CMP_PREPROCESS_DIFF, CMP_ENCODER_GOLOMB_ZERO, 0, 1 },
+	{ "iwt_zero", CMP_PREPROCESS_IWT, CMP_ENCODER_GOLOMB_ZERO, 0, 0 },
+	{ "iwt_multi", CMP_PREPROCESS_IWT, CMP_ENCODER_GOLOMB_MULTI, 0, 0 },
+	{ "diff_model_zero", CMP_PREPROCESS_DIFF, CMP_ENCODER_GOLOMB_ZERO, 1, 0 },
+	{ "diff_model_multi", CMP_PREPROCESS_DIFF, CMP_ENCODER_GOLOMB_MULTI, 1, 0 }
+};
+
+#define ICOUNT_NUM_CONFIGS (sizeof(icount_configs) / sizeof(icount_configs[0]))
+
+
+static void config_to_params(const struct icount_config *config, uint32_t num_frames,
+			     struct cmp_params *params)
+{
+	memset(params, 0, sizeof(*params));
+	params->primary_preprocessing = config->preprocessing;
+	params->primary_encoder_type = config->encoder_type;
+	params->checksum_enabled = (uint8_t)config->checksum;
+	if (config->encoder_type != CMP_ENCODER_UNCOMPRESSED) {
+		params->primary_encoder_param = ICOUNT_G_PAR;
+		if (config->encoder_type == CMP_ENCODER_GOLOMB_MULTI)
+			params->primary_encoder_outlier = ICOUNT_OUTLIER;
+	}
+	if (config->model) {
+		params->secondary_iterations = num_frames;
+		params->secondary_preprocessing = CMP_PREPROCESS_MODEL;
+		params->secondary_encoder_type = params->primary_encoder_type;
+		params->secondary_encoder_param = params->primary_encoder_param;
+		params->secondary_encoder_outlier = params->primary_encoder_outlier;
+		params->model_rate = ICOUNT_MODEL_RATE;
+	}
+}
+
+
+static void *load_file(const char *filename, uint32_t *size)
+{
+	FILE *fp = fopen(filename, "rb");
+	void *data = NULL;
+	long len;
+
+	if (!fp) {
+		perror(filename);
+		return NULL;
+	}
+	if (fseek(fp, 0, SEEK_END) == 0 && (len = ftell(fp)) > 0 &&
+	    (unsigned long)len <= UINT32_MAX && fseek(fp, 0, SEEK_SET) == 0) {
+		data = malloc((size_t)len);
+		if (data && fread(data, 1, (size_t)len, fp) != (size_t)len) {
+			free(data);
+			data = NULL;
+		}
+		*size = (uint32_t)len;
+	}
+	if (!data)
+		fprintf(stderr, "%s: cannot read the file\n", filename);
+	fclose(fp);
+	return data;
+}
+
+
+/* compresses all frames; only the calls of cmp_compress_u16_be() are counted */
+static int compress_frames(const struct icount_config *config, const uint8_t *data,
+			   uint32_t frame_size, uint32_t num_frames)
+{
+	struct cmp_params params;
+	struct cmp_context ctx;
+	uint32_t work_size, dst_capacity, i;
+	void *work_buf, *dst;
+	int err = 0;
+
+	config_to_params(config, num_frames, &params);
+	work_size = cmp_cal_work_buf_size(&params, frame_size);
+	dst_capacity = cmp_compress_bound_params(&params, frame_size);
+	if (cmp_is_error(dst_capacity)) /* the data compress well enough to fit anyway */
+		dst_capacity = (uint32_t)CMP_HDR_MAX_COMPRESSED_SIZE;
+	if (cmp_is_error(work_size))
+		return -1;
+	work_buf = malloc(work_size ? work_size : 1);
+	dst = malloc(dst_capacity);
+	if (!work_buf || !dst ||
+	    cmp_is_error(cmp_initialise(&ctx, &params, work_buf, work_size))) {
+		free(work_buf);
+		free(dst);
+		return -1;
+	}
+
+	for (i = 0; i < num_frames && !err; i++) {
+		uint32_t const cmp_size = cmp_compress_u16_be(&ctx, dst, dst_capacity,
+							      data + i * frame_size, frame_size);
+
+		if (cmp_is_error(cmp_size)) {
+			fprintf(stderr, "%s: frame %lu: %s\n", config->name, (unsigned long)i,
+				cmp_get_error_message(cmp_size));
+			err = -1;
+		}
+	}
+
+	cmp_deinitialise(&ctx);
+	free(work_buf);
+	free(dst);
+	return err;
+}
+
+
+int main(int argc, char **argv)
+{
+	const struct icount_config *config = NULL;
+	unsigned long num_frames;
+	uint32_t size, frame_size;
+	uint8_t *data;
+	char *end;
+	size_t i;
+	int err;
+
+	if (argc == 2 && !strcmp(argv[1], "--list")) {
+		for (i = 0; i < ICOUNT_NUM_CONFIGS; i++)
+			printf("%s\n", icount_configs[i].name);
+		return EXIT_SUCCESS;
+	}
+	if (argc != 4) {
+		fprintf(stderr, "Usage: %s --list\n       %s CONFIG FILE NUM_FRAMES\n", argv[0],
+			argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < ICOUNT_NUM_CONFIGS; i++)
+		if (!strcmp(argv[1], icount_configs[i].name))
+			config = &icount_configs[i];
+	if (!config) {
+		fprintf(stderr, "unknown configuration: %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	num_frames = strtoul(argv[3], &end, 10);
+	if (end == argv[3] || *end != '\0' || num_frames == 0 || num_frames > UINT32_MAX) {
+		fprintf(stderr, "invalid number of frames: %s\n", argv[3]);
+		return EXIT_FAILURE;
+	}
+
+	data = load_file(argv[2], &size);
+	if (!data)
+		return EXIT_FAILURE;
+	frame_size = size / (uint32_t)num_frames;
+	if (frame_size * num_frames != size || frame_size % 2) {
+		fprintf(stderr, "%s: not %lu frames of 16-bit samples\n", argv[2], num_frames);
+		free(data);
+		return EXIT_FAILURE;
+	}
+
+	err = compress_frames(config, data, frame_size, (uint32_t)num_frames);
+	free(data);
+	return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,345 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Kernels measured by the microbenchmark harness
+ *
+ * The internal kernels are measured through the narrowest entry point the
+ * library has: the single level IWT through the IWT preprocessing, which runs
+ * all decomposition levels, and golomb_encode() through
+ * cmp_encoder_encode_s16(). bitstream_add_bits32() and cmp_checksum() are
+ * called directly.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "../lib/cmp.h"
+#include "../lib/cmp_decompress.h"
+#include "../lib/cmp_errors.h"
+#include "../lib/cmp_header.h"
+#include "../lib/common/bitstream_writer.h"
+#include "../lib/common/header_private.h"
+#include "../lib/common/sample_reader.h"
+#include "../lib/compress/encoder.h"
+#include "../lib/compress/preprocess.h"
+
+/** Golomb parameter of the encoder and engine kernels */
+#define BENCH_G_PAR 16
+
+/** outlier of the multi escape encoder kernel */
+#define BENCH_OUTLIER 300
+
+
+/* ====== IWT ===== */
+
+struct iwt_state {
+	const struct preprocessing_method *method;
+	struct sample_desc desc;
+	void *work_buf;
+	uint32_t work_buf_size;
+};
+
+
+static void *iwt_setup(const uint16_t *samples, uint32_t num_samples)
+{
+	struct iwt_state *st = calloc(1, sizeof(*st));
+
+	if (!st)
+		return NULL;
+	st->method = preprocessing_get_method(CMP_PREPROCESS_IWT);
+	if (!st->method ||
+	    cmp_is_error(sample_read_src_init(&st->desc, samples,
+					      num_samples * (uint32_t)sizeof(*samples), CMP_U16))) {
+		free(st);
+		return NULL;
+	}
+	st->work_buf_size = st->method->get_work_buf_size(num_samples * (uint32_t)sizeof(*samples));
+	st->work_buf = malloc(st->work_buf_size);
+	if (!st->work_buf) {
+		free(st);
+		return NULL;
+	}
+	return st;
+}
+
+
+static int iwt_run(void *state)
+{
+	struct iwt_state *st = state;
+
+	return cmp_is_error(st->method->init(&st->desc, st->work_buf, st->work_buf_size)) != 0;
+}
+
+
+static void iwt_teardown(void *state)
+{
+	struct iwt_state *st = state;
+
+	free(st->work_buf);
+	free(st);
+}
+
+
+/* ====== Golomb encoder and bitstream writer ===== */
+
+struct encode_state {
+	struct cmp_encoder enc;
+	int16_t *residuals;     /**< differences of neighbouring samples */
+	uint32_t *values;       /**< raw bits for the bitstream kernel */
+	uint8_t *lengths;       /**< number of bits of the values */
+	uint32_t num_samples;
+	uint64_t *dst;
+	uint32_t dst_size;
+};
+
+
+static void encode_teardown(void *state)
+{
+	struct encode_state *st = state;
+
+	free(st->residuals);
+	free(st->values);
+	free(st->lengths);
+	free(st->dst);
+	free(st);
+}
+
+
+static struct encode_state *encode_setup(const uint16_t *samples, uint32_t num_samples,
+					 enum cmp_encoder_type encoder_type, uint32_t outlier)
+{
+	struct encode_state *st = calloc(1, sizeof(*st));
+	uint64_t const dst_size = cmp_encoder_max_compressed_size(num_samples * 2) + 8;
+	uint32_t i;
+
+	if (!st)
+		return NULL;
+	st->num_samples = num_samples;
+	st->dst_size = (uint32_t)dst_size;
+	st->residuals = malloc(num_samples * sizeof(*st->residuals));
+	st->dst = malloc((size_t)dst_size);
+	if (!st->residuals || !st->dst || dst_size > UINT32_MAX ||
+	    cmp_is_error(cmp_encoder_init(&st->enc, encoder_type, BENCH_G_PAR, outlier))) {
+		encode_teardown(st);
+		return NULL;
+	}
+	for (i = 0; i < num_samples; i++)
+		st->residuals[i] = (int16_t)(samples[i] - (i ? samples[i - 1] : 0));
+	return st;
+}
+
+
+static void *golomb_zero_setup(const uint16_t *samples, uint32_t num_samples)
+{
+	return encode_setup(samples, num_samples, CMP_ENCODER_GOLOMB_ZERO, 0);
+}
+
+
+static void *golomb_multi_setup(const uint16_t *samples, uint32_t num_samples)
+{
+	return encode_setup(samples, num_samples, CMP_ENCODER_GOLOMB_MULTI, BENCH_OUTLIER);
+}
+
+
+static int golomb_run(void *state)
+{
+	struct encode_state *st = state;
+	struct bitstream_writer bs;
+	uint32_t i;
+
+	(void)bitstream_writer_init(&bs, st->dst, st->dst_size);
+	for (i = 0; i < st->num_samples; i++)
+		cmp_encoder_encode_s16(&st->enc, st->residuals[i], &bs);
+	return cmp_is_error(bitstream_flush(&bs)) != 0;
+}
+
+
+static void *bitstream_setup(const uint16_t *samples, uint32_t num_samples)
+{
+	struct encode_state *st = calloc(1, sizeof(*st));
+	uint32_t i;
+
+	if (!st)
+		return NULL;
+	st->num_samples = num_samples;
+	st->dst_size = num_samples * (uint32_t)sizeof(uint32_t) + 8;
+	st->values = malloc(num_samples * sizeof(*st->values));
+	st->lengths = malloc(num_samples);
+	st->dst = malloc(st->dst_size);
+	if (!st->values || !st->lengths || !st->dst) {
+		encode_teardown(st);
+		return NULL;
+	}
+	/* code word lengths as produced by the encoders, from 1 to 32 bits */
+	for (i = 0; i < num_samples; i++) {
+		unsigned int const len = 1 + (samples[i] & 0x1FU);
+
+		st->lengths[i] = (uint8_t)len;
+		st->values[i] = (uint32_t)((samples[i] * 2654435761UL) & (0xFFFFFFFFUL >> (32 - len)));
+	}
+	return st;
+}
+
+
+static int bitstream_run(void *state)
+{
+	struct encode_state *st = state;
+	struct bitstream_writer bs;
+	uint32_t i;
+
+	(void)bitstream_writer_init(&bs, st->dst, st->dst_size);
+	for (i = 0; i < st->num_samples; i++)
+		bitstream_add_bits32(&bs, st->values[i], st->lengths[i]);
+	return cmp_is_error(bitstream_flush(&bs)) != 0;
+}
+
+
+/* ====== Checksum ===== */
+
+struct checksum_state {
+	struct sample_desc desc;
+	uint32_t checksum;
+};
+
+
+static void *checksum_setup(const uint16_t *samples, uint32_t num_samples)
+{
+	struct checksum_state *st = calloc(1, sizeof(*st));
+
+	if (st && cmp_is_error(sample_read_src_init(&st->desc, samples,
+						    num_samples * (uint32_t)sizeof(*samples),
+						    CMP_U16))) {
+		free(st);
+		return NULL;
+	}
+	return st;
+}
+
+
+static int checksum_run(void *state)
+{
+	struct checksum_state *st = state;
+
+	st->checksum = cmp_checksum(&st->desc);
+	return 0;
+}
+
+
+/* ====== Compression engine ===== */
+
+struct engine_state {
+	struct cmp_context ctx;
+	struct cmp_decompress_context dctx;
+	const uint16_t *samples;
+	uint32_t src_size;
+	void *work_buf;
+	void *dst;
+	uint32_t dst_capacity;
+	uint32_t cmp_size;
+	uint16_t *decompressed;
+};
+
+
+static void engine_teardown(void *state)
+{
+	struct engine_state *st = state;
+
+	cmp_deinitialise(&st->ctx);
+	free(st->work_buf);
+	free(st->dst);
+	free(st->decompressed);
+	free(st);
+}
+
+
+static int compress_run(void *state)
+{
+	struct engine_state *st = state;
+
+	st->cmp_size = cmp_compress_u16(&st->ctx, st->dst, st->dst_capacity, st->samples,
+					st->src_size);
+	return cmp_is_error(st->cmp_size) != 0;
+}
+
+
+static void *compress_setup(const uint16_t *samples, uint32_t num_samples)
+{
+	struct engine_state *st = calloc(1, sizeof(*st));
+	struct cmp_params params;
+	uint32_t work_size;
+
+	if (!st)
+		return NULL;
+	memset(&params, 0, sizeof(params));
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = BENCH_G_PAR;
+
+	st->samples = samples;
+	st->src_size = num_samples * (uint32_t)sizeof(*samples);
+	st->dst_capacity = cmp_compress_bound_params(&params, st->src_size);
+	if (cmp_is_error(st->dst_capacity)) /* the data compress well enough to fit anyway */
+		st->dst_capacity = (uint32_t)CMP_HDR_MAX_COMPRESSED_SIZE;
+	work_size = cmp_cal_work_buf_size(&params, st->src_size);
+	if (cmp_is_error(work_size)) {
+		free(st);
+		return NULL;
+	}
+	st->work_buf = malloc(work_size ? work_size : 1);
+	st->dst = malloc(st->dst_capacity);
+	if (!st->work_buf || !st->dst ||
+	    cmp_is_error(cmp_initialise(&st->ctx, &params, st->work_buf, work_size))) {
+		engine_teardown(st);
+		return NULL;
+	}
+	return st;
+}
+
+
+static void *decompress_setup(const uint16_t *samples, uint32_t num_samples)
+{
+	struct engine_state *st = compress_setup(samples, num_samples);
+
+	if (!st)
+		return NULL;
+	st->decompressed = malloc(st->src_size);
+	if (!st->decompressed || compress_run(st) ||
+	    cmp_is_error(cmp_decompress_initialise(&st->dctx, NULL, 0))) {
+		engine_teardown(st);
+		return NULL;
+	}
+	return st;
+}
+
+
+static int decompress_run(void *state)
+{
+	struct engine_state *st = state;
+
+	return cmp_is_error(cmp_decompress_u16(&st->dctx, st->decompressed, st->src_size,
+					       st->dst, st->cmp_size)) != 0;
+}
+
+
+const struct bench_kernel bench_kernels[] = {
+	{ "iwt", "multi level IWT preprocessing (iwt_single_level_i16)",
+	  iwt_setup, iwt_run, iwt_teardown },
+	{ "golomb_zero", "zero escape Golomb encoder (golomb_encode)",
+	  golomb_zero_setup, golomb_run, encode_teardown },
+	{ "golomb_multi", "multi escape Golomb encoder (golomb_encode)",
+	  golomb_multi_setup, golomb_run, encode_teardown },
+	{ "bitstream", "bitstream_add_bits32() with 1 to 32 bits",
+	  bitstream_setup, bitstream_run, encode_teardown },
+	{ "checksum", "cmp_checksum()", checksum_setup, checksum_run, free },
+	{ "compress", "cmp_compress_u16() with DIFF and GOLOMB_ZERO",
+	  compress_setup, compress_run, engine_teardown },
+	{ "decompress", "cmp_decompress_u16() of a DIFF and GOLOMB_ZERO frame",
+	  decompress_setup, decompress_run, engine_teardown }
+};
+
+const unsigned int bench_num_kernels = sizeof(bench_kernels) / sizeof(bench_kernels[0]);
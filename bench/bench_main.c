@@ -0,0 +1,378 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Microbenchmark harness
+ *
+ * Every kernel is measured over input sizes from cache-resident to DRAM-bound.
+ * After a warm-up, which also calibrates how many runs are timed together, the
+ * runs are repeated; repetitions further than three scaled median absolute
+ * deviations from the median are rejected as outliers (e.g., interrupts or
+ * frequency changes). The median of the remaining repetitions is reported.
+ *
+ * The results can be written as JSON and compared against such a file from an
+ * earlier run; a kernel slower than the baseline by more than a threshold is
+ * reported as a regression and the harness fails.
+ *
+ * Usage: bench_micro [--filter=NAME] [--repetitions=N] [--min-time=S]
+ *		      [--json=FILE] [--baseline=FILE] [--threshold=PERCENT]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+#include "../programs/datagen.h"
+
+/** Input sizes in bytes: L1, L2 and last level cache resident and DRAM-bound */
+static const uint32_t bench_sizes[] = { 4 * 1024, 64 * 1024, 1024 * 1024, 8 * 1024 * 1024 };
+
+#define BENCH_MAX_REPETITIONS 1000
+#define BENCH_MAX_NAME_LEN 64
+
+/** scale factor of the median absolute deviation to a standard deviation */
+#define MAD_TO_SIGMA 1.4826
+#define OUTLIER_SIGMAS 3.0
+
+
+struct bench_options {
+	const char *filter;
+	unsigned int repetitions;
+	double min_time;       /**< minimum time of the warm-up and of every repetition */
+	const char *json;
+	const char *baseline;
+	double threshold;      /**< allowed slowdown against the baseline in percent */
+};
+
+
+struct bench_result {
+	const char *kernel;
+	uint32_t size;
+	double ns_per_sample;  /**< median of the accepted repetitions */
+	double mb_per_s;
+	double spread;         /**< median absolute deviation relative to the median in percent */
+	unsigned int repetitions;
+	unsigned int rejected;
+};
+
+
+static double now_seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+
+static int compare_double(const void *a, const void *b)
+{
+	double const x = *(const double *)a;
+	double const y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+
+static double abs_double(double x)
+{
+	return x < 0 ? -x : x;
+}
+
+
+/* median of sorted values */
+static double median_of(const double *v, unsigned int n)
+{
+	return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+
+/* one tall synthetic frame, so the same corpus is measured on every machine */
+static int fill_samples(uint16_t *data, uint32_t num_samples)
+{
+	struct datagen_params params;
+	struct datagen g;
+
+	datagen_default_params(&params);
+	params.height = num_samples / params.width;
+	if (datagen_init(&g, &params))
+		return -1;
+	datagen_frame(&g, 0, data);
+	datagen_free(&g);
+	return 0;
+}
+
+
+/**
+ * @brief measures a kernel over one input size
+ *
+ * @returns 0 on success or -1 if the kernel failed
+ */
+
+static int bench_measure(const struct bench_kernel *k, const uint16_t *samples, uint32_t size,
+			 const struct bench_options *opt, struct bench_result *res)
+{
+	uint32_t const num_samples = size / (uint32_t)sizeof(uint16_t);
+	double times[BENCH_MAX_REPETITIONS];
+	double dev[BENCH_MAX_REPETITIONS];
+	double start, elapsed, median, mad;
+	unsigned long runs = 0, batch, b;
+	unsigned int r, n;
+	void *state = k->setup(samples, num_samples);
+
+	if (!state) {
+		fprintf(stderr, "%s: setup failed for %lu bytes\n", k->name, (unsigned long)size);
+		return -1;
+	}
+
+	/* warm-up; also estimates how many runs take min_time */
+	start = now_seconds();
+	do {
+		if (k->run(state))
+			goto fail;
+		runs++;
+		elapsed = now_seconds() - start;
+	} while (elapsed < opt->min_time);
+	batch = (unsigned long)(opt->min_time / (elapsed / (double)runs)) + 1;
+
+	for (r = 0; r < opt->repetitions; r++) {
+		start = now_seconds();
+		for (b = 0; b < batch; b++)
+			if (k->run(state))
+				goto fail;
+		times[r] = (now_seconds() - start) / (double)batch;
+	}
+	k->teardown(state);
+
+	/* reject the outliers with the median absolute deviation */
+	qsort(times, opt->repetitions, sizeof(*times), compare_double);
+	median = median_of(times, opt->repetitions);
+	for (r = 0; r < opt->repetitions; r++)
+		dev[r] = abs_double(times[r] - median);
+	qsort(dev, opt->repetitions, sizeof(*dev), compare_double);
+	mad = median_of(dev, opt->repetitions);
+	for (n = 0, r = 0; r < opt->repetitions; r++)
+		if (abs_double(times[r] - median) <= OUTLIER_SIGMAS * MAD_TO_SIGMA * mad)
+			times[n++] = times[r];
+	median = median_of(times, n);
+
+	res->kernel = k->name;
+	res->size = size;
+	res->ns_per_sample = median * 1e9 / num_samples;
+	res->mb_per_s = (double)size / median / 1e6;
+	res->spread = mad / median * 100;
+	res->repetitions = n;
+	res->rejected = opt->repetitions - n;
+	return 0;
+
+fail:
+	fprintf(stderr, "%s: run failed for %lu bytes\n", k->name, (unsigned long)size);
+	k->teardown(state);
+	return -1;
+}
+
+
+static FILE *json_open(const char *filename)
+{
+	FILE *fp = fopen(filename, "w");
+
+	if (!fp)
+		perror(filename);
+	else
+		fprintf(fp, "{\n  \"results\": [");
+	return fp;
+}
+
+
+/* one result per line, so a baseline can be read back with read_baseline() */
+static void json_write(FILE *fp, const struct bench_result *res, int first)
+{
+	fprintf(fp, "%s\n    {\"kernel\": \"%s\", \"size\": %lu, \"ns_per_sample\": %.4f, "
+		"\"mb_per_s\": %.2f, \"spread_percent\": %.2f, \"repetitions\": %u, "
+		"\"rejected\": %u}", first ? "" : ",", res->kernel, (unsigned long)res->size,
+		res->ns_per_sample, res->mb_per_s, res->spread, res->repetitions, res->rejected);
+}
+
+
+static int json_close(FILE *fp, const char *filename)
+{
+	fprintf(fp, "\n  ]\n}\n");
+	if (ferror(fp) | fclose(fp)) {
+		perror(filename);
+		return -1;
+	}
+	return 0;
+}
+
+
+/**
+ * @brief looks up the result of a kernel in a baseline written with --json
+ *
+ * @returns the baseline time per sample in ns or a negative value if the
+ *	baseline has no result for the kernel and size
+ */
+
+static double read_baseline(FILE *fp, const char *kernel, uint32_t size)
+{
+	char line[512];
+
+	rewind(fp);
+	while (fgets(line, sizeof(line), fp)) {
+		const char *p = strstr(line, "{\"kernel\":");
+		char name[BENCH_MAX_NAME_LEN];
+		unsigned long base_size;
+		double ns_per_sample;
+
+		if (p && sscanf(p, "{\"kernel\": \"%63[^\"]\", \"size\": %lu, \"ns_per_sample\": %lf",
+				name, &base_size, &ns_per_sample) == 3 &&
+		    !strcmp(name, kernel) && base_size == size)
+			return ns_per_sample;
+	}
+	return -1;
+}
+
+
+static int parse_options(int argc, char **argv, struct bench_options *opt)
+{
+	int i;
+
+	opt->filter = NULL;
+	opt->repetitions = 20;
+	opt->min_time = 0.01;
+	opt->json = NULL;
+	opt->baseline = NULL;
+	opt->threshold = 5;
+
+	for (i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *value = strchr(arg, '=');
+		char *end = NULL;
+		int valid = 1;
+
+		value = value ? value + 1 : arg;
+		if (!strncmp(arg, "--filter=", 9)) {
+			opt->filter = value;
+		} else if (!strncmp(arg, "--repetitions=", 14)) {
+			unsigned long const n = strtoul(value, &end, 10);
+
+			valid = n >= 1 && n <= BENCH_MAX_REPETITIONS;
+			opt->repetitions = (unsigned int)n;
+		} else if (!strncmp(arg, "--min-time=", 11)) {
+			opt->min_time = strtod(value, &end);
+			valid = opt->min_time > 0;
+		} else if (!strncmp(arg, "--json=", 7)) {
+			opt->json = value;
+		} else if (!strncmp(arg, "--baseline=", 11)) {
+			opt->baseline = value;
+		} else if (!strncmp(arg, "--threshold=", 12)) {
+			opt->threshold = strtod(value, &end);
+			valid = opt->threshold >= 0;
+		} else {
+			fprintf(stderr, "unknown option: %s\n", arg);
+			return -1;
+		}
+		if (!valid || (end && (end == value || *end != '\0'))) {
+			fprintf(stderr, "invalid value: %s\n", arg);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+
+int main(int argc, char **argv)
+{
+	struct bench_options opt;
+	uint32_t const max_size = bench_sizes[sizeof(bench_sizes) / sizeof(bench_sizes[0]) - 1];
+	uint16_t *samples;
+	FILE *json = NULL, *baseline = NULL;
+	unsigned int k, num_results = 0, num_regressions = 0;
+	size_t s;
+	int err = 0;
+
+	if (parse_options(argc, argv, &opt)) {
+		fprintf(stderr, "Usage: %s [--filter=NAME] [--repetitions=N] [--min-time=S] "
+			"[--json=FILE] [--baseline=FILE] [--threshold=PERCENT]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	samples = malloc(max_size);
+	if (!samples || fill_samples(samples, max_size / (uint32_t)sizeof(*samples))) {
+		free(samples);
+		return EXIT_FAILURE;
+	}
+
+	if (opt.baseline) {
+		baseline = fopen(opt.baseline, "r");
+		if (!baseline) {
+			perror(opt.baseline);
+			free(samples);
+			return EXIT_FAILURE;
+		}
+	}
+	if (opt.json) {
+		json = json_open(opt.json);
+		if (!json) {
+			if (baseline)
+				fclose(baseline);
+			free(samples);
+			return EXIT_FAILURE;
+		}
+	}
+
+	printf("%-14s %9s %10s %10s %8s %7s%s\n", "kernel", "size", "ns/sample", "MB/s",
+	       "spread", "reject", baseline ? "   vs. baseline" : "");
+	for (k = 0; k < bench_num_kernels; k++) {
+		const struct bench_kernel *kernel = &bench_kernels[k];
+
+		if (opt.filter && !strstr(kernel->name, opt.filter))
+			continue;
+		for (s = 0; s < sizeof(bench_sizes) / sizeof(bench_sizes[0]); s++) {
+			struct bench_result res;
+
+			if (bench_measure(kernel, samples, bench_sizes[s], &opt, &res)) {
+				err = 1;
+				continue;
+			}
+			printf("%-14s %8luK %10.3f %10.1f %7.2f%% %7u", res.kernel,
+			       (unsigned long)res.size / 1024, res.ns_per_sample, res.mb_per_s,
+			       res.spread, res.rejected);
+			if (baseline) {
+				double const base = read_baseline(baseline, res.kernel, res.size);
+
+				if (base > 0) {
+					double const change = (res.ns_per_sample / base - 1) * 100;
+					int const regression = change > opt.threshold;
+
+					printf("   %+7.2f%%%s", change, regression ? " REGRESSION" : "");
+					num_regressions += (unsigned int)regression;
+				} else {
+					printf("   (new)");
+				}
+			}
+			printf("\n");
+			fflush(stdout);
+			if (json)
+				json_write(json, &res, num_results == 0);
+			num_results++;
+		}
+	}
+
+	if (json && json_close(json, opt.json))
+		err = 1;
+	if (baseline) {
+		fclose(baseline);
+		if (num_regressions) {
+			printf("%u regressions slower than the baseline by more than %.1f%%\n",
+			       num_regressions, opt.threshold);
+			err = 1;
+		}
+	}
+	free(samples);
+	return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}
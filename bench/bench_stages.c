@@ -0,0 +1,445 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Hardware performance counters of the compression stages
+ *
+ * Compresses frames with cmp_compress_u16() and measures its stages (see enum
+ * cmp_stage) with the cmp_set_trace() hooks, so the stages of the real engine
+ * are measured and not a copy of them. The trace clock takes a snapshot of the
+ * time and of all counters and returns its number; the differences of the
+ * snapshots at the start and the end of a stage are summed per stage. For
+ * every stage and for the whole frame the time, cycles, instructions, branch
+ * misses and L1 data and last level cache misses per sample are reported,
+ * together with the instructions per cycle. The setup and the header are done
+ * once per frame, so their cost is amortised over the samples of the frame.
+ *
+ * The counters come from Linux perf_event_open(2). Counters that cannot be
+ * opened, e.g. in a container or with a restrictive perf_event_paranoid
+ * setting, are reported as "-"; the times are always measured.
+ *
+ * Usage: bench_stages [--params=STRING] [--size=BYTES] [--repetitions=N]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "perf_counters.h"
+#include "../lib/cmp.h"
+#include "../lib/cmp_errors.h"
+#include "../lib/cmp_header.h"
+#include "../programs/datagen.h"
+#include "../programs/params_parse.h"
+
+#define STAGES_DEFAULT_SIZE (1024 * 1024)
+#define STAGES_MAX_REPETITIONS 1000
+
+/** minimum duration of a measured batch of frames in seconds */
+#define STAGES_MIN_BATCH_TIME 0.005
+
+/** clock reads of a frame; the uncompressed fallback reports the stages twice */
+#define STAGES_MAX_SNAPSHOTS (4 * CMP_NUM_STAGES)
+
+/** row of the whole frame after the rows of the stages */
+#define STAGES_FRAME CMP_NUM_STAGES
+
+
+static const char *const stage_names[CMP_NUM_STAGES + 1] = {
+	"setup", "preprocess_init", "encode", "checksum", "header", "frame_total"
+};
+
+
+/**
+ * @brief time and counter values at a point of the compression
+ */
+
+struct snapshot {
+	double time;
+	struct perf_values counts;
+};
+
+
+struct stages_state {
+	struct cmp_trace trace;
+	struct perf_counters *pc;
+	struct snapshot snap[STAGES_MAX_SNAPSHOTS];
+	uint64_t num_snaps;                   /**< snapshots taken in the current frame */
+	struct snapshot sum[CMP_NUM_STAGES + 1]; /**< sums of a batch per stage */
+	unsigned long reported[CMP_NUM_STAGES + 1]; /**< how often a stage was measured */
+	struct cmp_context ctx;
+	void *work_buf;
+	const uint16_t *samples;
+	uint32_t src_size;
+	uint64_t *dst;
+	uint32_t dst_capacity;
+};
+
+
+static double now_seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+
+static void take_snapshot(struct perf_counters *pc, struct snapshot *snap)
+{
+	perf_counters_read(pc, &snap->counts);
+	snap->time = now_seconds();
+}
+
+
+/* adds the difference between two snapshots to a sum */
+static void add_delta(struct snapshot *sum, const struct snapshot *start,
+		      const struct snapshot *end)
+{
+	int c;
+
+	sum->time += end->time - start->time;
+	for (c = 0; c < PERF_NUM_COUNTERS; c++) {
+		sum->counts.value[c] += end->counts.value[c] - start->counts.value[c];
+		sum->counts.valid[c] &= start->counts.valid[c] & end->counts.valid[c];
+	}
+}
+
+
+/* the clock of the trace; the value is the number of the snapshot */
+static uint64_t stages_clock(void *opaque)
+{
+	struct stages_state *st = opaque;
+	uint64_t const n = st->num_snaps < STAGES_MAX_SNAPSHOTS ? st->num_snaps++
+								 : STAGES_MAX_SNAPSHOTS - 1;
+
+	take_snapshot(st->pc, &st->snap[n]);
+	return n;
+}
+
+
+static void stages_stage_done(void *opaque, enum cmp_stage stage, uint64_t start, uint64_t end)
+{
+	struct stages_state *st = opaque;
+
+	if ((unsigned int)stage >= CMP_NUM_STAGES)
+		return;
+	add_delta(&st->sum[stage], &st->snap[start], &st->snap[end]);
+	st->reported[stage]++;
+}
+
+
+static void stages_reset(struct stages_state *st)
+{
+	int s, c;
+
+	memset(st->sum, 0, sizeof(st->sum));
+	memset(st->reported, 0, sizeof(st->reported));
+	for (s = 0; s <= CMP_NUM_STAGES; s++)
+		for (c = 0; c < PERF_NUM_COUNTERS; c++)
+			st->sum[s].counts.valid[c] = 1;
+}
+
+
+/* compresses a traced frame and measures it as a whole */
+static int frame_run(struct stages_state *st)
+{
+	struct snapshot start, end;
+	uint32_t cmp_size;
+
+	st->num_snaps = 0;
+	take_snapshot(st->pc, &start);
+	cmp_size = cmp_compress_u16(&st->ctx, st->dst, st->dst_capacity, st->samples,
+				    st->src_size);
+	take_snapshot(st->pc, &end);
+	add_delta(&st->sum[STAGES_FRAME], &start, &end);
+	st->reported[STAGES_FRAME]++;
+	return cmp_is_error(cmp_size) != 0;
+}
+
+
+static void stages_free(struct stages_state *st)
+{
+	cmp_deinitialise(&st->ctx);
+	free(st->work_buf);
+	free(st->dst);
+}
+
+
+static int stages_init(struct stages_state *st, const struct cmp_params *params,
+		       struct perf_counters *pc, const uint16_t *samples, uint32_t src_size)
+{
+	uint32_t work_buf_size;
+
+	memset(st, 0, sizeof(*st));
+	st->pc = pc;
+	st->samples = samples;
+	st->src_size = src_size;
+
+	work_buf_size = cmp_cal_work_buf_size(params, src_size);
+	st->dst_capacity = cmp_compress_bound_params(params, src_size);
+	if (cmp_is_error(st->dst_capacity)) /* the data compress well enough to fit anyway */
+		st->dst_capacity = (uint32_t)CMP_HDR_MAX_COMPRESSED_SIZE;
+	if (cmp_is_error(work_buf_size))
+		return -1;
+
+	st->work_buf = malloc(work_buf_size ? work_buf_size : 1);
+	st->dst = malloc(st->dst_capacity);
+	if (!st->work_buf || !st->dst ||
+	    cmp_is_error(cmp_initialise(&st->ctx, params, st->work_buf, work_buf_size))) {
+		stages_free(st);
+		return -1;
+	}
+
+	st->trace.clock = stages_clock;
+	st->trace.stage_done = stages_stage_done;
+	st->trace.opaque = st;
+	cmp_set_trace(&st->ctx, &st->trace);
+	return 0;
+}
+
+
+static int compare_double(const void *a, const void *b)
+{
+	double const x = *(const double *)a;
+	double const y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+
+/* median of unsorted values; the values are sorted */
+static double median_of(double *v, unsigned int n)
+{
+	qsort(v, n, sizeof(*v), compare_double);
+	return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+
+static void print_row(const char *name, double time, const double *value, const int *valid)
+{
+	int c;
+
+	printf("%-16s %10.4g", name, time);
+	for (c = 0; c < PERF_NUM_COUNTERS; c++) {
+		if (valid[c])
+			printf(" %12.4g", value[c]);
+		else
+			printf(" %12s", "-");
+		if (c == PERF_INSTRUCTIONS) {
+			if (valid[PERF_CYCLES] && valid[PERF_INSTRUCTIONS] && value[PERF_CYCLES] > 0)
+				printf(" %6.2f", value[PERF_INSTRUCTIONS] / value[PERF_CYCLES]);
+			else
+				printf(" %6s", "-");
+		}
+	}
+	printf("\n");
+}
+
+
+/**
+ * @brief measures the stages of the frames
+ *
+ * The frames are compressed in batches long enough for the clock and the
+ * counters; the medians over the repetitions are reported per sample. A
+ * stage the engine does not run, e.g., the checksum if disabled, is left out.
+ *
+ * @returns 0 on success or -1 if a compression failed
+ */
+
+static int stages_measure(struct stages_state *st, unsigned int repetitions)
+{
+	double const num_samples = (double)(st->src_size / sizeof(uint16_t));
+	double *values[CMP_NUM_STAGES + 1][PERF_NUM_COUNTERS + 1]; /* last: time */
+	int valid[CMP_NUM_STAGES + 1][PERF_NUM_COUNTERS];
+	unsigned long batch = 1, b;
+	unsigned int r;
+	int s, c, err = 0;
+
+	/* warm-up, which also calibrates the batch size */
+	for (;;) {
+		double const start = now_seconds();
+		double elapsed;
+
+		for (b = 0; b < batch; b++)
+			err |= frame_run(st);
+		elapsed = now_seconds() - start;
+		if (err)
+			return -1;
+		if (elapsed >= STAGES_MIN_BATCH_TIME || batch >= (1UL << 30))
+			break;
+		batch *= 2;
+	}
+
+	for (s = 0; s <= CMP_NUM_STAGES; s++) {
+		for (c = 0; c <= PERF_NUM_COUNTERS; c++) {
+			values[s][c] = malloc(repetitions * sizeof(*values[s][c]));
+			err |= !values[s][c];
+		}
+		for (c = 0; c < PERF_NUM_COUNTERS; c++)
+			valid[s][c] = 1;
+	}
+
+	for (r = 0; r < repetitions && !err; r++) {
+		struct perf_values unused;
+
+		stages_reset(st);
+		perf_counters_start(st->pc);
+		for (b = 0; b < batch; b++)
+			err |= frame_run(st);
+		perf_counters_stop(st->pc, &unused);
+		for (s = 0; s <= CMP_NUM_STAGES; s++) {
+			double const n = (double)batch * num_samples;
+
+			values[s][PERF_NUM_COUNTERS][r] = st->sum[s].time * 1e9 / n;
+			for (c = 0; c < PERF_NUM_COUNTERS; c++) {
+				values[s][c][r] = st->sum[s].counts.value[c] / n;
+				valid[s][c] &= st->sum[s].counts.valid[c];
+			}
+		}
+	}
+
+	for (s = 0; s <= CMP_NUM_STAGES && !err; s++) {
+		double value[PERF_NUM_COUNTERS];
+
+		if (!st->reported[s])
+			continue;
+		for (c = 0; c < PERF_NUM_COUNTERS; c++)
+			value[c] = median_of(values[s][c], repetitions);
+		print_row(stage_names[s], median_of(values[s][PERF_NUM_COUNTERS], repetitions),
+			  value, valid[s]);
+	}
+	fflush(stdout);
+
+	for (s = 0; s <= CMP_NUM_STAGES; s++)
+		for (c = 0; c <= PERF_NUM_COUNTERS; c++)
+			free(values[s][c]);
+	return err ? -1 : 0;
+}
+
+
+static int parse_options(int argc, char **argv, struct cmp_params *params, uint32_t *size,
+			 unsigned int *repetitions)
+{
+	int i;
+
+	memset(params, 0, sizeof(*params));
+	params->primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params->primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params->primary_encoder_param = 16;
+	params->checksum_enabled = 1;
+	*size = STAGES_DEFAULT_SIZE;
+	*repetitions = 11;
+
+	for (i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *value = strchr(arg, '=');
+		char *end = NULL;
+		int valid = 1;
+
+		value = value ? value + 1 : arg;
+		if (!strncmp(arg, "--params=", 9)) {
+			valid = cmp_params_parse(value, params) == CMP_PARSE_OK;
+		} else if (!strncmp(arg, "--size=", 7)) {
+			unsigned long const n = strtoul(value, &end, 10);
+
+			/* whole 16-bit samples of at least one row of a generated frame */
+			valid = n >= 1024 && n <= CMP_HDR_MAX_ORIGINAL_SIZE && n % 2 == 0;
+			*size = (uint32_t)n;
+		} else if (!strncmp(arg, "--repetitions=", 14)) {
+			unsigned long const n = strtoul(value, &end, 10);
+
+			valid = n >= 1 && n <= STAGES_MAX_REPETITIONS;
+			*repetitions = (unsigned int)n;
+		} else {
+			fprintf(stderr, "unknown option: %s\n", arg);
+			return -1;
+		}
+		if (!valid || (end && (end == value || *end != '\0'))) {
+			fprintf(stderr, "invalid value: %s\n", arg);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+
+/* a synthetic frame, so the same corpus is measured on every machine */
+static uint16_t *generate_samples(uint32_t size)
+{
+	struct datagen_params params;
+	struct datagen g;
+	uint32_t const num_samples = size / (uint32_t)sizeof(uint16_t);
+	uint16_t *samples, *frame;
+
+	datagen_default_params(&params);
+	params.height = (num_samples + params.width - 1) / params.width;
+	samples = malloc(size);
+	frame = malloc((size_t)params.width * params.height * sizeof(*frame));
+	if (!samples || !frame || datagen_init(&g, &params)) {
+		free(samples);
+		free(frame);
+		return NULL;
+	}
+	datagen_frame(&g, 0, frame);
+	memcpy(samples, frame, size);
+	datagen_free(&g);
+	free(frame);
+	return samples;
+}
+
+
+int main(int argc, char **argv)
+{
+	struct cmp_params params;
+	struct stages_state st;
+	struct perf_counters pc;
+	uint32_t size;
+	unsigned int repetitions;
+	uint16_t *samples;
+	int c, err = 0;
+
+	if (parse_options(argc, argv, &params, &size, &repetitions)) {
+		fprintf(stderr, "Usage: %s [--params=STRING] [--size=BYTES] [--repetitions=N]\n",
+			argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	samples = generate_samples(size);
+	if (!samples)
+		return EXIT_FAILURE;
+	if (perf_counters_open(&pc) == 0)
+		printf("note: no hardware performance counters available, only the times are measured\n");
+	if (stages_init(&st, &params, &pc, samples, size)) {
+		fprintf(stderr, "cannot set up the compression with these parameters\n");
+		perf_counters_close(&pc);
+		free(samples);
+		return EXIT_FAILURE;
+	}
+
+	printf("%lu samples, %s preprocessing, %s encoder, per sample:\n",
+	       (unsigned long)(size / sizeof(uint16_t)),
+	       cmp_preprocessing_name(params.primary_preprocessing),
+	       cmp_encoder_type_name(params.primary_encoder_type));
+	printf("%-16s %10s", "stage", "ns");
+	for (c = 0; c < PERF_NUM_COUNTERS; c++) {
+		printf(" %12s", perf_counter_name((enum perf_counter_id)c));
+		if (c == PERF_INSTRUCTIONS)
+			printf(" %6s", "IPC");
+	}
+	printf("\n");
+
+	if (stages_measure(&st, repetitions)) {
+		fprintf(stderr, "the compression failed\n");
+		err = 1;
+	}
+
+	stages_free(&st);
+	perf_counters_close(&pc);
+	free(samples);
+	return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""
+@file
+@author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+@date   2025
+@copyright GPL-2.0
+
+@brief Instruction count benchmark of the flight-representative build
+
+Counts the instructions executed in cmp_compress_u16_be() per sample for every
+configuration of bench_icount with Valgrind's callgrind tool and compares them
+against a baseline file. Unlike times, the counts are deterministic, so a
+configuration whose count differs from the baseline by more than the tolerance
+fails the benchmark, and so does a configuration missing from the baseline,
+unless --update writes it. Exits with 77 (skipped) if Valgrind is not
+installed.
+"""
+
+import argparse
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+EXIT_SKIP = 77
+
+# corpus: consecutive frames from the synthetic data generator
+FRAME_WIDTH = 512
+FRAME_HEIGHT = 32
+NUM_FRAMES = 8
+NUM_SAMPLES = FRAME_WIDTH * FRAME_HEIGHT * NUM_FRAMES
+
+COUNTED_FUNCTION = "cmp_compress_u16_be"
+
+BASELINE_HEADER = """\
+# Instructions executed per sample in cmp_compress_u16_be() by the
+# flight-representative build (32-bit, -O2, no SIMD), counted with Valgrind
+# over {frames} synthetic frames of {width}x{height} pixels.
+# Update after an intended change with: bench/icount.py ... --update
+# configuration instructions/sample
+"""
+
+
+def read_baseline(path):
+    baseline = {}
+    if not path.exists():
+        return baseline
+    for line in path.read_text().splitlines():
+        line = line.strip()
+        if not line or line.startswith("#"):
+            continue
+        name, value = line.split()
+        baseline[name] = float(value)
+    return baseline
+
+
+def write_baseline(path, results):
+    lines = [
+        BASELINE_HEADER.format(
+            frames=NUM_FRAMES, width=FRAME_WIDTH, height=FRAME_HEIGHT
+        )
+    ]
+    for name, value in results.items():
+        lines.append(f"{name} {value:.3f}\n")
+    path.write_text("".join(lines))
+
+
+def count_instructions(valgrind, bench, config, corpus):
+    result = subprocess.run(
+        [
+            valgrind,
+            "--tool=callgrind",
+            "--callgrind-out-file=/dev/null",
+            f"--toggle-collect={COUNTED_FUNCTION}",
+            bench,
+            config,
+            str(corpus),
+            str(NUM_FRAMES),
+        ],
+        capture_output=True,
+        text=True,
+    )
+    match = re.search(r"Collected\s*:\s*(\d+)", result.stderr)
+    if result.returncode != 0 or not match:
+        sys.stderr.write(result.stderr)
+        raise RuntimeError(f"counting the instructions of {config} failed")
+    return int(match.group(1)) / NUM_SAMPLES
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("@brief ")[1])
+    parser.add_argument("--bench", required=True, help="bench_icount executable")
+    parser.add_argument("--airsgen", required=True, help="airsgen executable")
+    parser.add_argument("--baseline", required=True, type=Path, help="baseline file")
+    parser.add_argument(
+        "--tolerance",
+        type=float,
+        default=1.0,
+        help="allowed difference to the baseline in percent (default: 1)",
+    )
+    parser.add_argument(
+        "--update", action="store_true", help="write the counts to the baseline file"
+    )
+    args = parser.parse_args()
+
+    valgrind = shutil.which("valgrind")
+    if valgrind is None:
+        print("valgrind not found, skipping the instruction count benchmark")
+        return EXIT_SKIP
+
+    configs = subprocess.run(
+        [args.bench, "--list"], capture_output=True, text=True, check=True
+    ).stdout.split()
+    baseline = read_baseline(args.baseline)
+    results = {}
+    failures = 0
+    missing = 0
+
+    with tempfile.TemporaryDirectory() as tmp:
+        corpus = Path(tmp) / "corpus.dat"
+        with open(corpus, "wb") as f:
+            subprocess.run(
+                [
+                    args.airsgen,
+                    "-q",
+                    f"--frames={NUM_FRAMES}",
+                    f"--width={FRAME_WIDTH}",
+                    f"--height={FRAME_HEIGHT}",
+                ],
+                stdout=f,
+                check=True,
+            )
+
+        print(
+            f"{'configuration':<20} {'instr/sample':>12} {'baseline':>10} {'change':>8}"
+        )
+        for config in configs:
+            value = count_instructions(valgrind, args.bench, config, corpus)
+            results[config] = value
+            base = baseline.get(config)
+            if base is None:
+                missing += 1
+                print(f"{config:<20} {value:12.3f} {'(missing)':>10}")
+                continue
+            change = (value / base - 1) * 100
+            failed = abs(change) > args.tolerance
+            failures += failed
+            print(
+                f"{config:<20} {value:12.3f} {base:10.3f} {change:+7.2f}%"
+                + (" FAIL" if failed else "")
+            )
+
+    if args.update:
+        write_baseline(args.baseline, results)
+        print(f"baseline written to {args.baseline}")
+        return 0
+    if missing:
+        print(
+            f"{missing} configurations are missing from the baseline; "
+            "count them with --update"
+        )
+    if failures:
+        print(
+            f"{failures} configurations differ from the baseline by more than "
+            f"{args.tolerance}%; if intended, update the baseline with --update"
+        )
+    return 1 if failures or missing else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,176 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Hardware performance counters of the calling thread
+ */
+
+#if defined(__linux__)
+/* syscall(2) is hidden under strict C89 with only _POSIX_C_SOURCE */
+#  define _DEFAULT_SOURCE
+#endif
+
+#include <string.h>
+
+#include "perf_counters.h"
+
+#if defined(__linux__)
+#  include <linux/perf_event.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#  define PERF_HAVE_EVENTS 1
+#else
+#  define PERF_HAVE_EVENTS 0
+#endif
+
+
+static const char *const counter_names[PERF_NUM_COUNTERS] = {
+	"cycles", "instructions", "branch-misses", "L1D-misses", "LLC-misses"
+};
+
+
+const char *perf_counter_name(enum perf_counter_id id)
+{
+	return (unsigned int)id < PERF_NUM_COUNTERS ? counter_names[id] : "unknown";
+}
+
+
+#if PERF_HAVE_EVENTS
+
+static int open_counter(uint32_t type, uint64_t config)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1; /* allowed with perf_event_paranoid <= 2 */
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	/* this thread on any CPU */
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+
+int perf_counters_open(struct perf_counters *pc)
+{
+	static const struct {
+		uint32_t type;
+		uint64_t config;
+	} events[PERF_NUM_COUNTERS] = {
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+				      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+				      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES }
+	};
+	int i, n = 0;
+
+	for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+		pc->fd[i] = open_counter(events[i].type, events[i].config);
+		n += pc->fd[i] >= 0;
+	}
+	return n;
+}
+
+
+void perf_counters_start(struct perf_counters *pc)
+{
+	int i;
+
+	for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+		if (pc->fd[i] < 0)
+			continue;
+		(void)ioctl(pc->fd[i], PERF_EVENT_IOC_RESET, 0);
+		(void)ioctl(pc->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+}
+
+
+void perf_counters_read(struct perf_counters *pc, struct perf_values *values)
+{
+	int i;
+
+	for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+		uint64_t buf[3]; /* value, time enabled, time running */
+
+		values->value[i] = 0;
+		values->valid[i] = 0;
+		if (pc->fd[i] < 0 || read(pc->fd[i], buf, sizeof(buf)) != (ssize_t)sizeof(buf) ||
+		    buf[2] == 0)
+			continue;
+		/* with more counters than the PMU has, the counters are multiplexed */
+		values->value[i] = (double)buf[0] * ((double)buf[1] / (double)buf[2]);
+		values->valid[i] = 1;
+	}
+}
+
+
+void perf_counters_stop(struct perf_counters *pc, struct perf_values *values)
+{
+	int i;
+
+	for (i = 0; i < PERF_NUM_COUNTERS; i++)
+		if (pc->fd[i] >= 0)
+			(void)ioctl(pc->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+	perf_counters_read(pc, values);
+}
+
+
+void perf_counters_close(struct perf_counters *pc)
+{
+	int i;
+
+	for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+		if (pc->fd[i] >= 0)
+			close(pc->fd[i]);
+		pc->fd[i] = -1;
+	}
+}
+
+#else /* !PERF_HAVE_EVENTS */
+
+int perf_counters_open(struct perf_counters *pc)
+{
+	int i;
+
+	for (i = 0; i < PERF_NUM_COUNTERS; i++)
+		pc->fd[i] = -1;
+	return 0;
+}
+
+
+void perf_counters_start(struct perf_counters *pc)
+{
+	(void)pc;
+}
+
+
+void perf_counters_read(struct perf_counters *pc, struct perf_values *values)
+{
+	(void)pc;
+	memset(values, 0, sizeof(*values));
+}
+
+
+void perf_counters_stop(struct perf_counters *pc, struct perf_values *values)
+{
+	(void)pc;
+	memset(values, 0, sizeof(*values));
+}
+
+
+void perf_counters_close(struct perf_counters *pc)
+{
+	(void)pc;
+}
+
+#endif /* PERF_HAVE_EVENTS */
@@ -0,0 +1,76 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Hardware performance counters of the calling thread
+ *
+ * Uses Linux perf_event_open(2) to count user space events. Every counter is
+ * opened on its own, so a counter the CPU, the kernel or a container does not
+ * provide (e.g., with a restrictive perf_event_paranoid setting) is just
+ * missing; on other systems no counter is available.
+ */
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+
+
+/**
+ * @brief counted events
+ */
+
+enum perf_counter_id {
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_BRANCH_MISSES,
+	PERF_L1D_MISSES,   /**< L1 data cache read misses */
+	PERF_LLC_MISSES,   /**< last level cache misses */
+	PERF_NUM_COUNTERS
+};
+
+
+/**
+ * @brief opened counters
+ */
+
+struct perf_counters {
+	int fd[PERF_NUM_COUNTERS]; /**< file descriptor of a counter; -1 if unavailable */
+};
+
+
+/**
+ * @brief values of a measurement
+ */
+
+struct perf_values {
+	double value[PERF_NUM_COUNTERS]; /**< counted events, scaled if the counter was multiplexed */
+	int valid[PERF_NUM_COUNTERS];    /**< non-zero if the counter was counting */
+};
+
+
+/**
+ * @brief opens all available counters
+ *
+ * @returns the number of available counters; 0 if counting is not possible
+ */
+int perf_counters_open(struct perf_counters *pc);
+
+/** @brief resets and starts all opened counters */
+void perf_counters_start(struct perf_counters *pc);
+
+/** @brief reads the values of all opened counters since the start; they keep counting */
+void perf_counters_read(struct perf_counters *pc, struct perf_values *values);
+
+/** @brief stops all opened counters and reads their values */
+void perf_counters_stop(struct perf_counters *pc, struct perf_values *values);
+
+/** @brief closes all counters */
+void perf_counters_close(struct perf_counters *pc);
+
+/** @brief returns a short name of a counter, e.g., "cycles" */
+const char *perf_counter_name(enum perf_counter_id id);
+
+#endif /* PERF_COUNTERS_H */
@@ -12,6 +12,10 @@
  * - Setup: Create a compression context with cmp_initialise()
  * - Process: Compress data using cmp_compress_u16()
  * - Reset compression context using cmp_reset()
+ * - Warm start: Start a model chain from a reference frame with
+ *   cmp_load_model_u16()
+ * - Failover: Continue a model chain in another context with
+ *   cmp_context_save() and cmp_context_restore()
  * - Clean-up: Optionally destroy context with cmp_deinitialise()
  *
  * @see @ref examples/ directory for usage examples
@@ -113,6 +117,88 @@ struct cmp_params {
 	/* Additional Options */
 	uint8_t checksum_enabled; /**< Enable checksum generation of original data if non-zero */
 	uint8_t uncompressed_fallback_enabled; /**< Fall back to uncompressed storage if compression is ineffective */
+	uint8_t iwt_in_place_enabled; /**< Calculate the IWT in the source buffer if non-zero; only
+				       *   supported by cmp_compress_u16_in_place() and
+				       *   cmp_compress_i16_in_place()
+				       */
+};
+
+
+/** Number of escape levels of the multi escape mechanism (2 to 16 raw bits) */
+#define CMP_STATS_NUM_ESCAPE_LEVELS 8
+
+/** Longest codeword of a sample in bits, including the raw bits of an escape */
+#define CMP_STATS_MAX_CODEWORD_BITS 48
+
+/** Number of entries of a residual histogram, one per 16-bit residual */
+#define CMP_RESIDUAL_HIST_SIZE 65536
+
+
+/**
+ * @brief Statistics of the last compressed frame
+ *
+ * Filled by the compression functions if set with cmp_set_stats(). The
+ * samples are the values after preprocessing, i.e. the residuals the encoder
+ * codes.
+ */
+
+struct cmp_stats {
+	uint32_t num_samples;        /**< Number of encoded samples */
+	uint32_t num_zero_escapes;   /**< Samples coded with the zero escape symbol */
+	uint32_t num_multi_escapes[CMP_STATS_NUM_ESCAPE_LEVELS]; /**< Samples coded with the
+								   *   multi escape symbol of
+								   *   every escape level
+								   */
+	uint32_t codeword_len_hist[CMP_STATS_MAX_CODEWORD_BITS + 1]; /**< Number of samples
+								       *   per codeword length
+								       *   in bits
+								       */
+	int16_t min_residual;        /**< Smallest encoded sample */
+	int16_t max_residual;        /**< Largest encoded sample */
+	uint32_t header_bits;        /**< Bits of the header */
+	uint32_t payload_bits;       /**< Bits of the encoded samples, including padding */
+	uint32_t checksum_bits;      /**< Bits of the checksum; 0 if disabled */
+	uint8_t uncompressed_fallback; /**< Non-zero if the frame was stored uncompressed because
+					*   it did not compress
+					*/
+};
+
+
+/**
+ * @brief Stages of the compression of a frame
+ */
+
+enum cmp_stage {
+	CMP_STAGE_SETUP,           /**< Selection of the parameters, encoder setup and header
+				    *   place holder
+				    */
+	CMP_STAGE_PREPROCESS_INIT, /**< Initialisation of the preprocessing, e.g., the IWT
+				    *   decomposition
+				    */
+	CMP_STAGE_ENCODE,          /**< Preprocessing and encoding of the samples */
+	CMP_STAGE_CHECKSUM,        /**< Checksum of the original samples */
+	CMP_STAGE_HEADER           /**< End of the bitstream and rewind and re-serialisation of
+				    *   the final header
+				    */
+};
+
+/** Number of compression stages */
+#define CMP_NUM_STAGES 5
+
+
+/**
+ * @brief Callbacks to trace the stages of the compression
+ *
+ * The time unit is up to the clock, e.g., the ticks of a hardware timer.
+ */
+
+struct cmp_trace {
+	uint64_t (*clock)(void *opaque); /**< Returns the current time */
+	void (*stage_done)(void *opaque, enum cmp_stage stage, uint64_t start,
+			   uint64_t end); /**< Called at the end of every stage with the clock
+					   *   values at its start and its end
+					   */
+	void *opaque;                     /**< Passed to the callbacks */
 };
 
 
@@ -134,6 +220,54 @@ struct cmp_context {
 	uint32_t model_size;      /**< Size of the model used in the model-based preprocessing */
 	uint64_t identifier;      /**< Identifier for the compression model */
 	uint8_t sequence_number; /**< Number of compression passes performed since the last reset */
+	uint8_t model_preloaded; /**< Non-zero if the chain started with cmp_load_model_u16() */
+	struct cmp_stats *stats;  /**< Statistics of the last frame; NULL if not collected */
+	uint32_t *residual_hist;  /**< Histogram of the residuals; NULL if not collected */
+	const struct cmp_trace *trace; /**< Trace of the stages; NULL if not traced */
+};
+
+
+/**
+ * @brief Output sink for compressing into small chunk buffers
+ *
+ * Instead of one destination buffer large enough for the whole frame, the
+ * compressor fills the chunk buffer and hands it to write_chunk() every time
+ * it is full (and once more at the end with the last partial chunk). The
+ * chunk buffer can be reused as soon as write_chunk() returns.
+ *
+ * The header at the beginning of the first chunk contains a place holder for
+ * the compressed size. After the last chunk, finalise_header() is called
+ * with the final header, which has exactly the same size as the place holder
+ * and has to replace the first hdr_size bytes of the frame.
+ *
+ * The callbacks return 0 on success; any other value aborts the compression
+ * with a CMP_ERR_DST_SINK_FAILED error.
+ */
+
+struct cmp_sink {
+	void *chunk_buf;         /**< Chunk buffer; MUST be 8-byte aligned */
+	uint32_t chunk_buf_size; /**< Size of the chunk buffer in bytes; at least 8,
+				  *   only the largest multiple of 8 is used
+				  */
+	/** Called with each filled chunk */
+	int (*write_chunk)(const void *chunk, uint32_t chunk_size, void *opaque);
+	/** Called with the final header after the last chunk */
+	int (*finalise_header)(const void *hdr, uint32_t hdr_size, void *opaque);
+	void *opaque; /**< Pointer passed to the callbacks */
+};
+
+
+/**
+ * @brief Streaming compression state
+ *
+ * Holds the state of a frame compressed piece by piece with
+ * cmp_compress_begin(), cmp_compress_push_*() and cmp_compress_end().
+ *
+ * @warning This structure MUST NOT be directly manipulated by external code.
+ */
+
+struct cmp_stream {
+	uint64_t opaque[48]; /**< Internal state, large enough for every platform */
 };
 
 
@@ -171,7 +305,8 @@ unsigned int cmp_is_error(uint32_t code);
  *
  * In this scenario the input data are not compressible. This function is
  * primarily useful for memory allocation purposes (destination buffer size).
- * Assumes a worst case configuration.
+ * Assumes a worst case configuration. If the compression parameters are known,
+ * use cmp_compress_bound_params(), which gives a much tighter bound.
  *
  * @param packed_size	packed size of the data in bytes (same as src_size,
  *			except for cmp_compress_i16_in_i32() where it's half)
@@ -184,6 +319,30 @@ unsigned int cmp_is_error(uint32_t code);
 uint32_t cmp_compress_bound(uint32_t packed_size);
 
 
+/**
+ * @brief Get the maximum compressed size for a given parameter configuration
+ *
+ * Unlike cmp_compress_bound(), the worst case is derived from the configured
+ * encoders (Golomb parameter and outlier) of the primary and, if used, the
+ * secondary pass. When the uncompressed fallback is enabled, the result is
+ * never larger than the uncompressed storage size (see
+ * CMP_UNCOMPRESSED_BOUND()).
+ *
+ * This is the recommended size for allocating the destination buffer; every
+ * compression call with these parameters is guaranteed to fit into it.
+ *
+ * @param params	pointer to the compression parameters used to compress
+ *			the data
+ * @param packed_size	packed size of the data in bytes (same as src_size,
+ *			except for cmp_compress_i16_in_i32() where it's half)
+ *
+ * @returns the compressed size in the worst-case scenario for the given
+ *	parameters or an error, which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_compress_bound_params(const struct cmp_params *params, uint32_t packed_size);
+
+
 /**
  * @brief Calculate the maximum buffer size required for uncompressed storage
  *
@@ -222,6 +381,9 @@ uint32_t cmp_compress_bound(uint32_t packed_size);
  * store intermediate calculations or a predictive model. The working buffer
  * provides that temporary storage space.
  *
+ * With iwt_in_place_enabled set, the IWT needs no working buffer, as the
+ * coefficients are calculated in the source buffer.
+ *
  * @param params	pointer to a compression parameters struct used to
  *			compress the data
  * @param src_size	size of a source data buffer in bytes
@@ -261,6 +423,93 @@ uint32_t cmp_cal_work_buf_size(const struct cmp_params *params, uint32_t src_siz
 uint32_t cmp_initialise(struct cmp_context *ctx, const struct cmp_params *params, void *work_buf,
 			uint32_t work_buf_size);
 
+
+/**
+ * @brief Collects statistics of the compressed frames
+ *
+ * After every successful call of a cmp_compress_*() function, the statistics
+ * of the compressed frame are in stats. The frames of the streaming functions
+ * (cmp_compress_begin() etc.) are not covered. Without statistics, the
+ * compression loop is not changed at all; with statistics, a separate loop
+ * records every sample, which is noticeably slower.
+ *
+ * @param ctx	pointer to an initialised compression context
+ * @param stats	pointer to the statistics to fill; NULL stops the collection
+ *
+ * @warning cmp_initialise() stops the collection; stats must remain valid
+ *	while it is set.
+ */
+
+void cmp_set_stats(struct cmp_context *ctx, struct cmp_stats *stats);
+
+
+/**
+ * @brief Counts the residuals of the compressed frames in a histogram
+ *
+ * Every cmp_compress_*() call adds its residuals, the values after
+ * preprocessing, to the histogram at the index of their ZigZag mapped value
+ * (0, -1, 1, -2, ...). The histogram is not cleared, so it sums up several
+ * frames. Like the statistics, the frames of the streaming functions are not
+ * covered and the samples are recorded in a separate, slower loop.
+ *
+ * @param ctx		pointer to an initialised compression context
+ * @param hist		pointer to the histogram to fill; NULL stops the
+ *			collection
+ * @param num_entries	number of entries of the histogram; must be
+ *			CMP_RESIDUAL_HIST_SIZE
+ *
+ * @warning cmp_initialise() stops the collection; hist must remain valid
+ *	while it is set.
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_set_residual_hist(struct cmp_context *ctx, uint32_t *hist, uint32_t num_entries);
+
+
+/**
+ * @brief Calculates the encoded size of residuals from their histogram
+ *
+ * Gives the number of bits the encoder with the given parameters needs for
+ * the residuals counted in a histogram collected with cmp_set_residual_hist(),
+ * without the header, the padding and the checksum of the
+ * frames. This way, the encoder parameters can be chosen for preprocessed data
+ * without compressing it again.
+ *
+ * @param residual_hist	histogram with CMP_RESIDUAL_HIST_SIZE entries
+ * @param encoder_type	encoder type
+ * @param encoder_param	encoder parameter
+ * @param outlier	outlier parameter needed for CMP_ENCODER_GOLOMB_MULTI
+ * @param bits		pointer to store the number of encoded bits
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_estimate_encoded_bits(const uint32_t *residual_hist,
+				   enum cmp_encoder_type encoder_type, uint32_t encoder_param,
+				   uint32_t outlier, uint64_t *bits);
+
+
+/**
+ * @brief Traces the stages of the compressed frames
+ *
+ * Every cmp_compress_*() call reports the time of each of its stages (see enum
+ * cmp_stage) to trace->stage_done(), measured with trace->clock(); a stage
+ * that is not needed, e.g., the checksum if disabled, is not reported. With
+ * the uncompressed fallback, the stages of both attempts are reported. The
+ * frames of the streaming functions (cmp_compress_begin() etc.) are not
+ * traced. The clock is only read between the stages, never per sample.
+ *
+ * @param ctx	pointer to an initialised compression context
+ * @param trace	pointer to the callbacks; NULL stops the tracing
+ *
+ * @warning cmp_initialise() stops the tracing; trace must remain valid while
+ *	it is set.
+ */
+
+void cmp_set_trace(struct cmp_context *ctx, const struct cmp_trace *trace);
+
+
 /**
  * @brief Compresses a signed 16-bit data buffer
  *
@@ -271,8 +520,8 @@ uint32_t cmp_initialise(struct cmp_context *ctx, const struct cmp_params *params
  * @param dst		the buffer to compress the src buffer into, MUST be
  *			8-byte aligned
  * @param dst_capacity	size of the dst buffer; may be any size, but
- *			cmp_compress_bound(src_size) is guaranteed to be large
- *			enough
+ *			cmp_compress_bound_params(params, src_size) is
+ *			guaranteed to be large enough
  * @param src		pointer to the data to compress
  * @param src_size	size of the data to compress, must be the same for every
  *			source buffer until the context is reset
@@ -310,6 +559,209 @@ uint32_t cmp_compress_u16(struct cmp_context *ctx, void *dst, uint32_t dst_capac
 			  const uint16_t *src, uint32_t src_size);
 
 
+/**
+ * @brief Compresses a signed 16-bit data buffer in big-endian byte order
+ *
+ * Same as cmp_compress_i16() but the samples are read in big-endian byte
+ * order, independent of the CPU, e.g., directly from a memory-mapped file.
+ * This way no byte swapping pass over the data is needed. The source data need
+ * no special alignment.
+ */
+
+uint32_t cmp_compress_i16_be(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+			     const void *src, uint32_t src_size);
+
+
+/**
+ * @brief Compresses an unsigned 16-bit data buffer in big-endian byte order
+ *
+ * Same as cmp_compress_i16_be() but for uint16_t data.
+ */
+
+uint32_t cmp_compress_u16_be(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+			     const void *src, uint32_t src_size);
+
+
+/**
+ * @brief Compresses a signed 16-bit data buffer that may be overwritten
+ *
+ * Same as cmp_compress_i16(), but if iwt_in_place_enabled is set and the IWT
+ * preprocessing is used, the IWT coefficients are calculated directly in the
+ * source buffer instead of the working buffer. This way no frame-sized working
+ * buffer is needed for the IWT (see cmp_cal_work_buf_size()).
+ *
+ * @param ctx		pointer to a compression context; must have been
+ *			initialised once with cmp_initialise()
+ * @param dst		the buffer to compress the src buffer into, MUST be
+ *			8-byte aligned
+ * @param dst_capacity	size of the dst buffer
+ * @param src		pointer to the data to compress; after a successful
+ *			IWT compression it contains the IWT coefficients, after
+ *			a failed compression the original data
+ * @param src_size	size of the data to compress, must be the same for every
+ *			source buffer until the context is reset
+ *
+ * @returns the compressed size or an error, which can be checked using
+ *	cmp_is_error()
+ */
+
+uint32_t cmp_compress_i16_in_place(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+				   int16_t *src, uint32_t src_size);
+
+
+/**
+ * @brief Compresses an unsigned 16-bit data buffer that may be overwritten
+ *
+ * Same as cmp_compress_i16_in_place() but for uint16_t data.
+ */
+
+uint32_t cmp_compress_u16_in_place(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+				   uint16_t *src, uint32_t src_size);
+
+
+/**
+ * @brief Compresses a signed 16-bit data buffer into an output sink
+ *
+ * Same as cmp_compress_i16() but the compressed data are handed chunk by
+ * chunk to an output sink, so the output memory needed is only the chunk
+ * buffer, regardless of the frame size.
+ *
+ * @param ctx		pointer to a compression context; must have been
+ *			initialised once with cmp_initialise()
+ * @param sink		pointer to an output sink description
+ * @param src		pointer to the data to compress
+ * @param src_size	size of the data to compress, must be the same for every
+ *			source buffer until the context is reset
+ *
+ * @note The uncompressed fallback can not be used with an output sink, as
+ *	chunks already handed over can not be taken back.
+ *
+ * @returns the compressed size (the total size of all chunks) or an error,
+ *	which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_compress_i16_to_sink(struct cmp_context *ctx, const struct cmp_sink *sink,
+				  const int16_t *src, uint32_t src_size);
+
+
+/**
+ * @brief Compresses 16-bit signed data packed in 32-bit words into an output sink
+ *
+ * Same as cmp_compress_i16_to_sink() but for int16_t data packed into
+ * int32_t words; see cmp_compress_i16_in_i32().
+ */
+
+uint32_t cmp_compress_i16_in_i32_to_sink(struct cmp_context *ctx, const struct cmp_sink *sink,
+					 const int32_t *src, uint32_t src_size);
+
+
+/**
+ * @brief Compresses an unsigned 16-bit data buffer into an output sink
+ *
+ * Same as cmp_compress_i16_to_sink() but for uint16_t data.
+ */
+
+uint32_t cmp_compress_u16_to_sink(struct cmp_context *ctx, const struct cmp_sink *sink,
+				  const uint16_t *src, uint32_t src_size);
+
+
+/**
+ * @brief Starts the streaming compression of a frame
+ *
+ * The data of the frame are then handed over piece by piece (e.g. row by row
+ * as they arrive from the detector) with cmp_compress_push_i16() or one of its
+ * variants and the frame is completed with cmp_compress_end(). The resulting
+ * frame is byte-identical to a single cmp_compress_i16() call over the
+ * concatenated data.
+ *
+ * NONE, DIFF and MODEL preprocessing are encoded as the data arrive. IWT
+ * preprocessing needs the whole frame, so the data are collected in the
+ * working buffer and encoded by cmp_compress_end().
+ *
+ * @param stream	pointer to a stream state to initialise
+ * @param ctx		pointer to a compression context; must have been
+ *			initialised once with cmp_initialise() and MUST NOT be
+ *			used otherwise until the frame is finished
+ * @param dst		the buffer to compress the frame into, MUST be 8-byte
+ *			aligned
+ * @param dst_capacity	size of the dst buffer;
+ *			cmp_compress_bound_params(params, packed_size) is
+ *			guaranteed to be large enough
+ * @param packed_size	packed size of the whole frame in bytes (the sum of
+ *			all pushed sizes, except for cmp_compress_push_i16_in_i32()
+ *			where it's half)
+ *
+ * @note The uncompressed fallback is not supported, as the data are not kept.
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_compress_begin(struct cmp_stream *stream, struct cmp_context *ctx, void *dst,
+			    uint32_t dst_capacity, uint32_t packed_size);
+
+
+/**
+ * @brief Starts the streaming compression of a frame into an output sink
+ *
+ * Same as cmp_compress_begin() but the compressed data are handed to an
+ * output sink; see cmp_compress_i16_to_sink(). The sink description has to
+ * stay valid until the frame is finished.
+ */
+
+uint32_t cmp_compress_begin_sink(struct cmp_stream *stream, struct cmp_context *ctx,
+				 const struct cmp_sink *sink, uint32_t packed_size);
+
+
+/**
+ * @brief Adds signed 16-bit data to a streamed frame
+ *
+ * All pieces of a frame must have the same data type. After an error the
+ * stream is aborted and has to be started again with cmp_compress_begin().
+ *
+ * @param stream	pointer to a stream started with cmp_compress_begin()
+ * @param src		pointer to the next piece of data
+ * @param src_size	size of the piece in bytes
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_compress_push_i16(struct cmp_stream *stream, const int16_t *src, uint32_t src_size);
+
+
+/**
+ * @brief Adds 16-bit signed data packed in 32-bit words to a streamed frame
+ *
+ * Same as cmp_compress_push_i16() but for int16_t data packed into int32_t
+ * words; see cmp_compress_i16_in_i32().
+ */
+
+uint32_t cmp_compress_push_i16_in_i32(struct cmp_stream *stream, const int32_t *src,
+				      uint32_t src_size);
+
+
+/**
+ * @brief Adds unsigned 16-bit data to a streamed frame
+ *
+ * Same as cmp_compress_push_i16() but for uint16_t data.
+ */
+
+uint32_t cmp_compress_push_u16(struct cmp_stream *stream, const uint16_t *src, uint32_t src_size);
+
+
+/**
+ * @brief Finishes a streamed frame
+ *
+ * All data announced with cmp_compress_begin() must have been pushed.
+ *
+ * @param stream	pointer to a stream started with cmp_compress_begin()
+ *
+ * @returns the compressed size or an error, which can be checked using
+ *	cmp_is_error()
+ */
+
+uint32_t cmp_compress_end(struct cmp_stream *stream);
+
+
 /**
  * @brief Resets the compression context
  *
@@ -328,6 +780,103 @@ uint32_t cmp_compress_u16(struct cmp_context *ctx, void *dst, uint32_t dst_capac
 uint32_t cmp_reset(struct cmp_context *ctx);
 
 
+/**
+ * @brief Starts a model frame chain from a reference frame
+ *
+ * Loads a caller-supplied reference frame, e.g., a dark or flat calibration
+ * frame, as the model of the MODEL preprocessing, so the chain starts without
+ * a primary frame: the next frames use the secondary parameters with sequence
+ * numbers 1 to secondary_iterations and carry reference_id as identifier and
+ * the preloaded model flag in their headers. A decoder needs the same reference, loaded with
+ * cmp_decompress_load_model_u16() and the identifier, to decompress them.
+ * When the chain ends, the next frame is a primary frame as after
+ * cmp_reset(); load the reference again to start the next chain warm.
+ *
+ * @param ctx			pointer to a compression context initialised
+ *				with secondary MODEL preprocessing
+ * @param reference		reference samples in host byte order; they are
+ *				copied into the working buffer
+ * @param reference_size	size of the reference in bytes; the frames of
+ *				the chain must have the same size
+ * @param reference_id		identifier of the reference; has to fit into
+ *				the 48-bit identifier field of the header
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_load_model_u16(struct cmp_context *ctx, const uint16_t *reference,
+			    uint32_t reference_size, uint64_t reference_id);
+
+
+/**
+ * @brief Same as cmp_load_model_u16() but for signed 16-bit samples
+ */
+
+uint32_t cmp_load_model_i16(struct cmp_context *ctx, const int16_t *reference,
+			    uint32_t reference_size, uint64_t reference_id);
+
+
+/** Size of a saved context state without the model in bytes */
+#define CMP_CONTEXT_STATE_HDR_SIZE 16
+
+
+/**
+ * @brief Gives the size needed to save the state of a compression context
+ *
+ * @param ctx	pointer to an initialised compression context
+ *
+ * @returns the maximum size of the state saved by cmp_context_save(), or an
+ *	error, which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_context_save_bound(const struct cmp_context *ctx);
+
+
+/**
+ * @brief Saves the state of a compression context
+ *
+ * The state is the position in the model frame chain, i.e., the identifier,
+ * the sequence number and the size of the frames, and the model of the MODEL
+ * preprocessing. It is serialised to a versioned big-endian blob, so that a
+ * restarted or a standby process can continue the chain with
+ * cmp_context_restore() instead of starting a new one with a primary frame.
+ * Save the state between frames; the parameters are not part of it.
+ *
+ * The model is stored uncompressed with its checksum, so neither saving nor
+ * restoring needs the decompressor or additional memory. To store it smaller,
+ * compress the saved state like any other data.
+ *
+ * @param ctx		pointer to an initialised compression context
+ * @param dst		buffer for the state
+ * @param dst_capacity	capacity of dst in bytes; at least
+ *			cmp_context_save_bound()
+ *
+ * @returns the size of the saved state in bytes, or an error, which can be
+ *	checked using cmp_is_error()
+ */
+
+uint32_t cmp_context_save(const struct cmp_context *ctx, void *dst, uint32_t dst_capacity);
+
+
+/**
+ * @brief Restores the state saved by cmp_context_save()
+ *
+ * The context has to be initialised with a working buffer large enough for
+ * the model; the next frame continues the saved chain. A state without a
+ * model can not continue a chain with MODEL preprocessing. The model is
+ * checked with its checksum.
+ *
+ * @param ctx		pointer to an initialised compression context
+ * @param src		saved state
+ * @param src_size	size of the saved state in bytes
+ *
+ * @returns an error code, which can be checked using cmp_is_error(); if
+ *	restoring the model failed, the context is reset
+ */
+
+uint32_t cmp_context_restore(struct cmp_context *ctx, const void *src, uint32_t src_size);
+
+
 /**
  * @brief Destroys a compression context
  *
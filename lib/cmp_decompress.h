@@ -0,0 +1,281 @@
+/**
+ * @file cmp_decompress.h
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Data Decompression API
+ *
+ * - Setup: Create a decompression context with cmp_decompress_initialise()
+ * - Process: Decompress frames using cmp_decompress_u16()
+ * - Reset: Forget the model of the previous frames with cmp_decompress_reset()
+ * - Clean-up: Optionally destroy context with cmp_decompress_deinitialise()
+ *
+ * Frames with CMP_PREPROCESS_MODEL preprocessing can only be decompressed if
+ * the frames before them, back to the last primary frame, were decompressed
+ * with the same context and in order. The model is kept in the working buffer
+ * of the context. A chain started from a reference frame with
+ * cmp_load_model_u16() needs the same reference loaded with
+ * cmp_decompress_load_model_u16() instead of its primary frame.
+ *
+ * @warning The interface is not frozen yet and may change in future versions.
+ */
+
+#ifndef CMP_DECOMPRESS_H
+#define CMP_DECOMPRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cmp.h"
+
+
+/**
+ * @brief Decompression context
+ *
+ * This structure maintains the state between decompressed frames, the model
+ * of the model preprocessing and the cached decoding table.
+ *
+ * @warning This structure MUST NOT be directly manipulated by external code.
+ *	Always use the provided API functions to interact with the decompression
+ *	context.
+ */
+
+struct cmp_decompress_context {
+	uint32_t magic;         /**< Magic number to prevent use of uninitialised contexts */
+	void *work_buf;         /**< Pointer to the working buffer holding the model */
+	uint32_t work_buf_size; /**< Size of the working buffer in bytes */
+	uint32_t model_size;    /**< Size of the model in bytes; 0 if no model is available */
+	uint64_t identifier;    /**< Identifier of the frames the model belongs to */
+	uint8_t sequence_number; /**< Sequence number of the last frame the model includes */
+	uint8_t model_preloaded; /**< Non-zero if the model started from a loaded reference */
+	uint32_t table_encoder[3]; /**< Encoder type, parameter and outlier of the table */
+	uint64_t table[4096];   /**< Lookup table of the Golomb decoder */
+};
+
+
+/* ======  Decompression Helper Functions   ====== */
+/**
+ * @brief Gets the size of the data a compressed frame decompresses to
+ *
+ * @param src		pointer to the start of a compressed frame
+ * @param src_size	number of readable bytes at src; at least the size of
+ *			the frame header
+ *
+ * @returns the original size in bytes, or an error, which can be checked using
+ *	cmp_is_error(); the size of int32_t samples decompressed with
+ *	cmp_decompress_i16_in_i32() is twice as large
+ */
+
+uint32_t cmp_get_original_size(const void *src, uint32_t src_size);
+
+
+/**
+ * @brief Gets the size of a compressed frame including header and checksum
+ *
+ * Useful to find the start of the next frame in a sequence of frames.
+ *
+ * @param src		pointer to the start of a compressed frame
+ * @param src_size	number of readable bytes at src; at least the size of
+ *			the frame header
+ *
+ * @returns the compressed size in bytes, or an error, which can be checked
+ *	using cmp_is_error()
+ */
+
+uint32_t cmp_get_compressed_size(const void *src, uint32_t src_size);
+
+
+/**
+ * @brief Metadata of a compressed frame as stored in its header
+ */
+
+struct cmp_frame_info {
+	size_t offset;            /**< position of the frame in the scanned data */
+	uint32_t compressed_size; /**< size of the frame including header and checksum */
+	uint32_t original_size;   /**< size of the decompressed data in bytes */
+	uint32_t header_size;     /**< size of the frame header in bytes */
+	uint64_t identifier;      /**< identifier of the model frame chain */
+	uint8_t sequence_number;  /**< position of the frame in its model frame chain */
+	enum cmp_preprocessing preprocessing;
+	enum cmp_encoder_type encoder_type;
+	uint32_t encoder_param;   /**< 0 for uncompressed frames */
+	uint32_t encoder_outlier; /**< 0 for uncompressed frames */
+	uint32_t model_rate;      /**< 0 for frames without model preprocessing */
+	int model_preloaded;      /**< non-zero if the model frame chain started with a loaded
+				   *   reference model instead of a primary frame
+				   */
+	int checksum_enabled;     /**< non-zero if the frame ends with a checksum */
+};
+
+
+/**
+ * @brief Reads and checks the header of a compressed frame
+ *
+ * Only the header is read; the compressed data are not checked.
+ *
+ * @param src		pointer to the start of a compressed frame
+ * @param src_size	number of readable bytes at src
+ * @param info		filled with the metadata of the frame; the offset is
+ *			set to 0
+ *
+ * @returns the compressed size of the frame, or an error, which can be
+ *	checked using cmp_is_error(); a frame larger than src_size is an error
+ */
+
+uint32_t cmp_get_frame_info(const void *src, uint32_t src_size, struct cmp_frame_info *info);
+
+
+/**
+ * @brief Iterator over a sequence of concatenated compressed frames
+ *
+ * The iterator jumps from header to header, so a sequence is scanned without
+ * decompressing it.
+ *
+ * @warning This structure MUST NOT be directly manipulated by external code.
+ */
+
+struct cmp_frame_iterator {
+	const uint8_t *src; /**< start of the frame sequence */
+	size_t src_size;    /**< size of the frame sequence in bytes */
+	size_t pos;         /**< position of the next frame */
+	uint32_t error;     /**< sticky error code */
+};
+
+
+/**
+ * @brief Initialises an iterator over a sequence of compressed frames
+ *
+ * @param it		pointer to the iterator to initialise
+ * @param src		start of the frame sequence
+ * @param src_size	size of the frame sequence in bytes
+ */
+
+void cmp_frame_iterator_init(struct cmp_frame_iterator *it, const void *src, size_t src_size);
+
+
+/**
+ * @brief Gets the metadata of the next frame of a sequence
+ *
+ * @param it	pointer to an initialised iterator
+ * @param info	filled with the metadata of the next frame
+ *
+ * @returns the compressed size of the frame, 0 after the last frame, or an
+ *	error, which can be checked using cmp_is_error(); after an error, the
+ *	iterator keeps returning the same error
+ */
+
+uint32_t cmp_frame_iterator_next(struct cmp_frame_iterator *it, struct cmp_frame_info *info);
+
+
+/* ======   Decompression Functions   ====== */
+/**
+ * @brief Initialises a decompression context
+ *
+ * @param dctx		pointer to a decompression context
+ * @param work_buf	pointer to a working buffer holding the model; can be
+ *			NULL if no frames with model preprocessing are
+ *			decompressed; has to be 2-byte aligned
+ * @param work_buf_size	size of the working buffer in bytes; at least the
+ *			original size of the frames using a model
+ *
+ * @returns an error, which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_decompress_initialise(struct cmp_decompress_context *dctx, void *work_buf,
+				   uint32_t work_buf_size);
+
+
+/**
+ * @brief Decompresses a frame into 16-bit signed samples
+ *
+ * @param dctx		pointer to an initialised decompression context
+ * @param dst		pointer to the destination buffer; has to be 2-byte
+ *			aligned
+ * @param dst_capacity	capacity of the destination buffer in bytes
+ * @param src		pointer to the compressed frame
+ * @param src_size	size of the source buffer in bytes; can be larger than
+ *			the frame
+ *
+ * @returns the number of bytes written into dst, or an error, which can be
+ *	checked using cmp_is_error()
+ */
+
+uint32_t cmp_decompress_i16(struct cmp_decompress_context *dctx, int16_t *dst,
+			    uint32_t dst_capacity, const void *src, uint32_t src_size);
+
+
+/**
+ * @brief Same as cmp_decompress_i16() but stores every sample sign-extended in
+ *	a 32-bit integer; dst has to be 4-byte aligned
+ */
+
+uint32_t cmp_decompress_i16_in_i32(struct cmp_decompress_context *dctx, int32_t *dst,
+				   uint32_t dst_capacity, const void *src, uint32_t src_size);
+
+
+/**
+ * @brief Same as cmp_decompress_i16() but for unsigned 16-bit samples
+ *
+ * @note The type of the samples matters for the model update; frames have to
+ *	be decompressed with the counterpart of the used compression function.
+ */
+
+uint32_t cmp_decompress_u16(struct cmp_decompress_context *dctx, uint16_t *dst,
+			    uint32_t dst_capacity, const void *src, uint32_t src_size);
+
+
+/**
+ * @brief Forgets the model of the previously decompressed frames
+ *
+ * @param dctx	pointer to an initialised decompression context
+ *
+ * @returns an error, which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_decompress_reset(struct cmp_decompress_context *dctx);
+
+
+/**
+ * @brief Loads the reference frame of a warm-started model frame chain
+ *
+ * Counterpart of cmp_load_model_u16(): the model frames with the identifier
+ * of the reference, the sequence numbers from 1 on and the preloaded model
+ * flag can be decompressed afterwards. Load the reference again for every chain started with it.
+ *
+ * @param dctx			pointer to an initialised decompression context
+ * @param reference		reference samples in host byte order
+ * @param reference_size	size of the reference in bytes; at most the size
+ *				of the working buffer
+ * @param reference_id		identifier of the reference used for the
+ *				compression
+ *
+ * @returns an error, which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_decompress_load_model_u16(struct cmp_decompress_context *dctx,
+				       const uint16_t *reference, uint32_t reference_size,
+				       uint64_t reference_id);
+
+
+/**
+ * @brief Same as cmp_decompress_load_model_u16() but for signed 16-bit samples
+ */
+
+uint32_t cmp_decompress_load_model_i16(struct cmp_decompress_context *dctx,
+				       const int16_t *reference, uint32_t reference_size,
+				       uint64_t reference_id);
+
+
+/**
+ * @brief Deinitialise a decompression context
+ *
+ * Clears the context structure. The working buffer is not freed.
+ *
+ * @param dctx	pointer to a decompression context
+ */
+
+void cmp_decompress_deinitialise(struct cmp_decompress_context *dctx);
+
+
+#endif /* CMP_DECOMPRESS_H */
@@ -35,6 +35,7 @@ enum cmp_error {
 	CMP_ERR_DST_TOO_SMALL = 30, /**< Destination buffer is too small */
 	CMP_ERR_DST_NULL = 31,      /**< Destination buffer pointer is NULL */
 	CMP_ERR_DST_UNALIGNED = 32, /**< Destination buffer not correct aligned */
+	CMP_ERR_DST_SINK_FAILED = 33, /**< Output sink reported an error */
 
 	CMP_ERR_SRC_SIZE_WRONG = 40,    /**< Source buffer size doesn't match expected size */
 	CMP_ERR_SRC_NULL = 41,          /**< Source buffer pointer is NULL */
@@ -46,12 +47,19 @@ enum cmp_error {
 
 	CMP_ERR_HDR_CMP_SIZE_TOO_LARGE = 60, /**< Compressed size exceeds header field limit */
 	CMP_ERR_HDR_ORIGINAL_TOO_LARGE = 61, /**< Original size exceeds header field limit */
+	CMP_ERR_HDR_VERSION_UNSUPPORTED = 62, /**< Frame was created by an incompatible version */
 
 	CMP_ERR_CONTEXT_INVALID = 70,   /**< Invalid compression context */
+	CMP_ERR_STREAM_INVALID = 71,    /**< Stream not started, already finished or misused */
+
+	CMP_ERR_FRAME_CORRUPTED = 80,   /**< Compressed frame is malformed */
+	CMP_ERR_CHECKSUM_MISMATCH = 81, /**< Decompressed data does not match the checksum */
+	CMP_ERR_MODEL_MISMATCH = 82,    /**< No matching model to decompress a model frame */
 
 	CMP_ERR_INT_HDR = 100,       /**< Internal header processing error */
 	CMP_ERR_INT_ENCODER = 101,   /**< Internal data encoder error */
 	CMP_ERR_INT_BITSTREAM = 102, /**< Internal bitstream error */
+	CMP_ERR_INT_DECODER = 103,   /**< Internal data decoder error */
 	/*
 	 * Limit marker - not an actual error code
 	 * Do not use this value directly. Prefer cmp_is_error() for error checking.
@@ -32,10 +32,11 @@
 #define CMP_HDR_BITS_IDENTIFIER      48
 #define CMP_HDR_BITS_SEQUENCE_NUMBER 8
 
-#define CMP_HDR_BITS_METHOD                                                         \
-	(CMP_HDR_BITS_METHOD_PREPROCESSING + CMP_HDR_BITS_METHOD_CHECKSUM_ENABLED + \
-	 CMP_HDR_BITS_METHOD_ENCODER_TYPE)
-#define CMP_HDR_BITS_METHOD_PREPROCESSING    4
+#define CMP_HDR_BITS_METHOD                                                        \
+	(CMP_HDR_BITS_METHOD_MODEL_PRELOADED + CMP_HDR_BITS_METHOD_PREPROCESSING + \
+	 CMP_HDR_BITS_METHOD_CHECKSUM_ENABLED + CMP_HDR_BITS_METHOD_ENCODER_TYPE)
+#define CMP_HDR_BITS_METHOD_MODEL_PRELOADED  1
+#define CMP_HDR_BITS_METHOD_PREPROCESSING    3
 #define CMP_HDR_BITS_METHOD_CHECKSUM_ENABLED 1
 #define CMP_HDR_BITS_METHOD_ENCODER_TYPE     3
 
@@ -51,6 +52,31 @@
 #define CMP_HDR_OFFSET_METHOD          15
 
 
+/*
+ * Flag of the model frame chains started with a loaded model; it takes the top
+ * bit of the former 4-bit preprocessing field, which no valid frame has set
+ */
+#define CMP_HDR_METHOD_MODEL_PRELOADED_FLAG                                                   \
+	(1U << (CMP_HDR_BITS_METHOD_PREPROCESSING + CMP_HDR_BITS_METHOD_CHECKSUM_ENABLED + \
+		CMP_HDR_BITS_METHOD_ENCODER_TYPE))
+
+
+/*
+ * Bit length of the extended header fields
+ */
+#define CMP_EXT_HDR_BITS_MODEL_RATE      8
+#define CMP_EXT_HDR_BITS_ENCODER_PARAM   16
+#define CMP_EXT_HDR_BITS_ENCODER_OUTLIER 24
+
+
+/*
+ * Byte offsets of the extended header fields
+ */
+#define CMP_EXT_HDR_OFFSET_MODEL_RATE    16
+#define CMP_EXT_HDR_OFFSET_ENCODER_PARAM 17
+#define CMP_EXT_HDR_OFFSET_OUTLIER_PARAM 19
+
+
 /** Size of the compression header in bytes */
 #define CMP_HDR_SIZE                                                                         \
 	((CMP_HDR_BITS_VERSION + CMP_HDR_BITS_COMPRESSED_SIZE + CMP_HDR_BITS_ORIGINAL_SIZE + \
@@ -58,6 +84,13 @@
 	 8)
 
 
+/** Size of the compression extension headers in bytes */
+#define CMP_EXT_HDR_SIZE                                                 \
+	((CMP_EXT_HDR_BITS_MODEL_RATE + CMP_EXT_HDR_BITS_ENCODER_PARAM + \
+	  CMP_EXT_HDR_BITS_ENCODER_OUTLIER) /                            \
+	 8)
+
+
 /** Size of the optional trailing checksum in byes */
 #define CMP_CHECKSUM_SIZE sizeof(uint32_t)
 
@@ -0,0 +1,198 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Big-Endian Bitstream Reader
+ *
+ * Counterpart of the bitstream writer. The reader keeps 64 bits of the
+ * bitstream in a local cache and only touches memory when refilled.
+ *
+ * Usage:
+ * - Initialize the bitstream reader:
+ *        bitstream_reader_init();
+ * - Make sure at least 57 unread bits are in the cache:
+ *        bitstream_refill();
+ * - Look at the next bits (MSB first) and consume them:
+ *        window = bitstream_peek();
+ *        bitstream_skip();
+ * - Check if more bits were consumed than the bitstream holds:
+ *        if (bitstream_overflowed()) ...
+ */
+
+#ifndef CMP_BITSTREAM_READER_H
+#define CMP_BITSTREAM_READER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "../common/byteorder.h"
+
+/** Minimum number of unread bits in the cache after bitstream_refill() */
+#define BITSTREAM_MIN_CACHE_BITS 57
+
+
+/**
+ * @brief This structure maintains the state of the bitstream reader
+ *
+ * @warning This structure MUST NOT be directly manipulated by external code.
+ *	Always use the provided API functions to interact with the structure.
+ */
+
+struct bitstream_reader {
+	uint64_t cache;             /**< The 64 bits starting at ptr, big-endian loaded */
+	unsigned int bits_consumed; /**< Number of already consumed bits in the cache */
+	const uint8_t *ptr;         /**< Bitstream position of the cache */
+	const uint8_t *start;       /**< Beginning of the bitstream */
+	const uint8_t *end;         /**< End of the bitstream */
+	int overflow;               /**< Set if read beyond the end of the bitstream */
+};
+
+
+/**
+ * @brief Refills the cache at the end of the bitstream
+ *
+ * @param br	pointer to an initialised bitstream_reader structure
+ */
+
+static __inline void bitstream_refill_slow(struct bitstream_reader *br)
+{
+	size_t const bytes = br->bits_consumed >> 3;
+	size_t const remaining = (size_t)(br->end - br->ptr);
+	size_t i;
+
+	if (bytes > remaining) {
+		br->overflow = 1;
+		br->ptr = br->end;
+		br->bits_consumed = 0;
+		br->cache = 0;
+		return;
+	}
+
+	br->ptr += bytes;
+	br->bits_consumed &= 7;
+	br->cache = 0;
+	for (i = 0; i < sizeof(br->cache); i++) {
+		br->cache <<= 8;
+		if (i < remaining - bytes)
+			br->cache |= br->ptr[i];
+	}
+}
+
+
+/**
+ * @brief Initializes a bitstream reader
+ *
+ * @param br	pointer to an already allocated bitstream_reader structure
+ * @param src	start address of the bitstream
+ * @param size	size of the bitstream in bytes
+ */
+
+static __inline void bitstream_reader_init(struct bitstream_reader *br, const void *src,
+					   size_t size)
+{
+	br->start = src;
+	br->ptr = src;
+	br->end = br->start + size;
+	br->cache = 0;
+	br->overflow = 0;
+	br->bits_consumed = 0;
+	bitstream_refill_slow(br);
+}
+
+
+/**
+ * @brief Reloads the cache, so that at least BITSTREAM_MIN_CACHE_BITS unread
+ *	bits are available
+ *
+ * Behind the end of the bitstream zeros are read, bitstream_overflowed()
+ * detects if they were consumed.
+ *
+ * @param br	pointer to an initialised bitstream_reader structure
+ */
+
+static __inline void bitstream_refill(struct bitstream_reader *br)
+{
+	size_t const bytes = br->bits_consumed >> 3;
+
+	if ((size_t)(br->end - br->ptr) >= bytes + sizeof(br->cache)) {
+		uint64_t value;
+
+		br->ptr += bytes;
+		br->bits_consumed &= 7;
+		memcpy(&value, br->ptr, sizeof(value));
+		br->cache = be64_to_cpu(value);
+		return;
+	}
+	bitstream_refill_slow(br);
+}
+
+
+/**
+ * @brief Gets the next unread bits of the cache, MSB aligned
+ *
+ * @param br	pointer to an initialised bitstream_reader structure
+ *
+ * @returns the cache shifted so that the next unread bit is the MSB; only the
+ *	upper 64 - bits_consumed bits are valid
+ */
+
+static __inline uint64_t bitstream_peek(const struct bitstream_reader *br)
+{
+	return br->cache << br->bits_consumed;
+}
+
+
+/**
+ * @brief Consumes bits of the cache
+ *
+ * @param br		pointer to an initialised bitstream_reader structure
+ * @param nb_bits	number of bits to consume; all of them have to be
+ *			in the cache
+ */
+
+static __inline void bitstream_skip(struct bitstream_reader *br, unsigned int nb_bits)
+{
+	br->bits_consumed += nb_bits;
+}
+
+
+/**
+ * @brief Reads up to 32 bits from the bitstream
+ *
+ * @param br		pointer to an initialised bitstream_reader structure
+ * @param nb_bits	number of bits to read in the range [1, 32]
+ *
+ * @returns the read bits
+ */
+
+static __inline uint32_t bitstream_read32(struct bitstream_reader *br, unsigned int nb_bits)
+{
+	uint32_t value;
+
+	bitstream_refill(br);
+	value = (uint32_t)(bitstream_peek(br) >> (64 - nb_bits));
+	bitstream_skip(br, nb_bits);
+	return value;
+}
+
+
+/**
+ * @brief Checks if more bits were consumed than the bitstream holds
+ *
+ * @param br	pointer to an initialised bitstream_reader structure
+ *
+ * @returns non-zero if the end of the bitstream was crossed
+ */
+
+static __inline int bitstream_overflowed(const struct bitstream_reader *br)
+{
+	if (br->overflow)
+		return 1;
+	return (size_t)(br->ptr - br->start) * 8 + br->bits_consumed >
+	       (size_t)(br->end - br->start) * 8;
+}
+
+#endif /* CMP_BITSTREAM_READER_H */
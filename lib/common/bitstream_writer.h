@@ -13,6 +13,12 @@
  *        error_code = bitstream_write();
  * - Flush remaining bits to the buffer:
  *        bytes_written = bitstream_flush();
+ *
+ * Alternatively, the writer can be initialised with an output sink using
+ * bitstream_writer_init_sink(). The buffer is then only used as a chunk buffer;
+ * every time it is full its content is handed to the sink and the writer
+ * starts again at the beginning of the buffer. The last partially filled chunk
+ * is handed over with bitstream_sink_finish().
  */
 
 #ifndef CMP_BITSTREAM_WRITER_H
@@ -28,6 +34,19 @@
 #define CMP_DST_ALIGNMENT sizeof(uint64_t)
 
 
+/**
+ * @brief Output sink function type
+ *
+ * @param chunk		pointer to the filled part of the chunk buffer
+ * @param chunk_size	number of bytes in the chunk
+ * @param opaque	pointer passed through from bitstream_writer_init_sink()
+ *
+ * @returns 0 on success, non-zero on failure
+ */
+
+typedef int (*bitstream_sink_func)(const void *chunk, uint32_t chunk_size, void *opaque);
+
+
 /**
  * @brief This structure maintains the state of the bitstream writer
  *
@@ -42,6 +61,9 @@ struct bitstream_writer {
 	uint8_t *ptr;         /**< Current write position */
 	uint8_t *end;         /**< End of the bitstream pointer */
 	uint32_t error;       /**< Sticky error code */
+	bitstream_sink_func sink; /**< Output sink; NULL if writing into a single buffer */
+	void *sink_opaque;        /**< Opaque pointer passed to the sink */
+	uint32_t sink_bytes;      /**< Bytes already handed to the sink */
 };
 
 
@@ -76,6 +98,60 @@ static __inline uint32_t bitstream_writer_init(struct bitstream_writer *bs, void
 }
 
 
+/**
+ * @brief Initializes a bitstream writer with an output sink
+ *
+ * @param bs		pointer to an already allocated bitstream_writer structure
+ * @param chunk_buf	start address of the chunk buffer; has to be 8-byte aligned
+ * @param size		capacity of the chunk buffer in bytes; only the largest
+ *			multiple of 8 is used; must be at least 8
+ * @param sink		function called with every full chunk
+ * @param opaque	pointer passed to the sink function
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+static __inline uint32_t bitstream_writer_init_sink(struct bitstream_writer *bs, void *chunk_buf,
+						    uint32_t size, bitstream_sink_func sink,
+						    void *opaque)
+{
+	uint32_t const error = bitstream_writer_init(bs, chunk_buf, size & ~(uint32_t)7);
+
+	if (cmp_is_error_int(error))
+		return error;
+	if (!sink)
+		return bs->error = CMP_ERROR(INT_BITSTREAM);
+	if (bs->end == bs->start)
+		return bs->error = CMP_ERROR(DST_TOO_SMALL);
+
+	bs->sink = sink;
+	bs->sink_opaque = opaque;
+	return error;
+}
+
+
+/**
+ * @brief Hands the written part of the chunk buffer to the output sink
+ *
+ * @param bs	pointer to a bitstream_writer initialised with a sink
+ * @param end	end of the data in the chunk buffer to hand over
+ */
+
+static __inline void bitstream_sink_chunk(struct bitstream_writer *bs, const uint8_t *end)
+{
+	uint32_t const size = (uint32_t)(end - bs->start);
+
+	if (size == 0)
+		return;
+	if (bs->sink(bs->start, size, bs->sink_opaque)) {
+		bs->error = CMP_ERROR(DST_SINK_FAILED);
+		return;
+	}
+	bs->sink_bytes += size;
+	bs->ptr = bs->start;
+}
+
+
 /**
  * @brief Stores a 64-bit integer as big-endian bytes
  *
@@ -144,6 +220,11 @@ static __inline void bitstream_add_bits32(struct bitstream_writer *bs, uint32_t
 	}
 
 	/* Slow path: need to flush cache */
+	if (bs->end - bs->ptr < 8 && bs->sink) {
+		bitstream_sink_chunk(bs, bs->ptr);
+		if (cmp_is_error_int(bs->error))
+			return;
+	}
 	if (bs->end - bs->ptr >= 8) {
 		bs->cache <<= bs->bit_cap;
 		bs->cache |= value >> (nb_bits - bs->bit_cap);
@@ -177,6 +258,78 @@ static __inline void bitstream_add_bits64(struct bitstream_writer *bs, uint64_t
 }
 
 
+/**
+ * @brief Starts writing raw bytes directly into the bitstream buffer
+ *
+ * Flushes the cached bits, which have to fill whole bytes, and returns the
+ * position at which the caller writes the raw bytes. The write is completed
+ * with bitstream_raw_end(). Not supported with an output sink.
+ *
+ * @param bs	pointer to an initialised bitstream_writer structure
+ * @param size	number of raw bytes the caller is going to write
+ *
+ * @returns the address to write the raw bytes to or NULL on error; the error
+ *	can be tested with bitstream_error()
+ */
+
+static __inline uint8_t *bitstream_raw_begin(struct bitstream_writer *bs, uint32_t size)
+{
+	unsigned int bytes;
+	uint8_t *cursor;
+
+	if (cmp_is_error_int(bitstream_error(bs)))
+		return NULL;
+	if (bs->sink || bs->bit_cap % 8 != 0) {
+		bs->error = CMP_ERROR(INT_BITSTREAM);
+		return NULL;
+	}
+
+	bytes = (64 - bs->bit_cap) / 8;
+	if ((size_t)(bs->end - bs->ptr) < (size_t)bytes + size) {
+		bs->error = CMP_ERROR(DST_TOO_SMALL);
+		return NULL;
+	}
+
+	cursor = bs->ptr;
+	if (bytes) {
+		uint64_t tmp = bs->cache << bs->bit_cap;
+
+		while (bytes--) {
+			*cursor++ = (uint8_t)(tmp >> (64 - 8));
+			tmp <<= 8;
+		}
+	}
+	return cursor;
+}
+
+
+/**
+ * @brief Completes writing raw bytes started with bitstream_raw_begin()
+ *
+ * The bytes after the last complete 64-bit word are loaded back into the
+ * cache, so further bits can be added as usual.
+ *
+ * @param bs	pointer to the bitstream_writer passed to bitstream_raw_begin()
+ * @param size	number of written raw bytes; same as passed to bitstream_raw_begin()
+ */
+
+static __inline void bitstream_raw_end(struct bitstream_writer *bs, uint32_t size)
+{
+	size_t const total = (64 - bs->bit_cap) / 8 + (size_t)size;
+	unsigned int const tail = (unsigned int)(total % 8);
+	unsigned int i;
+
+	if (cmp_is_error_int(bitstream_error(bs)))
+		return;
+
+	bs->ptr += total - tail;
+	bs->cache = 0;
+	for (i = 0; i < tail; i++)
+		bs->cache = bs->cache << 8 | bs->ptr[i];
+	bs->bit_cap = 64 - 8 * tail;
+}
+
+
 /**
  * @brief Pads the last byte with zeros if it's not completely filled
  *
@@ -210,8 +363,14 @@ static __inline uint32_t bitstream_flush(struct bitstream_writer *bs)
 	if (cmp_is_error_int(bitstream_error(bs)))
 		return bitstream_error(bs);
 
-	cursor = bs->ptr;
 	bytes = (64 - bs->bit_cap + 7) / 8;
+	if (bs->sink && (unsigned int)(bs->end - bs->ptr) < bytes) {
+		bitstream_sink_chunk(bs, bs->ptr);
+		if (cmp_is_error_int(bs->error))
+			return bs->error;
+	}
+
+	cursor = bs->ptr;
 	if (bytes) {
 		uint64_t tmp = bs->cache << bs->bit_cap;
 
@@ -223,7 +382,36 @@ static __inline uint32_t bitstream_flush(struct bitstream_writer *bs)
 		}
 	}
 
-	return (uint32_t)(cursor - bs->start);
+	return bs->sink_bytes + (uint32_t)(cursor - bs->start);
+}
+
+
+/**
+ * @brief Flushes all remaining bits and hands the last chunk to the sink
+ *
+ * @param bs	pointer to a bitstream_writer initialised with a sink
+ *
+ * @returns total bytes handed to the sink or an error code, which can be
+ *	checked using cmp_is_error()
+ */
+
+static __inline uint32_t bitstream_sink_finish(struct bitstream_writer *bs)
+{
+	uint32_t const size = bitstream_flush(bs);
+
+	if (cmp_is_error_int(size))
+		return size;
+	if (!bs->sink)
+		return bs->error = CMP_ERROR(INT_BITSTREAM);
+
+	bitstream_sink_chunk(bs, bs->start + (size - bs->sink_bytes));
+	if (cmp_is_error_int(bs->error))
+		return bs->error;
+
+	/* the writer is done, nothing is left in the cache */
+	bs->cache = 0;
+	bs->bit_cap = 64;
+	return size;
 }
 
 
@@ -241,14 +429,16 @@ static __inline uint32_t bitstream_size(const struct bitstream_writer *bs)
 	if (cmp_is_error_int(bitstream_error(bs)))
 		return bitstream_error(bs);
 
-	return (uint32_t)(bs->ptr - bs->start) + (64 - (uint32_t)bs->bit_cap + 7) / 8;
+	return bs->sink_bytes + (uint32_t)(bs->ptr - bs->start) +
+	       (64 - (uint32_t)bs->bit_cap + 7) / 8;
 }
 
 
 /**
  * @brief Reset the bitstream writer to the beginning of its buffer
  *
- * @param bs	pointer to the initialised bitstream_writer structure
+ * @param bs	pointer to the initialised bitstream_writer structure; a writer
+ *		with an output sink can not be rewound
  *
  * @returns an error code, which can be checked using cmp_is_error()
  */
@@ -259,6 +449,8 @@ static __inline uint32_t bitstream_rewind(struct bitstream_writer *bs)
 
 	if (cmp_is_error_int(ret))
 		return ret;
+	if (bs->sink)
+		return bs->error = CMP_ERROR(INT_BITSTREAM);
 
 	return bitstream_writer_init(bs, bs->start, (uint32_t)(bs->end - bs->start));
 }
@@ -0,0 +1,135 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Endianness conversion of whole arrays of 16-bit values
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "compiler.h"
+
+/*
+ * Without a compile-time SSSE3 target, x86 builds select the pshufb swap at
+ * run time; GCC 4.9 and clang allow SSSE3 intrinsics in functions with a
+ * target attribute.
+ */
+#if !defined(__SSSE3__) && (defined(__x86_64__) || defined(__i386__)) && \
+	(CMP_GNUC_PREREQ(4, 9) || defined(__clang__))
+#  define BSWAP_SSSE3_DISPATCH 1
+#endif
+
+#if defined(__SSSE3__) || defined(BSWAP_SSSE3_DISPATCH)
+#  include <tmmintrin.h>
+#endif
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  include <arm_neon.h>
+#  define BSWAP_NEON 1
+#endif
+
+#include "byteorder_bulk.h"
+
+#ifdef BSWAP_SSSE3_DISPATCH
+#  define TARGET_SSSE3 __attribute__((target("ssse3")))
+#else
+#  define TARGET_SSSE3
+#endif
+
+enum { BLOCK_SIZE = 16 /**< bytes swapped at once */ };
+
+
+#if defined(__SSSE3__) || defined(BSWAP_SSSE3_DISPATCH)
+/**
+ * @brief swaps the bytes of the 16-bit values of blocks of 16 bytes with pshufb
+ *
+ * @param dst		destination of the swapped blocks
+ * @param src		blocks to swap
+ * @param num_blocks	number of blocks to swap
+ */
+
+static TARGET_SSSE3 void bswap16_blocks_ssse3(uint8_t *dst, const uint8_t *src,
+					      size_t num_blocks)
+{
+	__m128i const shuffle = _mm_set_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+	size_t i;
+
+	for (i = 0; i < num_blocks; i++) {
+		const uint8_t *s = src + i * BLOCK_SIZE;
+		__m128i const v = _mm_loadu_si128((const __m128i *)(const void *)s);
+
+		_mm_storeu_si128((__m128i *)(void *)(dst + i * BLOCK_SIZE),
+				 _mm_shuffle_epi8(v, shuffle));
+	}
+}
+#endif
+
+
+#if !defined(__SSSE3__)
+/**
+ * @brief swaps the bytes of the 16-bit values of blocks of 16 bytes without
+ *	SSSE3
+ *
+ * @param dst		destination of the swapped blocks
+ * @param src		blocks to swap
+ * @param num_blocks	number of blocks to swap
+ */
+
+static void bswap16_blocks(uint8_t *dst, const uint8_t *src, size_t num_blocks)
+{
+	size_t i;
+
+	for (i = 0; i < num_blocks; i++) {
+		const uint8_t *s = src + i * BLOCK_SIZE;
+		uint8_t *d = dst + i * BLOCK_SIZE;
+#if defined(__SSE2__)
+		__m128i const v = _mm_loadu_si128((const __m128i *)(const void *)s);
+
+		_mm_storeu_si128((__m128i *)(void *)d,
+				 _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+#elif defined(BSWAP_NEON)
+		vst1q_u8(d, vrev16q_u8(vld1q_u8(s)));
+#else
+		uint64_t const mask = 0x00FF00FF00FF00FFULL;
+		uint64_t w[2];
+
+		memcpy(w, s, sizeof(w));
+		w[0] = (w[0] & mask) << 8 | ((w[0] >> 8) & mask);
+		w[1] = (w[1] & mask) << 8 | ((w[1] >> 8) & mask);
+		memcpy(d, w, sizeof(w));
+#endif
+	}
+}
+#endif
+
+
+void bswap16_bulk(void *dst, const void *src, size_t num_values)
+{
+	size_t const num_blocks = num_values * sizeof(uint16_t) / BLOCK_SIZE;
+	uint8_t *d = dst;
+	const uint8_t *s = src;
+	size_t i;
+
+	/* every block is loaded before it is stored, so dst may be src */
+#if defined(__SSSE3__)
+	bswap16_blocks_ssse3(d, s, num_blocks);
+#elif defined(BSWAP_SSSE3_DISPATCH)
+	if (__builtin_cpu_supports("ssse3"))
+		bswap16_blocks_ssse3(d, s, num_blocks);
+	else
+		bswap16_blocks(d, s, num_blocks);
+#else
+	bswap16_blocks(d, s, num_blocks);
+#endif
+
+	for (i = num_blocks * BLOCK_SIZE / sizeof(uint16_t); i < num_values; i++) {
+		uint8_t const hi = s[2 * i];
+
+		d[2 * i] = s[2 * i + 1];
+		d[2 * i + 1] = hi;
+	}
+}
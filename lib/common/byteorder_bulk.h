@@ -0,0 +1,69 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Endianness conversion of whole arrays of 16-bit values
+ *
+ * Same as the single value conversions of byteorder.h, but for many values at
+ * once. The swapping uses SIMD instructions where the compiler targets them
+ * (SSSE3 pshufb, SSE2 or NEON rev16) and a portable word-wise swap otherwise.
+ * On x86 the pshufb swap is also used without an SSSE3 target if the CPU
+ * supports it at run time.
+ */
+
+#ifndef BYTEORDER_BULK_H
+#define BYTEORDER_BULK_H
+
+#include <stddef.h>
+#include <string.h>
+
+#include "byteorder.h"
+
+
+/**
+ * @brief byteswaps an array of 16-bit values
+ *
+ * @param dst		destination of the swapped values; may be the same as
+ *			src, but must not overlap it otherwise
+ * @param src		values to swap; no alignment is needed
+ * @param num_values	number of 16-bit values to swap
+ */
+
+void bswap16_bulk(void *dst, const void *src, size_t num_values);
+
+
+/**
+ * @brief converts an array of big-endian 16-bit values to CPU byte order
+ *
+ * @param dst		destination of the converted values; may be the same as src
+ * @param src		big-endian values
+ * @param num_values	number of 16-bit values to convert
+ */
+
+static __inline void be16_to_cpu_bulk(void *dst, const void *src, size_t num_values)
+{
+#ifdef __LITTLE_ENDIAN
+	bswap16_bulk(dst, src, num_values);
+#else
+	if (dst != src)
+		memmove(dst, src, num_values * sizeof(uint16_t));
+#endif
+}
+
+
+/**
+ * @brief converts an array of 16-bit values in CPU byte order to big-endian
+ *
+ * @param dst		destination of the converted values; may be the same as src
+ * @param src		values in CPU byte order
+ * @param num_values	number of 16-bit values to convert
+ */
+
+static __inline void cpu_to_be16_bulk(void *dst, const void *src, size_t num_values)
+{
+	be16_to_cpu_bulk(dst, src, num_values);
+}
+
+#endif /* BYTEORDER_BULK_H */
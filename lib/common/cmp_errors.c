@@ -46,6 +46,8 @@ const char *cmp_get_error_string(enum cmp_error code)
 		return "Destination buffer pointer is NULL";
 	case CMP_ERR_DST_UNALIGNED:
 		return "Destination buffer pointer is unaligned";
+	case CMP_ERR_DST_SINK_FAILED:
+		return "Output sink reported an error";
 
 	case CMP_ERR_SRC_SIZE_WRONG:
 		return "Source buffer size is invalid";
@@ -65,9 +67,20 @@ const char *cmp_get_error_string(enum cmp_error code)
 		return "Compressed size exceeds header field limit";
 	case CMP_ERR_HDR_ORIGINAL_TOO_LARGE:
 		return "Original size exceeds header field limit";
+	case CMP_ERR_HDR_VERSION_UNSUPPORTED:
+		return "Compressed frame was created by an unsupported version";
 
 	case CMP_ERR_CONTEXT_INVALID:
 		return "Compression context uninitialised or corrupted";
+	case CMP_ERR_STREAM_INVALID:
+		return "Streaming state not started, already finished or misused";
+
+	case CMP_ERR_FRAME_CORRUPTED:
+		return "Compressed frame is corrupted";
+	case CMP_ERR_CHECKSUM_MISMATCH:
+		return "Checksum of the decompressed data does not match";
+	case CMP_ERR_MODEL_MISMATCH:
+		return "No matching model available to decompress the frame";
 
 	case CMP_ERR_INT_HDR:
 		return "Internal header processing error";
@@ -75,6 +88,8 @@ const char *cmp_get_error_string(enum cmp_error code)
 		return "Internal data encoder error";
 	case CMP_ERR_INT_BITSTREAM:
 		return "Internal bitstream writer error";
+	case CMP_ERR_INT_DECODER:
+		return "Internal data decoder error";
 
 	case CMP_ERR_MAX_CODE:
 	default:
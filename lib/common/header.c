@@ -15,6 +15,7 @@
 #include "err_private.h"
 #include "sample_reader.h"
 #include "bitstream_writer.h"
+#include "compiler.h"
 
 #define XXH_INLINE_ALL
 #define XXH_STATIC_LINKING_ONLY
@@ -48,13 +49,14 @@ uint32_t cmp_hdr_serialize(struct bitstream_writer *bs, const struct cmp_hdr *hd
 	bitstream_add_bits64(bs, hdr->sequence_number, CMP_HDR_BITS_SEQUENCE_NUMBER);
 
 	/* internal structure of the compression method */
+	bitstream_add_bits64(bs, hdr->model_preloaded, CMP_HDR_BITS_METHOD_MODEL_PRELOADED);
 	bitstream_add_bits64(bs, hdr->preprocessing, CMP_HDR_BITS_METHOD_PREPROCESSING);
 	bitstream_add_bits64(bs, hdr->checksum_enabled, CMP_HDR_BITS_METHOD_CHECKSUM_ENABLED);
 	bitstream_add_bits64(bs, hdr->encoder_type, CMP_HDR_BITS_METHOD_ENCODER_TYPE);
 
 	if (hdr->preprocessing != CMP_PREPROCESS_NONE ||
 	    hdr->encoder_type != CMP_ENCODER_UNCOMPRESSED) {
-		bitstream_add_bits64(bs, hdr->model_rate, CMP_EXT_HDR_BITS_MODEL_ADAPTATION);
+		bitstream_add_bits64(bs, hdr->model_rate, CMP_EXT_HDR_BITS_MODEL_RATE);
 		bitstream_add_bits64(bs, hdr->encoder_param, CMP_EXT_HDR_BITS_ENCODER_PARAM);
 		bitstream_add_bits64(bs, hdr->encoder_outlier, CMP_EXT_HDR_BITS_ENCODER_OUTLIER);
 	}
@@ -112,7 +114,8 @@ uint32_t cmp_hdr_deserialize(const void *src, uint32_t src_size, struct cmp_hdr
 	hdr->sequence_number = start[CMP_HDR_OFFSET_SEQUENCE_NUMBER];
 
 	method = start[CMP_HDR_OFFSET_METHOD];
-	hdr->preprocessing = (method >> 4) & 0XF;
+	hdr->model_preloaded = (method >> 7) & 0x1;
+	hdr->preprocessing = (method >> 4) & 0x7;
 	hdr->checksum_enabled = (method >> 3) & 0x1;
 	hdr->encoder_type = method & 0x7;
 
@@ -134,30 +137,94 @@ uint32_t cmp_hdr_deserialize(const void *src, uint32_t src_size, struct cmp_hdr
 }
 
 
+/**
+ * @brief Checks if the sample data can be hashed as they are
+ *
+ * The checksum is calculated over the big-endian samples, which are the raw
+ * bytes of big-endian samples and of 16-bit samples on a big-endian CPU.
+ *
+ * @param desc	pointer to the sample descriptor
+ *
+ * @return non-zero if no byte swapping is needed
+ */
+
+static int checksum_is_raw(const struct sample_desc *desc)
+{
+	if (sample_type_is_be(desc->type))
+		return 1;
+	return !XXH_CPU_LITTLE_ENDIAN && (desc->type == CMP_I16 || desc->type == CMP_U16);
+}
+
+
 uint32_t cmp_checksum(const struct sample_desc *desc)
 {
-	uint32_t i;
-	XXH32_state_t state;
+	struct cmp_checksum_state state;
 
 	/*
-	 * Fast path: on big-endian systems with contiguous data, we can hash
-	 * directly without byte swapping.
+	 * Fast path: contiguous big-endian data, we can hash directly without
+	 * byte swapping.
 	 */
-	if (!XXH_CPU_LITTLE_ENDIAN && (desc->type == CMP_I16 || desc->type == CMP_U16))
+	if (checksum_is_raw(desc))
 		return XXH32(desc->data, desc->num_samples * sizeof(uint16_t), CHECKSUM_SEED);
 
 	/*
-	 * Slow path: convert each sample to big-endian for consistent checksums
+	 * Slow path: convert the samples to big-endian for consistent checksums
 	 * across architectures.
 	 */
-	(void)XXH32_reset(&state, CHECKSUM_SEED);
-	for (i = 0; i < desc->num_samples; i++) {
-		uint16_t value = (uint16_t)sample_read_i16(desc, i);
+	cmp_checksum_reset(&state);
+	cmp_checksum_update(&state, desc);
+	return cmp_checksum_digest(&state);
+}
+
+
+void cmp_checksum_reset(struct cmp_checksum_state *state)
+{
+	XXH32_state_t xxh_state;
+
+	compile_time_assert(sizeof(xxh_state) <= sizeof(*state), checksum_state_too_small);
+
+	(void)XXH32_reset(&xxh_state, CHECKSUM_SEED);
+	memcpy(state, &xxh_state, sizeof(xxh_state));
+}
 
-		if (XXH_CPU_LITTLE_ENDIAN)
-			value = __builtin_bswap16(value);
 
-		(void)XXH32_update(&state, &value, sizeof(value));
+void cmp_checksum_update(struct cmp_checksum_state *state, const struct sample_desc *desc)
+{
+	XXH32_state_t xxh_state;
+	uint16_t buf[64];
+	uint32_t i, n;
+
+	memcpy(&xxh_state, state, sizeof(xxh_state));
+
+	if (checksum_is_raw(desc)) {
+		(void)XXH32_update(&xxh_state, desc->data, desc->num_samples * sizeof(uint16_t));
+	} else {
+		/* convert the samples to big-endian in small batches */
+		for (i = 0; i < desc->num_samples; i += n) {
+			uint32_t j;
+
+			n = desc->num_samples - i;
+			if (n > ARRAY_SIZE(buf))
+				n = ARRAY_SIZE(buf);
+			for (j = 0; j < n; j++) {
+				uint16_t value = (uint16_t)sample_read_i16(desc, i + j);
+
+				if (XXH_CPU_LITTLE_ENDIAN)
+					value = __builtin_bswap16(value);
+				buf[j] = value;
+			}
+			(void)XXH32_update(&xxh_state, buf, n * sizeof(buf[0]));
+		}
 	}
-	return XXH32_digest(&state);
+
+	memcpy(state, &xxh_state, sizeof(xxh_state));
+}
+
+
+uint32_t cmp_checksum_digest(const struct cmp_checksum_state *state)
+{
+	XXH32_state_t xxh_state;
+
+	memcpy(&xxh_state, state, sizeof(xxh_state));
+	return XXH32_digest(&xxh_state);
 }
@@ -19,25 +19,6 @@
 #include "../cmp_header.h"
 
 
-/* Bit length of the different extended header fields */
-#define CMP_EXT_HDR_BITS_MODEL_ADAPTATION 8
-#define CMP_EXT_HDR_BITS_ENCODER_PARAM    16
-#define CMP_EXT_HDR_BITS_ENCODER_OUTLIER  24
-
-
-/* Extended header offsets */
-#define CMP_EXT_HDR_OFFSET_MODEL_RATE    16
-#define CMP_EXT_HDR_OFFSET_ENCODER_PARAM 17
-#define CMP_EXT_HDR_OFFSET_OUTLIER_PARAM 19
-
-
-/** Size of the compression extension headers in bytes TBC */
-#define CMP_EXT_HDR_SIZE                                                       \
-	((CMP_EXT_HDR_BITS_MODEL_ADAPTATION + CMP_EXT_HDR_BITS_ENCODER_PARAM + \
-	  CMP_EXT_HDR_BITS_ENCODER_OUTLIER) /                                  \
-	 8)
-
-
 /** Size of the basic compression plus the extension headers in bytes TBC */
 #define CMP_HDR_MAX_SIZE (CMP_HDR_SIZE + CMP_EXT_HDR_SIZE)
 
@@ -65,6 +46,7 @@ struct cmp_hdr {
 	uint8_t sequence_number;
 
 	/* Compression method */
+	uint8_t model_preloaded;
 	enum cmp_preprocessing preprocessing;
 	uint8_t checksum_enabled;
 	enum cmp_encoder_type encoder_type;
@@ -113,4 +95,48 @@ uint32_t cmp_hdr_deserialize(const void *src, uint32_t src_size, struct cmp_hdr
 
 uint32_t cmp_checksum(const struct sample_desc *desc);
 
+
+/**
+ * @brief State of an incremental checksum calculation
+ *
+ * @note the content is private to the checksum implementation
+ */
+
+struct cmp_checksum_state {
+	uint32_t opaque[12]; /**< large enough to hold the xxHash state */
+};
+
+
+/**
+ * @brief Starts an incremental checksum calculation
+ *
+ * @param state	pointer to the checksum state to initialise
+ */
+
+void cmp_checksum_reset(struct cmp_checksum_state *state);
+
+
+/**
+ * @brief Adds samples to an incremental checksum calculation
+ *
+ * Feeding the data in several parts results in the same checksum as a single
+ * cmp_checksum() call over the concatenated samples.
+ *
+ * @param state	pointer to an initialised checksum state
+ * @param desc	pointer to the sample descriptor of the samples to add
+ */
+
+void cmp_checksum_update(struct cmp_checksum_state *state, const struct sample_desc *desc);
+
+
+/**
+ * @brief Returns the checksum of all samples added so far
+ *
+ * @param state	pointer to an initialised checksum state
+ *
+ * @returns a 32-bit checksum of the data
+ */
+
+uint32_t cmp_checksum_digest(const struct cmp_checksum_state *state);
+
 #endif /* CMP_HEADER_PRIVATE_H */
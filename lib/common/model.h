@@ -0,0 +1,73 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Model update shared by the compressor and the decompressor
+ */
+
+#ifndef CMP_MODEL_H
+#define CMP_MODEL_H
+
+#include <stdint.h>
+
+#include "sample_reader.h"
+#include "compiler.h"
+
+
+/** Maximum allowed model adaptation rate parameter  */
+#define CMP_MAX_MODEL_RATE 16
+
+
+/**
+ * @brief Updates the model value based on new data and adaptation rate
+ *
+ * @param data		new data value to incorporate into the model
+ * @param model		current model value
+ * @param model_rate	model adaptation rate; higher values make the model adapt
+ *			more slowly to new data; must be less than or equal to
+ *			CMP_MAX_MODEL_RATE
+ * @returns the updated model value
+ */
+
+static __inline int16_t update_model_16(int32_t data, int32_t model, int model_rate)
+{
+#define MODEL_SHIFT_BITS 4
+	compile_time_assert(CMP_MAX_MODEL_RATE == 1 << MODEL_SHIFT_BITS,
+			    _CMP_MAX_MODEL_RATE_MODEL_SHIFT_BITS_mismatch);
+	int32_t const weighted_data = data * (CMP_MAX_MODEL_RATE - model_rate);
+	int32_t const weighted_model = model * model_rate;
+
+	return (int16_t)((weighted_model + weighted_data) >> MODEL_SHIFT_BITS);
+}
+
+
+/**
+ * @brief Updates the model value of a sample of the given data type
+ *
+ * @param data		new sample value to incorporate into the model
+ * @param model		current model value
+ * @param model_rate	model adaptation rate, see update_model_16()
+ * @param dtype		data type of the sample; unsigned samples are weighted
+ *			as unsigned values
+ *
+ * @returns the updated model value
+ */
+
+static __inline int16_t update_model(int16_t data, int16_t model, int model_rate,
+				     enum cmp_type dtype)
+{
+	switch (dtype) {
+	case CMP_I16:
+	case CMP_I16_IN_I32:
+	case CMP_I16_BE:
+		return update_model_16(data, model, model_rate);
+	case CMP_U16:
+	case CMP_U16_BE:
+	default:
+		return update_model_16((uint16_t)data, (uint16_t)model, model_rate);
+	}
+}
+
+#endif /* CMP_MODEL_H */
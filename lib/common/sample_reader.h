@@ -6,7 +6,12 @@
 
 #include "../common/err_private.h"
 
-enum cmp_type { CMP_I16 = 0, CMP_I16_IN_I32, CMP_U16 };
+/**
+ * @brief types of the samples to compress; the _BE types are stored in
+ *	big-endian byte order, independent of the CPU
+ */
+
+enum cmp_type { CMP_I16 = 0, CMP_I16_IN_I32, CMP_U16, CMP_I16_BE, CMP_U16_BE };
 
 struct sample_desc {
 	const void *data;
@@ -30,6 +35,8 @@ static __inline uint32_t sample_read_src_init(struct sample_desc *src_desc, cons
 	switch (src_type) {
 	case CMP_I16:
 	case CMP_U16:
+	case CMP_I16_BE:
+	case CMP_U16_BE:
 		stride = sizeof(int16_t);
 		break;
 	case CMP_I16_IN_I32:
@@ -51,6 +58,20 @@ static __inline uint32_t sample_read_src_init(struct sample_desc *src_desc, cons
 }
 
 
+/**
+ * @brief Checks if samples are stored in big-endian byte order
+ *
+ * @param type	sample type
+ *
+ * @return non-zero for big-endian samples
+ */
+
+static __inline int sample_type_is_be(enum cmp_type type)
+{
+	return type == CMP_I16_BE || type == CMP_U16_BE;
+}
+
+
 /**
  * @brief Reads a 16-bit signed integer from the sample data
  *
@@ -68,6 +89,13 @@ static __inline int16_t sample_read_i16(const struct sample_desc *desc, uint32_t
 	if (desc->stride == sizeof(int32_t))
 		return (int16_t)(*(const uint32_t *)addr & 0xFFFFU);
 
+	/* byte by byte, so the samples need no alignment */
+	if (sample_type_is_be(desc->type)) {
+		const uint8_t *b = addr;
+
+		return (int16_t)(uint16_t)((unsigned int)b[0] << 8 | b[1]);
+	}
+
 	return *(const int16_t *)addr;
 }
 
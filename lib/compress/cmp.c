@@ -16,12 +16,28 @@
 #include "../common/sample_reader.h"
 #include "../common/err_private.h"
 #include "../common/bitstream_writer.h"
+#include "../common/byteorder_bulk.h"
 #include "../common/header_private.h"
+#include "../common/model.h"
 #include "../common/bithacks.h"
 #include "../common/compiler.h"
 
 #define CMP_MAGIC 34021395 /* arbitrary magic number I like */
 
+#define CMP_STATE_MAGIC 0x41435458U /* "ACTX" */
+#define CMP_STATE_VERSION 1
+
+/* Flags of a saved context state */
+#define CMP_STATE_MODEL_PRESENT 0x01U
+#define CMP_STATE_MODEL_PRELOADED 0x02U
+
+/* Byte offsets of the fields of a saved context state */
+#define CMP_STATE_OFFSET_VERSION         4
+#define CMP_STATE_OFFSET_FLAGS           5
+#define CMP_STATE_OFFSET_IDENTIFIER      6
+#define CMP_STATE_OFFSET_SEQUENCE_NUMBER 12
+#define CMP_STATE_OFFSET_MODEL_SIZE      13
+
 
 /* Fallback monotonic counter implementation for g_get_timestamp() */
 static void fallback_get_timestamp(uint32_t *coarse, uint16_t *fine)
@@ -74,6 +90,104 @@ uint32_t cmp_compress_bound(uint32_t packed_size)
 }
 
 
+/**
+ * @brief Calculates the worst-case compressed size for a single compression pass
+ *
+ * @param preprocessing		preprocessing used in the pass
+ * @param encoder_type		encoder used in the pass
+ * @param encoder_param		encoder parameter used in the pass
+ * @param outlier		outlier parameter used in the pass
+ * @param packed_size		packed size of the data in bytes
+ * @param checksum_enabled	non-zero if a checksum is appended
+ *
+ * @returns the compressed size in the worst-case scenario or an error, which
+ *	can be checked using cmp_is_error()
+ */
+
+static uint32_t pass_bound(enum cmp_preprocessing preprocessing, enum cmp_encoder_type encoder_type,
+			   uint32_t encoder_param, uint32_t outlier, uint32_t packed_size,
+			   int checksum_enabled)
+{
+	struct cmp_encoder enc;
+	uint64_t n_samples, bound;
+	uint32_t ret;
+
+	ret = cmp_encoder_init(&enc, encoder_type, encoder_param, outlier);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	n_samples = DIV_ROUND_UP((uint64_t)packed_size * 8, CMP_NUM_BITS_PER_SAMPLE);
+	bound = DIV_ROUND_UP(n_samples * cmp_encoder_max_bits_per_sample(&enc), 8);
+
+	if (preprocessing == CMP_PREPROCESS_NONE && encoder_type == CMP_ENCODER_UNCOMPRESSED)
+		bound += CMP_HDR_SIZE;
+	else
+		bound += CMP_HDR_MAX_SIZE;
+
+	if (checksum_enabled)
+		bound += CMP_CHECKSUM_SIZE;
+
+	if (bound > CMP_HDR_MAX_COMPRESSED_SIZE)
+		return CMP_ERROR(HDR_CMP_SIZE_TOO_LARGE);
+
+	return (uint32_t)bound;
+}
+
+
+uint32_t cmp_compress_bound_params(const struct cmp_params *params, uint32_t packed_size)
+{
+	uint32_t bound, secondary_bound;
+
+	if (params == NULL)
+		return CMP_ERROR(GENERIC);
+
+	if (packed_size > CMP_HDR_MAX_ORIGINAL_SIZE)
+		return CMP_ERROR(HDR_ORIGINAL_TOO_LARGE);
+
+	bound = pass_bound(params->primary_preprocessing, params->primary_encoder_type,
+			   params->primary_encoder_param, params->primary_encoder_outlier,
+			   packed_size, params->checksum_enabled);
+	if (cmp_is_error_int(bound) && !params->uncompressed_fallback_enabled)
+		return bound;
+
+	if (params->secondary_iterations) {
+		secondary_bound = pass_bound(params->secondary_preprocessing,
+					     params->secondary_encoder_type,
+					     params->secondary_encoder_param,
+					     params->secondary_encoder_outlier, packed_size,
+					     params->checksum_enabled);
+		if (cmp_is_error_int(secondary_bound) && !params->uncompressed_fallback_enabled)
+			return secondary_bound;
+		/* errors are larger than every valid bound */
+		bound = max_u32(bound, secondary_bound);
+	}
+
+	/*
+	 * The uncompressed fallback guarantees that a frame never gets larger
+	 * than the uncompressed size.
+	 */
+	if (params->uncompressed_fallback_enabled) {
+		uint32_t uncompressed_bound = CMP_HDR_SIZE + packed_size;
+
+		if (params->checksum_enabled)
+			uncompressed_bound += CMP_CHECKSUM_SIZE;
+		if (uncompressed_bound > CMP_HDR_MAX_COMPRESSED_SIZE)
+			return CMP_ERROR(HDR_CMP_SIZE_TOO_LARGE);
+
+		bound = min_u32(bound, uncompressed_bound);
+	}
+
+	return bound;
+}
+
+
+static int model_is_needed(const struct cmp_params *params)
+{
+	return params->secondary_preprocessing == CMP_PREPROCESS_MODEL &&
+	       params->secondary_iterations != 0;
+}
+
+
 uint32_t cmp_cal_work_buf_size(const struct cmp_params *params, uint32_t src_size)
 {
 	const struct preprocessing_method *preprocess;
@@ -89,12 +203,18 @@ uint32_t cmp_cal_work_buf_size(const struct cmp_params *params, uint32_t src_siz
 	if (preprocess == NULL)
 		return CMP_ERROR(PARAMS_INVALID);
 	primary_work_buf_size = preprocess->get_work_buf_size(src_size);
+	/* in-place, the IWT coefficients are calculated in the source buffer */
+	if (params->iwt_in_place_enabled && params->primary_preprocessing == CMP_PREPROCESS_IWT)
+		primary_work_buf_size = 0;
 
 	if (params->secondary_iterations) {
 		preprocess = preprocessing_get_method(params->secondary_preprocessing);
 		if (preprocess == NULL)
 			return CMP_ERROR(PARAMS_INVALID);
 		secondary_work_buf_size = preprocess->get_work_buf_size(src_size);
+		if (params->iwt_in_place_enabled &&
+		    params->secondary_preprocessing == CMP_PREPROCESS_IWT)
+			secondary_work_buf_size = 0;
 	} else {
 		secondary_work_buf_size = 0;
 	}
@@ -103,52 +223,6 @@ uint32_t cmp_cal_work_buf_size(const struct cmp_params *params, uint32_t src_siz
 }
 
 
-/** Maximum allowed model adaptation rate parameter  */
-#define CMP_MAX_MODEL_RATE 16
-
-/**
- * @brief Updates the model value based on new data and adaptation rate
- *
- * @param data		new data value to incorporate into the model
- * @param model		current model value
- * @param model_rate	model adaptation rate; higher values make the model adapt
- *			more slowly to new data; must be less than or equal to
- *			CMP_MAX_MODEL_RATE
- * @returns the updated model value
- */
-
-static int16_t update_model_16(int32_t data, int32_t model, int model_rate)
-{
-#define MODEL_SHIFT_BITS 4
-	compile_time_assert(CMP_MAX_MODEL_RATE == 1 << MODEL_SHIFT_BITS,
-			    _CMP_MAX_MODEL_RATE_MODEL_SHIFT_BITS_mismatch);
-	int32_t const weighted_data = data * (CMP_MAX_MODEL_RATE - model_rate);
-	int32_t const weighted_model = model * model_rate;
-
-	return (int16_t)((weighted_model + weighted_data) >> MODEL_SHIFT_BITS);
-}
-
-
-static int16_t update_model(int16_t data, int16_t model, int model_rate, enum cmp_type dtype)
-{
-	switch (dtype) {
-	case CMP_I16:
-	case CMP_I16_IN_I32:
-		return update_model_16(data, model, model_rate);
-	case CMP_U16:
-	default:
-		return update_model_16((uint16_t)data, (uint16_t)model, model_rate);
-	}
-}
-
-
-static int model_is_needed(const struct cmp_params *params)
-{
-	return params->secondary_preprocessing == CMP_PREPROCESS_MODEL &&
-	       params->secondary_iterations != 0;
-}
-
-
 uint32_t cmp_initialise(struct cmp_context *ctx, const struct cmp_params *params, void *work_buf,
 			uint32_t work_buf_size)
 {
@@ -209,21 +283,33 @@ uint32_t cmp_initialise(struct cmp_context *ctx, const struct cmp_params *params
 }
 
 
-/* Main compression loop */
-static uint32_t compress_engine(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
-				const struct sample_desc *src_desc)
+/**
+ * @brief Starts a new frame
+ *
+ * Selects the compression pass, initialises the encoder and writes the header
+ * with a compressed size place holder into the bitstream.
+ *
+ * @param ctx		pointer to a compression context
+ * @param bs		pointer to an initialised bitstream writer
+ * @param hdr		pointer to a header structure filled with the header of
+ *			the frame
+ * @param enc		pointer to the encoder to initialise
+ * @param model		filled with a pointer to the model, or NULL if no model
+ *			is needed
+ * @param packed_size	packed size of the data to compress in bytes
+ *
+ * @returns an error, which can be checked using cmp_is_error()
+ */
+
+static uint32_t frame_begin(struct cmp_context *ctx, struct bitstream_writer *bs,
+			    struct cmp_hdr *hdr, struct cmp_encoder *enc, int16_t **model,
+			    uint32_t packed_size)
 {
-	uint32_t i, ret, n_values;
+	uint32_t ret;
 	enum cmp_preprocessing selected_preprocessing;
 	enum cmp_encoder_type selected_encoder_type;
 	uint32_t selected_encoder_param;
 	uint32_t selected_outlier;
-	struct bitstream_writer bs;
-	struct cmp_encoder enc;
-	const struct preprocessing_method *preprocess;
-	int16_t *model = NULL;
-	struct cmp_hdr hdr = { 0 };
-	uint32_t compress_bound;
 
 	if (ctx->sequence_number == 0 || ctx->sequence_number > ctx->params.secondary_iterations) {
 		ret = cmp_reset(ctx);
@@ -233,7 +319,7 @@ static uint32_t compress_engine(struct cmp_context *ctx, void *dst, uint32_t dst
 		selected_encoder_type = ctx->params.primary_encoder_type;
 		selected_encoder_param = ctx->params.primary_encoder_param;
 		selected_outlier = ctx->params.primary_encoder_outlier;
-		ctx->model_size = get_packed_size(src_desc);
+		ctx->model_size = packed_size;
 	} else {
 		selected_preprocessing = ctx->params.secondary_preprocessing;
 		selected_encoder_type = ctx->params.secondary_encoder_type;
@@ -243,223 +329,1380 @@ static uint32_t compress_engine(struct cmp_context *ctx, void *dst, uint32_t dst
 		 * When using model preprocessing the size of the data to
 		 * compression is not allowed to change unit a reset.
 		 */
-		if (model_is_needed(&ctx->params) && get_packed_size(src_desc) != ctx->model_size)
+		if (model_is_needed(&ctx->params) && packed_size != ctx->model_size)
 			return CMP_ERROR(SRC_SIZE_MISMATCH);
 	}
 
+	*model = NULL;
 	if (model_is_needed(&ctx->params)) {
-		if (ctx->work_buf_size < get_packed_size(src_desc))
+		if (ctx->work_buf_size < packed_size)
 			return CMP_ERROR(WORK_BUF_TOO_SMALL);
-		model = ctx->work_buf;
+		*model = ctx->work_buf;
 	}
 
-	ret = bitstream_writer_init(&bs, dst, dst_capacity);
+	ret = bitstream_error(bs);
 	if (cmp_is_error_int(ret))
 		return ret;
 
-	ret = cmp_encoder_init(&enc, selected_encoder_type, selected_encoder_param,
+	ret = cmp_encoder_init(enc, selected_encoder_type, selected_encoder_param,
 			       selected_outlier);
 	if (cmp_is_error_int(ret))
 		return ret;
 
-	hdr.version_flag = 1;
-	hdr.version_id = CMP_VERSION_NUMBER;
-	hdr.original_size = get_packed_size(src_desc);
-	hdr.compressed_size = 0; /* place holder, not know right now */
-	hdr.identifier = ctx->identifier;
-	hdr.sequence_number = ctx->sequence_number;
-	hdr.preprocessing = selected_preprocessing;
-	hdr.checksum_enabled = !!ctx->params.checksum_enabled;
-	hdr.encoder_type = selected_encoder_type;
-	if (selected_preprocessing == CMP_PREPROCESS_MODEL)
-		hdr.model_rate = ctx->params.model_rate;
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->version_flag = 1;
+	hdr->version_id = CMP_VERSION_NUMBER;
+	hdr->original_size = packed_size;
+	hdr->compressed_size = 0; /* place holder, not know right now */
+	hdr->identifier = ctx->identifier;
+	hdr->sequence_number = ctx->sequence_number;
+	hdr->preprocessing = selected_preprocessing;
+	hdr->checksum_enabled = !!ctx->params.checksum_enabled;
+	hdr->encoder_type = selected_encoder_type;
+	if (selected_preprocessing == CMP_PREPROCESS_MODEL) {
+		hdr->model_preloaded = ctx->model_preloaded;
+		hdr->model_rate = ctx->params.model_rate;
+	}
 	if (selected_encoder_type != CMP_ENCODER_UNCOMPRESSED) {
-		hdr.encoder_param = selected_encoder_param;
-		hdr.encoder_outlier = enc.outlier;
+		hdr->encoder_param = selected_encoder_param;
+		hdr->encoder_outlier = enc->outlier;
 	}
-	ret = cmp_hdr_serialize(&bs, &hdr);
+	ret = cmp_hdr_serialize(bs, hdr);
 	if (cmp_is_error_int(ret))
 		return ret;
 
-	compress_bound = cmp_compress_bound(get_packed_size(src_desc));
-	if (cmp_is_error_int(compress_bound))
-		compress_bound = ~0U;
-
-	preprocess = preprocessing_get_method(selected_preprocessing);
-	if (preprocess == NULL)
-		return CMP_ERROR(PARAMS_INVALID);
-
-	n_values = preprocess->init(src_desc, ctx->work_buf, ctx->work_buf_size);
-	if (cmp_is_error_int(n_values))
-		return n_values;
+	return CMP_ERROR(NO_ERROR);
+}
 
-	for (i = 0; i < n_values; i++) {
-		int16_t const value = preprocess->process(i, src_desc, ctx->work_buf);
 
-		cmp_encoder_encode_s16(&enc, value, &bs);
-		if (dst_capacity < compress_bound)
-			if (cmp_is_error_int(bitstream_error(&bs)))
-				break;
+/**
+ * @brief Completes a frame by appending the optional checksum
+ *
+ * @param bs		pointer to the bitstream writer of the frame
+ * @param hdr		pointer to the header of the frame; the compressed size
+ *			is updated
+ * @param checksum	checksum of the original data; only used if enabled in
+ *			the header
+ *
+ * @returns the compressed size or an error, which can be checked using
+ *	cmp_is_error()
+ */
 
-		if (model) {
-			if (ctx->sequence_number == 0)
-				model[i] = sample_read_i16(src_desc, i);
-			else
-				model[i] = update_model(sample_read_i16(src_desc, i), model[i],
-							(int)ctx->params.model_rate,
-							src_desc->type);
-		}
+static uint32_t frame_end(struct bitstream_writer *bs, struct cmp_hdr *hdr, uint32_t checksum)
+{
+	if (hdr->checksum_enabled) {
+		bitstream_pad_last_byte(bs);
+		bitstream_add_bits32(bs, checksum, bitsizeof(checksum));
 	}
 
-	if (ctx->params.checksum_enabled) {
-		uint32_t const checksum = cmp_checksum(src_desc);
-
-		bitstream_pad_last_byte(&bs);
-		bitstream_add_bits32(&bs, checksum, bitsizeof(checksum));
-	}
+	hdr->compressed_size = bitstream_flush(bs);
+	return hdr->compressed_size;
+}
 
-	hdr.compressed_size = bitstream_flush(&bs);
-	if (cmp_is_error_int(hdr.compressed_size))
-		return hdr.compressed_size;
 
-	/*
-	 * Now that we have the final compressed size, rewind the bitstream and
-	 * re-serialize the header with the correct cmp_size.
-	 */
-	ret = bitstream_rewind(&bs);
-	if (cmp_is_error_int(ret))
-		return ret;
-	ret = cmp_hdr_serialize(&bs, &hdr);
-	if (cmp_is_error_int(ret))
-		return ret;
+/**
+ * @brief Updates the model with a sample of the frame being compressed
+ *
+ * @param ctx		pointer to a compression context
+ * @param model		pointer to the model
+ * @param src_desc	pointer to the sample descriptor of the data to compress
+ * @param i		index of the sample
+ */
 
-	ctx->sequence_number++;
-	return hdr.compressed_size;
+static __inline void model_update_sample(const struct cmp_context *ctx, int16_t *model,
+					 const struct sample_desc *src_desc, uint32_t i)
+{
+	if (ctx->sequence_number == 0)
+		model[i] = sample_read_i16(src_desc, i);
+	else
+		model[i] = update_model(sample_read_i16(src_desc, i), model[i],
+					(int)ctx->params.model_rate, src_desc->type);
 }
 
 
-/* implements uncompressed fallback */
-static uint32_t cmp_compress_generic(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
-				     const struct sample_desc *src_desc)
+/**
+ * @brief Checks if the samples of a frame can be copied into the bitstream
+ *
+ * Without preprocessing the uncompressed encoder writes every sample as
+ * big-endian 16-bit value, so the encoded data is a byte-order converted copy
+ * of 16-bit samples.
+ *
+ * @param bs		pointer to the bitstream writer of the frame
+ * @param hdr		pointer to the header of the frame
+ * @param src_desc	pointer to the sample descriptor of the data to compress
+ *
+ * @returns non-zero if raw_copy_samples() can be used to encode the samples
+ */
+
+static int raw_copy_is_possible(const struct bitstream_writer *bs, const struct cmp_hdr *hdr,
+				const struct sample_desc *src_desc)
 {
-	uint32_t uncompressed_size = CMP_HDR_SIZE + get_packed_size(src_desc);
-	enum cmp_preprocessing saved_preprocessing;
-	enum cmp_encoder_type saved_encoder_type;
-	uint32_t ret;
+	return hdr->preprocessing == CMP_PREPROCESS_NONE &&
+	       hdr->encoder_type == CMP_ENCODER_UNCOMPRESSED &&
+	       src_desc->stride == sizeof(int16_t) && !bs->sink;
+}
 
-	if (ctx == NULL)
-		return CMP_ERROR(GENERIC);
 
-	if (ctx->magic != CMP_MAGIC)
-		return CMP_ERROR(CONTEXT_INVALID);
+/**
+ * @brief Encodes the samples of a frame by copying them into the bitstream
+ *
+ * @param bs		pointer to the bitstream writer of the frame
+ * @param src_desc	pointer to the sample descriptor of the data to compress
+ */
 
-	if (cmp_is_error_int(dst_capacity))
-		return CMP_ERROR(GENERIC);
+static void raw_copy_samples(struct bitstream_writer *bs, const struct sample_desc *src_desc)
+{
+	uint32_t const size = get_packed_size(src_desc);
+	uint8_t *dst = bitstream_raw_begin(bs, size);
 
-	if (ctx->params.checksum_enabled)
-		uncompressed_size += CMP_CHECKSUM_SIZE;
+	if (dst == NULL)
+		return;
 
-	/* Skip fallback if disabled or output buffer too small for uncompressed */
-	if (!ctx->params.uncompressed_fallback_enabled || dst_capacity < uncompressed_size)
-		return compress_engine(ctx, dst, dst_capacity, src_desc);
+	if (sample_type_is_be(src_desc->type))
+		memcpy(dst, src_desc->data, size);
+	else
+		cpu_to_be16_bulk(dst, src_desc->data, src_desc->num_samples);
 
-	/*
-	 * Try compression with restricted buffer size. If data doesn't compress
-	 * well enough to fit in uncompressed_size bytes, we'll get a buffer
-	 * overflow error and fall back to uncompressed storage.
-	 */
-	ret = compress_engine(ctx, dst, uncompressed_size, src_desc);
-	if (cmp_get_error_code(ret) != CMP_ERR_DST_TOO_SMALL)
-		return ret;
+	bitstream_raw_end(bs, size);
+}
 
-	/*
-	 * Compression failed - fall back to uncompressed storage.
-	 * Reset context to avoid corrupted model state, then temporarily
-	 * switch to uncompressed mode.
-	 */
-	ret = cmp_reset(ctx);
-	if (cmp_is_error_int(ret))
-		return ret;
-	saved_preprocessing = ctx->params.primary_preprocessing;
-	saved_encoder_type = ctx->params.primary_encoder_type;
-	ctx->params.primary_preprocessing = CMP_PREPROCESS_NONE;
-	ctx->params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
 
-	ret = compress_engine(ctx, dst, uncompressed_size, src_desc);
+/**
+ * @brief Starts the statistics of a frame
+ *
+ * @param stats	pointer to the statistics to reset
+ */
 
-	ctx->params.primary_preprocessing = saved_preprocessing;
-	ctx->params.primary_encoder_type = saved_encoder_type;
-	return ret;
+static void stats_frame_begin(struct cmp_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->min_residual = INT16_MAX;
+	stats->max_residual = INT16_MIN;
 }
 
 
-uint32_t cmp_compress_u16(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
-			  const uint16_t *src, uint32_t src_size)
+/**
+ * @brief Completes the statistics of a frame with the size of its parts
+ *
+ * @param stats	pointer to the statistics of the frame
+ * @param hdr	pointer to the final header of the frame
+ */
+
+static void stats_frame_end(struct cmp_stats *stats, const struct cmp_hdr *hdr)
 {
-	uint32_t error;
-	struct sample_desc src_desc;
+	uint32_t hdr_size = CMP_HDR_SIZE;
 
-	error = sample_read_src_init(&src_desc, src, src_size, CMP_U16);
-	if (cmp_is_error(error))
-		return error;
+	/* same condition as in cmp_hdr_serialize() */
+	if (hdr->preprocessing != CMP_PREPROCESS_NONE ||
+	    hdr->encoder_type != CMP_ENCODER_UNCOMPRESSED)
+		hdr_size = CMP_HDR_MAX_SIZE;
 
-	return cmp_compress_generic(ctx, dst, dst_capacity, &src_desc);
+	stats->header_bits = hdr_size * 8;
+	stats->checksum_bits = hdr->checksum_enabled ? (uint32_t)bitsizeof(uint32_t) : 0;
+	stats->payload_bits = hdr->compressed_size * 8 - stats->header_bits - stats->checksum_bits;
 }
 
 
-uint32_t cmp_compress_i16(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
-			  const int16_t *src, uint32_t src_size)
+/**
+ * @brief Encodes the samples of a frame and records them in the statistics
+ *
+ * Same as the encode loop of compress_engine() plus recording every sample in
+ * the statistics and the residual histogram of the context, if they are set;
+ * a separate loop keeps the recording out of the regular loop.
+ *
+ * @param ctx		pointer to a compression context
+ * @param bs		pointer to the bitstream writer of the frame
+ * @param dst_capacity	capacity of the bitstream; 0 for an output sink
+ * @param compress_bound	worst-case size of the frame
+ * @param enc		pointer to the encoder of the frame
+ * @param preprocess	preprocessing of the frame; already initialised
+ * @param src_desc	pointer to the sample descriptor of the data to compress
+ * @param work_buf	pointer to the working buffer of the preprocessing
+ * @param model		pointer to the model to update; NULL if none
+ * @param n_values	number of values to encode
+ */
+
+static void encode_with_stats(const struct cmp_context *ctx, struct bitstream_writer *bs,
+			      uint32_t dst_capacity, uint32_t compress_bound,
+			      const struct cmp_encoder *enc,
+			      const struct preprocessing_method *preprocess,
+			      const struct sample_desc *src_desc, void *work_buf, int16_t *model,
+			      uint32_t n_values)
 {
-	uint32_t error;
-	struct sample_desc src_desc;
+	uint32_t i;
 
-	error = sample_read_src_init(&src_desc, src, src_size, CMP_I16);
-	if (cmp_is_error(error))
-		return error;
+	for (i = 0; i < n_values; i++) {
+		int16_t const value = preprocess->process(i, src_desc, work_buf);
+
+		cmp_encoder_encode_s16(enc, value, bs);
+		if (ctx->stats)
+			cmp_encoder_stats_s16(enc, value, ctx->stats);
+		if (ctx->residual_hist)
+			cmp_encoder_hist_add_s16(value, ctx->residual_hist);
+		if (dst_capacity < compress_bound)
+			if (cmp_is_error_int(bitstream_error(bs)))
+				break;
 
-	return cmp_compress_generic(ctx, dst, dst_capacity, &src_desc);
+		if (model)
+			model_update_sample(ctx, model, src_desc, i);
+	}
 }
 
 
-uint32_t cmp_compress_i16_in_i32(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
-				 const int32_t *src, uint32_t src_size)
+/* Returns the current time of the trace clock; 0 if the context is not traced */
+static uint64_t trace_clock(const struct cmp_context *ctx)
 {
-	uint32_t error;
-	struct sample_desc src_desc;
-
-	error = sample_read_src_init(&src_desc, src, src_size, CMP_I16_IN_I32);
-	if (cmp_is_error(error))
-		return error;
-
-	return cmp_compress_generic(ctx, dst, dst_capacity, &src_desc);
+	if (ctx->trace == NULL)
+		return 0;
+	return ctx->trace->clock(ctx->trace->opaque);
 }
 
 
-static uint64_t cmp_get_new_identifier(void)
-{
-	uint32_t coarse = 0;
-	uint16_t fine = 0;
-
-	compile_time_assert(bitsizeof(coarse) + bitsizeof(fine) == CMP_HDR_BITS_IDENTIFIER,
-			    cmp_hdr_identifier_timestamp_mismatch);
+/**
+ * @brief Reports a completed stage to the trace of a context
+ *
+ * @param ctx	pointer to a compression context
+ * @param stage	completed stage
+ * @param start	trace clock value at the start of the stage
+ *
+ * @returns the trace clock value at the end of the stage, which is the start
+ *	of the next stage; 0 if the context is not traced
+ */
 
-	g_get_timestamp(&coarse, &fine);
+static uint64_t trace_stage(const struct cmp_context *ctx, enum cmp_stage stage, uint64_t start)
+{
+	uint64_t const end = trace_clock(ctx);
 
-	return ((uint64_t)coarse << 16) | (uint64_t)fine;
+	if (ctx->trace)
+		ctx->trace->stage_done(ctx->trace->opaque, stage, start, end);
+	return end;
 }
 
 
-uint32_t cmp_reset(struct cmp_context *ctx)
+/**
+ * @brief Main compression loop
+ *
+ * Writes a complete frame into the bitstream. The header is written with a
+ * compressed size place holder; the final header is returned in hdr and has
+ * to be re-serialised by the caller.
+ *
+ * @param ctx		pointer to a compression context
+ * @param bs		pointer to an initialised bitstream writer
+ * @param dst_capacity	capacity of the bitstream; 0 if the bitstream can fail
+ *			regardless of the written size (e.g. an output sink)
+ * @param hdr		pointer to a header structure filled with the header of
+ *			the compressed frame
+ * @param src_desc	pointer to the sample descriptor of the data to compress
+ * @param in_place_buf	pointer to the writable source data, if the IWT may be
+ *			calculated in-place; NULL otherwise
+ * @param transformed	pointer to store if in_place_buf holds the IWT
+ *			coefficients instead of the source data; the caller
+ *			has to undo the transform if the frame is not emitted
+ * @param trace_time	pointer to store the trace clock value at which the
+ *			header stage starts
+ *
+ * @returns the compressed size or an error, which can be checked using
+ *	cmp_is_error()
+ */
+
+static uint32_t compress_engine(struct cmp_context *ctx, struct bitstream_writer *bs,
+				uint32_t dst_capacity, struct cmp_hdr *hdr,
+				const struct sample_desc *src_desc, int16_t *in_place_buf,
+				int *transformed, uint64_t *trace_time)
 {
-	if (ctx == NULL)
-		return CMP_ERROR(GENERIC);
+	uint32_t i, ret, n_values;
+	struct cmp_encoder enc;
+	const struct preprocessing_method *preprocess;
+	int16_t *model;
+	uint32_t compress_bound;
+	void *work_buf;
+	uint32_t work_buf_size;
+	uint32_t checksum = 0;
+	int in_place;
+	uint64_t t;
+
+	*transformed = 0;
+	t = trace_clock(ctx);
+	ret = frame_begin(ctx, bs, hdr, &enc, &model, get_packed_size(src_desc));
+	if (cmp_is_error_int(ret))
+		return ret;
 
-	if (ctx->magic != CMP_MAGIC)
-		return CMP_ERROR(CONTEXT_INVALID);
+	if (ctx->stats)
+		stats_frame_begin(ctx->stats);
 
-	ctx->sequence_number = 0;
-	ctx->identifier = cmp_get_new_identifier();
+	compress_bound = cmp_compress_bound(get_packed_size(src_desc));
+	if (cmp_is_error_int(compress_bound))
+		compress_bound = ~0U;
+
+	preprocess = preprocessing_get_method(hdr->preprocessing);
+	if (preprocess == NULL)
+		return CMP_ERROR(PARAMS_INVALID);
+
+	work_buf = ctx->work_buf;
+	work_buf_size = ctx->work_buf_size;
+	t = trace_stage(ctx, CMP_STAGE_SETUP, t);
+
+	in_place = in_place_buf && ctx->params.iwt_in_place_enabled &&
+		   hdr->preprocessing == CMP_PREPROCESS_IWT;
+	if (in_place) {
+		/* everything that needs the original samples is done up front */
+		if (hdr->checksum_enabled) {
+			checksum = cmp_checksum(src_desc);
+			t = trace_stage(ctx, CMP_STAGE_CHECKSUM, t);
+		}
+		if (model) {
+			/* a model is only started with a primary IWT frame */
+			for (i = 0; i < src_desc->num_samples; i++)
+				model[i] = sample_read_i16(src_desc, i);
+			model = NULL;
+		}
+		work_buf = in_place_buf;
+		work_buf_size = get_packed_size(src_desc);
+	}
+
+	n_values = preprocess->init(src_desc, work_buf, work_buf_size);
+	if (cmp_is_error_int(n_values))
+		return n_values;
+	*transformed = in_place;
+	t = trace_stage(ctx, CMP_STAGE_PREPROCESS_INIT, t);
+
+	if (ctx->stats || ctx->residual_hist) {
+		encode_with_stats(ctx, bs, dst_capacity, compress_bound, &enc, preprocess,
+				  src_desc, work_buf, model, n_values);
+	} else if (raw_copy_is_possible(bs, hdr, src_desc)) {
+		raw_copy_samples(bs, src_desc);
+		if (model)
+			for (i = 0; i < src_desc->num_samples; i++)
+				model_update_sample(ctx, model, src_desc, i);
+	} else {
+		for (i = 0; i < n_values; i++) {
+			int16_t const value = preprocess->process(i, src_desc, work_buf);
+
+			cmp_encoder_encode_s16(&enc, value, bs);
+			if (dst_capacity < compress_bound)
+				if (cmp_is_error_int(bitstream_error(bs)))
+					break;
+
+			if (model)
+				model_update_sample(ctx, model, src_desc, i);
+		}
+	}
+
+	t = trace_stage(ctx, CMP_STAGE_ENCODE, t);
+
+	if (!in_place && hdr->checksum_enabled) {
+		checksum = cmp_checksum(src_desc);
+		t = trace_stage(ctx, CMP_STAGE_CHECKSUM, t);
+	}
+
+	*trace_time = t;
+	ret = frame_end(bs, hdr, checksum);
+	if (ctx->stats && !cmp_is_error_int(ret))
+		stats_frame_end(ctx->stats, hdr);
+
+	return ret;
+}
+
+
+/* Re-serialises the final header at the start of a destination buffer */
+static uint32_t buffer_finalise_header(struct bitstream_writer *bs, const struct cmp_hdr *hdr)
+{
+	uint32_t ret;
+
+	/*
+	 * Now that we have the final compressed size, rewind the bitstream and
+	 * re-serialize the header with the correct cmp_size.
+	 */
+	ret = bitstream_rewind(bs);
+	if (cmp_is_error_int(ret))
+		return ret;
+	ret = cmp_hdr_serialize(bs, hdr);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	return hdr->compressed_size;
+}
+
+
+/* Flushes the last chunk of an output sink and hands over the final header */
+static uint32_t sink_finalise_header(struct bitstream_writer *bs, const struct cmp_hdr *hdr,
+				     int (*finalise_header)(const void *hdr, uint32_t hdr_size,
+							    void *opaque),
+				     void *opaque)
+{
+	uint64_t hdr_buf[DIV_ROUND_UP(CMP_HDR_MAX_SIZE, sizeof(uint64_t))];
+	struct bitstream_writer hdr_bs;
+	uint32_t ret, hdr_size;
+
+	ret = bitstream_sink_finish(bs);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	ret = bitstream_writer_init(&hdr_bs, hdr_buf, sizeof(hdr_buf));
+	if (cmp_is_error_int(ret))
+		return ret;
+	hdr_size = cmp_hdr_serialize(&hdr_bs, hdr);
+	if (cmp_is_error_int(hdr_size))
+		return hdr_size;
+
+	if (finalise_header(hdr_buf, hdr_size, opaque))
+		return CMP_ERROR(DST_SINK_FAILED);
+
+	return hdr->compressed_size;
+}
+
+
+/* Compresses a frame into a single destination buffer */
+static uint32_t compress_to_buffer(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+				   const struct sample_desc *src_desc, int16_t *in_place_buf)
+{
+	struct bitstream_writer bs;
+	struct cmp_hdr hdr;
+	uint32_t ret;
+	uint64_t t;
+	int transformed;
+
+	/* initialisation errors are sticky and reported by compress_engine() */
+	(void)bitstream_writer_init(&bs, dst, dst_capacity);
+
+	ret = compress_engine(ctx, &bs, dst_capacity, &hdr, src_desc, in_place_buf, &transformed,
+			      &t);
+	if (!cmp_is_error_int(ret))
+		ret = buffer_finalise_header(&bs, &hdr);
+	if (cmp_is_error_int(ret)) {
+		/* give the caller back the original data, as the frame is not emitted */
+		if (transformed)
+			iwt_inverse_i16(in_place_buf, src_desc->num_samples);
+		return ret;
+	}
+	(void)trace_stage(ctx, CMP_STAGE_HEADER, t);
+
+	ctx->sequence_number++;
+	return ret;
+}
+
+
+/* Compresses a frame into an output sink */
+static uint32_t compress_to_sink(struct cmp_context *ctx, const struct cmp_sink *sink,
+				 const struct sample_desc *src_desc)
+{
+	struct bitstream_writer bs;
+	struct cmp_hdr hdr;
+	uint32_t ret;
+	uint64_t t;
+	int transformed; /* always 0 without an in-place buffer */
+
+	if (ctx == NULL)
+		return CMP_ERROR(GENERIC);
+
+	if (ctx->magic != CMP_MAGIC)
+		return CMP_ERROR(CONTEXT_INVALID);
+
+	if (sink == NULL || sink->write_chunk == NULL || sink->finalise_header == NULL)
+		return CMP_ERROR(DST_NULL);
+
+	/* already emitted chunks can not be taken back */
+	if (ctx->params.uncompressed_fallback_enabled)
+		return CMP_ERROR(PARAMS_INVALID);
+
+	/* initialisation errors are sticky and reported by compress_engine() */
+	(void)bitstream_writer_init_sink(&bs, sink->chunk_buf, sink->chunk_buf_size,
+					 sink->write_chunk, sink->opaque);
+
+	ret = compress_engine(ctx, &bs, 0, &hdr, src_desc, NULL, &transformed, &t);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	ret = sink_finalise_header(&bs, &hdr, sink->finalise_header, sink->opaque);
+	if (cmp_is_error_int(ret))
+		return ret;
+	(void)trace_stage(ctx, CMP_STAGE_HEADER, t);
+
+	ctx->sequence_number++;
+	return ret;
+}
+
+
+/* implements uncompressed fallback */
+static uint32_t cmp_compress_generic(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+				     const struct sample_desc *src_desc, int16_t *in_place_buf)
+{
+	uint32_t uncompressed_size = CMP_HDR_SIZE + get_packed_size(src_desc);
+	enum cmp_preprocessing saved_preprocessing;
+	enum cmp_encoder_type saved_encoder_type;
+	uint32_t ret;
+
+	if (ctx == NULL)
+		return CMP_ERROR(GENERIC);
+
+	if (ctx->magic != CMP_MAGIC)
+		return CMP_ERROR(CONTEXT_INVALID);
+
+	if (cmp_is_error_int(dst_capacity))
+		return CMP_ERROR(GENERIC);
+
+	if (ctx->params.checksum_enabled)
+		uncompressed_size += CMP_CHECKSUM_SIZE;
+
+	/* Skip fallback if disabled or output buffer too small for uncompressed */
+	if (!ctx->params.uncompressed_fallback_enabled || dst_capacity < uncompressed_size)
+		return compress_to_buffer(ctx, dst, dst_capacity, src_desc, in_place_buf);
+
+	/*
+	 * Try compression with restricted buffer size. If data doesn't compress
+	 * well enough to fit in uncompressed_size bytes, we'll get a buffer
+	 * overflow error and fall back to uncompressed storage.
+	 */
+	ret = compress_to_buffer(ctx, dst, uncompressed_size, src_desc, in_place_buf);
+	if (cmp_get_error_code(ret) != CMP_ERR_DST_TOO_SMALL)
+		return ret;
+
+	/*
+	 * Compression failed - fall back to uncompressed storage.
+	 * Reset context to avoid corrupted model state, then temporarily
+	 * switch to uncompressed mode.
+	 */
+	ret = cmp_reset(ctx);
+	if (cmp_is_error_int(ret))
+		return ret;
+	saved_preprocessing = ctx->params.primary_preprocessing;
+	saved_encoder_type = ctx->params.primary_encoder_type;
+	ctx->params.primary_preprocessing = CMP_PREPROCESS_NONE;
+	ctx->params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+
+	ret = compress_to_buffer(ctx, dst, uncompressed_size, src_desc, NULL);
+	if (ctx->stats && !cmp_is_error_int(ret))
+		ctx->stats->uncompressed_fallback = 1;
+
+	ctx->params.primary_preprocessing = saved_preprocessing;
+	ctx->params.primary_encoder_type = saved_encoder_type;
+	return ret;
+}
+
+
+uint32_t cmp_compress_u16(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+			  const uint16_t *src, uint32_t src_size)
+{
+	uint32_t error;
+	struct sample_desc src_desc;
+
+	error = sample_read_src_init(&src_desc, src, src_size, CMP_U16);
+	if (cmp_is_error(error))
+		return error;
+
+	return cmp_compress_generic(ctx, dst, dst_capacity, &src_desc, NULL);
+}
+
+
+uint32_t cmp_compress_i16(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+			  const int16_t *src, uint32_t src_size)
+{
+	uint32_t error;
+	struct sample_desc src_desc;
+
+	error = sample_read_src_init(&src_desc, src, src_size, CMP_I16);
+	if (cmp_is_error(error))
+		return error;
+
+	return cmp_compress_generic(ctx, dst, dst_capacity, &src_desc, NULL);
+}
+
+
+uint32_t cmp_compress_i16_in_i32(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+				 const int32_t *src, uint32_t src_size)
+{
+	uint32_t error;
+	struct sample_desc src_desc;
+
+	error = sample_read_src_init(&src_desc, src, src_size, CMP_I16_IN_I32);
+	if (cmp_is_error(error))
+		return error;
+
+	return cmp_compress_generic(ctx, dst, dst_capacity, &src_desc, NULL);
+}
+
+
+uint32_t cmp_compress_i16_be(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+			     const void *src, uint32_t src_size)
+{
+	uint32_t error;
+	struct sample_desc src_desc;
+
+	error = sample_read_src_init(&src_desc, src, src_size, CMP_I16_BE);
+	if (cmp_is_error(error))
+		return error;
+
+	return cmp_compress_generic(ctx, dst, dst_capacity, &src_desc, NULL);
+}
+
+
+uint32_t cmp_compress_u16_be(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+			     const void *src, uint32_t src_size)
+{
+	uint32_t error;
+	struct sample_desc src_desc;
+
+	error = sample_read_src_init(&src_desc, src, src_size, CMP_U16_BE);
+	if (cmp_is_error(error))
+		return error;
+
+	return cmp_compress_generic(ctx, dst, dst_capacity, &src_desc, NULL);
+}
+
+
+uint32_t cmp_compress_i16_in_place(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+				   int16_t *src, uint32_t src_size)
+{
+	uint32_t error;
+	struct sample_desc src_desc;
+
+	error = sample_read_src_init(&src_desc, src, src_size, CMP_I16);
+	if (cmp_is_error(error))
+		return error;
+
+	return cmp_compress_generic(ctx, dst, dst_capacity, &src_desc, src);
+}
+
+
+uint32_t cmp_compress_u16_in_place(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
+				   uint16_t *src, uint32_t src_size)
+{
+	uint32_t error;
+	struct sample_desc src_desc;
+
+	error = sample_read_src_init(&src_desc, src, src_size, CMP_U16);
+	if (cmp_is_error(error))
+		return error;
+
+	return cmp_compress_generic(ctx, dst, dst_capacity, &src_desc, (int16_t *)src);
+}
+
+
+uint32_t cmp_compress_u16_to_sink(struct cmp_context *ctx, const struct cmp_sink *sink,
+				  const uint16_t *src, uint32_t src_size)
+{
+	uint32_t error;
+	struct sample_desc src_desc;
+
+	error = sample_read_src_init(&src_desc, src, src_size, CMP_U16);
+	if (cmp_is_error(error))
+		return error;
+
+	return compress_to_sink(ctx, sink, &src_desc);
+}
+
+
+uint32_t cmp_compress_i16_to_sink(struct cmp_context *ctx, const struct cmp_sink *sink,
+				  const int16_t *src, uint32_t src_size)
+{
+	uint32_t error;
+	struct sample_desc src_desc;
+
+	error = sample_read_src_init(&src_desc, src, src_size, CMP_I16);
+	if (cmp_is_error(error))
+		return error;
+
+	return compress_to_sink(ctx, sink, &src_desc);
+}
+
+
+uint32_t cmp_compress_i16_in_i32_to_sink(struct cmp_context *ctx, const struct cmp_sink *sink,
+					 const int32_t *src, uint32_t src_size)
+{
+	uint32_t error;
+	struct sample_desc src_desc;
+
+	error = sample_read_src_init(&src_desc, src, src_size, CMP_I16_IN_I32);
+	if (cmp_is_error(error))
+		return error;
+
+	return compress_to_sink(ctx, sink, &src_desc);
+}
+
+
+#define CMP_STREAM_MAGIC 0x5354524DU /* "STRM" */
+
+/** Internal state behind the opaque struct cmp_stream */
+struct stream_state {
+	uint32_t magic;			/**< set while a frame is in progress */
+	struct cmp_context *ctx;	/**< context the frame belongs to */
+	struct bitstream_writer bs;	/**< destination buffer or output sink */
+	struct cmp_encoder enc;		/**< encoder selected for the frame */
+	struct cmp_hdr hdr;		/**< header of the frame */
+	struct cmp_checksum_state checksum; /**< checksum of the data pushed so far */
+	const struct cmp_sink *sink;	/**< output sink; NULL for a destination buffer */
+	int16_t *model;			/**< model; NULL if no model is needed */
+	uint32_t dst_capacity;		/**< capacity of the destination buffer */
+	uint32_t compress_bound;	/**< worst-case size of the frame */
+	uint32_t num_samples;		/**< number of samples in the frame */
+	uint32_t pos;			/**< number of samples pushed so far */
+	int16_t last_sample;		/**< last pushed sample for DIFF preprocessing */
+	enum cmp_type type;		/**< sample type of the pushed data */
+};
+
+
+/*
+ * The state is copied in and out of the opaque storage instead of accessing
+ * it through a cast pointer, which would break the strict aliasing rules.
+ */
+static void stream_load(struct stream_state *st, const struct cmp_stream *stream)
+{
+	compile_time_assert(sizeof(struct stream_state) <= sizeof(struct cmp_stream),
+			    cmp_stream_too_small_for_stream_state);
+
+	memcpy(st, stream, sizeof(*st));
+}
+
+
+static void stream_store(struct cmp_stream *stream, const struct stream_state *st)
+{
+	memcpy(stream, st, sizeof(*st));
+}
+
+
+/* Common part of cmp_compress_begin() and cmp_compress_begin_sink() */
+static uint32_t stream_begin(struct stream_state *st, struct cmp_context *ctx,
+			     uint32_t packed_size)
+{
+	uint32_t ret;
+
+	if (packed_size == 0 || packed_size % sizeof(int16_t) != 0)
+		return CMP_ERROR(SRC_SIZE_WRONG);
+
+	ret = frame_begin(ctx, &st->bs, &st->hdr, &st->enc, &st->model, packed_size);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	switch (st->hdr.preprocessing) {
+	case CMP_PREPROCESS_NONE:
+	case CMP_PREPROCESS_DIFF:
+	case CMP_PREPROCESS_MODEL:
+		break;
+	case CMP_PREPROCESS_IWT:
+		/* the samples are collected in the working buffer */
+		if (!ctx->work_buf)
+			return CMP_ERROR(WORK_BUF_NULL);
+		if (ctx->work_buf_size < packed_size)
+			return CMP_ERROR(WORK_BUF_TOO_SMALL);
+		break;
+	default:
+		return CMP_ERROR(PARAMS_INVALID);
+	}
+
+	st->compress_bound = cmp_compress_bound(packed_size);
+	if (cmp_is_error_int(st->compress_bound))
+		st->compress_bound = ~0U;
+
+	if (st->hdr.checksum_enabled)
+		cmp_checksum_reset(&st->checksum);
+
+	st->ctx = ctx;
+	st->num_samples = packed_size / sizeof(int16_t);
+	st->pos = 0;
+	st->last_sample = 0;
+	st->magic = CMP_STREAM_MAGIC;
+
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+static uint32_t stream_begin_buffer(struct stream_state *st, struct cmp_context *ctx, void *dst,
+				    uint32_t dst_capacity, uint32_t packed_size)
+{
+	if (ctx == NULL)
+		return CMP_ERROR(GENERIC);
+
+	if (ctx->magic != CMP_MAGIC)
+		return CMP_ERROR(CONTEXT_INVALID);
+
+	if (cmp_is_error_int(dst_capacity))
+		return CMP_ERROR(GENERIC);
+
+	/* the data are not kept, so there is nothing to fall back to */
+	if (ctx->params.uncompressed_fallback_enabled)
+		return CMP_ERROR(PARAMS_INVALID);
+
+	/* initialisation errors are sticky and reported by frame_begin() */
+	(void)bitstream_writer_init(&st->bs, dst, dst_capacity);
+	st->dst_capacity = dst_capacity;
+
+	return stream_begin(st, ctx, packed_size);
+}
+
+
+uint32_t cmp_compress_begin(struct cmp_stream *stream, struct cmp_context *ctx, void *dst,
+			    uint32_t dst_capacity, uint32_t packed_size)
+{
+	struct stream_state st;
+	uint32_t ret;
+
+	if (stream == NULL)
+		return CMP_ERROR(GENERIC);
+
+	memset(&st, 0, sizeof(st));
+	ret = stream_begin_buffer(&st, ctx, dst, dst_capacity, packed_size);
+	stream_store(stream, &st);
+
+	return ret;
+}
+
+
+static uint32_t stream_begin_sink(struct stream_state *st, struct cmp_context *ctx,
+				  const struct cmp_sink *sink, uint32_t packed_size)
+{
+	if (ctx == NULL)
+		return CMP_ERROR(GENERIC);
+
+	if (ctx->magic != CMP_MAGIC)
+		return CMP_ERROR(CONTEXT_INVALID);
+
+	if (sink == NULL || sink->write_chunk == NULL || sink->finalise_header == NULL)
+		return CMP_ERROR(DST_NULL);
+
+	/* already emitted chunks can not be taken back */
+	if (ctx->params.uncompressed_fallback_enabled)
+		return CMP_ERROR(PARAMS_INVALID);
+
+	/* initialisation errors are sticky and reported by frame_begin() */
+	(void)bitstream_writer_init_sink(&st->bs, sink->chunk_buf, sink->chunk_buf_size,
+					 sink->write_chunk, sink->opaque);
+	st->sink = sink;
+
+	return stream_begin(st, ctx, packed_size);
+}
+
+
+uint32_t cmp_compress_begin_sink(struct cmp_stream *stream, struct cmp_context *ctx,
+				 const struct cmp_sink *sink, uint32_t packed_size)
+{
+	struct stream_state st;
+	uint32_t ret;
+
+	if (stream == NULL)
+		return CMP_ERROR(GENERIC);
+
+	memset(&st, 0, sizeof(st));
+	ret = stream_begin_sink(&st, ctx, sink, packed_size);
+	stream_store(stream, &st);
+
+	return ret;
+}
+
+
+/* Preprocesses and encodes the next piece of a streamed frame */
+static uint32_t stream_encode(struct stream_state *st, const struct sample_desc *desc)
+{
+	struct cmp_context *ctx = st->ctx;
+	uint32_t j;
+
+	for (j = 0; j < desc->num_samples; j++) {
+		uint32_t const i = st->pos + j;
+		int16_t const sample = sample_read_i16(desc, j);
+		int16_t value;
+
+		switch (st->hdr.preprocessing) {
+		case CMP_PREPROCESS_DIFF:
+			/* the previous sample is carried over piece boundaries */
+			value = i == 0 ? sample : (int16_t)(sample - st->last_sample);
+			st->last_sample = sample;
+			break;
+		case CMP_PREPROCESS_MODEL:
+			value = (int16_t)(sample - (uint16_t)st->model[i]);
+			break;
+		case CMP_PREPROCESS_NONE:
+		case CMP_PREPROCESS_IWT: /* not reached, IWT samples are collected */
+		default:
+			value = sample;
+			break;
+		}
+
+		cmp_encoder_encode_s16(&st->enc, value, &st->bs);
+		if (st->dst_capacity < st->compress_bound)
+			if (cmp_is_error_int(bitstream_error(&st->bs)))
+				break;
+
+		if (st->model) {
+			if (ctx->sequence_number == 0)
+				st->model[i] = sample;
+			else
+				st->model[i] = update_model(sample, st->model[i],
+							    (int)ctx->params.model_rate,
+							    desc->type);
+		}
+	}
+
+	return bitstream_error(&st->bs);
+}
+
+
+/* Encodes the IWT coefficients of the samples collected in the working buffer */
+static uint32_t stream_encode_iwt(struct stream_state *st)
+{
+	struct cmp_context *ctx = st->ctx;
+	const struct preprocessing_method *preprocess;
+	struct sample_desc collected;
+	uint32_t i, n_values, ret;
+
+	ret = sample_read_src_init(&collected, ctx->work_buf, st->num_samples * sizeof(int16_t),
+				   CMP_I16);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	preprocess = preprocessing_get_method(CMP_PREPROCESS_IWT);
+	if (preprocess == NULL)
+		return CMP_ERROR(PARAMS_INVALID);
+
+	/* the transformation is done in-place */
+	n_values = preprocess->init(&collected, ctx->work_buf, ctx->work_buf_size);
+	if (cmp_is_error_int(n_values))
+		return n_values;
+
+	for (i = 0; i < n_values; i++) {
+		cmp_encoder_encode_s16(&st->enc, preprocess->process(i, &collected, ctx->work_buf),
+				       &st->bs);
+		if (st->dst_capacity < st->compress_bound)
+			if (cmp_is_error_int(bitstream_error(&st->bs)))
+				break;
+	}
+
+	/*
+	 * The model shares the working buffer with the coefficients; a model
+	 * started with an IWT frame has to contain the original samples.
+	 */
+	if (st->model)
+		iwt_inverse_i16(ctx->work_buf, st->num_samples);
+
+	return bitstream_error(&st->bs);
+}
+
+
+static uint32_t stream_push(struct cmp_stream *stream, const void *src, uint32_t src_size,
+			    enum cmp_type type)
+{
+	struct stream_state state;
+	struct stream_state *st = &state;
+	struct sample_desc desc;
+	uint32_t ret, j;
+
+	if (stream == NULL)
+		return CMP_ERROR(GENERIC);
+	stream_load(st, stream);
+
+	if (st->magic != CMP_STREAM_MAGIC)
+		return CMP_ERROR(STREAM_INVALID);
+
+	ret = sample_read_src_init(&desc, src, src_size, type);
+	if (cmp_is_error_int(ret))
+		goto fail;
+
+	/* the model update and the checksum depend on the sample type */
+	if (st->pos != 0 && st->type != type) {
+		ret = CMP_ERROR(STREAM_INVALID);
+		goto fail;
+	}
+	st->type = type;
+
+	if (desc.num_samples > st->num_samples - st->pos) {
+		ret = CMP_ERROR(SRC_SIZE_WRONG);
+		goto fail;
+	}
+
+	if (st->hdr.checksum_enabled)
+		cmp_checksum_update(&st->checksum, &desc);
+
+	if (st->hdr.preprocessing == CMP_PREPROCESS_IWT) {
+		int16_t *collected = st->ctx->work_buf;
+
+		for (j = 0; j < desc.num_samples; j++)
+			collected[st->pos + j] = sample_read_i16(&desc, j);
+	} else {
+		ret = stream_encode(st, &desc);
+		if (cmp_is_error_int(ret))
+			goto fail;
+	}
+
+	st->pos += desc.num_samples;
+	stream_store(stream, st);
+	return CMP_ERROR(NO_ERROR);
+
+fail:
+	st->magic = 0;
+	stream_store(stream, st);
+	return ret;
+}
+
+
+uint32_t cmp_compress_push_i16(struct cmp_stream *stream, const int16_t *src, uint32_t src_size)
+{
+	return stream_push(stream, src, src_size, CMP_I16);
+}
+
+
+uint32_t cmp_compress_push_i16_in_i32(struct cmp_stream *stream, const int32_t *src,
+				      uint32_t src_size)
+{
+	return stream_push(stream, src, src_size, CMP_I16_IN_I32);
+}
+
+
+uint32_t cmp_compress_push_u16(struct cmp_stream *stream, const uint16_t *src, uint32_t src_size)
+{
+	return stream_push(stream, src, src_size, CMP_U16);
+}
+
+
+uint32_t cmp_compress_end(struct cmp_stream *stream)
+{
+	struct stream_state state;
+	struct stream_state *st = &state;
+	uint32_t ret;
+
+	if (stream == NULL)
+		return CMP_ERROR(GENERIC);
+	stream_load(st, stream);
+
+	if (st->magic != CMP_STREAM_MAGIC)
+		return CMP_ERROR(STREAM_INVALID);
+	st->magic = 0; /* the stream is finished, whatever happens */
+	stream_store(stream, st);
+
+	if (st->pos != st->num_samples)
+		return CMP_ERROR(SRC_SIZE_WRONG);
+
+	if (st->hdr.preprocessing == CMP_PREPROCESS_IWT) {
+		ret = stream_encode_iwt(st);
+		if (cmp_is_error_int(ret))
+			return ret;
+	}
+
+	ret = frame_end(&st->bs, &st->hdr,
+			st->hdr.checksum_enabled ? cmp_checksum_digest(&st->checksum) : 0);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	if (st->sink)
+		ret = sink_finalise_header(&st->bs, &st->hdr, st->sink->finalise_header,
+					   st->sink->opaque);
+	else
+		ret = buffer_finalise_header(&st->bs, &st->hdr);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	st->ctx->sequence_number++;
+	return ret;
+}
+
+
+static uint64_t cmp_get_new_identifier(void)
+{
+	uint32_t coarse = 0;
+	uint16_t fine = 0;
+
+	compile_time_assert(bitsizeof(coarse) + bitsizeof(fine) == CMP_HDR_BITS_IDENTIFIER,
+			    cmp_hdr_identifier_timestamp_mismatch);
+
+	g_get_timestamp(&coarse, &fine);
+
+	return ((uint64_t)coarse << 16) | (uint64_t)fine;
+}
+
+
+void cmp_set_stats(struct cmp_context *ctx, struct cmp_stats *stats)
+{
+	if (ctx)
+		ctx->stats = stats;
+}
+
+
+uint32_t cmp_set_residual_hist(struct cmp_context *ctx, uint32_t *hist, uint32_t num_entries)
+{
+	if (ctx == NULL)
+		return CMP_ERROR(GENERIC);
+
+	if (ctx->magic != CMP_MAGIC)
+		return CMP_ERROR(CONTEXT_INVALID);
+
+	if (hist != NULL && num_entries != CMP_RESIDUAL_HIST_SIZE)
+		return CMP_ERROR(PARAMS_INVALID);
+
+	ctx->residual_hist = hist;
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+uint32_t cmp_estimate_encoded_bits(const uint32_t *residual_hist,
+				   enum cmp_encoder_type encoder_type, uint32_t encoder_param,
+				   uint32_t outlier, uint64_t *bits)
+{
+	struct cmp_encoder enc;
+	uint32_t ret;
+
+	if (residual_hist == NULL || bits == NULL)
+		return CMP_ERROR(GENERIC);
+
+	ret = cmp_encoder_init(&enc, encoder_type, encoder_param, outlier);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	*bits = cmp_encoder_hist_bits(&enc, residual_hist);
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+void cmp_set_trace(struct cmp_context *ctx, const struct cmp_trace *trace)
+{
+	if (ctx)
+		ctx->trace = trace;
+}
+
+
+uint32_t cmp_reset(struct cmp_context *ctx)
+{
+	if (ctx == NULL)
+		return CMP_ERROR(GENERIC);
+
+	if (ctx->magic != CMP_MAGIC)
+		return CMP_ERROR(CONTEXT_INVALID);
+
+	ctx->sequence_number = 0;
+	ctx->identifier = cmp_get_new_identifier();
 	ctx->model_size = 0;
+	ctx->model_preloaded = 0;
+
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+/* loads the reference samples into the model of a new chain */
+static uint32_t load_model(struct cmp_context *ctx, const void *reference,
+			   uint32_t reference_size, uint64_t reference_id)
+{
+	if (ctx == NULL)
+		return CMP_ERROR(GENERIC);
+
+	if (ctx->magic != CMP_MAGIC)
+		return CMP_ERROR(CONTEXT_INVALID);
+
+	if (!model_is_needed(&ctx->params))
+		return CMP_ERROR(PARAMS_INVALID);
+
+	if (reference_id >> CMP_HDR_BITS_IDENTIFIER)
+		return CMP_ERROR(PARAMS_INVALID);
+
+	if (reference == NULL)
+		return CMP_ERROR(SRC_NULL);
+
+	if (reference_size == 0 || reference_size % sizeof(int16_t) ||
+	    reference_size > CMP_HDR_MAX_ORIGINAL_SIZE)
+		return CMP_ERROR(SRC_SIZE_WRONG);
+
+	if (ctx->work_buf_size < reference_size)
+		return CMP_ERROR(WORK_BUF_TOO_SMALL);
+
+	/* the model holds the bit patterns of the samples in host byte order */
+	memcpy(ctx->work_buf, reference, reference_size);
+	ctx->model_size = reference_size;
+	ctx->identifier = reference_id;
+	/* the reference takes the place of the primary frame */
+	ctx->sequence_number = 1;
+	ctx->model_preloaded = 1;
+
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+uint32_t cmp_load_model_u16(struct cmp_context *ctx, const uint16_t *reference,
+			    uint32_t reference_size, uint64_t reference_id)
+{
+	return load_model(ctx, reference, reference_size, reference_id);
+}
+
+
+uint32_t cmp_load_model_i16(struct cmp_context *ctx, const int16_t *reference,
+			    uint32_t reference_size, uint64_t reference_id)
+{
+	return load_model(ctx, reference, reference_size, reference_id);
+}
+
+
+/* the model in the working buffer belongs to the current chain */
+static int model_is_present(const struct cmp_context *ctx)
+{
+	return model_is_needed(&ctx->params) && ctx->sequence_number != 0 &&
+	       ctx->model_size != 0 && ctx->model_size <= ctx->work_buf_size;
+}
+
+
+static void put_be(uint8_t *p, uint64_t value, unsigned int num_bytes)
+{
+	while (num_bytes--) {
+		p[num_bytes] = (uint8_t)value;
+		value >>= 8;
+	}
+}
+
+
+static uint64_t get_be(const uint8_t *p, unsigned int num_bytes)
+{
+	uint64_t value = 0;
+
+	while (num_bytes--)
+		value = value << 8 | *p++;
+	return value;
+}
+
+
+/* checksum of the model as used by the frames */
+static uint32_t model_checksum(const int16_t *model, uint32_t model_size)
+{
+	struct sample_desc desc;
+
+	desc.data = model;
+	desc.num_samples = model_size / sizeof(int16_t);
+	desc.stride = sizeof(int16_t);
+	desc.type = CMP_I16;
+	return cmp_checksum(&desc);
+}
+
+
+uint32_t cmp_context_save_bound(const struct cmp_context *ctx)
+{
+	if (ctx == NULL)
+		return CMP_ERROR(GENERIC);
+
+	if (ctx->magic != CMP_MAGIC)
+		return CMP_ERROR(CONTEXT_INVALID);
+
+	if (!model_is_present(ctx))
+		return CMP_CONTEXT_STATE_HDR_SIZE;
+	return CMP_CONTEXT_STATE_HDR_SIZE + ctx->model_size + CMP_CHECKSUM_SIZE;
+}
+
+
+uint32_t cmp_context_save(const struct cmp_context *ctx, void *dst, uint32_t dst_capacity)
+{
+	uint8_t *state = dst;
+	uint32_t bound, size;
+	uint8_t flags = 0;
+
+	bound = cmp_context_save_bound(ctx);
+	if (cmp_is_error_int(bound))
+		return bound;
+
+	if (dst == NULL)
+		return CMP_ERROR(DST_NULL);
+
+	if (dst_capacity < bound)
+		return CMP_ERROR(DST_TOO_SMALL);
+
+	size = CMP_CONTEXT_STATE_HDR_SIZE;
+	if (model_is_present(ctx)) {
+		const int16_t *model = ctx->work_buf;
+
+		uint32_t i;
+
+		flags |= CMP_STATE_MODEL_PRESENT;
+		if (ctx->model_preloaded)
+			flags |= CMP_STATE_MODEL_PRELOADED;
+		for (i = 0; i < ctx->model_size / sizeof(int16_t); i++)
+			put_be(state + size + i * sizeof(int16_t), (uint16_t)model[i],
+			       sizeof(int16_t));
+		put_be(state + size + ctx->model_size, model_checksum(model, ctx->model_size),
+		       CMP_CHECKSUM_SIZE);
+		size += ctx->model_size + (uint32_t)CMP_CHECKSUM_SIZE;
+	}
+
+	put_be(state, CMP_STATE_MAGIC, 4);
+	state[CMP_STATE_OFFSET_VERSION] = CMP_STATE_VERSION;
+	state[CMP_STATE_OFFSET_FLAGS] = flags;
+	put_be(state + CMP_STATE_OFFSET_IDENTIFIER, ctx->identifier,
+	       CMP_HDR_BITS_IDENTIFIER / 8);
+	state[CMP_STATE_OFFSET_SEQUENCE_NUMBER] = ctx->sequence_number;
+	put_be(state + CMP_STATE_OFFSET_MODEL_SIZE, ctx->model_size,
+	       CMP_HDR_BITS_ORIGINAL_SIZE / 8);
+
+	return size;
+}
+
+
+/* reads the model of a saved state into the working buffer */
+static uint32_t model_restore(struct cmp_context *ctx, const uint8_t *src, uint32_t src_size,
+			      uint32_t model_size)
+{
+	int16_t *model = ctx->work_buf;
+	uint32_t i;
+
+	if (model_size == 0 || model_size % sizeof(int16_t))
+		return CMP_ERROR(FRAME_CORRUPTED);
+
+	if (model_size > ctx->work_buf_size)
+		return CMP_ERROR(WORK_BUF_TOO_SMALL);
+
+	if (src_size < model_size + CMP_CHECKSUM_SIZE)
+		return CMP_ERROR(SRC_SIZE_WRONG);
+
+	for (i = 0; i < model_size / sizeof(int16_t); i++)
+		model[i] = (int16_t)get_be(src + i * sizeof(int16_t), sizeof(int16_t));
+	if (model_checksum(model, model_size) !=
+	    (uint32_t)get_be(src + model_size, CMP_CHECKSUM_SIZE))
+		return CMP_ERROR(CHECKSUM_MISMATCH);
+
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+uint32_t cmp_context_restore(struct cmp_context *ctx, const void *src, uint32_t src_size)
+{
+	const uint8_t *state = src;
+	uint32_t model_size, ret;
+	uint8_t flags, sequence_number;
+
+	if (ctx == NULL)
+		return CMP_ERROR(GENERIC);
+
+	if (ctx->magic != CMP_MAGIC)
+		return CMP_ERROR(CONTEXT_INVALID);
+
+	if (src == NULL)
+		return CMP_ERROR(SRC_NULL);
+
+	if (src_size < CMP_CONTEXT_STATE_HDR_SIZE)
+		return CMP_ERROR(SRC_SIZE_WRONG);
+
+	if (get_be(state, 4) != CMP_STATE_MAGIC)
+		return CMP_ERROR(FRAME_CORRUPTED);
+
+	if (state[CMP_STATE_OFFSET_VERSION] != CMP_STATE_VERSION)
+		return CMP_ERROR(HDR_VERSION_UNSUPPORTED);
+
+	flags = state[CMP_STATE_OFFSET_FLAGS];
+	if ((flags & ~(CMP_STATE_MODEL_PRESENT | CMP_STATE_MODEL_PRELOADED)) ||
+	    ((flags & CMP_STATE_MODEL_PRELOADED) && !(flags & CMP_STATE_MODEL_PRESENT)))
+		return CMP_ERROR(FRAME_CORRUPTED);
+	sequence_number = state[CMP_STATE_OFFSET_SEQUENCE_NUMBER];
+	model_size = (uint32_t)get_be(state + CMP_STATE_OFFSET_MODEL_SIZE,
+				      CMP_HDR_BITS_ORIGINAL_SIZE / 8);
+
+	/* a chain with a model can not be continued without it */
+	if (model_is_needed(&ctx->params) && sequence_number != 0 &&
+	    !(flags & CMP_STATE_MODEL_PRESENT))
+		return CMP_ERROR(PARAMS_INVALID);
+
+	if ((flags & CMP_STATE_MODEL_PRESENT) && model_is_needed(&ctx->params)) {
+		ret = model_restore(ctx, state + CMP_CONTEXT_STATE_HDR_SIZE,
+				    src_size - CMP_CONTEXT_STATE_HDR_SIZE, model_size);
+		if (cmp_is_error_int(ret)) {
+			/* the working buffer no longer holds the old model */
+			(void)cmp_reset(ctx);
+			return ret;
+		}
+	}
+
+	ctx->identifier = get_be(state + CMP_STATE_OFFSET_IDENTIFIER,
+				 CMP_HDR_BITS_IDENTIFIER / 8);
+	ctx->sequence_number = sequence_number;
+	ctx->model_size = model_size;
+	ctx->model_preloaded = !!(flags & CMP_STATE_MODEL_PRELOADED);
 
 	return CMP_ERROR(NO_ERROR);
 }
@@ -378,6 +378,143 @@ void cmp_encoder_encode_s16(const struct cmp_encoder *enc, int16_t value,
 }
 
 
+/**
+ * @brief Calculates the length of a Golomb codeword
+ *
+ * @param value		value to be encoded, must be smaller than
+ *			golomb_upper_bound()
+ * @param g_par		Golomb parameter (have to be bigger than 0)
+ * @param g_par_log2	Is ilog2(g_par)
+ *
+ * @returns the length of the codeword golomb_encode() creates for value in bits
+ */
+
+static uint32_t golomb_codeword_len(uint32_t value, uint32_t g_par, uint32_t g_par_log2)
+{
+	uint32_t const cutoff = (2U << g_par_log2) - g_par; /* members in group 0 */
+
+	if (value < cutoff)
+		return g_par_log2 + 1;
+
+	return g_par_log2 + 2 + (value - cutoff) / g_par;
+}
+
+
+/**
+ * @brief Calculates the escape level of a multi escape codeword
+ *
+ * @param enc		Pointer to an encoder of the CMP_ENCODER_GOLOMB_MULTI type
+ * @param mapped	mapped value that is not smaller than the outlier
+ *
+ * @returns the escape level cmp_encoder_encode_s16() uses for the value
+ */
+
+static unsigned int multi_escape_level(const struct cmp_encoder *enc, uint32_t mapped)
+{
+	uint32_t const diff = mapped - enc->outlier;
+
+	return diff < 4 ? 0 : ilog2(diff) / 2;
+}
+
+
+/**
+ * @brief Calculates the length of the codeword of a mapped value
+ *
+ * @param enc		Pointer to a successful initialised encoder structure
+ * @param mapped	mapped (see map_to_unsigned()) 16-bit value
+ *
+ * @returns the length of the codeword cmp_encoder_encode_s16() writes for the
+ *	value in bits, including the raw bits of an escape
+ */
+
+static uint32_t codeword_len(const struct cmp_encoder *enc, uint32_t mapped)
+{
+	switch (enc->encoder_type) {
+	case CMP_ENCODER_UNCOMPRESSED:
+		break;
+
+	case CMP_ENCODER_GOLOMB_ZERO:
+		if (mapped < enc->outlier)
+			return golomb_codeword_len(mapped + 1, enc->g_par, enc->g_par_log2);
+		return enc->g_par_log2 + 1 + CMP_NUM_BITS_PER_SAMPLE;
+
+	case CMP_ENCODER_GOLOMB_MULTI: {
+		unsigned int level;
+
+		if (mapped < enc->outlier)
+			return golomb_codeword_len(mapped, enc->g_par, enc->g_par_log2);
+
+		level = multi_escape_level(enc, mapped);
+		return golomb_codeword_len(enc->outlier + level, enc->g_par, enc->g_par_log2) +
+		       (level + 1) * 2;
+	}
+	}
+
+	return CMP_NUM_BITS_PER_SAMPLE;
+}
+
+
+void cmp_encoder_stats_s16(const struct cmp_encoder *enc, int16_t value,
+			   struct cmp_stats *stats)
+{
+	uint32_t const mapped = (uint16_t)map_to_unsigned(value, bitsizeof(value));
+	uint32_t const len = codeword_len(enc, mapped);
+
+	compile_time_assert(CMP_STATS_NUM_ESCAPE_LEVELS == (CMP_NUM_BITS_PER_SAMPLE + 1) / 2,
+			    stats_escape_levels_mismatch);
+	compile_time_assert(CMP_STATS_MAX_CODEWORD_BITS == CMP_MAX_BITS_PER_SAMPLE,
+			    stats_codeword_bits_mismatch);
+
+	if (enc->encoder_type == CMP_ENCODER_GOLOMB_ZERO && mapped >= enc->outlier)
+		stats->num_zero_escapes++;
+	if (enc->encoder_type == CMP_ENCODER_GOLOMB_MULTI && mapped >= enc->outlier)
+		stats->num_multi_escapes[multi_escape_level(enc, mapped)]++;
+
+	stats->num_samples++;
+	stats->codeword_len_hist[min_u32(len, CMP_STATS_MAX_CODEWORD_BITS)]++;
+	if (value < stats->min_residual)
+		stats->min_residual = value;
+	if (value > stats->max_residual)
+		stats->max_residual = value;
+}
+
+
+void cmp_encoder_hist_add_s16(int16_t value, uint32_t *residual_hist)
+{
+	residual_hist[(uint16_t)map_to_unsigned(value, bitsizeof(value))]++;
+}
+
+
+uint64_t cmp_encoder_hist_bits(const struct cmp_encoder *enc, const uint32_t *residual_hist)
+{
+	uint64_t bits = 0;
+	uint32_t mapped;
+
+	compile_time_assert(CMP_RESIDUAL_HIST_SIZE == 1U << CMP_NUM_BITS_PER_SAMPLE,
+			    residual_hist_size_mismatch);
+
+	for (mapped = 0; mapped < CMP_RESIDUAL_HIST_SIZE; mapped++)
+		if (residual_hist[mapped])
+			bits += (uint64_t)residual_hist[mapped] * codeword_len(enc, mapped);
+
+	return bits;
+}
+
+
+uint32_t cmp_encoder_max_bits_per_sample(const struct cmp_encoder *enc)
+{
+	uint32_t const max_mapped = (1U << CMP_NUM_BITS_PER_SAMPLE) - 1;
+	uint32_t len;
+
+	/* the codeword length grows with the value, except for the zero escape */
+	len = codeword_len(enc, max_mapped);
+	if (enc->encoder_type == CMP_ENCODER_GOLOMB_ZERO && enc->outlier <= max_mapped)
+		len = max_u32(len, codeword_len(enc, enc->outlier - 1));
+
+	return len;
+}
+
+
 uint64_t cmp_encoder_max_compressed_size(uint32_t size)
 {
 	uint64_t const n_samples = DIV_ROUND_UP((uint64_t)size * 8, CMP_NUM_BITS_PER_SAMPLE);
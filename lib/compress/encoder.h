@@ -83,6 +83,47 @@ void cmp_encoder_encode_s16(const struct cmp_encoder *enc, int16_t value,
 			    struct bitstream_writer *bs);
 
 
+/**
+ * @brief Records how a 16-bit signed sample is encoded
+ *
+ * Updates the sample count, the escape counts, the codeword length histogram
+ * and the residual range of the statistics for the codeword that
+ * cmp_encoder_encode_s16() writes for the value; nothing is written.
+ *
+ * @param enc		Pointer to a successful initialised encoder structure
+ * @param value		16-bit signed sample to record
+ * @param stats		Pointer to the statistics to update
+ */
+
+void cmp_encoder_stats_s16(const struct cmp_encoder *enc, int16_t value,
+			   struct cmp_stats *stats);
+
+
+/**
+ * @brief Counts a 16-bit signed sample in a residual histogram
+ *
+ * @param value		16-bit signed sample to count
+ * @param residual_hist	Histogram of CMP_RESIDUAL_HIST_SIZE entries, indexed by
+ *			the ZigZag mapped residuals
+ */
+
+void cmp_encoder_hist_add_s16(int16_t value, uint32_t *residual_hist);
+
+
+/**
+ * @brief Calculates the number of bits needed to encode a residual histogram
+ *
+ * @param enc		Pointer to a successful initialised encoder structure
+ * @param residual_hist	Histogram of CMP_RESIDUAL_HIST_SIZE entries, indexed by
+ *			the ZigZag mapped residuals
+ *
+ * @returns the sum of the codeword lengths cmp_encoder_encode_s16() writes for
+ *	the counted residuals in bits
+ */
+
+uint64_t cmp_encoder_hist_bits(const struct cmp_encoder *enc, const uint32_t *residual_hist);
+
+
 /**
  * @brief Checks if the given encoder type and parameter are valid
  *
@@ -97,6 +138,18 @@ uint32_t cmp_encoder_params_check(enum cmp_encoder_type encoder_type, uint32_t e
 				  uint32_t outlier);
 
 
+/**
+ * @brief Calculates the longest codeword the encoder can produce for a sample
+ *
+ * @param enc	Pointer to a successful initialised encoder structure
+ *
+ * @returns the maximum number of bits needed to encode a single 16-bit sample
+ *	with the given encoder configuration
+ */
+
+uint32_t cmp_encoder_max_bits_per_sample(const struct cmp_encoder *enc);
+
+
 /**
  * @brief Calculates the maximum worst cased compressed size
  *
@@ -198,11 +198,12 @@ static void iwt_multi_level_decomposition_i16(const struct sample_desc *src_desc
 		return;
 	}
 
-	if (src_desc->type == CMP_I16_IN_I32) {
+	if (src_desc->type != CMP_I16 && src_desc->type != CMP_U16) {
 		uint32_t i;
 		/*
-		 * For non-contiguous 16-bit samples stored in 32-bit words,
-		 * we need to pack them into a contiguous array first.
+		 * For non-contiguous 16-bit samples stored in 32-bit words or
+		 * big-endian samples, we need to pack them into a contiguous
+		 * array in CPU byte order first.
 		 * TODO: Optimize by adding a stride parameter to
 		 * iwt_single_level_i16() to process non-contiguous data
 		 * directly.
@@ -221,6 +222,95 @@ static void iwt_multi_level_decomposition_i16(const struct sample_desc *src_desc
 }
 
 
+/**
+ * @brief Reverts a single level integer wavelet transform (IWT) in-place
+ *
+ * @param y	pointer to the coefficients of a level; replaced by the input
+ *		of that level
+ * @param n	total number of int16_t samples in the buffer
+ * @param s	stride used for the forward transform of this level
+ *
+ * @see iwt_single_level_i16() for the coefficient arrangement
+ */
+
+static void iwt_inverse_single_level_i16(int16_t *y, size_t n, size_t s)
+{
+	size_t i;
+
+	if (s >= n)
+		return;
+
+	/* even indexes first, they only depend on the odd coefficients */
+	y[0] = (int16_t)(y[0] - floor_division_by_2(y[s]));
+	for (i = 2 * s; i + s < n; i += 2 * s)
+		y[i] = (int16_t)(y[i] - floor_division_by_4(y[i - s] + y[i + s]));
+	if (i < n)
+		y[i] = (int16_t)(y[i] - floor_division_by_2(y[i - s]));
+
+	/* now the odd indexes can be restored from their neighbours */
+	for (i = 0; i + 2 * s < n; i += 2 * s)
+		y[i + s] = (int16_t)(y[i + s] + floor_division_by_2(y[i] + y[i + 2 * s]));
+	if (i + s < n)
+		y[i + s] = (int16_t)(y[i + s] + y[i]);
+}
+
+
+void iwt_inverse_i16(int16_t *data, uint32_t num_samples)
+{
+	size_t stride = 1;
+
+	while (stride < num_samples)
+		stride <<= 1;
+
+	for (stride >>= 1; stride > 0; stride >>= 1)
+		iwt_inverse_single_level_i16(data, num_samples, stride);
+}
+
+
+/**
+ * @brief Reverts a single level IWT in-place for 16-bit samples stored in
+ *	32-bit words
+ *
+ * @param y	pointer to the sign-extended coefficients of a level; replaced
+ *		by the input of that level
+ * @param n	total number of samples in the buffer
+ * @param s	stride used for the forward transform of this level
+ *
+ * @see iwt_inverse_single_level_i16()
+ */
+
+static void iwt_inverse_single_level_i16_in_i32(int32_t *y, size_t n, size_t s)
+{
+	size_t i;
+
+	if (s >= n)
+		return;
+
+	y[0] = (int16_t)(y[0] - floor_division_by_2(y[s]));
+	for (i = 2 * s; i + s < n; i += 2 * s)
+		y[i] = (int16_t)(y[i] - floor_division_by_4(y[i - s] + y[i + s]));
+	if (i < n)
+		y[i] = (int16_t)(y[i] - floor_division_by_2(y[i - s]));
+
+	for (i = 0; i + 2 * s < n; i += 2 * s)
+		y[i + s] = (int16_t)(y[i + s] + floor_division_by_2(y[i] + y[i + 2 * s]));
+	if (i + s < n)
+		y[i + s] = (int16_t)(y[i + s] + y[i]);
+}
+
+
+void iwt_inverse_i16_in_i32(int32_t *data, uint32_t num_samples)
+{
+	size_t stride = 1;
+
+	while (stride < num_samples)
+		stride <<= 1;
+
+	for (stride >>= 1; stride > 0; stride >>= 1)
+		iwt_inverse_single_level_i16_in_i32(data, num_samples, stride);
+}
+
+
 /* ====== Preprocessing Method Functions ====== */
 /**
  * @brief Calculates the required work buffer size for none preprocessing
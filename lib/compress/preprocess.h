@@ -68,4 +68,28 @@ struct preprocessing_method {
 const struct preprocessing_method *preprocessing_get_method(enum cmp_preprocessing type);
 
 
+/**
+ * @brief Reverts the multi level IWT decomposition of the IWT preprocessing
+ *	in-place
+ *
+ * @param data		pointer to the IWT coefficients; replaced by the
+ *			original samples
+ * @param num_samples	number of int16_t samples in data
+ */
+
+void iwt_inverse_i16(int16_t *data, uint32_t num_samples);
+
+
+/**
+ * @brief Reverts the IWT decomposition in-place for 16-bit samples stored in
+ *	32-bit words
+ *
+ * @param data		pointer to the sign-extended IWT coefficients; replaced
+ *			by the sign-extended original samples
+ * @param num_samples	number of samples in data
+ */
+
+void iwt_inverse_i16_in_i32(int32_t *data, uint32_t num_samples);
+
+
 #endif /* CMP_PREPROCESS_H */
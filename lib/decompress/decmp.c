@@ -0,0 +1,591 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Data decompression implementation
+ *
+ * A frame is decompressed in whole-block passes: first all samples are decoded
+ * into the destination buffer, then the preprocessing is reverted in-place and
+ * at last the checksum is verified.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "decoder.h"
+#include "../cmp_decompress.h"
+#include "../compress/preprocess.h"
+#include "../common/bitstream_reader.h"
+#include "../common/header_private.h"
+#include "../common/sample_reader.h"
+#include "../common/err_private.h"
+#include "../common/model.h"
+#include "../common/bithacks.h"
+#include "../common/compiler.h"
+
+#define CMP_DECOMPRESS_MAGIC 0x44434D50U /* "DCMP" */
+
+/** Number of samples decoded at once into 32-bit words */
+#define DECODE_CHUNK_SAMPLES 256
+
+
+/**
+ * @brief Reads and checks the header of a compressed frame
+ *
+ * @param src		pointer to the start of a compressed frame
+ * @param src_size	number of readable bytes at src
+ * @param hdr		filled with the header of the frame
+ *
+ * @returns the size of the header, or an error, which can be checked using
+ *	cmp_is_error()
+ */
+
+static uint32_t frame_read_header(const void *src, uint32_t src_size, struct cmp_hdr *hdr)
+{
+	uint32_t hdr_size, min_size;
+
+	if (!src)
+		return CMP_ERROR(SRC_NULL);
+	if (src_size < CMP_HDR_SIZE)
+		return CMP_ERROR(SRC_SIZE_WRONG);
+
+	hdr_size = cmp_hdr_deserialize(src, src_size, hdr);
+	if (cmp_is_error_int(hdr_size))
+		return CMP_ERROR(SRC_SIZE_WRONG);
+
+	if (hdr->version_flag != 1 || hdr->version_id != CMP_VERSION_NUMBER)
+		return CMP_ERROR(HDR_VERSION_UNSUPPORTED);
+
+	min_size = hdr_size;
+	if (hdr->checksum_enabled)
+		min_size += (uint32_t)CMP_CHECKSUM_SIZE;
+	if (hdr->compressed_size < min_size)
+		return CMP_ERROR(FRAME_CORRUPTED);
+	if (hdr->original_size == 0 || hdr->original_size % sizeof(int16_t))
+		return CMP_ERROR(FRAME_CORRUPTED);
+
+	switch (hdr->preprocessing) {
+	case CMP_PREPROCESS_NONE:
+	case CMP_PREPROCESS_DIFF:
+	case CMP_PREPROCESS_IWT:
+		break;
+	case CMP_PREPROCESS_MODEL:
+		/* a model is only available after a primary frame */
+		if (hdr->sequence_number == 0 || hdr->model_rate > CMP_MAX_MODEL_RATE)
+			return CMP_ERROR(FRAME_CORRUPTED);
+		return hdr_size;
+	default:
+		return CMP_ERROR(FRAME_CORRUPTED);
+	}
+
+	/* only model frames belong to a chain with a loaded model */
+	if (hdr->model_preloaded)
+		return CMP_ERROR(FRAME_CORRUPTED);
+
+	return hdr_size;
+}
+
+
+uint32_t cmp_get_original_size(const void *src, uint32_t src_size)
+{
+	struct cmp_hdr hdr;
+	uint32_t const ret = frame_read_header(src, src_size, &hdr);
+
+	if (cmp_is_error_int(ret))
+		return ret;
+	return hdr.original_size;
+}
+
+
+uint32_t cmp_get_compressed_size(const void *src, uint32_t src_size)
+{
+	struct cmp_hdr hdr;
+	uint32_t const ret = frame_read_header(src, src_size, &hdr);
+
+	if (cmp_is_error_int(ret))
+		return ret;
+	return hdr.compressed_size;
+}
+
+
+uint32_t cmp_get_frame_info(const void *src, uint32_t src_size, struct cmp_frame_info *info)
+{
+	struct cmp_hdr hdr;
+	uint32_t hdr_size;
+
+	if (info == NULL)
+		return CMP_ERROR(GENERIC);
+
+	hdr_size = frame_read_header(src, src_size, &hdr);
+	if (cmp_is_error_int(hdr_size))
+		return hdr_size;
+	if (hdr.compressed_size > src_size)
+		return CMP_ERROR(SRC_SIZE_WRONG);
+
+	memset(info, 0, sizeof(*info));
+	info->compressed_size = hdr.compressed_size;
+	info->original_size = hdr.original_size;
+	info->header_size = hdr_size;
+	info->identifier = hdr.identifier;
+	info->sequence_number = hdr.sequence_number;
+	info->preprocessing = hdr.preprocessing;
+	info->encoder_type = hdr.encoder_type;
+	info->encoder_param = hdr.encoder_param;
+	info->encoder_outlier = hdr.encoder_outlier;
+	info->model_rate = hdr.model_rate;
+	info->model_preloaded = hdr.model_preloaded;
+	info->checksum_enabled = hdr.checksum_enabled;
+
+	return hdr.compressed_size;
+}
+
+
+void cmp_frame_iterator_init(struct cmp_frame_iterator *it, const void *src, size_t src_size)
+{
+	if (it == NULL)
+		return;
+
+	it->src = src;
+	it->src_size = src_size;
+	it->pos = 0;
+	it->error = src || !src_size ? CMP_ERROR(NO_ERROR) : CMP_ERROR(SRC_NULL);
+}
+
+
+uint32_t cmp_frame_iterator_next(struct cmp_frame_iterator *it, struct cmp_frame_info *info)
+{
+	size_t remaining;
+	uint32_t ret;
+
+	if (it == NULL)
+		return CMP_ERROR(GENERIC);
+	if (cmp_is_error_int(it->error))
+		return it->error;
+	if (it->pos >= it->src_size)
+		return 0;
+
+	/* a frame is smaller than 2^24 bytes, so this limit never cuts a frame */
+	remaining = it->src_size - it->pos;
+	if (remaining > UINT32_MAX)
+		remaining = UINT32_MAX;
+
+	ret = cmp_get_frame_info(it->src + it->pos, (uint32_t)remaining, info);
+	if (cmp_is_error_int(ret))
+		return it->error = ret;
+
+	info->offset = it->pos;
+	it->pos += ret;
+	return ret;
+}
+
+
+uint32_t cmp_decompress_initialise(struct cmp_decompress_context *dctx, void *work_buf,
+				   uint32_t work_buf_size)
+{
+	if (dctx == NULL)
+		return CMP_ERROR(GENERIC);
+	cmp_decompress_deinitialise(dctx);
+
+	if (work_buf == NULL && work_buf_size != 0)
+		return CMP_ERROR(WORK_BUF_NULL);
+	if ((uintptr_t)work_buf & (sizeof(int16_t) - 1))
+		return CMP_ERROR(WORK_BUF_UNALIGNED);
+
+	dctx->work_buf = work_buf;
+	dctx->work_buf_size = work_buf_size;
+	dctx->magic = CMP_DECOMPRESS_MAGIC;
+
+	return cmp_decompress_reset(dctx);
+}
+
+
+/**
+ * @brief Sets up the decoder of a frame; the decoding table is only rebuilt
+ *	if the encoder settings changed since the last frame
+ *
+ * @param dctx	pointer to a decompression context
+ * @param hdr	pointer to the header of the frame
+ * @param dec	pointer to the decoder to initialise
+ *
+ * @returns an error, which can be checked using cmp_is_error()
+ */
+
+static uint32_t decoder_setup(struct cmp_decompress_context *dctx, const struct cmp_hdr *hdr,
+			      struct cmp_decoder *dec)
+{
+	uint32_t const ret = cmp_decoder_init(dec, hdr->encoder_type, hdr->encoder_param,
+					      hdr->encoder_outlier);
+
+	compile_time_assert(ARRAY_SIZE(dctx->table) == CMP_DECODER_TABLE_SIZE,
+			    decoding_table_size_mismatch);
+
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	if (hdr->encoder_type == CMP_ENCODER_UNCOMPRESSED)
+		return CMP_ERROR(NO_ERROR);
+
+	if (dctx->table_encoder[0] != (uint32_t)hdr->encoder_type ||
+	    dctx->table_encoder[1] != hdr->encoder_param ||
+	    dctx->table_encoder[2] != hdr->encoder_outlier) {
+		cmp_decoder_build_table(dec, dctx->table);
+		dctx->table_encoder[0] = hdr->encoder_type;
+		dctx->table_encoder[1] = hdr->encoder_param;
+		dctx->table_encoder[2] = hdr->encoder_outlier;
+	}
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+/** Decodes 16-bit samples and sign-extends them into 32-bit words */
+static uint32_t decode_i16_in_i32(const struct cmp_decoder *dec, const uint64_t *table,
+				  struct bitstream_reader *br, int32_t *dst,
+				  uint32_t num_samples)
+{
+	int16_t chunk[DECODE_CHUNK_SAMPLES];
+	uint32_t i, j;
+
+	for (i = 0; i < num_samples; i += ARRAY_SIZE(chunk)) {
+		uint32_t const n = min_u32(ARRAY_SIZE(chunk), num_samples - i);
+		uint32_t const ret = cmp_decoder_decode_s16(dec, table, br, chunk, n);
+
+		if (cmp_is_error_int(ret))
+			return ret;
+		for (j = 0; j < n; j++)
+			dst[i + j] = chunk[j];
+	}
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+/** Reverts the 1d difference preprocessing */
+static void diff_inverse(int16_t *samples, uint32_t num_samples)
+{
+	uint32_t i;
+
+	for (i = 1; i < num_samples; i++)
+		samples[i] = (int16_t)(samples[i] + samples[i - 1]);
+}
+
+
+/** Reverts the 1d difference preprocessing of samples stored in 32-bit words */
+static void diff_inverse_i16_in_i32(int32_t *samples, uint32_t num_samples)
+{
+	uint32_t i;
+
+	for (i = 1; i < num_samples; i++)
+		samples[i] = (int16_t)(samples[i] + samples[i - 1]);
+}
+
+
+/** Reverts the model preprocessing and updates the model */
+static void model_inverse(int16_t *samples, int16_t *model, uint32_t num_samples,
+			  int model_rate, enum cmp_type type)
+{
+	uint32_t i;
+
+	for (i = 0; i < num_samples; i++) {
+		int16_t const sample = (int16_t)(samples[i] + model[i]);
+
+		samples[i] = sample;
+		model[i] = update_model(sample, model[i], model_rate, type);
+	}
+}
+
+
+/** Reverts the model preprocessing of samples stored in 32-bit words */
+static void model_inverse_i16_in_i32(int32_t *samples, int16_t *model, uint32_t num_samples,
+				     int model_rate)
+{
+	uint32_t i;
+
+	for (i = 0; i < num_samples; i++) {
+		int16_t const sample = (int16_t)(samples[i] + model[i]);
+
+		samples[i] = sample;
+		model[i] = update_model(sample, model[i], model_rate, CMP_I16_IN_I32);
+	}
+}
+
+
+/**
+ * @brief Decodes the samples of a frame and reverts the preprocessing
+ *
+ * @param hdr		header of the frame
+ * @param dec		pointer to an initialised decoder
+ * @param table		decoding table of the decoder
+ * @param br		pointer to the bitstream reader of the frame
+ * @param dst		buffer for the samples; int32_t for CMP_I16_IN_I32,
+ *			otherwise int16_t or uint16_t
+ * @param model		model of the frame; NULL if no model is used
+ * @param num_samples	number of samples in the frame
+ * @param type		type of the samples
+ *
+ * @returns an error, which can be checked using cmp_is_error()
+ */
+
+static uint32_t decode_samples(const struct cmp_hdr *hdr, const struct cmp_decoder *dec,
+			       const uint64_t *table, struct bitstream_reader *br, void *dst,
+			       int16_t *model, uint32_t num_samples, enum cmp_type type)
+{
+	uint32_t ret;
+
+	if (type == CMP_I16_IN_I32)
+		ret = decode_i16_in_i32(dec, table, br, dst, num_samples);
+	else
+		ret = cmp_decoder_decode_s16(dec, table, br, dst, num_samples);
+	if (cmp_is_error_int(ret))
+		return ret;
+	if (bitstream_overflowed(br))
+		return CMP_ERROR(FRAME_CORRUPTED);
+
+	switch (hdr->preprocessing) {
+	case CMP_PREPROCESS_NONE:
+		break;
+	case CMP_PREPROCESS_DIFF:
+		if (type == CMP_I16_IN_I32)
+			diff_inverse_i16_in_i32(dst, num_samples);
+		else
+			diff_inverse(dst, num_samples);
+		break;
+	case CMP_PREPROCESS_IWT:
+		if (type == CMP_I16_IN_I32)
+			iwt_inverse_i16_in_i32(dst, num_samples);
+		else
+			iwt_inverse_i16(dst, num_samples);
+		break;
+	case CMP_PREPROCESS_MODEL:
+		if (type == CMP_I16_IN_I32)
+			model_inverse_i16_in_i32(dst, model, num_samples, (int)hdr->model_rate);
+		else
+			model_inverse(dst, model, num_samples, (int)hdr->model_rate, type);
+		break;
+	default:
+		return CMP_ERROR(FRAME_CORRUPTED);
+	}
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+/**
+ * @brief Decompresses a frame into 16-bit samples
+ *
+ * @param dctx		pointer to a decompression context
+ * @param dst		buffer for the decompressed samples
+ * @param dst_capacity	capacity of the destination buffer in bytes
+ * @param src		pointer to the compressed frame
+ * @param src_size	size of the source buffer in bytes
+ * @param type		type of the samples in the destination buffer
+ *
+ * @returns the number of decompressed samples, or an error, which can be
+ *	checked using cmp_is_error()
+ */
+
+static uint32_t decompress_engine(struct cmp_decompress_context *dctx, void *dst,
+				  uint32_t dst_capacity, const void *src, uint32_t src_size,
+				  enum cmp_type type)
+{
+	struct cmp_hdr hdr;
+	struct cmp_decoder dec;
+	struct bitstream_reader br;
+	int16_t *model = NULL;
+	uint32_t const stride = type == CMP_I16_IN_I32 ? sizeof(int32_t) : sizeof(int16_t);
+	uint32_t hdr_size, data_size, num_samples, ret;
+
+	if (dctx == NULL)
+		return CMP_ERROR(GENERIC);
+	if (dctx->magic != CMP_DECOMPRESS_MAGIC)
+		return CMP_ERROR(CONTEXT_INVALID);
+	if (dst == NULL)
+		return CMP_ERROR(DST_NULL);
+	if ((uintptr_t)dst & (stride - 1))
+		return CMP_ERROR(DST_UNALIGNED);
+
+	hdr_size = frame_read_header(src, src_size, &hdr);
+	if (cmp_is_error_int(hdr_size))
+		return hdr_size;
+	if (hdr.compressed_size > src_size)
+		return CMP_ERROR(SRC_SIZE_WRONG);
+
+	num_samples = hdr.original_size / sizeof(int16_t);
+	if ((uint64_t)num_samples * stride > dst_capacity)
+		return CMP_ERROR(DST_TOO_SMALL);
+
+	if (hdr.preprocessing == CMP_PREPROCESS_MODEL) {
+		if (dctx->model_size != hdr.original_size || dctx->identifier != hdr.identifier ||
+		    dctx->sequence_number + 1 != hdr.sequence_number ||
+		    dctx->model_preloaded != hdr.model_preloaded)
+			return CMP_ERROR(MODEL_MISMATCH);
+		model = dctx->work_buf;
+	}
+
+	ret = decoder_setup(dctx, &hdr, &dec);
+	if (cmp_is_error_int(ret))
+		return ret;
+
+	data_size = hdr.compressed_size - hdr_size;
+	if (hdr.checksum_enabled)
+		data_size -= (uint32_t)CMP_CHECKSUM_SIZE;
+	bitstream_reader_init(&br, (const uint8_t *)src + hdr_size, data_size);
+
+	ret = decode_samples(&hdr, &dec, dctx->table, &br, dst, model, num_samples, type);
+	if (cmp_is_error_int(ret))
+		return ret;
+	if (model)
+		dctx->sequence_number = hdr.sequence_number;
+
+	if (hdr.checksum_enabled) {
+		const uint8_t *checksum_pos = (const uint8_t *)src + hdr.compressed_size -
+					      CMP_CHECKSUM_SIZE;
+		uint32_t const checksum = (uint32_t)checksum_pos[0] << 24 |
+					  (uint32_t)checksum_pos[1] << 16 |
+					  (uint32_t)checksum_pos[2] << 8 | checksum_pos[3];
+		struct sample_desc desc;
+
+		desc.data = dst;
+		desc.num_samples = num_samples;
+		desc.stride = (uint8_t)stride;
+		desc.type = type == CMP_I16_IN_I32 ? CMP_I16_IN_I32 : CMP_I16;
+		if (cmp_checksum(&desc) != checksum) {
+			if (model)
+				dctx->model_size = 0; /* the updated model is useless */
+			return CMP_ERROR(CHECKSUM_MISMATCH);
+		}
+	}
+
+	/* every primary frame starts a new model */
+	if (hdr.sequence_number == 0) {
+		if (dctx->work_buf_size >= hdr.original_size) {
+			if (type == CMP_I16_IN_I32) {
+				const int32_t *samples = dst;
+				int16_t *first_model = dctx->work_buf;
+				uint32_t i;
+
+				for (i = 0; i < num_samples; i++)
+					first_model[i] = (int16_t)samples[i];
+			} else {
+				memcpy(dctx->work_buf, dst, hdr.original_size);
+			}
+			dctx->model_size = hdr.original_size;
+			dctx->identifier = hdr.identifier;
+			dctx->sequence_number = 0;
+			dctx->model_preloaded = 0;
+		} else {
+			dctx->model_size = 0;
+		}
+	}
+
+	return num_samples;
+}
+
+
+uint32_t cmp_decompress_i16(struct cmp_decompress_context *dctx, int16_t *dst,
+			    uint32_t dst_capacity, const void *src, uint32_t src_size)
+{
+	uint32_t const ret = decompress_engine(dctx, dst, dst_capacity, src, src_size, CMP_I16);
+
+	if (cmp_is_error_int(ret))
+		return ret;
+	return ret * sizeof(*dst);
+}
+
+
+uint32_t cmp_decompress_i16_in_i32(struct cmp_decompress_context *dctx, int32_t *dst,
+				   uint32_t dst_capacity, const void *src, uint32_t src_size)
+{
+	uint32_t const ret = decompress_engine(dctx, dst, dst_capacity, src, src_size,
+					       CMP_I16_IN_I32);
+
+	if (cmp_is_error_int(ret))
+		return ret;
+	return ret * sizeof(*dst);
+}
+
+
+uint32_t cmp_decompress_u16(struct cmp_decompress_context *dctx, uint16_t *dst,
+			    uint32_t dst_capacity, const void *src, uint32_t src_size)
+{
+	uint32_t const ret = decompress_engine(dctx, dst, dst_capacity, src, src_size, CMP_U16);
+
+	if (cmp_is_error_int(ret))
+		return ret;
+	return ret * sizeof(*dst);
+}
+
+
+uint32_t cmp_decompress_reset(struct cmp_decompress_context *dctx)
+{
+	if (dctx == NULL)
+		return CMP_ERROR(GENERIC);
+
+	if (dctx->magic != CMP_DECOMPRESS_MAGIC)
+		return CMP_ERROR(CONTEXT_INVALID);
+
+	dctx->model_size = 0;
+	dctx->identifier = 0;
+	dctx->sequence_number = 0;
+	dctx->model_preloaded = 0;
+	/* no valid encoder type, forces a table rebuild */
+	dctx->table_encoder[0] = UINT32_MAX;
+
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+/* loads the reference samples as the model of a warm-started chain */
+static uint32_t decompress_load_model(struct cmp_decompress_context *dctx,
+				      const void *reference, uint32_t reference_size,
+				      uint64_t reference_id)
+{
+	if (dctx == NULL)
+		return CMP_ERROR(GENERIC);
+
+	if (dctx->magic != CMP_DECOMPRESS_MAGIC)
+		return CMP_ERROR(CONTEXT_INVALID);
+
+	if (reference_id >> CMP_HDR_BITS_IDENTIFIER)
+		return CMP_ERROR(PARAMS_INVALID);
+
+	if (reference == NULL)
+		return CMP_ERROR(SRC_NULL);
+
+	if (reference_size == 0 || reference_size % sizeof(int16_t))
+		return CMP_ERROR(SRC_SIZE_WRONG);
+
+	if (dctx->work_buf_size < reference_size)
+		return CMP_ERROR(WORK_BUF_TOO_SMALL);
+
+	memcpy(dctx->work_buf, reference, reference_size);
+	dctx->model_size = reference_size;
+	dctx->identifier = reference_id;
+	/* the reference takes the place of the primary frame */
+	dctx->sequence_number = 0;
+	dctx->model_preloaded = 1;
+
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+uint32_t cmp_decompress_load_model_u16(struct cmp_decompress_context *dctx,
+				       const uint16_t *reference, uint32_t reference_size,
+				       uint64_t reference_id)
+{
+	return decompress_load_model(dctx, reference, reference_size, reference_id);
+}
+
+
+uint32_t cmp_decompress_load_model_i16(struct cmp_decompress_context *dctx,
+				       const int16_t *reference, uint32_t reference_size,
+				       uint64_t reference_id)
+{
+	return decompress_load_model(dctx, reference, reference_size, reference_id);
+}
+
+
+void cmp_decompress_deinitialise(struct cmp_decompress_context *dctx)
+{
+	if (dctx)
+		memset(dctx, 0, sizeof(*dctx));
+}
@@ -0,0 +1,330 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Data Decompression Decoder Implementation
+ *
+ * The Golomb code of the encoder is a canonical prefix code: the cutoff
+ * smallest values have codewords of g_par_log2 + 1 bits, every following group
+ * of g_par values is one bit longer than the group before. A codeword longer
+ * than g_par_log2 + 1 bits is a run of ones followed by a (g_par_log2 + 2) bit
+ * field f with 2 * cutoff <= f < 3 * 2^g_par_log2. The field never starts with
+ * two ones, so the group can be found from the number of leading ones.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "decoder.h"
+#include "../compress/encoder.h"
+#include "../common/bitstream_reader.h"
+#include "../common/err_private.h"
+#include "../common/compiler.h"
+
+/** Number of values a decoding table entry can hold */
+#define TABLE_ENTRY_MAX_VALUES 3
+
+/** Number of table lookups a refilled bitstream reader cache serves */
+#define LOOKUPS_PER_REFILL (BITSTREAM_MIN_CACHE_BITS / CMP_DECODER_TABLE_BITS)
+
+/** Highest escape level the multi escape mechanism uses for 16-bit samples */
+#define MULTI_ESCAPE_MAX_LEVEL ((CMP_NUM_BITS_PER_SAMPLE - 1) / 2)
+
+/** Marks a codeword length of an invalid codeword */
+#define INVALID_CODEWORD_LEN 64
+
+
+/**
+ * @brief Reverts the ZigZag mapping of the encoder
+ *
+ * @param mapped	ZigZag encoded value; must be smaller than 2^16
+ *
+ * @returns the signed 16-bit value
+ */
+
+static __inline int16_t map_to_signed(uint32_t mapped)
+{
+	return (int16_t)(uint16_t)((mapped >> 1) ^ (0U - (mapped & 1U)));
+}
+
+
+/**
+ * @brief Decodes a Golomb codeword
+ *
+ * @param dec	pointer to an initialised Golomb decoder
+ * @param w	bitstream window with the codeword starting at the MSB
+ * @param len	filled with the length of the codeword in bits; larger than
+ *		CMP_MAX_BITS_GOLOMB_CW if the window starts with no valid
+ *		codeword
+ *
+ * @returns the decoded value
+ */
+
+static __inline uint32_t golomb_decode(const struct cmp_decoder *dec, uint64_t w,
+				       unsigned int *len)
+{
+	unsigned int const l = dec->g_par_log2;
+	uint32_t const first = (uint32_t)(w >> (63 - l));
+	unsigned int group;
+	uint32_t f;
+
+	if (first < dec->cutoff) {
+		*len = l + 1;
+		return first;
+	}
+
+	if (~w == 0) {
+		*len = INVALID_CODEWORD_LEN;
+		return 0;
+	}
+	group = (unsigned int)__builtin_clzll(~w);
+	f = (uint32_t)((w << group) >> (62 - l));
+	if (f < 2 * dec->cutoff) {
+		/* the last leading one belongs to the field */
+		group--;
+		f = (uint32_t)((w << group) >> (62 - l));
+	}
+
+	*len = l + 2 + group;
+	return dec->cutoff + group * dec->g_par + f - 2 * dec->cutoff;
+}
+
+
+/**
+ * @brief Decodes a single Golomb encoded sample including escape symbols
+ *
+ * @param dec	pointer to an initialised Golomb decoder
+ * @param br	pointer to a refilled bitstream reader
+ * @param value	filled with the decoded sample
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+static __inline uint32_t decode_symbol(const struct cmp_decoder *dec,
+				       struct bitstream_reader *br, int16_t *value)
+{
+	uint64_t const w = bitstream_peek(br);
+	unsigned int len;
+	uint32_t const g_value = golomb_decode(dec, w, &len);
+	uint32_t mapped;
+
+	if (len > CMP_MAX_BITS_GOLOMB_CW)
+		return CMP_ERROR(FRAME_CORRUPTED);
+
+	if (dec->encoder_type == CMP_ENCODER_GOLOMB_ZERO) {
+		if (g_value == 0) {
+			/* raw mapped sample follows the escape symbol */
+			mapped = (uint32_t)((w << len) >> (64 - CMP_NUM_BITS_PER_SAMPLE));
+			len += CMP_NUM_BITS_PER_SAMPLE;
+		} else {
+			mapped = g_value - 1;
+		}
+	} else {
+		if (g_value < dec->outlier) {
+			mapped = g_value;
+		} else {
+			uint32_t const level = g_value - dec->outlier;
+			unsigned int const n_raw = (level + 1) * 2;
+
+			if (level > MULTI_ESCAPE_MAX_LEVEL)
+				return CMP_ERROR(FRAME_CORRUPTED);
+			mapped = dec->outlier + (uint32_t)((w << len) >> (64 - n_raw));
+			len += n_raw;
+		}
+	}
+	if (mapped > UINT16_MAX)
+		return CMP_ERROR(FRAME_CORRUPTED);
+
+	bitstream_skip(br, len);
+	*value = map_to_signed(mapped);
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+uint32_t cmp_decoder_init(struct cmp_decoder *dec, enum cmp_encoder_type encoder_type,
+			  uint32_t encoder_param, uint32_t outlier)
+{
+	if (!dec)
+		return CMP_ERROR(INT_DECODER);
+
+	memset(dec, 0, sizeof(*dec));
+	dec->encoder_type = encoder_type;
+
+	switch (encoder_type) {
+	case CMP_ENCODER_UNCOMPRESSED:
+		break;
+
+	case CMP_ENCODER_GOLOMB_ZERO:
+	case CMP_ENCODER_GOLOMB_MULTI:
+		if (encoder_param < CMP_MIN_GOLOMB_PAR || encoder_param > CMP_MAX_GOLOMB_PAR)
+			return CMP_ERROR(FRAME_CORRUPTED);
+		if (outlier == 0)
+			return CMP_ERROR(FRAME_CORRUPTED);
+		dec->g_par = encoder_param;
+		dec->g_par_log2 = 31 - (uint32_t)__builtin_clz(encoder_param);
+		dec->cutoff = (2U << dec->g_par_log2) - encoder_param;
+		dec->outlier = outlier;
+		break;
+
+	default:
+		return CMP_ERROR(FRAME_CORRUPTED);
+	}
+
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+void cmp_decoder_build_table(const struct cmp_decoder *dec, uint64_t *table)
+{
+	uint32_t i;
+
+	/*
+	 * Entry layout: bits 0-7 number of values, bits 8-15 number of
+	 * consumed bits, bits 16-63 up to three decoded samples
+	 */
+	for (i = 0; i < CMP_DECODER_TABLE_SIZE; i++) {
+		uint64_t const w = (uint64_t)i << (64 - CMP_DECODER_TABLE_BITS);
+		uint64_t entry = 0;
+		unsigned int pos = 0, count = 0;
+
+		while (count < TABLE_ENTRY_MAX_VALUES) {
+			unsigned int len;
+			uint32_t const g_value = golomb_decode(dec, w << pos, &len);
+			uint32_t mapped;
+
+			if (pos + len > CMP_DECODER_TABLE_BITS)
+				break;
+			if (dec->encoder_type == CMP_ENCODER_GOLOMB_ZERO) {
+				if (g_value == 0)
+					break; /* escape symbol */
+				mapped = g_value - 1;
+			} else {
+				if (g_value >= dec->outlier)
+					break; /* escape symbol */
+				mapped = g_value;
+			}
+			if (mapped > UINT16_MAX)
+				break;
+
+			entry |= (uint64_t)(uint16_t)map_to_signed(mapped) << (16 + 16 * count);
+			pos += len;
+			count++;
+		}
+		table[i] = entry | (uint64_t)pos << 8 | count;
+	}
+}
+
+
+/**
+ * @brief Reads uncompressed 16-bit samples
+ *
+ * @param br		pointer to an initialised bitstream reader
+ * @param dst		buffer to store the samples
+ * @param num_samples	number of samples to read
+ */
+
+static __inline void decode_uncompressed(struct bitstream_reader *br, int16_t *dst,
+					 uint32_t num_samples)
+{
+	uint32_t i;
+
+	compile_time_assert(3 * CMP_NUM_BITS_PER_SAMPLE <= BITSTREAM_MIN_CACHE_BITS,
+			    three_samples_do_not_fit_in_the_reader_cache);
+
+	for (i = 0; i + 3 <= num_samples; i += 3) {
+		uint64_t w;
+
+		bitstream_refill(br);
+		w = bitstream_peek(br);
+		dst[i] = (int16_t)(uint16_t)(w >> 48);
+		dst[i + 1] = (int16_t)(uint16_t)(w >> 32);
+		dst[i + 2] = (int16_t)(uint16_t)(w >> 16);
+		bitstream_skip(br, 3 * CMP_NUM_BITS_PER_SAMPLE);
+	}
+	for (; i < num_samples; i++)
+		dst[i] = (int16_t)bitstream_read32(br, CMP_NUM_BITS_PER_SAMPLE);
+}
+
+
+/**
+ * @brief Decodes Golomb encoded samples
+ *
+ * @param dec		pointer to an initialised Golomb decoder
+ * @param table		lookup table built for the decoder
+ * @param br		pointer to an initialised bitstream reader
+ * @param dst		buffer to store the decoded samples
+ * @param num_samples	number of samples to decode
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+static __inline uint32_t decode_golomb(const struct cmp_decoder *dec, const uint64_t *table,
+				       struct bitstream_reader *br, int16_t *dst,
+				       uint32_t num_samples)
+{
+	uint32_t i = 0;
+
+	compile_time_assert(CMP_MAX_BITS_GOLOMB_CW + CMP_NUM_BITS_PER_SAMPLE <=
+			    BITSTREAM_MIN_CACHE_BITS, codeword_does_not_fit_in_the_reader_cache);
+
+	/*
+	 * fast path: one lookup resolves up to three short codewords and one
+	 * refill serves several lookups
+	 */
+	while (i + TABLE_ENTRY_MAX_VALUES <= num_samples) {
+		unsigned int k = 0;
+		uint64_t entry;
+
+		bitstream_refill(br);
+		entry = table[bitstream_peek(br) >> (64 - CMP_DECODER_TABLE_BITS)];
+		if ((entry & 0xFF) == 0) {
+			uint32_t const err = decode_symbol(dec, br, &dst[i]);
+
+			if (cmp_is_error_int(err))
+				return err;
+			i++;
+			continue;
+		}
+		do {
+			dst[i] = (int16_t)(uint16_t)(entry >> 16);
+			dst[i + 1] = (int16_t)(uint16_t)(entry >> 32);
+			dst[i + 2] = (int16_t)(uint16_t)(entry >> 48);
+			i += (uint32_t)(entry & 0xFF);
+			bitstream_skip(br, (unsigned int)(entry >> 8) & 0xFF);
+			if (++k == LOOKUPS_PER_REFILL || i + TABLE_ENTRY_MAX_VALUES > num_samples)
+				break;
+			entry = table[bitstream_peek(br) >> (64 - CMP_DECODER_TABLE_BITS)];
+		} while (entry & 0xFF);
+	}
+
+	/* the last samples are decoded one by one */
+	for (; i < num_samples; i++) {
+		uint32_t err;
+
+		bitstream_refill(br);
+		err = decode_symbol(dec, br, &dst[i]);
+		if (cmp_is_error_int(err))
+			return err;
+	}
+
+	return CMP_ERROR(NO_ERROR);
+}
+
+
+uint32_t cmp_decoder_decode_s16(const struct cmp_decoder *dec, const uint64_t *table,
+				struct bitstream_reader *br, int16_t *dst, uint32_t num_samples)
+{
+	/* work on a local copy, so the compiler can keep the reader in registers */
+	struct bitstream_reader reader = *br;
+	uint32_t err = CMP_ERROR(NO_ERROR);
+
+	if (dec->encoder_type == CMP_ENCODER_UNCOMPRESSED)
+		decode_uncompressed(&reader, dst, num_samples);
+	else
+		err = decode_golomb(dec, table, &reader, dst, num_samples);
+
+	*br = reader;
+	return err;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Data Decompression Decoder Header File
+ */
+
+#ifndef CMP_DECODER_H
+#define CMP_DECODER_H
+
+#include <stdint.h>
+#include "../cmp.h"
+#include "../common/bitstream_reader.h"
+
+/** Number of bitstream bits resolved by a single decoding table lookup */
+#define CMP_DECODER_TABLE_BITS 12
+
+/** Number of entries of a decoding table */
+#define CMP_DECODER_TABLE_SIZE (1U << CMP_DECODER_TABLE_BITS)
+
+
+/**
+ * @brief Decompression decoder state structure
+ *
+ * @warning This structure MUST NOT be directly manipulated by external code.
+ *	Always use the provided API functions to interact with the structure.
+ */
+
+struct cmp_decoder {
+	enum cmp_encoder_type encoder_type; /** Algorithm used for encoding samples */
+
+	/* Golomb parameters (used only in GOLOMB modes, otherwise ignored) */
+	uint32_t g_par;      /**< Golomb parameter */
+	uint32_t g_par_log2; /**< Precomputed log2(Golomb parameter) */
+	uint32_t cutoff;     /**< Number of values with the shortest codeword */
+	uint32_t outlier;    /**< Threshold value for encoding outliers */
+};
+
+
+/**
+ * @brief Initialize a decompression decoder
+ *
+ * @param dec		Pointer to the decoder structure to initialize
+ * @param encoder_type	Type of encoder used to encode the samples
+ * @param encoder_param	Parameter of the encoder
+ * @param outlier	Outlier threshold the encoder used
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_decoder_init(struct cmp_decoder *dec, enum cmp_encoder_type encoder_type,
+			  uint32_t encoder_param, uint32_t outlier);
+
+
+/**
+ * @brief Builds the lookup table used to decode Golomb encoded samples
+ *
+ * Every entry resolves up to three consecutive codewords, which fit in the
+ * CMP_DECODER_TABLE_BITS bitstream bits the entry is indexed with. Escape
+ * symbols and longer codewords are left to the bit-by-bit decoder.
+ *
+ * @param dec	Pointer to a successful initialised Golomb decoder
+ * @param table	Table to fill; has to hold CMP_DECODER_TABLE_SIZE entries
+ */
+
+void cmp_decoder_build_table(const struct cmp_decoder *dec, uint64_t *table);
+
+
+/**
+ * @brief Decodes 16-bit signed samples
+ *
+ * @param dec		Pointer to a successful initialised decoder structure
+ * @param table		Lookup table built with cmp_decoder_build_table() for
+ *			the decoder; not used by the uncompressed decoder
+ * @param br		Pointer to an initialised bitstream reader
+ * @param dst		Buffer to store the decoded samples
+ * @param num_samples	Number of samples to decode
+ *
+ * @note Decoding past the end of the bitstream is not an error here, check
+ *	bitstream_overflowed() after the last samples are decoded.
+ *
+ * @returns an error code, which can be checked using cmp_is_error()
+ */
+
+uint32_t cmp_decoder_decode_s16(const struct cmp_decoder *dec, const uint64_t *table,
+				struct bitstream_reader *br, int16_t *dst, uint32_t num_samples);
+
+
+#endif /* CMP_DECODER_H */
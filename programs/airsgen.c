@@ -0,0 +1,292 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief airsgen - generates synthetic AIRS-like data for benchmarks
+ *
+ * Writes deterministic detector frames as 16-bit big-endian samples, which
+ * the AIRSPACE CLI compresses like flight data, so benchmarks can run on the
+ * same corpus on every machine.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lib/cmp_header.h"
+#include "../lib/common/byteorder_bulk.h"
+#include "datagen.h"
+#include "file.h"
+#include "log.h"
+#include "util.h"
+
+#define AIRSGEN_MAX_FRAMES 100000UL
+#define AIRSGEN_SUFFIX_FORMAT "%05lu.dat"
+#define AIRSGEN_SUFFIX_LEN 9
+
+
+static int parse_u32(const char *str, unsigned long min, unsigned long max, uint32_t *value)
+{
+	char *end;
+	unsigned long n;
+
+	errno = 0;
+	n = strtoul(str, &end, 10);
+	if (errno || end == str || *end != '\0' || str[0] == '-' || n < min || n > max)
+		return -1;
+
+	*value = (uint32_t)n;
+	return 0;
+}
+
+
+static int parse_double(const char *str, double min, double max, double *value)
+{
+	char *end;
+	double d;
+
+	errno = 0;
+	d = strtod(str, &end);
+	if (errno || end == str || *end != '\0' || !(d >= min && d <= max))
+		return -1;
+
+	*value = d;
+	return 0;
+}
+
+
+static void print_usage(FILE *stream, const char *program_name)
+{
+	LOG_F(stream, "Usage: %s [OPTIONS...] [-o PREFIX]\n", program_name);
+	LOG_F(stream, "Generate synthetic AIRS-like detector frames as 16-bit big-endian samples.\n\n");
+	LOG_F(stream, "Without -o, the frames are written one after the other to standard output.\n");
+	LOG_F(stream, "\nOptions:\n");
+	LOG_F(stream, "  -o PREFIX         Write frame N to PREFIX" AIRSGEN_SUFFIX_FORMAT "\n", 0UL);
+	LOG_F(stream, "  -n, --frames=N    Number of frames (default: 1)\n");
+	LOG_F(stream, "  -W, --width=N     Spectral pixels per row (default: 512)\n");
+	LOG_F(stream, "  -H, --height=N    Spatial rows per frame (default: 64)\n");
+	LOG_F(stream, "  -s, --seed=N      Seed of the random structures (default: 1)\n");
+	LOG_F(stream, "  --noise=DN        Standard deviation of the read noise (default: 8)\n");
+	LOG_F(stream, "  --background=DN   Background level (default: 1000)\n");
+	LOG_F(stream, "  --gradient=DN     Background increase across the rows (default: 200)\n");
+	LOG_F(stream, "  --drift=DN        Background change per frame (default: 2)\n");
+	LOG_F(stream, "  --spectrum=DN     Peak signal of the spectrum (default: 20000)\n");
+	LOG_F(stream, "  --lines=N         Absorption lines in the spectrum (default: 16)\n");
+	LOG_F(stream, "  --hot-pixels=F    Fraction of hot pixels (default: 0.001)\n");
+	LOG_F(stream, "  --cosmic-rays=N   Cosmic ray hits per frame (default: 4)\n");
+	LOG_F(stream, "  --saturation=DN   Largest pixel value (default: 65535)\n");
+	LOG_F(stream, "  -q, --quiet       Decrease verbosity\n");
+	LOG_F(stream, "  -v, --verbose     Increase verbosity\n");
+	LOG_F(stream, "  -h, --help        Display this help\n");
+	LOG_F(stream, "\nExamples:\n");
+	LOG_F(stream, "# 100 frames of 1024x128 pixels in corpus/\n");
+	LOG_F(stream, "airsgen -n 100 -W 1024 -H 128 -o corpus/frame_\n");
+	LOG_F(stream, "# A noisy stream compressed in frames\n");
+	LOG_F(stream, "airsgen -n 10 --noise=50 | airspace -c --frame-size=65536 - > stream.air\n");
+}
+
+
+/* writes all frames to a stream or to one file per frame */
+static int generate(const struct datagen_params *params, uint32_t num_frames,
+		    const char *prefix)
+{
+	struct datagen g;
+	uint32_t const num_samples = params->width * params->height;
+	uint16_t *samples = NULL;
+	char *filename = NULL;
+	FILE *out = NULL;
+	uint32_t i;
+	int result = -1;
+
+	if (datagen_init(&g, params))
+		return -1;
+
+	samples = malloc(num_samples * sizeof(*samples));
+	if (prefix)
+		filename = malloc(strlen(prefix) + AIRSGEN_SUFFIX_LEN + 1);
+	if (!samples || (prefix && !filename)) {
+		LOG_ERROR_WITH_ERRNO("Memory allocation failed for a frame");
+		goto end;
+	}
+	if (!prefix) {
+		out = file_create(STD_OUT_MARK);
+		if (!out)
+			goto end;
+	}
+
+	for (i = 0; i < num_frames; i++) {
+		datagen_frame(&g, i, samples);
+		cpu_to_be16_bulk(samples, samples, num_samples);
+		if (prefix) {
+			sprintf(filename, "%s" AIRSGEN_SUFFIX_FORMAT, prefix, (unsigned long)i);
+			if (file_save(filename, samples, num_samples * sizeof(*samples)))
+				goto end;
+		} else if (file_write(out, STD_OUT_MARK, samples, num_samples * sizeof(*samples))) {
+			goto end;
+		}
+	}
+	result = 0;
+
+	{
+		struct hr_fmt const hr = util_make_human_readable(
+			(uint64_t)num_frames * num_samples * sizeof(*samples), 0);
+
+		LOG_PLAIN(LOG_LEVEL_INFO, "Generated %lu frames of %lux%lu pixels, %.*f%s\n",
+			  (unsigned long)num_frames, (unsigned long)params->width,
+			  (unsigned long)params->height, hr.precision, hr.value, hr.suffix);
+	}
+end:
+	if (out && file_close(out, STD_OUT_MARK))
+		result = -1;
+	free(filename);
+	free(samples);
+	datagen_free(&g);
+	return result;
+}
+
+
+/**
+ * @brief entry point of the data generator
+ *
+ * @param argc	number of command-line arguments.
+ * @param argv	array of command-line arguments.
+ *
+ * @returns EXIT_SUCCESS on success, EXIT_FAILURE on error
+ */
+
+int main(int argc, char *argv[])
+{
+	int ch;
+	/*
+	 * For long options that have no equivalent short option, use a
+	 * non-character as a pseudo short option, starting with CHAR_MAX + 1.
+	 */
+	enum {
+		NOISE_OPT = CHAR_MAX + 1,
+		BACKGROUND_OPT,
+		GRADIENT_OPT,
+		DRIFT_OPT,
+		SPECTRUM_OPT,
+		LINES_OPT,
+		HOT_PIXELS_OPT,
+		COSMIC_RAYS_OPT,
+		SATURATION_OPT
+	};
+	static struct option long_options[] = {
+		{ "frames",      required_argument, NULL, 'n'             },
+		{ "width",       required_argument, NULL, 'W'             },
+		{ "height",      required_argument, NULL, 'H'             },
+		{ "seed",        required_argument, NULL, 's'             },
+		{ "noise",       required_argument, NULL, NOISE_OPT       },
+		{ "background",  required_argument, NULL, BACKGROUND_OPT  },
+		{ "gradient",    required_argument, NULL, GRADIENT_OPT    },
+		{ "drift",       required_argument, NULL, DRIFT_OPT       },
+		{ "spectrum",    required_argument, NULL, SPECTRUM_OPT    },
+		{ "lines",       required_argument, NULL, LINES_OPT       },
+		{ "hot-pixels",  required_argument, NULL, HOT_PIXELS_OPT  },
+		{ "cosmic-rays", required_argument, NULL, COSMIC_RAYS_OPT },
+		{ "saturation",  required_argument, NULL, SATURATION_OPT  },
+		{ "quiet",       no_argument,       NULL, 'q'             },
+		{ "verbose",     no_argument,       NULL, 'v'             },
+		{ "help",        no_argument,       NULL, 'h'             },
+		{ NULL,          0,                 NULL, 0               }
+	};
+	struct datagen_params params;
+	const char *prefix = NULL;
+	uint32_t num_frames = 1;
+	uint32_t u32;
+	int err = 0;
+
+	assert(argv);
+	assert(argc >= 1);
+	log_setup_color();
+	datagen_default_params(&params);
+
+	while ((ch = getopt_long(argc, argv, "o:n:W:H:s:qvh", long_options, NULL)) != -1) {
+		switch (ch) {
+		case 'o':
+			prefix = optarg;
+			break;
+		case 'n':
+			err = parse_u32(optarg, 1, AIRSGEN_MAX_FRAMES, &num_frames);
+			break;
+		case 'W':
+			err = parse_u32(optarg, 1, UINT32_MAX, &params.width);
+			break;
+		case 'H':
+			err = parse_u32(optarg, 1, UINT32_MAX, &params.height);
+			break;
+		case 's':
+			err = parse_u32(optarg, 0, UINT32_MAX, &u32);
+			params.seed = u32;
+			break;
+		case NOISE_OPT:
+			err = parse_double(optarg, 0, 65535, &params.noise);
+			break;
+		case BACKGROUND_OPT:
+			err = parse_double(optarg, 0, 65535, &params.background);
+			break;
+		case GRADIENT_OPT:
+			err = parse_double(optarg, -65535, 65535, &params.gradient);
+			break;
+		case DRIFT_OPT:
+			err = parse_double(optarg, -65535, 65535, &params.drift);
+			break;
+		case SPECTRUM_OPT:
+			err = parse_double(optarg, 0, 65535, &params.spectrum);
+			break;
+		case LINES_OPT:
+			err = parse_u32(optarg, 0, 10000, &params.num_lines);
+			break;
+		case HOT_PIXELS_OPT:
+			err = parse_double(optarg, 0, 1, &params.hot_pixels);
+			break;
+		case COSMIC_RAYS_OPT:
+			err = parse_u32(optarg, 0, 1000000, &params.cosmic_rays);
+			break;
+		case SATURATION_OPT:
+			err = parse_u32(optarg, 1, UINT16_MAX, &u32);
+			params.saturation = (uint16_t)u32;
+			break;
+		case 'q':
+			log_decrease_verbosity();
+			break;
+		case 'v':
+			log_increase_verbosity();
+			break;
+		case 'h':
+			print_usage(stdout, argv[0]);
+			return EXIT_SUCCESS;
+		default:
+			print_usage(stderr, argv[0]);
+			return EXIT_FAILURE;
+		}
+		if (err) {
+			LOG_ERROR("Invalid value: %s", argv[optind - 1]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind < argc) {
+		LOG_ERROR("Unexpected argument: %s", argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	if ((uint64_t)params.width * params.height * sizeof(uint16_t) > CMP_HDR_MAX_ORIGINAL_SIZE) {
+		LOG_ERROR("A frame of %lux%lu pixels is larger than a compressed frame can be",
+			  (unsigned long)params.width, (unsigned long)params.height);
+		return EXIT_FAILURE;
+	}
+	if (!prefix && util_is_console(stdout)) {
+		LOG_ERROR("stdout is a terminal, aborting");
+		return EXIT_FAILURE;
+	}
+
+	return generate(&params, num_frames, prefix) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
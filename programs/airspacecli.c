@@ -14,19 +14,29 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <pthread.h>
 
 #include "../lib/cmp.h"
+#include "../lib/cmp_header.h"
+#include "../lib/cmp_decompress.h"
+#include "../lib/common/byteorder_bulk.h"
+#include "archive.h"
+#include "benchmark.h"
+#include "daemon.h"
 #include "file.h"
 #include "log.h"
+#include "pool.h"
 #include "util.h"
 #include "params_parse.h"
+#include "trace.h"
+#include "tune.h"
 
 /* Program information */
 #define PROGRAM_NAME "AIRSPACE CLI"
 #ifndef AIRSPACE_VERSION
 #  define AIRSPACE_VERSION "v" CMP_VERSION_STRING
 #endif
-#define AIRSPACE_EXTENSION ".air"
 
 #define AUTHOR "Dominik Loidolt"
 #define AIRSPACE_WELCOME_MESSAGE                                                    \
@@ -34,7 +44,10 @@
 		AIRSPACE_VERSION, AUTHOR
 
 /** Operation modes */
-enum operation_mode { MODE_COMPRESS, MODE_DECOMPRESS };
+enum operation_mode { MODE_COMPRESS, MODE_DECOMPRESS, MODE_LIST, MODE_BENCH, MODE_TUNE };
+
+/** How the compressed files are put into an archive */
+enum archive_mode { ARCHIVE_NONE, ARCHIVE_CREATE, ARCHIVE_APPEND };
 
 
 /* memory allocation or die */
@@ -50,45 +63,81 @@ static void *malloc_safe(size_t size)
 }
 
 
+/* memory reallocation or die */
+static void *realloc_safe(void *ptr, size_t size)
+{
+	void *new_ptr = realloc(ptr, size);
+
+	if (!new_ptr) {
+		LOG_ERROR_WITH_ERRNO("Memory allocation failed for size %lu", (unsigned long)size);
+		exit(EXIT_FAILURE);
+	}
+	return new_ptr;
+}
+
+
 /**
  * @brief appends the airspace specific suffix to the input string
  *
- * Adds a predefined suffix to the given string, using an internal buffer.
+ * Adds a predefined suffix to the given string, using a caller provided
+ * buffer, so every thread can use its own buffer.
  *
- * @param str	string to add suffix or NULL to free resources
+ * @param str		string to add suffix
+ * @param buf		pointer to a buffer for the result; grown if needed
+ * @param buf_size	pointer to the size of the buffer
  *
  * @returns pointer to the modified string
- * @warning The buffer is shared across calls and not thread-safe.
  */
 
-static const char *add_airspace_suffix(const char *str)
+static const char *add_airspace_suffix(const char *str, char **buf, size_t *buf_size)
 {
-	static char *buf;
-	static size_t buf_size;
-
 	size_t str_len;
 	size_t need_buf_size;
 
-	if (!str) {
-		free(buf);
-		return NULL;
-	}
+	assert(str);
+	assert(buf);
+	assert(buf_size);
 
 	str_len = strlen(str);
 	need_buf_size = str_len + sizeof(AIRSPACE_EXTENSION);
 
-	if (need_buf_size > buf_size) {
+	if (need_buf_size > *buf_size) {
 		enum { BUFFER_MARGIN = 30 };
 
-		free(buf);
-		buf_size = need_buf_size + BUFFER_MARGIN;
-		buf = malloc_safe(buf_size);
+		free(*buf);
+		*buf_size = need_buf_size + BUFFER_MARGIN;
+		*buf = malloc_safe(*buf_size);
 	}
 
-	memcpy(buf, str, str_len);
-	memcpy(buf + str_len, AIRSPACE_EXTENSION, sizeof(AIRSPACE_EXTENSION));
+	memcpy(*buf, str, str_len);
+	memcpy(*buf + str_len, AIRSPACE_EXTENSION, sizeof(AIRSPACE_EXTENSION));
+
+	return *buf;
+}
+
+
+/**
+ * @brief thread-safe timestamp provider for the frame identifiers
+ *
+ * Provides the seconds since the epoch as coarse time and a counter as fine
+ * time, so the identifiers of the frames of one run are unique, even if they
+ * are created by several threads.
+ */
 
-	return buf;
+static void cli_get_timestamp(uint32_t *coarse, uint16_t *fine)
+{
+	static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+	static uint64_t last;
+	uint64_t now = (uint64_t)time(NULL) << 16;
+
+	pthread_mutex_lock(&mutex);
+	if (now <= last)
+		now = last + 1;
+	last = now;
+	pthread_mutex_unlock(&mutex);
+
+	*coarse = (uint32_t)(now >> 16);
+	*fine = (uint16_t)now;
 }
 
 
@@ -106,9 +155,16 @@ static void log_file_status(enum log_level level, const char *input_filename, ui
 }
 
 
-static void log_summery(const char **input_files, int num_files, size_t sum_input_size,
-			const char *output_name, size_t sum_output_size)
+static void log_summery(enum operation_mode mode, const char **input_files, int num_files,
+			size_t sum_input_size, const char *output_name, size_t sum_output_size,
+			double seconds)
 {
+	int const verbose = log_get_level() > LOG_LEVEL_DEBUG;
+	/* the throughput is measured on the uncompressed side */
+	size_t const raw_size = mode == MODE_COMPRESS ? sum_input_size : sum_output_size;
+	struct hr_fmt const hr_speed = util_make_human_readable(
+		seconds > 0 ? (uint64_t)((double)raw_size / seconds) : 0, 0);
+
 	if (num_files == 1) { /* one file -> display the file status instead of the summery */
 		/* if not already done in the log file status */
 		if (log_get_level() < LOG_LEVEL_DEBUG) {
@@ -116,92 +172,1414 @@ static void log_summery(const char **input_files, int num_files, size_t sum_inpu
 					output_name, (uint32_t)sum_output_size);
 		}
 	} else {
-		int const verbose = log_get_level() > LOG_LEVEL_DEBUG;
 		struct hr_fmt const hr_i_sum = util_make_human_readable(sum_input_size, verbose);
 		struct hr_fmt const hr_o_sum = util_make_human_readable(sum_output_size, verbose);
 
-		LOG_PLAIN(LOG_LEVEL_INFO, "%d files compressed: %.2f%% (%.*f%s => %.*f%s)\n",
-			  num_files, (double)sum_output_size / (double)sum_input_size * 100.0,
+		LOG_PLAIN(LOG_LEVEL_INFO, "%d files %s: %.2f%% (%.*f%s => %.*f%s)\n", num_files,
+			  mode == MODE_COMPRESS ? "compressed" : "decompressed",
+			  (double)sum_output_size / (double)sum_input_size * 100.0,
 			  hr_i_sum.precision, hr_i_sum.value, hr_i_sum.suffix,
 			  hr_o_sum.precision, hr_o_sum.value, hr_o_sum.suffix);
 	}
+	LOG_PLAIN(LOG_LEVEL_DEBUG, "Processed in %.3f s (%.*f%s/s)\n", seconds,
+		  hr_speed.precision, hr_speed.value, hr_speed.suffix);
 }
 
 
-static int compress_file_list(const char *output_name, const char **input_files, int num_files,
-			      const struct cmp_params *params)
+/** Stages of a file in the compression pipeline */
+enum compress_stage { STAGE_READ, STAGE_COMPRESS, STAGE_WRITE, NUM_COMPRESS_STAGES };
+
+
+/**
+ * @brief buffers of a file in the compression pipeline; recycled for the
+ *	following files
+ */
+
+struct compress_slot {
+	struct file_input src;  /**< source data; opened by the reader */
+	struct file_buffer dst; /**< compressed data; filled by a compressor */
+	uint32_t input_size;
+	uint32_t output_size;
+	int err;                /**< set if a stage failed for this file */
+};
+
+
+/**
+ * @brief state shared by the reader, the compression workers and the writer
+ */
+
+struct compress_shared {
+	const char **input_files;       /**< files to compress */
+	int num_files;                  /**< number of files */
+	int chain_len;                  /**< number of files compressed with one model chain */
+	const char *output_name;        /**< name of the shared output; NULL for one output per file */
+	FILE *output;                   /**< shared output stream; written in input file order */
+	struct archive_writer *archive; /**< archive to write the files into; NULL for no archive */
+	const struct cmp_params *params; /**< compression parameters */
+	int may_map;                    /**< set if the input files may be memory-mapped */
+	struct compress_slot *slots;    /**< buffers of the files in the pipeline */
+	struct pool_pipeline pipeline;  /**< passes the files from stage to stage */
+
+	/* owned by the writer */
+	int num_written;                /**< number of successfully completed files */
+	char *name_buf;
+	size_t name_buf_size;
+	size_t sum_input_size;
+	size_t sum_output_size;
+};
+
+
+/**
+ * @brief private state of a compression worker
+ */
+
+struct compress_worker {
+	struct cmp_context ctx;
+	void *work_buf;
+	struct trace_track track;
+};
+
+
+/**
+ * @brief reads the input files in order into the pipeline slots
+ */
+
+static void *compress_reader(void *arg)
 {
-	int result = EXIT_FAILURE;
-	int const needs_output_name = !output_name;
+	struct compress_shared *sh = arg;
 	int i;
 
-	void *work_buf = NULL;
-	struct cmp_context ctx;
+	for (i = 0; i < sh->num_files; i++) {
+		struct compress_slot *slot;
+		int err;
 
-	size_t sum_input_size = 0;
-	size_t sum_output_size = 0;
+		if (pool_pipeline_wait(&sh->pipeline, (unsigned int)i, STAGE_READ))
+			break;
+		slot = &sh->slots[(unsigned int)i % sh->pipeline.num_slots];
+		err = file_input_open(&slot->src, sh->input_files[i], sh->may_map) != 0;
+		slot->input_size = slot->src.size;
+		slot->err = err;
+		pool_pipeline_pass(&sh->pipeline, (unsigned int)i);
+		/* the writer aborts the pipeline when it gets to the failed file */
+		if (err)
+			break;
+	}
+	return NULL;
+}
+
+
+/**
+ * @brief compresses the files of a model chain in order
+ *
+ * The chain starts with a reset context, so the files are compressed the same
+ * way, no matter which worker compresses them. A failed file is passed on to
+ * the writer, which completes the files before it and aborts the pipeline.
+ *
+ * @returns 0 on success, -1 if the pipeline was aborted
+ */
+
+static int compress_chain(void *shared, void *worker, unsigned int chain)
+{
+	struct compress_shared *sh = shared;
+	struct compress_worker *w = worker;
+	int const first = (int)chain * sh->chain_len;
+	int const end = first + sh->chain_len < sh->num_files ? first + sh->chain_len
+							      : sh->num_files;
+	int err = cmp_is_error(cmp_reset(&w->ctx)) != 0;
+	int i;
+
+	for (i = first; i < end; i++) {
+		struct compress_slot *slot;
+
+		if (pool_pipeline_wait(&sh->pipeline, (unsigned int)i, STAGE_COMPRESS))
+			return -1;
+		slot = &sh->slots[(unsigned int)i % sh->pipeline.num_slots];
+		/* the rest of the chain can not be compressed after an error */
+		err |= slot->err;
+		if (!err) {
+			slot->output_size = file_compress(&w->ctx, sh->params, &slot->src,
+							  &slot->dst, sh->input_files[i]);
+			err = cmp_is_error(slot->output_size) != 0;
+		}
+		file_input_close(&slot->src);
+		slot->err = err;
+		pool_pipeline_pass(&sh->pipeline, (unsigned int)i);
+	}
+
+	return 0;
+}
+
+
+/**
+ * @brief writes and logs the compressed files in input order
+ */
+
+static void *compress_writer(void *arg)
+{
+	struct compress_shared *sh = arg;
+	int i;
+
+	for (i = 0; i < sh->num_files; i++) {
+		const char *input_file = sh->input_files[i];
+		const char *output_name = sh->output_name;
+		struct compress_slot *slot;
+		int err;
+
+		if (pool_pipeline_wait(&sh->pipeline, (unsigned int)i, STAGE_WRITE))
+			break;
+		slot = &sh->slots[(unsigned int)i % sh->pipeline.num_slots];
+		if (!output_name)
+			output_name = add_airspace_suffix(input_file, &sh->name_buf,
+							  &sh->name_buf_size);
+		err = slot->err;
+		if (!err && sh->archive)
+			err = archive_writer_add(sh->archive, slot->dst.data, slot->output_size,
+						 input_file);
+		else if (!err && sh->output)
+			err = file_write(sh->output, output_name, slot->dst.data,
+					 slot->output_size);
+		else if (!err)
+			err = file_save(output_name, slot->dst.data, slot->output_size);
+		if (err) {
+			pool_pipeline_abort(&sh->pipeline);
+			break;
+		}
+		log_file_status(LOG_LEVEL_DEBUG, input_file, slot->input_size, output_name,
+				slot->output_size);
+		sh->sum_input_size += slot->input_size;
+		sh->sum_output_size += slot->output_size;
+		sh->num_written++;
+		pool_pipeline_pass(&sh->pipeline, (unsigned int)i);
+	}
+	return NULL;
+}
+
+
+/**
+ * @brief compresses a list of files
+ *
+ * The files go through a pipeline: a reader thread loads them in order, the
+ * compression workers compress them and a writer thread writes them in
+ * order. The file buffers are allocated once, sized from the largest input,
+ * and recycled, so reading and writing overlap with the compression, also with
+ * a single compression worker.
+ *
+ * In archive mode the compressed files are written into the archive
+ * output_name, which is indexed by file name. With a trace file, the
+ * compression stages of every worker are traced as a thread of its own.
+ */
+
+static int compress_file_list(const char *output_name, const char **input_files, int num_files,
+			      const struct cmp_params *params, unsigned int num_threads,
+			      enum archive_mode archive_mode, struct trace_file *trace)
+{
+	int result = EXIT_FAILURE;
+	struct compress_shared shared;
+	struct archive_writer archive;
+	struct compress_worker *workers = NULL;
+	unsigned int num_workers = 0;
+	unsigned int num_chains;
+	unsigned int num_slots = 0;
+	uint32_t max_file_size = 0;
+	uint32_t max_load_size = 0;
+	uint32_t work_buf_size;
+	pthread_t reader, writer;
+	int reader_started = 0, writer_started = 0;
+	unsigned int i;
+
+	double const start_time = util_get_time();
 
 	assert(input_files);
 	assert(num_files > 0);
 	assert(params);
+	assert(num_threads > 0);
+
+	memset(&shared, 0, sizeof(shared));
+	shared.input_files = input_files;
+	shared.num_files = num_files;
+	shared.output_name = output_name;
+	shared.params = params;
+	/* the in-place IWT needs writable samples */
+	shared.may_map = !params->iwt_in_place_enabled;
+	/*
+	 * The context switches between the primary and secondary parameters,
+	 * so every cycle of them is compressed by the same worker in order.
+	 */
+	shared.chain_len = (int)params->secondary_iterations + 1;
+	num_chains = (unsigned int)((num_files + shared.chain_len - 1) / shared.chain_len);
 
 	{ /* Initialization setup */
-		uint32_t first_file_size;
-		uint32_t work_buf_size;
-		uint32_t return_code;
+		int f;
+
+		/* this also reads stdin once by the main thread */
+		for (f = 0; f < num_files; f++) {
+			uint32_t file_size;
+
+			if (file_get_size_u32(input_files[f], &file_size))
+				return EXIT_FAILURE;
+			if (file_size > max_file_size)
+				max_file_size = file_size;
+			/* memory-mapped files need no load buffer */
+			if ((!shared.may_map || !strcmp(input_files[f], STD_IN_MARK)) &&
+			    file_size > max_load_size)
+				max_load_size = file_size;
+		}
 
 		/* Allocate work buff if need */
-		if (file_get_size_u32(input_files[0], &first_file_size))
-			goto cleanup;
-		work_buf_size = cmp_cal_work_buf_size(params, first_file_size);
+		work_buf_size = cmp_cal_work_buf_size(params, max_file_size);
 		if (cmp_is_error(work_buf_size)) {
 			LOG_ERROR_CMP(work_buf_size, "Error calculating work buffer size");
-			goto cleanup;
+			return EXIT_FAILURE;
 		}
+	}
+
+	num_workers = num_threads < num_chains ? num_threads : num_chains;
+	/* one file is read and one is written while every worker compresses one */
+	num_slots = num_workers + 2 < (unsigned int)num_files ? num_workers + 2
+							      : (unsigned int)num_files;
+	if (pool_pipeline_init(&shared.pipeline, num_slots, NUM_COMPRESS_STAGES))
+		return EXIT_FAILURE;
+	shared.slots = malloc_safe(num_slots * sizeof(*shared.slots));
+	memset(shared.slots, 0, num_slots * sizeof(*shared.slots));
+	for (i = 0; i < num_slots; i++) {
+		if (file_buffer_reserve(&shared.slots[i].src.buf, max_load_size) ||
+		    file_buffer_reserve(&shared.slots[i].dst,
+					file_compress_bound(params, max_file_size)))
+			goto cleanup;
+	}
+
+	/* the frames of the workers need unique identifiers */
+	if (num_workers > 1)
+		cmp_set_timestamp_func(cli_get_timestamp);
+
+	workers = malloc_safe(num_workers * sizeof(*workers));
+	memset(workers, 0, num_workers * sizeof(*workers));
+	for (i = 0; i < num_workers; i++) {
+		uint32_t return_code;
+
 		if (work_buf_size > 0)
-			work_buf = malloc_safe(work_buf_size);
+			workers[i].work_buf = malloc_safe(work_buf_size);
 
-		return_code = cmp_initialise(&ctx, params, work_buf, work_buf_size);
+		return_code = cmp_initialise(&workers[i].ctx, params, workers[i].work_buf,
+					     work_buf_size);
 		if (cmp_is_error(return_code)) {
 			LOG_ERROR_CMP(return_code, "Compression initialization failed");
 			goto cleanup;
 		}
+		if (trace)
+			trace_track_attach(&workers[i].track, trace, i + 1, &workers[i].ctx);
 	}
 
-	for (i = 0; i < num_files; i++) {
-		uint32_t output_size;
+	if (archive_mode != ARCHIVE_NONE) {
+		assert(output_name);
+		if (archive_mode == ARCHIVE_APPEND ? archive_writer_open_append(&archive, output_name)
+						   : archive_writer_create(&archive, output_name))
+			goto cleanup;
+		shared.archive = &archive;
+	} else if (output_name) {
+		shared.output = file_create(output_name);
+		if (!shared.output)
+			goto cleanup;
+	}
+
+	LOG_DEBUG("Compressing %d files in %u chains with %u threads", num_files, num_chains,
+		  num_workers);
+
+	reader_started = !pthread_create(&reader, NULL, compress_reader, &shared);
+	if (reader_started)
+		writer_started = !pthread_create(&writer, NULL, compress_writer, &shared);
+	if (!writer_started) {
+		LOG_ERROR("Can't create the I/O threads");
+		pool_pipeline_abort(&shared.pipeline);
+	}
+
+	/* the workers only fail if the pipeline is aborted or can not be started */
+	if (pool_run(num_workers, num_chains, compress_chain, &shared, workers,
+		     sizeof(*workers)))
+		pool_pipeline_abort(&shared.pipeline);
+	if (reader_started)
+		pthread_join(reader, NULL);
+	if (writer_started)
+		pthread_join(writer, NULL);
+	if (shared.num_written != num_files)
+		goto cleanup;
+
+	log_summery(MODE_COMPRESS, input_files, num_files, shared.sum_input_size,
+		    output_name ? output_name : shared.name_buf, shared.sum_output_size,
+		    util_get_time() - start_time);
+
+	result = EXIT_SUCCESS;
+
+cleanup:
+	/* an archive keeps the files written before an error */
+	if (shared.archive && archive_writer_close(shared.archive))
+		result = EXIT_FAILURE;
+	if (shared.output && file_close(shared.output, output_name))
+		result = EXIT_FAILURE;
+	if (workers) {
+		for (i = 0; i < num_workers; i++) {
+			cmp_deinitialise(&workers[i].ctx);
+			free(workers[i].work_buf);
+		}
+	}
+	free(workers);
+	for (i = 0; i < num_slots; i++) {
+		file_input_free(&shared.slots[i].src);
+		file_buffer_free(&shared.slots[i].dst);
+	}
+	free(shared.slots);
+	free(shared.name_buf);
+	pool_pipeline_destroy(&shared.pipeline);
+
+	return result;
+}
+
+
+/**
+ * @brief compresses a stream in frames of a fixed size
+ *
+ * Every frame is compressed as soon as it is read and written out
+ * immediately, so a live pipe is compressed with constant memory and a
+ * latency of one frame. The context is kept between the frames, so the model
+ * frame chains continue across the frames.
+ *
+ * A shorter last frame is compressed after a reset of the context; it starts
+ * a new chain, as all model frames of a chain have the same size. A last frame
+ * with an odd number of bytes is an error, after all complete frames are
+ * written.
+ */
+
+static int compress_stream(const char *output_name, const char *input_file,
+			   const struct cmp_params *params, uint32_t frame_size,
+			   struct trace_file *trace)
+{
+	int result = EXIT_FAILURE;
+	struct cmp_context ctx;
+	struct trace_track track;
+	struct file_buffer src = { 0 };
+	struct file_buffer dst = { 0 };
+	void *work_buf = NULL;
+	const char *input_name;
+	FILE *input = NULL;
+	FILE *output = NULL;
+	char *name_buf = NULL;
+	size_t name_buf_size = 0;
+	uint32_t work_buf_size, dst_capacity, ret;
+	unsigned long num_frames = 0;
+	uint64_t sum_input_size = 0;
+	uint64_t sum_output_size = 0;
+
+	double const start_time = util_get_time();
+
+	assert(input_file);
+	assert(params);
+	assert(frame_size > 0 && frame_size % sizeof(uint16_t) == 0);
+
+	input_name = strcmp(input_file, STD_IN_MARK) ? input_file : "stdin";
+	memset(&ctx, 0, sizeof(ctx));
+	if (!output_name)
+		output_name = add_airspace_suffix(input_file, &name_buf, &name_buf_size);
+
+	work_buf_size = cmp_cal_work_buf_size(params, frame_size);
+	if (cmp_is_error(work_buf_size)) {
+		LOG_ERROR_CMP(work_buf_size, "Error calculating work buffer size");
+		goto cleanup;
+	}
+	if (work_buf_size > 0)
+		work_buf = malloc_safe(work_buf_size);
+	ret = cmp_initialise(&ctx, params, work_buf, work_buf_size);
+	if (cmp_is_error(ret)) {
+		LOG_ERROR_CMP(ret, "Compression initialization failed");
+		goto cleanup;
+	}
+	if (trace)
+		trace_track_attach(&track, trace, 1, &ctx);
+
+	dst_capacity = file_compress_bound(params, frame_size);
+	if (file_buffer_reserve(&src, frame_size) || file_buffer_reserve(&dst, dst_capacity))
+		goto cleanup;
+
+	input = file_open_input(input_file);
+	if (!input)
+		goto cleanup;
+	output = file_create(output_name);
+	if (!output)
+		goto cleanup;
 
-		assert(input_files[i]);
-		if (needs_output_name)
-			output_name = add_airspace_suffix(input_files[i]);
+	LOG_DEBUG("Compressing %s in frames of %lu bytes", input_name, (unsigned long)frame_size);
 
-		output_size = file_compress(&ctx, output_name, input_files[i]);
-		if (cmp_is_error(output_size))
+	while (1) {
+		size_t read_size;
+		uint32_t cmp_size;
+
+		if (file_read(input, input_file, src.data, frame_size, &read_size))
 			goto cleanup;
+		if (read_size == 0)
+			break;
+		if (read_size < frame_size) {
+			if (read_size % sizeof(uint16_t)) {
+				LOG_ERROR("%s: last frame size of %lu bytes is not a multiple of %lu",
+					  input_name, (unsigned long)read_size,
+					  (unsigned long)sizeof(uint16_t));
+				goto cleanup;
+			}
+			/* the model frames of a chain have the size of their model */
+			ret = cmp_reset(&ctx);
+			if (cmp_is_error(ret)) {
+				LOG_ERROR_CMP(ret, "Compression reset failed");
+				goto cleanup;
+			}
+			LOG_DEBUG("Last frame of %lu bytes starts a new model chain",
+				  (unsigned long)read_size);
+		}
 
-		{ /* compression done; do some longing */
-			uint32_t input_size;
+		/* the in-place IWT needs the samples in host byte order */
+		if (params->iwt_in_place_enabled) {
+			be16_to_cpu_bulk(src.data, src.data, read_size / sizeof(uint16_t));
+			cmp_size = cmp_compress_u16_in_place(&ctx, dst.data, dst_capacity, src.data,
+							     (uint32_t)read_size);
+		} else {
+			cmp_size = cmp_compress_u16_be(&ctx, dst.data, dst_capacity, src.data,
+						       (uint32_t)read_size);
+		}
+		if (cmp_is_error(cmp_size)) {
+			LOG_ERROR_CMP(cmp_size, "Compression failed for frame %lu of %s",
+				      num_frames, input_name);
+			goto cleanup;
+		}
 
-			(void)file_get_size_u32(input_files[i], &input_size);
-			log_file_status(LOG_LEVEL_DEBUG, input_files[i], input_size, output_name,
-					output_size);
-			sum_input_size += input_size;
-			sum_output_size += output_size;
+		if (file_write(output, output_name, dst.data, cmp_size))
+			goto cleanup;
+		if (fflush(output)) {
+			LOG_ERROR_WITH_ERRNO("Error writing '%s'", output_name);
+			goto cleanup;
 		}
+
+		num_frames++;
+		sum_input_size += read_size;
+		sum_output_size += cmp_size;
+		if (read_size < frame_size)
+			break;
 	}
 
-	log_summery(input_files, num_files, sum_input_size, output_name, sum_output_size);
+	{
+		int const verbose = log_get_level() > LOG_LEVEL_DEBUG;
+		struct hr_fmt const hr_i = util_make_human_readable(sum_input_size, verbose);
+		struct hr_fmt const hr_o = util_make_human_readable(sum_output_size, verbose);
+		double const seconds = util_get_time() - start_time;
+		struct hr_fmt const hr_speed = util_make_human_readable(
+			seconds > 0 ? (uint64_t)((double)sum_input_size / seconds) : 0, 0);
+
+		LOG_PLAIN(LOG_LEVEL_INFO, "%s: %lu frames, %.2f%% (%.*f%s => %.*f%s, %s)\n",
+			  input_name, num_frames,
+			  sum_input_size ? (double)sum_output_size / (double)sum_input_size * 100.0
+					 : 0.0,
+			  hr_i.precision, hr_i.value, hr_i.suffix,
+			  hr_o.precision, hr_o.value, hr_o.suffix,
+			  strcmp(output_name, STD_OUT_MARK) ? output_name : "stdout");
+		LOG_PLAIN(LOG_LEVEL_DEBUG, "Processed in %.3f s (%.*f%s/s)\n", seconds,
+			  hr_speed.precision, hr_speed.value, hr_speed.suffix);
+	}
 
 	result = EXIT_SUCCESS;
 
 cleanup:
+	if (output && file_close(output, output_name))
+		result = EXIT_FAILURE;
+	if (input)
+		(void)file_close(input, input_file);
+	cmp_deinitialise(&ctx);
 	free(work_buf);
-	add_airspace_suffix(NULL); /* free internal buffer */
+	file_buffer_free(&src);
+	file_buffer_free(&dst);
+	free(name_buf);
+
+	return result;
+}
+
+
+/**
+ * @brief removes the airspace specific suffix from a file name
+ *
+ * @param str		file name ending with the airspace suffix
+ * @param buf		pointer to a buffer for the result; grown if needed
+ * @param buf_size	pointer to the size of the buffer
+ *
+ * @returns pointer to the file name without suffix or NULL if the file name
+ *	has no airspace suffix
+ */
+
+static const char *remove_airspace_suffix(const char *str, char **buf, size_t *buf_size)
+{
+	size_t const str_len = strlen(str);
+	size_t const suffix_len = sizeof(AIRSPACE_EXTENSION) - 1;
+
+	if (str_len <= suffix_len || strcmp(str + str_len - suffix_len, AIRSPACE_EXTENSION)) {
+		LOG_ERROR("%s: unknown suffix (%s expected)", str, AIRSPACE_EXTENSION);
+		return NULL;
+	}
+
+	if (str_len - suffix_len + 1 > *buf_size) {
+		free(*buf);
+		*buf_size = str_len - suffix_len + 1;
+		*buf = malloc_safe(*buf_size);
+	}
+	memcpy(*buf, str, str_len - suffix_len);
+	(*buf)[str_len - suffix_len] = '\0';
+
+	return *buf;
+}
+
+
+/**
+ * @brief state shared by the decompression workers
+ */
+
+struct decompress_shared {
+	const char **input_files;   /**< files to decompress */
+	const char *output_name;    /**< name of the shared output; NULL for one output per file */
+	FILE *output;               /**< shared output stream; written in input file order */
+	const int *chain_start;     /**< first file of every model chain and the number of files */
+	struct pool_sequencer turn; /**< orders the completion of the files */
+	const char *last_output;    /**< output name of the last completed file */
+};
+
+
+/**
+ * @brief private state of a decompression worker; reused for all its files
+ */
+
+struct decompress_worker {
+	struct file_decompressor dec;
+	char *name_buf;
+	size_t name_buf_size;
+	size_t sum_input_size;
+	size_t sum_output_size;
+};
+
+
+/**
+ * @brief decompresses the files of a model chain in order
+ *
+ * The files are completed, i.e., written to the shared output and logged, in
+ * the order of the input files.
+ *
+ * @returns 0 on success, -1 on error
+ */
+
+static int decompress_chain(void *shared, void *worker, unsigned int chain)
+{
+	struct decompress_shared *sh = shared;
+	struct decompress_worker *w = worker;
+	int i;
+
+	for (i = sh->chain_start[chain]; i < sh->chain_start[chain + 1]; i++) {
+		const char *input_file = sh->input_files[i];
+		const char *output_name = sh->output_name;
+		uint32_t input_size = 0;
+		uint32_t output_size = 0;
+		int err;
+
+		if (!output_name)
+			output_name = remove_airspace_suffix(input_file, &w->name_buf,
+							     &w->name_buf_size);
+		err = !output_name;
+		if (!err) {
+			output_size = file_decompress(&w->dec, input_file, &input_size);
+			err = cmp_is_error(output_size) != 0;
+		}
+		if (!err && !sh->output)
+			err = file_save(output_name, w->dec.dst.data, output_size);
+
+		/* complete the files in input order, also if one of them failed */
+		if (pool_sequencer_wait(&sh->turn, (unsigned int)i))
+			return -1;
+		if (!err && sh->output)
+			err = file_write(sh->output, output_name, w->dec.dst.data, output_size);
+		if (err) {
+			pool_sequencer_abort(&sh->turn);
+			return -1;
+		}
+		log_file_status(LOG_LEVEL_DEBUG, input_file, input_size, output_name, output_size);
+		w->sum_input_size += input_size;
+		w->sum_output_size += output_size;
+		sh->last_output = output_name;
+		pool_sequencer_done(&sh->turn);
+	}
+
+	return 0;
+}
+
+
+/**
+ * @brief groups the input files into model chains
+ *
+ * A file starting with a model preprocessed frame needs the model of the file
+ * before it, so it belongs to the same chain. A chain started with a loaded
+ * reference model (see cmp_load_model_u16()) needs that reference, which is
+ * not available here, so such a file is rejected.
+ *
+ * @param input_files	files to decompress
+ * @param num_files	number of files
+ * @param num_chains	pointer to store the number of chains
+ *
+ * @returns an array with the first file of every chain followed by num_files
+ *	or NULL on error
+ */
+
+static int *find_model_chains(const char **input_files, int num_files, int *num_chains)
+{
+	int *chain_start = malloc_safe((size_t)(num_files + 1) * sizeof(*chain_start));
+	int i;
+
+	*num_chains = 0;
+	for (i = 0; i < num_files; i++) {
+		uint8_t hdr[CMP_HDR_SIZE];
+		uint32_t hdr_size;
+		int needs_model = 0;
+
+		if (file_peek(input_files[i], hdr, sizeof(hdr), &hdr_size)) {
+			free(chain_start);
+			return NULL;
+		}
+		if (hdr_size == sizeof(hdr)) {
+			unsigned int const preprocessing = (hdr[CMP_HDR_OFFSET_METHOD] >>
+				(CMP_HDR_BITS_METHOD_CHECKSUM_ENABLED +
+				 CMP_HDR_BITS_METHOD_ENCODER_TYPE)) &
+				((1U << CMP_HDR_BITS_METHOD_PREPROCESSING) - 1);
+
+			needs_model = preprocessing == CMP_PREPROCESS_MODEL;
+			if (needs_model && hdr[CMP_HDR_OFFSET_SEQUENCE_NUMBER] == 1 &&
+			    (hdr[CMP_HDR_OFFSET_METHOD] & CMP_HDR_METHOD_MODEL_PRELOADED_FLAG)) {
+				LOG_ERROR("%s: the frame needs a loaded reference model",
+					  input_files[i]);
+				free(chain_start);
+				return NULL;
+			}
+		}
+		if (i == 0 || !needs_model)
+			chain_start[(*num_chains)++] = i;
+	}
+	chain_start[*num_chains] = num_files;
+
+	return chain_start;
+}
+
+
+/**
+ * @brief builds the output name of an archived file
+ *
+ * The file is extracted next to the archive under its archived name.
+ *
+ * @param archive_name	name of the archive
+ * @param name		archived file name
+ * @param buf		pointer to a buffer for the result; grown if needed
+ * @param buf_size	pointer to the size of the buffer
+ *
+ * @returns pointer to the output name
+ */
+
+static const char *archive_member_path(const char *archive_name, const char *name, char **buf,
+				       size_t *buf_size)
+{
+	size_t dir_len = 0;
+	size_t need_buf_size;
+	const char *p;
+
+	for (p = archive_name; *p != '\0'; p++)
+		if (*p == '/' || *p == '\\')
+			dir_len = (size_t)(p - archive_name) + 1;
+
+	need_buf_size = dir_len + strlen(name) + 1;
+	if (need_buf_size > *buf_size) {
+		free(*buf);
+		*buf_size = need_buf_size;
+		*buf = malloc_safe(*buf_size);
+	}
+	memcpy(*buf, archive_name, dir_len);
+	strcpy(*buf + dir_len, name);
+
+	return *buf;
+}
+
+
+/**
+ * @brief frame of an archive in a list of archives
+ */
+
+struct archive_frame {
+	int archive;    /**< number of the archive */
+	uint32_t entry; /**< number of the index entry in the archive */
+};
+
+
+/**
+ * @brief state shared by the archive extraction workers
+ */
+
+struct extract_shared {
+	const char **archives;              /**< archives to extract */
+	const char *output_name;            /**< name of the shared output; NULL for one output per file */
+	FILE *output;                       /**< shared output stream; written in archive order */
+	const struct archive_frame *frames; /**< frames of all archives in order */
+	const int *chain_start;             /**< first frame of every model chain and the number of frames */
+	struct pool_sequencer turn;         /**< orders the completion of the frames */
+	const char *last_output;            /**< output name of the last extracted file */
+};
+
+
+/**
+ * @brief private state of an extraction worker; reused for all its frames
+ */
+
+struct extract_worker {
+	struct file_decompressor dec;
+	struct archive_reader ar;
+	int archive;    /**< archive opened by ar; -1 if none */
+	char *name;
+	char *path_buf;
+	size_t path_buf_size;
+	size_t sum_input_size;
+	size_t sum_output_size;
+	int num_extracted;
+};
+
+
+/**
+ * @brief decompresses the frames of a model chain of the archives in order
+ *
+ * The files are completed, i.e., written and logged, in archive order; so a
+ * file name that occurs several times ends up with the last of its frames.
+ *
+ * @returns 0 on success, -1 on error
+ */
+
+static int extract_chain(void *shared, void *worker, unsigned int chain)
+{
+	struct extract_shared *sh = shared;
+	struct extract_worker *w = worker;
+	int k;
+
+	for (k = sh->chain_start[chain]; k < sh->chain_start[chain + 1]; k++) {
+		int const a = sh->frames[k].archive;
+		const char *archive = sh->archives[a];
+		const char *out_name = sh->output_name;
+		struct archive_entry entry;
+		uint32_t output_size = 0;
+		int err = 0;
+
+		if (w->archive != a) {
+			archive_reader_close(&w->ar);
+			w->archive = -1;
+			err = archive_reader_open(&w->ar, archive);
+			if (!err)
+				w->archive = a;
+		}
+		if (!err)
+			err = archive_read_entry(&w->ar, sh->frames[k].entry, &entry) ||
+			      archive_read_name(&w->ar, &entry, w->name) ||
+			      archive_read_frame(&w->ar, &entry, &w->dec.src);
+		if (!err && !out_name) {
+			if (entry.name_len == 0) {
+				LOG_ERROR("%s: file %lu has no name, use -o or --stdout", archive,
+					  (unsigned long)sh->frames[k].entry);
+				err = 1;
+			} else {
+				out_name = archive_member_path(archive, w->name, &w->path_buf,
+							       &w->path_buf_size);
+			}
+		}
+		if (!err) {
+			output_size = file_decompress_buffer(&w->dec, entry.compressed_size,
+							     archive);
+			err = cmp_is_error(output_size) != 0;
+		}
+
+		/* complete the files in archive order, also if one of them failed */
+		if (pool_sequencer_wait(&sh->turn, (unsigned int)k))
+			return -1;
+		if (!err) {
+			if (sh->output)
+				err = file_write(sh->output, out_name, w->dec.dst.data, output_size);
+			else
+				err = file_save(out_name, w->dec.dst.data, output_size);
+		}
+		if (err) {
+			pool_sequencer_abort(&sh->turn);
+			return -1;
+		}
+		log_file_status(LOG_LEVEL_DEBUG, w->name, entry.compressed_size, out_name,
+				output_size);
+		w->sum_input_size += entry.compressed_size;
+		w->sum_output_size += output_size;
+		w->num_extracted++;
+		sh->last_output = out_name;
+		pool_sequencer_done(&sh->turn);
+	}
+
+	return 0;
+}
+
+
+/**
+ * @brief lists the frames of archives and groups them into model chains
+ *
+ * Only a primary frame (sequence number 0) starts a new chain; every other
+ * frame may need the model of the frame before it.
+ *
+ * @param archives	archives to list
+ * @param num_archives	number of archives
+ * @param frames	pointer to store the frames of all archives
+ * @param num_frames	pointer to store the number of frames
+ * @param chain_start	pointer to store the first frame of every chain
+ *			followed by num_frames
+ * @param num_chains	pointer to store the number of chains
+ *
+ * @returns 0 on success or -1 on error
+ */
+
+static int find_archive_chains(const char **archives, int num_archives,
+			       struct archive_frame **frames, int *num_frames,
+			       int **chain_start, int *num_chains)
+{
+	struct archive_reader ar;
+	size_t capacity = 0;
+	int a;
+
+	*frames = NULL;
+	*chain_start = NULL;
+	*num_frames = 0;
+	*num_chains = 0;
+	for (a = 0; a < num_archives; a++) {
+		uint32_t i;
+
+		if (archive_reader_open(&ar, archives[a]))
+			return -1;
+		LOG_DEBUG("Extracting %lu files from %s", (unsigned long)ar.num_entries,
+			  archives[a]);
+		if (ar.num_entries > (uint32_t)INT_MAX - (uint32_t)*num_frames - 1) {
+			LOG_ERROR("%s: too many files in the archives", archives[a]);
+			archive_reader_close(&ar);
+			return -1;
+		}
+		if ((size_t)*num_frames + ar.num_entries + 1 > capacity) {
+			capacity = (size_t)*num_frames + ar.num_entries + 1;
+			*frames = realloc_safe(*frames, capacity * sizeof(**frames));
+			*chain_start = realloc_safe(*chain_start, capacity * sizeof(**chain_start));
+		}
+		for (i = 0; i < ar.num_entries; i++) {
+			struct archive_entry entry;
+
+			if (archive_read_entry(&ar, i, &entry)) {
+				archive_reader_close(&ar);
+				return -1;
+			}
+			if (*num_frames == 0 || entry.sequence_number == 0)
+				(*chain_start)[(*num_chains)++] = *num_frames;
+			(*frames)[*num_frames].archive = a;
+			(*frames)[*num_frames].entry = i;
+			(*num_frames)++;
+		}
+		archive_reader_close(&ar);
+	}
+	if (*chain_start)
+		(*chain_start)[*num_chains] = *num_frames;
+	return 0;
+}
+
+
+/**
+ * @brief decompresses all files of a list of archives
+ *
+ * The model chains are decompressed in parallel; the frames of a chain are
+ * decompressed in archive order, so the chains are kept intact. Every file is
+ * extracted next to its archive, unless all files go to a shared output.
+ */
+
+static int decompress_archive_list(const char *output_name, const char **archives,
+				   int num_archives, unsigned int num_threads)
+{
+	int result = EXIT_FAILURE;
+	struct extract_shared shared;
+	struct extract_worker *workers = NULL;
+	unsigned int num_workers = 0;
+	struct archive_frame *frames;
+	int *chain_start;
+	int num_frames, num_chains;
+	size_t sum_input_size = 0;
+	size_t sum_output_size = 0;
+	int num_extracted = 0;
+	unsigned int i;
+
+	double const start_time = util_get_time();
+
+	memset(&shared, 0, sizeof(shared));
+	pool_sequencer_init(&shared.turn);
+	if (find_archive_chains(archives, num_archives, &frames, &num_frames, &chain_start,
+				&num_chains))
+		goto cleanup;
+	shared.archives = archives;
+	shared.output_name = output_name;
+	shared.frames = frames;
+	shared.chain_start = chain_start;
+	if (output_name) {
+		shared.output = file_create(output_name);
+		if (!shared.output)
+			goto cleanup;
+	}
+	if (num_chains == 0) {
+		result = EXIT_SUCCESS;
+		goto cleanup;
+	}
+
+	num_workers = num_threads < (unsigned int)num_chains ? num_threads
+							     : (unsigned int)num_chains;
+	workers = malloc_safe(num_workers * sizeof(*workers));
+	for (i = 0; i < num_workers; i++) {
+		memset(&workers[i], 0, sizeof(workers[i]));
+		file_decompressor_init(&workers[i].dec);
+		workers[i].archive = -1;
+		workers[i].name = malloc_safe(ARCHIVE_MAX_NAME_LEN + 1);
+	}
+	LOG_DEBUG("Extracting %d files in %d chains with %u threads", num_frames, num_chains,
+		  num_workers);
+
+	if (pool_run(num_workers, (unsigned int)num_chains, extract_chain, &shared, workers,
+		     sizeof(*workers)))
+		goto cleanup;
+
+	for (i = 0; i < num_workers; i++) {
+		sum_input_size += workers[i].sum_input_size;
+		sum_output_size += workers[i].sum_output_size;
+		num_extracted += workers[i].num_extracted;
+	}
+	if (num_extracted > 0)
+		log_summery(MODE_DECOMPRESS, archives, num_extracted, sum_input_size,
+			    shared.last_output, sum_output_size, util_get_time() - start_time);
+
+	result = EXIT_SUCCESS;
+
+cleanup:
+	if (shared.output && file_close(shared.output, output_name))
+		result = EXIT_FAILURE;
+	for (i = 0; i < num_workers; i++) {
+		archive_reader_close(&workers[i].ar);
+		file_decompressor_free(&workers[i].dec);
+		free(workers[i].name);
+		free(workers[i].path_buf);
+	}
+	free(workers);
+	pool_sequencer_destroy(&shared.turn);
+	free(frames);
+	free(chain_start);
+
+	return result;
+}
+
+
+/**
+ * @brief counts the archives in a list of files
+ *
+ * @returns the number of archives or -1 on error
+ */
+
+static int count_archives(const char **input_files, int num_files)
+{
+	int num_archives = 0;
+	int i;
+
+	for (i = 0; i < num_files; i++) {
+		int const ret = archive_is_archive(input_files[i]);
+
+		if (ret < 0)
+			return -1;
+		num_archives += ret;
+	}
+	return num_archives;
+}
+
+
+static int decompress_file_list(const char *output_name, const char **input_files,
+				int num_files, unsigned int num_threads)
+{
+	int result = EXIT_FAILURE;
+	struct decompress_shared shared;
+	struct decompress_worker *workers = NULL;
+	unsigned int num_workers = 0;
+	int num_chains;
+	int *chain_start;
+	unsigned int i;
+
+	size_t sum_input_size = 0;
+	size_t sum_output_size = 0;
+	double const start_time = util_get_time();
+
+	assert(input_files);
+	assert(num_files > 0);
+	assert(num_threads > 0);
+
+	{ /* archives are extracted on their own */
+		int const num_archives = count_archives(input_files, num_files);
+
+		if (num_archives < 0)
+			return EXIT_FAILURE;
+		if (num_archives == num_files)
+			return decompress_archive_list(output_name, input_files, num_files,
+						       num_threads);
+		if (num_archives > 0) {
+			LOG_ERROR("Archives and compressed files can't be decompressed together");
+			return EXIT_FAILURE;
+		}
+	}
+
+	chain_start = find_model_chains(input_files, num_files, &num_chains);
+	if (!chain_start)
+		return EXIT_FAILURE;
+
+	memset(&shared, 0, sizeof(shared));
+	shared.input_files = input_files;
+	shared.output_name = output_name;
+	shared.chain_start = chain_start;
+	pool_sequencer_init(&shared.turn);
+	if (output_name) {
+		shared.output = file_create(output_name);
+		if (!shared.output)
+			goto cleanup;
+	}
+
+	num_workers = num_threads < (unsigned int)num_chains ? num_threads
+							     : (unsigned int)num_chains;
+	workers = malloc_safe(num_workers * sizeof(*workers));
+	for (i = 0; i < num_workers; i++) {
+		memset(&workers[i], 0, sizeof(workers[i]));
+		file_decompressor_init(&workers[i].dec);
+	}
+	LOG_DEBUG("Decompressing %d files in %d chains with %u threads", num_files, num_chains,
+		  num_workers);
+
+	if (pool_run(num_workers, (unsigned int)num_chains, decompress_chain, &shared, workers,
+		     sizeof(*workers)))
+		goto cleanup;
+
+	for (i = 0; i < num_workers; i++) {
+		sum_input_size += workers[i].sum_input_size;
+		sum_output_size += workers[i].sum_output_size;
+	}
+	log_summery(MODE_DECOMPRESS, input_files, num_files, sum_input_size, shared.last_output,
+		    sum_output_size, util_get_time() - start_time);
+
+	result = EXIT_SUCCESS;
+
+cleanup:
+	if (shared.output && file_close(shared.output, output_name))
+		result = EXIT_FAILURE;
+	for (i = 0; i < num_workers; i++) {
+		file_decompressor_free(&workers[i].dec);
+		free(workers[i].name_buf);
+	}
+	free(workers);
+	pool_sequencer_destroy(&shared.turn);
+	free(chain_start);
+
+	return result;
+}
+
+
+/**
+ * @brief state of a model frame chain while listing frames
+ */
+
+struct list_chain {
+	int valid;                /**< set if a chain has been started */
+	uint64_t identifier;      /**< identifier of the chain */
+	uint32_t original_size;   /**< size of the model */
+	uint8_t sequence_number;  /**< sequence number of the last frame of the chain */
+};
+
+
+/**
+ * @brief checks if a frame continues its model frame chain like the
+ *	decompressor requires it
+ *
+ * @returns 0 if the frame fits into the chain, -1 if the chain is broken
+ */
+
+static int list_chain_update(struct list_chain *chain, const struct cmp_frame_info *info)
+{
+	/* a loaded reference model takes the place of the primary frame */
+	if (info->sequence_number == 0 || (info->model_preloaded && info->sequence_number == 1)) {
+		chain->valid = 1;
+		chain->identifier = info->identifier;
+		chain->original_size = info->original_size;
+		chain->sequence_number = info->sequence_number;
+		return 0;
+	}
+	if (info->preprocessing != CMP_PREPROCESS_MODEL)
+		return 0;
+
+	if (!chain->valid || chain->identifier != info->identifier ||
+	    chain->original_size != info->original_size ||
+	    chain->sequence_number + 1 != info->sequence_number) {
+		chain->valid = 0;
+		return -1;
+	}
+	chain->sequence_number = info->sequence_number;
+	return 0;
+}
+
+
+/**
+ * @brief lists the frames of a file or an archive
+ *
+ * Only the frame headers are read; the file is memory-mapped, so the frames
+ * are skipped without reading the compressed data. The frames of an archive
+ * are found through its index, because an appended archive keeps the old
+ * index and footer in front of the appended frames.
+ *
+ * @param view		view to open the file with
+ * @param filename	name of the file to list
+ * @param chain		model frame chain of the files before; a chain can
+ *			go on from file to file like during decompression
+ * @param print_frames	non-zero to print a line for every frame
+ *
+ * @returns 0 on success or -1 if the file contains invalid frames
+ */
+
+static int list_file(struct file_view *view, const char *filename, struct list_chain *chain,
+		     int print_frames)
+{
+	const char *name = strcmp(filename, STD_IN_MARK) ? filename : "stdin";
+	struct cmp_frame_iterator it;
+	struct cmp_frame_info info;
+	struct archive_index index;
+	int const verbose = log_get_level() > LOG_LEVEL_DEBUG;
+	int is_archive;
+	unsigned long num_frames = 0;
+	unsigned long num_chains = 0;
+	unsigned long num_broken = 0;
+	uint64_t sum_compressed = 0;
+	uint64_t sum_original = 0;
+	uint32_t ret;
+	int result = 0;
+
+	if (file_view_open(view, filename))
+		return -1;
+
+	is_archive = archive_index_init(&index, view->data, view->size) == 0;
+	cmp_frame_iterator_init(&it, view->data, view->size);
+
+	if (print_frames) {
+		LOG_STDOUT("%s:\n", name);
+		LOG_STDOUT("%6s %12s %10s %10s %7s %-10s %-12s %5s %7s %4s %3s %12s %3s%s\n",
+			   "frame", "offset", "compressed", "original", "ratio", "preprocess",
+			   "encoder", "param", "outlier", "rate", "chk", "identifier", "seq",
+			   is_archive ? "  name" : "");
+	}
+
+	while (is_archive ? num_frames < index.num_entries
+			  : (ret = cmp_frame_iterator_next(&it, &info)) != 0) {
+		struct archive_entry entry;
+		uint64_t offset = it.pos;
+		int broken;
+
+		if (is_archive) {
+			if (archive_index_entry(&index, (uint32_t)num_frames, &entry)) {
+				LOG_ERROR("%s: invalid index entry %lu", name, num_frames);
+				result = -1;
+				break;
+			}
+			offset = entry.offset;
+			ret = cmp_get_frame_info((const uint8_t *)view->data + entry.offset,
+						 entry.compressed_size, &info);
+			info.offset = entry.offset;
+		}
+		if (cmp_is_error(ret)) {
+			LOG_ERROR_CMP(ret, "%s: invalid frame at offset %llu", name,
+				      (unsigned long long)offset);
+			result = -1;
+			break;
+		}
+		if (is_archive && ret != entry.compressed_size) {
+			LOG_ERROR("%s: index does not match frame %lu", name, num_frames);
+			result = -1;
+			break;
+		}
+
+		broken = list_chain_update(chain, &info);
+		num_broken += broken != 0;
+		num_chains += info.sequence_number == 0 ||
+			      (info.model_preloaded && info.sequence_number == 1);
+		sum_compressed += info.compressed_size;
+		sum_original += info.original_size;
+
+		if (print_frames) {
+			double const ratio = info.original_size ? (double)info.compressed_size /
+					     (double)info.original_size * 100.0 : 0.0;
+
+			LOG_STDOUT("%6lu %12llu %10lu %10lu %6.2f%% %-10s %-12s %5lu %7lu %4lu %3s "
+				   "%012llx %3u%s",
+				   num_frames, (unsigned long long)info.offset,
+				   (unsigned long)info.compressed_size,
+				   (unsigned long)info.original_size, ratio,
+				   cmp_preprocessing_name(info.preprocessing),
+				   cmp_encoder_type_name(info.encoder_type),
+				   (unsigned long)info.encoder_param,
+				   (unsigned long)info.encoder_outlier,
+				   (unsigned long)info.model_rate,
+				   info.checksum_enabled ? "yes" : "no",
+				   (unsigned long long)info.identifier,
+				   (unsigned int)info.sequence_number, broken ? "!" : " ");
+			if (is_archive)
+				LOG_STDOUT(" %.*s", (int)entry.name_len, index.names + entry.name_offset);
+			LOG_STDOUT("\n");
+		}
+		if (broken)
+			LOG_WARNING("%s: frame %lu does not continue its model frame chain", name,
+				    num_frames);
+		num_frames++;
+	}
+	{
+		struct hr_fmt const hr_c = util_make_human_readable(sum_compressed, verbose);
+		struct hr_fmt const hr_o = util_make_human_readable(sum_original, verbose);
+
+		LOG_STDOUT("%s: %lu frames, %.2f%% (%.*f%s => %.*f%s), %lu model chains, "
+			   "%lu broken\n",
+			   name, num_frames,
+			   sum_original ? (double)sum_compressed / (double)sum_original * 100.0
+					: 0.0,
+			   hr_o.precision, hr_o.value, hr_o.suffix,
+			   hr_c.precision, hr_c.value, hr_c.suffix, num_chains, num_broken);
+	}
+
+	file_view_close(view);
+	return result;
+}
+
+
+/**
+ * @brief lists the frames of a list of files without decompressing them
+ *
+ * With -q only the summary line of every file is printed.
+ */
+
+static int list_file_list(const char **input_files, int num_files)
+{
+	int result = EXIT_SUCCESS;
+	struct file_view view;
+	struct list_chain chain;
+	int const print_frames = log_get_level() >= LOG_LEVEL_DEFAULT;
+	int i;
+
+	memset(&view, 0, sizeof(view));
+	memset(&chain, 0, sizeof(chain));
+	for (i = 0; i < num_files; i++)
+		if (list_file(&view, input_files[i], &chain, print_frames))
+			result = EXIT_FAILURE;
+	file_view_free(&view);
 
 	return result;
 }
 
 
+/**
+ * @brief parses the number of worker threads
+ *
+ * @param str		string to parse; 0 selects one thread per core
+ * @param num_threads	pointer to store the number of threads
+ *
+ * @returns 0 on success, -1 on error
+ */
+
+static int parse_num_threads(const char *str, unsigned int *num_threads)
+{
+	char *end;
+	unsigned long n;
+
+	errno = 0;
+	n = strtoul(str, &end, 10);
+	if (errno || end == str || *end != '\0' || str[0] == '-' || n > POOL_MAX_THREADS)
+		return -1;
+
+	*num_threads = n ? (unsigned int)n : util_count_cores();
+	if (*num_threads > POOL_MAX_THREADS)
+		*num_threads = POOL_MAX_THREADS;
+	return 0;
+}
+
+
+/**
+ * @brief parses the size of the frames of a stream
+ *
+ * @param str		string to parse; a number of bytes
+ * @param frame_size	pointer to store the frame size
+ *
+ * @returns 0 on success, -1 on error
+ */
+
+static int parse_frame_size(const char *str, uint32_t *frame_size)
+{
+	char *end;
+	unsigned long n;
+
+	errno = 0;
+	n = strtoul(str, &end, 10);
+	if (errno || end == str || *end != '\0' || str[0] == '-' || n == 0 ||
+	    n % sizeof(uint16_t) || n > CMP_HDR_MAX_ORIGINAL_SIZE)
+		return -1;
+
+	*frame_size = (uint32_t)n;
+	return 0;
+}
+
+
+/**
+ * @brief parses the minimum measuring time of a benchmark setting
+ *
+ * @param str		string to parse; a non-negative number of seconds
+ * @param min_time	pointer to store the time
+ *
+ * @returns 0 on success, -1 on error
+ */
+
+static int parse_bench_time(const char *str, double *min_time)
+{
+	char *end;
+	double t;
+
+	errno = 0;
+	t = strtod(str, &end);
+	if (errno || end == str || *end != '\0' || !(t >= 0 && t <= 3600))
+		return -1;
+
+	*min_time = t;
+	return 0;
+}
+
+
+/**
+ * @brief parses the number of iterations of a benchmark setting
+ *
+ * @param str		string to parse; a positive number
+ * @param iterations	pointer to store the number of iterations
+ *
+ * @returns 0 on success, -1 on error
+ */
+
+static int parse_bench_iterations(const char *str, unsigned int *iterations)
+{
+	char *end;
+	unsigned long n;
+
+	errno = 0;
+	n = strtoul(str, &end, 10);
+	if (errno || end == str || *end != '\0' || str[0] == '-' || n == 0 || n > UINT_MAX)
+		return -1;
+
+	*iterations = (unsigned int)n;
+	return 0;
+}
+
+
 /**
  * @brief creates a file list from the input arguments
  *
@@ -257,7 +1635,23 @@ static void print_usage(FILE *stream, const char *program_name)
 	LOG_F(stream, "With no FILE, or when FILE is -, read standard input.\n");
 	LOG_F(stream, "\nOptions:\n");
 	LOG_F(stream, "  -c, --compress    Compress input files\n");
+	LOG_F(stream, "  -l, --list        List the frames of compressed files and archives\n");
+	LOG_F(stream, "  -b                Benchmark the compression of the files in memory\n");
 	LOG_F(stream, "  -o OUTPUT         Write output to OUTPUT\n");
+	LOG_F(stream, "  --archive         Compress the files into the archive OUTPUT\n");
+	LOG_F(stream, "  --append          Append the files to the archive OUTPUT\n");
+	LOG_F(stream, "  --frame-size=N    Compress the input stream in frames of N bytes\n");
+	LOG_F(stream, "  --watch=PATH      Compress new files in directory PATH or named in FIFO PATH\n");
+	LOG_F(stream, "  --params-file=F   Read the compression parameters from file F\n");
+	LOG_F(stream, "  --bench-time=S    Measure every benchmark setting for S seconds (default: 1)\n");
+	LOG_F(stream, "  --bench-iter=N    Measure every benchmark setting N times\n");
+	LOG_F(stream, "  --bench-sweep     Benchmark all preprocessing, encoder and g_par combinations\n");
+	LOG_F(stream, "  --json            Print the benchmark results as JSON\n");
+	LOG_F(stream, "  --tune            Search the compression parameters for the files; -o saves\n");
+	LOG_F(stream, "                    the parameters with the best ratio to OUTPUT\n");
+	LOG_F(stream, "  --trace=FILE      Write the timings of the compression stages to FILE as\n");
+	LOG_F(stream, "                    Chrome trace JSON (chrome://tracing, Perfetto)\n");
+	LOG_F(stream, "  -T, --threads=N   (De)compress with N threads (0: one per core)\n");
 	LOG_F(stream, "  -q, --quiet       Decrease verbosity\n");
 	LOG_F(stream, "  -v, --verbose     Increase verbosity\n");
 	LOG_F(stream, "  --[no]color       Print color codes in output\n");
@@ -266,8 +1660,20 @@ static void print_usage(FILE *stream, const char *program_name)
 	LOG_F(stream, "\nExamples:\n");
 	LOG_F(stream, "# Compressing files1 and files2 to output.air\n");
 	LOG_F(stream, "airspace -c file1 file2 -o output.air\n");
-	LOG_F(stream, "# Decompressing files (coming soon!)\n");
-	LOG_F(stream, "airspace output.air -o file1.dat file2.dat\n");
+	LOG_F(stream, "# Adding file3 to the archive archive.air\n");
+	LOG_F(stream, "airspace -c --append file3 -o archive.air\n");
+	LOG_F(stream, "# Compressing a live stream in frames of 64 KiB\n");
+	LOG_F(stream, "acquire | airspace -c --frame-size=65536 - > stream.air\n");
+	LOG_F(stream, "# Compressing new files in incoming/ into archive/ until SIGTERM\n");
+	LOG_F(stream, "airspace -c --watch=incoming -o archive --params-file=params.txt\n");
+	LOG_F(stream, "# Decompressing file1.air and file2.air to file1 and file2 with 4 threads\n");
+	LOG_F(stream, "airspace -T4 file1.air file2.air\n");
+	LOG_F(stream, "# Listing the frames of archive.air without decompressing them\n");
+	LOG_F(stream, "airspace -l archive.air\n");
+	LOG_F(stream, "# Benchmarking all parameter combinations on file1 and file2\n");
+	LOG_F(stream, "airspace -b --bench-sweep file1 file2\n");
+	LOG_F(stream, "# Searching the parameters for file1 and file2 and saving them to params.txt\n");
+	LOG_F(stream, "airspace --tune file1 file2 -o params.txt\n");
 }
 
 
@@ -299,6 +1705,17 @@ int main(int argc, char *argv[])
 	 */
 	enum {
 		STDOUT_OPT = CHAR_MAX + 1,
+		ARCHIVE_OPT,
+		APPEND_OPT,
+		FRAME_SIZE_OPT,
+		WATCH_OPT,
+		PARAMS_FILE_OPT,
+		BENCH_TIME_OPT,
+		BENCH_ITER_OPT,
+		BENCH_SWEEP_OPT,
+		JSON_OPT,
+		TUNE_OPT,
+		TRACE_OPT,
 		COLOR_OPT,
 		NO_COLOR_OPT,
 		DEBUG_STDIN_CONSOLE_OPT,
@@ -306,8 +1723,21 @@ int main(int argc, char *argv[])
 	};
 	static struct option long_options[] = {
 		{ "compress",               no_argument,       NULL, 'c'                      },
+		{ "list",                   no_argument,       NULL, 'l'                      },
 		{ "params",                 required_argument, NULL, 'p'                      },
+		{ "threads",                required_argument, NULL, 'T'                      },
 		{ "stdout",                 no_argument,       NULL, STDOUT_OPT               },
+		{ "archive",                no_argument,       NULL, ARCHIVE_OPT              },
+		{ "append",                 no_argument,       NULL, APPEND_OPT               },
+		{ "frame-size",             required_argument, NULL, FRAME_SIZE_OPT           },
+		{ "watch",                  required_argument, NULL, WATCH_OPT                },
+		{ "params-file",            required_argument, NULL, PARAMS_FILE_OPT          },
+		{ "bench-time",             required_argument, NULL, BENCH_TIME_OPT           },
+		{ "bench-iter",             required_argument, NULL, BENCH_ITER_OPT           },
+		{ "bench-sweep",            no_argument,       NULL, BENCH_SWEEP_OPT          },
+		{ "json",                   no_argument,       NULL, JSON_OPT                 },
+		{ "tune",                   no_argument,       NULL, TUNE_OPT                 },
+		{ "trace",                  required_argument, NULL, TRACE_OPT                },
 		{ "verbose",                no_argument,       NULL, 'v'                      },
 		{ "quiet",                  no_argument,       NULL, 'q'                      },
 		{ "color",                  no_argument,       NULL, COLOR_OPT                },
@@ -327,18 +1757,32 @@ int main(int argc, char *argv[])
 	/* Set defaults */
 	enum operation_mode mode = MODE_DECOMPRESS;
 	const char *output_filename = NULL;
+	enum archive_mode archive_mode = ARCHIVE_NONE;
 	struct cmp_params params = { 0 };
+	unsigned int num_threads = 0;
+	uint32_t frame_size = 0;
+	const char *watch_path = NULL;
+	const char *params_file = NULL;
+	struct bench_options bench_opt = { 1.0, 0, 0, 0 };
+	const char *trace_filename = NULL;
+	struct trace_file trace;
 
 	assert(argv);
 	assert(argc >= 1);
 	program_name = argv[0];
 	log_setup_color();
 
-	while ((ch = getopt_long(argc, argv, "Vvqhco:", long_options, NULL)) != -1) {
+	while ((ch = getopt_long(argc, argv, "Vvqhclbo:T:", long_options, NULL)) != -1) {
 		switch (ch) {
 		case 'c':
 			mode = MODE_COMPRESS;
 			break;
+		case 'l':
+			mode = MODE_LIST;
+			break;
+		case 'b':
+			mode = MODE_BENCH;
+			break;
 		case 'p':
 			if (cmp_params_parse(optarg, &params) != CMP_PARSE_OK) {
 				LOG_ERROR("Incorrect parameter option: %s", argv[optind-1]);
@@ -348,9 +1792,59 @@ int main(int argc, char *argv[])
 		case 'o':
 			output_filename = optarg;
 			break;
+		case 'T':
+			if (parse_num_threads(optarg, &num_threads)) {
+				LOG_ERROR("Invalid number of threads: %s", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
 		case STDOUT_OPT:
 			output_filename = STD_OUT_MARK;
 			break;
+		case ARCHIVE_OPT:
+			if (archive_mode == ARCHIVE_NONE)
+				archive_mode = ARCHIVE_CREATE;
+			break;
+		case APPEND_OPT:
+			archive_mode = ARCHIVE_APPEND;
+			break;
+		case FRAME_SIZE_OPT:
+			if (parse_frame_size(optarg, &frame_size)) {
+				LOG_ERROR("Invalid frame size: %s (an even number of bytes up to %lu)",
+					  optarg, (unsigned long)(CMP_HDR_MAX_ORIGINAL_SIZE & ~1UL));
+				return EXIT_FAILURE;
+			}
+			break;
+		case WATCH_OPT:
+			watch_path = optarg;
+			break;
+		case PARAMS_FILE_OPT:
+			params_file = optarg;
+			break;
+		case BENCH_TIME_OPT:
+			if (parse_bench_time(optarg, &bench_opt.min_time)) {
+				LOG_ERROR("Invalid benchmark time: %s", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case BENCH_ITER_OPT:
+			if (parse_bench_iterations(optarg, &bench_opt.iterations)) {
+				LOG_ERROR("Invalid number of benchmark iterations: %s", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case BENCH_SWEEP_OPT:
+			bench_opt.sweep = 1;
+			break;
+		case JSON_OPT:
+			bench_opt.json = 1;
+			break;
+		case TUNE_OPT:
+			mode = MODE_TUNE;
+			break;
+		case TRACE_OPT:
+			trace_filename = optarg;
+			break;
 		case 'v':
 			log_increase_verbosity();
 			break;
@@ -389,6 +1883,31 @@ int main(int argc, char *argv[])
 
 	LOG_PLAIN(LOG_LEVEL_DEBUG, AIRSPACE_WELCOME_MESSAGE);
 
+	/* the tuning uses all cores unless told otherwise */
+	if (!num_threads)
+		num_threads = mode == MODE_TUNE ? util_count_cores() : 1;
+
+	if (trace_filename && (mode != MODE_COMPRESS || watch_path)) {
+		LOG_ERROR("--trace is only supported for the compression of files or a stream");
+		return EXIT_FAILURE;
+	}
+
+	if (watch_path) {
+		if (mode != MODE_COMPRESS || archive_mode != ARCHIVE_NONE || frame_size) {
+			LOG_ERROR("--watch is only supported for compression into single files");
+			return EXIT_FAILURE;
+		}
+		if (argc > 0) {
+			LOG_ERROR("--watch takes no input files");
+			return EXIT_FAILURE;
+		}
+		/* the frames of the channels need unique identifiers */
+		cmp_set_timestamp_func(cli_get_timestamp);
+		return compress_daemon(watch_path, output_filename, &params, params_file);
+	}
+	if (params_file && file_load_params(params_file, &params))
+		return EXIT_FAILURE;
+
 	input_files = allocate_file_list(argv, argc, &num_files, &is_reading_stdin);
 
 	if (is_reading_stdin) {
@@ -398,7 +1917,8 @@ int main(int argc, char *argv[])
 		}
 		LOG_DEBUG("Using stdin as an input");
 
-		if (!output_filename) {
+		if (!output_filename && mode != MODE_LIST && mode != MODE_BENCH &&
+		    mode != MODE_TUNE) {
 			if (util_is_console(stdout)) {
 				LOG_ERROR("stdout is a terminal, aborting");
 				goto end;
@@ -408,6 +1928,43 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	if (mode == MODE_LIST && output_filename) {
+		LOG_ERROR("--list prints to stdout and takes no output file");
+		goto end;
+	}
+
+	if (mode == MODE_BENCH && (output_filename || archive_mode != ARCHIVE_NONE || frame_size)) {
+		LOG_ERROR("-b benchmarks in memory and takes no output options");
+		goto end;
+	}
+
+	if (mode == MODE_TUNE && (archive_mode != ARCHIVE_NONE || frame_size)) {
+		LOG_ERROR("--tune takes no archive or frame size options");
+		goto end;
+	}
+
+	if (archive_mode != ARCHIVE_NONE) {
+		if (mode != MODE_COMPRESS) {
+			LOG_ERROR("--archive and --append are only supported for compression");
+			goto end;
+		}
+		if (!output_filename) {
+			LOG_ERROR("An archive needs an output file (-o OUTPUT)");
+			goto end;
+		}
+	}
+
+	if (frame_size) {
+		if (mode != MODE_COMPRESS || archive_mode != ARCHIVE_NONE) {
+			LOG_ERROR("--frame-size is only supported for compression without an archive");
+			goto end;
+		}
+		if (num_files != 1) {
+			LOG_ERROR("--frame-size compresses a single input stream");
+			goto end;
+		}
+	}
+
 	/* No info message by default when output is stdout */
 	if (output_filename && !strcmp(output_filename, STD_OUT_MARK) &&
 	    log_get_level() == LOG_LEVEL_DEFAULT)
@@ -416,10 +1973,32 @@ int main(int argc, char *argv[])
 	/* Execute requested operation */
 	switch (mode) {
 	case MODE_COMPRESS:
-		return_val = compress_file_list(output_filename, input_files, num_files, &params);
+		if (trace_filename && trace_file_open(&trace, trace_filename))
+			break;
+		if (frame_size)
+			return_val = compress_stream(output_filename, input_files[0], &params,
+						     frame_size, trace_filename ? &trace : NULL);
+		else
+			return_val = compress_file_list(output_filename, input_files, num_files,
+							&params, num_threads, archive_mode,
+							trace_filename ? &trace : NULL);
+		if (trace_filename && trace_file_close(&trace))
+			return_val = EXIT_FAILURE;
 		break;
 	case MODE_DECOMPRESS:
-		LOG_ERROR("Decompression not implemented yet");
+		return_val = decompress_file_list(output_filename, input_files, num_files,
+						  num_threads);
+		break;
+	case MODE_LIST:
+		return_val = list_file_list(input_files, num_files);
+		break;
+	case MODE_BENCH:
+		return_val = bench_files(input_files, num_files, &params, &bench_opt) ?
+				     EXIT_FAILURE : EXIT_SUCCESS;
+		break;
+	case MODE_TUNE:
+		return_val = tune_files(input_files, num_files, &params, num_threads,
+					output_filename) ? EXIT_FAILURE : EXIT_SUCCESS;
 		break;
 	default:
 		LOG_ERROR("Invalid operation mode");
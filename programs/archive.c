@@ -0,0 +1,613 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Archive container implementation
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "archive.h"
+#include "file.h"
+#include "log.h"
+#include "../lib/cmp_header.h"
+#include "../lib/cmp_decompress.h"
+
+/* 64-bit file positions, also where long has 32 bits */
+#if defined(_WIN32)
+typedef __int64 archive_off_t;
+#  define archive_fseek _fseeki64
+#  define archive_ftell _ftelli64
+#else
+#  include <sys/types.h>
+typedef off_t archive_off_t;
+#  define archive_fseek fseeko
+#  define archive_ftell ftello
+#endif
+
+/* largest value of the signed archive_off_t */
+#define ARCHIVE_OFF_MAX \
+	((uint64_t)((((archive_off_t)1 << (sizeof(archive_off_t) * CHAR_BIT - 2)) - 1) * 2 + 1))
+
+
+/**
+ * @brief decoded archive footer
+ */
+
+struct archive_footer {
+	uint64_t index_offset;
+	uint32_t num_entries;
+	uint32_t names_size;
+};
+
+
+static void put_be(uint8_t *p, uint64_t value, unsigned int num_bytes)
+{
+	while (num_bytes--) {
+		p[num_bytes] = (uint8_t)value;
+		value >>= 8;
+	}
+}
+
+
+static uint64_t get_be(const uint8_t *p, unsigned int num_bytes)
+{
+	uint64_t value = 0;
+	unsigned int i;
+
+	for (i = 0; i < num_bytes; i++)
+		value = value << 8 | p[i];
+	return value;
+}
+
+
+static void serialize_entry(uint8_t buf[ARCHIVE_ENTRY_SIZE], const struct archive_entry *e)
+{
+	memset(buf, 0, ARCHIVE_ENTRY_SIZE);
+	put_be(buf + 0, e->offset, 8);
+	put_be(buf + 8, e->compressed_size, 4);
+	put_be(buf + 12, e->original_size, 4);
+	put_be(buf + 16, e->identifier, 6);
+	put_be(buf + 22, e->sequence_number, 1);
+	/* byte 23 is reserved */
+	put_be(buf + 24, e->name_offset, 4);
+	put_be(buf + 28, e->name_len, 2);
+	/* bytes 30 and 31 are reserved */
+}
+
+
+static void deserialize_entry(const uint8_t buf[ARCHIVE_ENTRY_SIZE], struct archive_entry *e)
+{
+	e->offset = get_be(buf + 0, 8);
+	e->compressed_size = (uint32_t)get_be(buf + 8, 4);
+	e->original_size = (uint32_t)get_be(buf + 12, 4);
+	e->identifier = get_be(buf + 16, 6);
+	e->sequence_number = (uint8_t)get_be(buf + 22, 1);
+	e->name_offset = (uint32_t)get_be(buf + 24, 4);
+	e->name_len = (uint16_t)get_be(buf + 28, 2);
+}
+
+
+/**
+ * @brief checks that an entry lies within the frame area and the name table
+ */
+
+static int entry_is_valid(const struct archive_entry *e, uint64_t index_offset,
+			  uint32_t names_size)
+{
+	return e->offset <= index_offset && e->compressed_size <= index_offset - e->offset &&
+	       e->name_offset <= names_size && e->name_len <= names_size - e->name_offset;
+}
+
+
+static int archive_seek(FILE *fp, const char *filename, uint64_t pos)
+{
+	if (pos > ARCHIVE_OFF_MAX || archive_fseek(fp, (archive_off_t)pos, SEEK_SET)) {
+		LOG_ERROR_WITH_ERRNO("Can't seek in '%s'", filename);
+		return -1;
+	}
+	return 0;
+}
+
+
+static int archive_read(FILE *fp, const char *filename, void *buf, size_t size)
+{
+	if (fread(buf, 1, size, fp) != size) {
+		if (ferror(fp))
+			LOG_ERROR_WITH_ERRNO("Can't read '%s'", filename);
+		else
+			LOG_ERROR("%s: archive is truncated", filename);
+		return -1;
+	}
+	return 0;
+}
+
+
+/**
+ * @brief decodes and validates the footer of an archive
+ *
+ * @param buf		serialised footer
+ * @param file_size	size of the archive in bytes
+ * @param footer	pointer to store the decoded footer
+ *
+ * @returns 0 on success or 1 if the data are no archive
+ */
+
+static int parse_footer(const uint8_t buf[ARCHIVE_FOOTER_SIZE], uint64_t file_size,
+			struct archive_footer *footer)
+{
+	uint64_t index_size;
+
+	if (get_be(buf + 20, 4) != ARCHIVE_MAGIC || get_be(buf + 16, 2) != ARCHIVE_VERSION)
+		return 1;
+
+	footer->index_offset = get_be(buf + 0, 8);
+	footer->num_entries = (uint32_t)get_be(buf + 8, 4);
+	footer->names_size = (uint32_t)get_be(buf + 12, 4);
+
+	index_size = (uint64_t)footer->num_entries * ARCHIVE_ENTRY_SIZE + footer->names_size;
+	if (footer->index_offset > file_size - ARCHIVE_FOOTER_SIZE ||
+	    file_size - ARCHIVE_FOOTER_SIZE - footer->index_offset != index_size)
+		return 1;
+
+	return 0;
+}
+
+
+/**
+ * @brief reads and validates the footer at the end of an archive
+ *
+ * @param fp		opened archive
+ * @param filename	name of the archive; used for error messages
+ * @param footer	pointer to store the decoded footer
+ * @param quiet		non-zero to not log that the file is no archive
+ *
+ * @returns 0 on success, 1 if the file is no archive or -1 on error
+ */
+
+static int read_footer(FILE *fp, const char *filename, struct archive_footer *footer, int quiet)
+{
+	uint8_t buf[ARCHIVE_FOOTER_SIZE];
+	uint64_t file_size;
+	archive_off_t end;
+
+	if (archive_fseek(fp, 0, SEEK_END) || (end = archive_ftell(fp)) < 0) {
+		LOG_ERROR_WITH_ERRNO("Can't seek in '%s'", filename);
+		return -1;
+	}
+	file_size = (uint64_t)end;
+
+	if (file_size >= ARCHIVE_FOOTER_SIZE) {
+		if (archive_seek(fp, filename, file_size - ARCHIVE_FOOTER_SIZE) ||
+		    archive_read(fp, filename, buf, sizeof(buf)))
+			return -1;
+		if (parse_footer(buf, file_size, footer) == 0)
+			return 0;
+	}
+
+	if (!quiet)
+		LOG_ERROR("'%s' is not an archive", filename);
+	return 1;
+}
+
+
+/* returns the last component of a path */
+static const char *path_basename(const char *path)
+{
+	const char *name = path;
+	const char *p;
+
+	for (p = path; *p != '\0'; p++)
+		if (*p == '/' || *p == '\\')
+			name = p + 1;
+	return name;
+}
+
+
+static void archive_writer_reset(struct archive_writer *aw, const char *filename)
+{
+	memset(aw, 0, sizeof(*aw));
+	aw->filename = filename;
+}
+
+
+int archive_writer_create(struct archive_writer *aw, const char *filename)
+{
+	assert(aw);
+	assert(filename);
+
+	archive_writer_reset(aw, filename);
+	aw->fp = file_create(filename);
+	return aw->fp ? 0 : -1;
+}
+
+
+/**
+ * @brief loads the index of an archive into a writer
+ *
+ * @returns 0 on success or -1 on error
+ */
+
+static int archive_writer_load_index(struct archive_writer *aw,
+				     const struct archive_footer *footer)
+{
+	uint8_t buf[ARCHIVE_ENTRY_SIZE];
+	uint32_t i;
+
+	aw->entries_capacity = footer->num_entries;
+	aw->names_capacity = footer->names_size;
+	aw->entries = malloc((footer->num_entries ? footer->num_entries : 1) *
+			     sizeof(*aw->entries));
+	aw->names = malloc(footer->names_size ? footer->names_size : 1);
+	if (!aw->entries || !aw->names) {
+		LOG_ERROR_WITH_ERRNO("Memory allocation failed for the index of '%s'",
+				     aw->filename);
+		return -1;
+	}
+
+	if (archive_seek(aw->fp, aw->filename, footer->index_offset))
+		return -1;
+	for (i = 0; i < footer->num_entries; i++) {
+		if (archive_read(aw->fp, aw->filename, buf, sizeof(buf)))
+			return -1;
+		deserialize_entry(buf, &aw->entries[i]);
+		if (!entry_is_valid(&aw->entries[i], footer->index_offset, footer->names_size)) {
+			LOG_ERROR("%s: invalid index entry %lu", aw->filename, (unsigned long)i);
+			return -1;
+		}
+	}
+	if (archive_read(aw->fp, aw->filename, aw->names, footer->names_size))
+		return -1;
+
+	aw->num_entries = footer->num_entries;
+	aw->names_size = footer->names_size;
+	return 0;
+}
+
+
+int archive_writer_open_append(struct archive_writer *aw, const char *filename)
+{
+	struct archive_footer footer;
+	uint64_t end;
+
+	assert(aw);
+	assert(filename);
+
+	archive_writer_reset(aw, filename);
+	if (!strcmp(filename, STD_OUT_MARK) || !strcmp(filename, NULL_MARK)) {
+		LOG_ERROR("Can't append to '%s'", filename);
+		return -1;
+	}
+
+	aw->fp = fopen(filename, "r+b");
+	if (!aw->fp) {
+		if (errno == ENOENT)
+			return archive_writer_create(aw, filename);
+		LOG_ERROR_WITH_ERRNO("Can't open '%s'", filename);
+		return -1;
+	}
+
+	if (read_footer(aw->fp, filename, &footer, 0) ||
+	    archive_writer_load_index(aw, &footer))
+		goto fail;
+
+	/*
+	 * The new frames and the new index go behind the old footer, which
+	 * stays intact until the new footer is written. An interrupted append
+	 * leaves the old archive in the first end bytes of the file.
+	 */
+	end = footer.index_offset + (uint64_t)footer.num_entries * ARCHIVE_ENTRY_SIZE +
+	      footer.names_size + ARCHIVE_FOOTER_SIZE;
+	if (archive_seek(aw->fp, filename, end))
+		goto fail;
+	aw->pos = end;
+	return 0;
+
+fail:
+	(void)file_close(aw->fp, filename);
+	aw->fp = NULL;
+	free(aw->entries);
+	free(aw->names);
+	return -1;
+}
+
+
+/**
+ * @brief makes room for another entry and its name
+ *
+ * @returns 0 on success or -1 on error
+ */
+
+static int archive_writer_grow(struct archive_writer *aw, uint32_t name_len)
+{
+	if (aw->num_entries == aw->entries_capacity) {
+		uint32_t const capacity = aw->entries_capacity ? 2 * aw->entries_capacity : 64;
+		struct archive_entry *entries;
+
+		if (capacity <= aw->entries_capacity) {
+			LOG_ERROR("%s: too many frames in the archive", aw->filename);
+			return -1;
+		}
+		entries = realloc(aw->entries, capacity * sizeof(*entries));
+		if (!entries) {
+			LOG_ERROR_WITH_ERRNO("Memory allocation failed for the archive index");
+			return -1;
+		}
+		aw->entries = entries;
+		aw->entries_capacity = capacity;
+	}
+
+	if (name_len > aw->names_capacity - aw->names_size) {
+		uint32_t capacity = aw->names_capacity ? aw->names_capacity : 1024;
+		char *names;
+
+		while (capacity - aw->names_size < name_len) {
+			if (capacity > UINT32_MAX / 2) {
+				LOG_ERROR("%s: name table too large", aw->filename);
+				return -1;
+			}
+			capacity *= 2;
+		}
+		names = realloc(aw->names, capacity);
+		if (!names) {
+			LOG_ERROR_WITH_ERRNO("Memory allocation failed for the archive names");
+			return -1;
+		}
+		aw->names = names;
+		aw->names_capacity = capacity;
+	}
+	return 0;
+}
+
+
+int archive_writer_add(struct archive_writer *aw, const void *frame, uint32_t frame_size,
+		       const char *src_filename)
+{
+	const uint8_t *hdr = frame;
+	const char *name;
+	struct archive_entry *e;
+	size_t name_len;
+
+	assert(aw);
+	assert(aw->fp);
+	assert(frame);
+	assert(src_filename);
+
+	name = strcmp(src_filename, STD_IN_MARK) ? path_basename(src_filename) : "";
+	name_len = strlen(name);
+	if (name_len > ARCHIVE_MAX_NAME_LEN) {
+		LOG_ERROR("%s: file name too long for an archive", src_filename);
+		return -1;
+	}
+	if (frame_size < CMP_HDR_SIZE) {
+		LOG_ERROR("%s: invalid frame", src_filename);
+		return -1;
+	}
+	if (archive_writer_grow(aw, (uint32_t)name_len))
+		return -1;
+
+	if (file_write(aw->fp, aw->filename, frame, frame_size)) {
+		/* the index is written behind the last complete frame */
+		if (aw->fp != stdout)
+			(void)archive_seek(aw->fp, aw->filename, aw->pos);
+		return -1;
+	}
+
+	e = &aw->entries[aw->num_entries++];
+	e->offset = aw->pos;
+	e->compressed_size = frame_size;
+	e->original_size = cmp_get_original_size(frame, frame_size);
+	e->identifier = get_be(hdr + CMP_HDR_OFFSET_IDENTIFIER, CMP_HDR_BITS_IDENTIFIER / 8);
+	e->sequence_number = hdr[CMP_HDR_OFFSET_SEQUENCE_NUMBER];
+	e->name_offset = aw->names_size;
+	e->name_len = (uint16_t)name_len;
+	memcpy(aw->names + aw->names_size, name, name_len);
+	aw->names_size += (uint32_t)name_len;
+	aw->pos += frame_size;
+
+	return 0;
+}
+
+
+int archive_writer_close(struct archive_writer *aw)
+{
+	uint8_t buf[ARCHIVE_ENTRY_SIZE];
+	uint8_t footer[ARCHIVE_FOOTER_SIZE];
+	uint32_t i;
+	int err = 0;
+
+	assert(aw);
+
+	if (!aw->fp)
+		return -1;
+
+	for (i = 0; i < aw->num_entries && !err; i++) {
+		serialize_entry(buf, &aw->entries[i]);
+		err = file_write(aw->fp, aw->filename, buf, sizeof(buf));
+	}
+	if (!err)
+		err = file_write(aw->fp, aw->filename, aw->names, aw->names_size);
+	if (!err) {
+		memset(footer, 0, sizeof(footer));
+		put_be(footer + 0, aw->pos, 8);
+		put_be(footer + 8, aw->num_entries, 4);
+		put_be(footer + 12, aw->names_size, 4);
+		put_be(footer + 16, ARCHIVE_VERSION, 2);
+		put_be(footer + 20, ARCHIVE_MAGIC, 4);
+		err = file_write(aw->fp, aw->filename, footer, sizeof(footer));
+	}
+	if (file_close(aw->fp, aw->filename))
+		err = -1;
+
+	free(aw->entries);
+	free(aw->names);
+	archive_writer_reset(aw, aw->filename);
+
+	return err ? -1 : 0;
+}
+
+
+int archive_is_archive(const char *filename)
+{
+	struct archive_footer footer;
+	FILE *fp;
+	int ret;
+
+	assert(filename);
+
+	if (!strcmp(filename, STD_IN_MARK))
+		return 0;
+
+	fp = fopen(filename, "rb");
+	if (!fp) {
+		LOG_ERROR_WITH_ERRNO("Can't open '%s'", filename);
+		return -1;
+	}
+	ret = read_footer(fp, filename, &footer, 1);
+	(void)file_close(fp, filename);
+
+	if (ret < 0)
+		return -1;
+	return ret == 0;
+}
+
+
+int archive_reader_open(struct archive_reader *ar, const char *filename)
+{
+	struct archive_footer footer;
+
+	assert(ar);
+	assert(filename);
+
+	memset(ar, 0, sizeof(*ar));
+	ar->filename = filename;
+	ar->fp = fopen(filename, "rb");
+	if (!ar->fp) {
+		LOG_ERROR_WITH_ERRNO("Can't open '%s'", filename);
+		return -1;
+	}
+	if (read_footer(ar->fp, filename, &footer, 0)) {
+		archive_reader_close(ar);
+		return -1;
+	}
+
+	ar->index_offset = footer.index_offset;
+	ar->num_entries = footer.num_entries;
+	ar->names_size = footer.names_size;
+	return 0;
+}
+
+
+int archive_read_entry(struct archive_reader *ar, uint32_t i, struct archive_entry *entry)
+{
+	uint8_t buf[ARCHIVE_ENTRY_SIZE];
+
+	assert(ar);
+	assert(ar->fp);
+	assert(entry);
+	assert(i < ar->num_entries);
+
+	if (archive_seek(ar->fp, ar->filename, ar->index_offset + (uint64_t)i * ARCHIVE_ENTRY_SIZE) ||
+	    archive_read(ar->fp, ar->filename, buf, sizeof(buf)))
+		return -1;
+	deserialize_entry(buf, entry);
+	if (!entry_is_valid(entry, ar->index_offset, ar->names_size)) {
+		LOG_ERROR("%s: invalid index entry %lu", ar->filename, (unsigned long)i);
+		return -1;
+	}
+	return 0;
+}
+
+
+int archive_read_name(struct archive_reader *ar, const struct archive_entry *entry, char *name)
+{
+	uint64_t const names_offset = ar->index_offset +
+				      (uint64_t)ar->num_entries * ARCHIVE_ENTRY_SIZE;
+
+	assert(ar);
+	assert(ar->fp);
+	assert(entry);
+	assert(name);
+
+	if (archive_seek(ar->fp, ar->filename, names_offset + entry->name_offset) ||
+	    archive_read(ar->fp, ar->filename, name, entry->name_len))
+		return -1;
+	name[entry->name_len] = '\0';
+
+	/* only the last path component is stored */
+	if (strlen(name) != entry->name_len || strchr(name, '/') || strchr(name, '\\') ||
+	    !strcmp(name, ".") || !strcmp(name, "..")) {
+		LOG_ERROR("%s: invalid file name in the archive", ar->filename);
+		return -1;
+	}
+	return 0;
+}
+
+
+int archive_read_frame(struct archive_reader *ar, const struct archive_entry *entry,
+		       struct file_buffer *buf)
+{
+	assert(ar);
+	assert(ar->fp);
+	assert(entry);
+	assert(buf);
+
+	if (file_buffer_reserve(buf, entry->compressed_size))
+		return -1;
+	if (archive_seek(ar->fp, ar->filename, entry->offset))
+		return -1;
+	return archive_read(ar->fp, ar->filename, buf->data, entry->compressed_size);
+}
+
+
+void archive_reader_close(struct archive_reader *ar)
+{
+	assert(ar);
+
+	if (ar->fp)
+		(void)file_close(ar->fp, ar->filename);
+	ar->fp = NULL;
+}
+
+
+int archive_index_init(struct archive_index *index, const void *data, uint64_t size)
+{
+	const uint8_t *bytes = data;
+	struct archive_footer footer;
+
+	assert(index);
+	assert(data || size == 0);
+
+	memset(index, 0, sizeof(*index));
+	if (size < ARCHIVE_FOOTER_SIZE ||
+	    parse_footer(bytes + (size - ARCHIVE_FOOTER_SIZE), size, &footer))
+		return 1;
+
+	index->entries = bytes + footer.index_offset;
+	index->names = (const char *)(bytes + footer.index_offset +
+				      (uint64_t)footer.num_entries * ARCHIVE_ENTRY_SIZE);
+	index->index_offset = footer.index_offset;
+	index->num_entries = footer.num_entries;
+	index->names_size = footer.names_size;
+	return 0;
+}
+
+
+int archive_index_entry(const struct archive_index *index, uint32_t i,
+			struct archive_entry *entry)
+{
+	assert(index);
+	assert(entry);
+	assert(i < index->num_entries);
+
+	deserialize_entry(index->entries + (size_t)i * ARCHIVE_ENTRY_SIZE, entry);
+	return entry_is_valid(entry, index->index_offset, index->names_size) ? 0 : -1;
+}
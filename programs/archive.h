@@ -0,0 +1,219 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Archive container holding many compressed frames in one file
+ *
+ * An archive is a concatenation of compressed frames followed by an index
+ * with one fixed-size entry per frame, a table with the original file names
+ * and a fixed-size footer at the end of the file:
+ *
+ *	frame 0 | ... | frame N-1 | entry 0 | ... | entry N-1 | names | footer
+ *
+ * The footer gives the position of the index, so any entry, and with it any
+ * frame, is found with a single seek, without looking at the frame headers.
+ * New frames are appended behind the old footer, followed by an index of all
+ * frames and a new footer; the old index and footer remain as unused bytes
+ * between the frames. All fields are stored in big-endian byte order.
+ */
+
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "file.h"
+
+#define ARCHIVE_MAGIC       0x41495241UL /**< "AIRA" at the end of every archive */
+#define ARCHIVE_VERSION     1
+#define ARCHIVE_ENTRY_SIZE  32 /**< size of a serialised index entry in bytes */
+#define ARCHIVE_FOOTER_SIZE 24 /**< size of the serialised footer in bytes */
+#define ARCHIVE_MAX_NAME_LEN 0xFFFFU
+
+
+/**
+ * @brief index entry of a frame in an archive
+ */
+
+struct archive_entry {
+	uint64_t offset;          /**< position of the frame in the archive */
+	uint32_t compressed_size; /**< size of the frame in bytes */
+	uint32_t original_size;   /**< size of the decompressed data in bytes */
+	uint64_t identifier;      /**< identifier from the frame header */
+	uint8_t sequence_number;  /**< sequence number from the frame header */
+	uint32_t name_offset;     /**< position of the file name in the name table */
+	uint16_t name_len;        /**< length of the file name; 0 if unknown */
+};
+
+
+/**
+ * @brief state to write frames into an archive
+ */
+
+struct archive_writer {
+	FILE *fp;
+	const char *filename;
+	uint64_t pos;                  /**< position of the next frame */
+	struct archive_entry *entries; /**< entries of all frames in the archive */
+	uint32_t num_entries;
+	uint32_t entries_capacity;
+	char *names;                   /**< name table of all frames in the archive */
+	uint32_t names_size;
+	uint32_t names_capacity;
+};
+
+
+/**
+ * @brief state to read frames from an archive
+ */
+
+struct archive_reader {
+	FILE *fp;
+	const char *filename;
+	uint64_t index_offset; /**< position of the first index entry */
+	uint32_t num_entries;  /**< number of frames in the archive */
+	uint32_t names_size;   /**< size of the name table in bytes */
+};
+
+
+/**
+ * @brief index of an archive in memory, e.g., of a memory-mapped archive
+ */
+
+struct archive_index {
+	const uint8_t *entries; /**< serialised index entries */
+	const char *names;      /**< name table; the names are not zero-terminated */
+	uint64_t index_offset;  /**< position of the index; end of the frames */
+	uint32_t num_entries;   /**< number of frames in the archive */
+	uint32_t names_size;    /**< size of the name table in bytes */
+};
+
+
+/**
+ * @brief creates a new archive; an existing file is not overwritten
+ *
+ * @param aw		writer to initialise
+ * @param filename	name of the archive or the stdout marker
+ *
+ * @returns 0 on success or -1 on error
+ */
+int archive_writer_create(struct archive_writer *aw, const char *filename);
+
+/**
+ * @brief opens an archive to append frames; creates the archive if it does
+ *	not exist
+ *
+ * @param aw		writer to initialise
+ * @param filename	name of the archive
+ *
+ * @returns 0 on success or -1 on error
+ */
+int archive_writer_open_append(struct archive_writer *aw, const char *filename);
+
+/**
+ * @brief writes a compressed frame into an archive
+ *
+ * @param aw		opened archive writer
+ * @param frame		compressed frame
+ * @param frame_size	size of the frame in bytes
+ * @param src_filename	name of the compressed file; only the last path
+ *			component is stored
+ *
+ * @returns 0 on success or -1 on error
+ */
+int archive_writer_add(struct archive_writer *aw, const void *frame, uint32_t frame_size,
+		       const char *src_filename);
+
+/**
+ * @brief writes the index of all added frames and closes an archive
+ *
+ * The index is also written if adding a frame failed, so the archive holds the
+ * frames added before.
+ *
+ * @returns 0 on success or -1 on error
+ */
+int archive_writer_close(struct archive_writer *aw);
+
+
+/**
+ * @brief checks if a file is an archive
+ *
+ * @returns 1 for an archive, 0 for any other file (e.g., plain compressed
+ *	frames or stdin) or -1 on error
+ */
+int archive_is_archive(const char *filename);
+
+/**
+ * @brief opens an archive for reading and validates its footer
+ *
+ * @returns 0 on success or -1 on error
+ */
+int archive_reader_open(struct archive_reader *ar, const char *filename);
+
+/**
+ * @brief reads the index entry of a frame
+ *
+ * @param ar	opened archive reader
+ * @param i	number of the frame; smaller than ar->num_entries
+ * @param entry	pointer to store the validated entry
+ *
+ * @returns 0 on success or -1 on error
+ */
+int archive_read_entry(struct archive_reader *ar, uint32_t i, struct archive_entry *entry);
+
+/**
+ * @brief reads the file name of a frame
+ *
+ * @param ar		opened archive reader
+ * @param entry		entry of the frame
+ * @param name		buffer for the zero-terminated name; at least
+ *			entry->name_len + 1 bytes
+ *
+ * @returns 0 on success or -1 on error
+ */
+int archive_read_name(struct archive_reader *ar, const struct archive_entry *entry, char *name);
+
+/**
+ * @brief reads a frame into a buffer
+ *
+ * @param ar	opened archive reader
+ * @param entry	entry of the frame
+ * @param buf	buffer for the frame; grown if needed
+ *
+ * @returns 0 on success or -1 on error
+ */
+int archive_read_frame(struct archive_reader *ar, const struct archive_entry *entry,
+		       struct file_buffer *buf);
+
+/** @brief closes an archive reader */
+void archive_reader_close(struct archive_reader *ar);
+
+
+/**
+ * @brief locates the index of an archive in memory
+ *
+ * @param index	index to initialise
+ * @param data	content of the whole archive
+ * @param size	size of the archive in bytes
+ *
+ * @returns 0 on success or 1 if the data are no archive
+ */
+int archive_index_init(struct archive_index *index, const void *data, uint64_t size);
+
+/**
+ * @brief decodes an entry of an archive index in memory
+ *
+ * @param index	initialised index
+ * @param i	number of the frame; smaller than index->num_entries
+ * @param entry	pointer to store the entry
+ *
+ * @returns 0 on success or -1 if the entry is invalid
+ */
+int archive_index_entry(const struct archive_index *index, uint32_t i,
+			struct archive_entry *entry);
+
+#endif /* ARCHIVE_H */
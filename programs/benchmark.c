@@ -0,0 +1,458 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief In-memory compression benchmark of the CLI
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "benchmark.h"
+#include "../lib/cmp.h"
+#include "../lib/cmp_errors.h"
+#include "file.h"
+#include "log.h"
+#include "params_parse.h"
+#include "util.h"
+
+#define BENCH_MAX_G_PAR 4096U        /**< largest Golomb parameter of a sweep */
+#define BENCH_DEFAULT_OUTLIER 16U    /**< multi escape outlier of a sweep if none is given */
+#define BENCH_MAX_MODEL_ITERATIONS 255U
+
+
+static int compare_double(const void *a, const void *b)
+{
+	double const x = *(const double *)a;
+	double const y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+
+/* checks if the error of a parameter set only means that it does not fit the inputs */
+static int bench_is_invalid(uint32_t ret)
+{
+	return cmp_get_error_code(ret) == CMP_ERR_PARAMS_INVALID ||
+	       cmp_get_error_code(ret) == CMP_ERR_SRC_SIZE_MISMATCH;
+}
+
+
+int bench_load(struct bench_state *st, const char **filenames, int num_files)
+{
+	int i;
+
+	memset(st, 0, sizeof(*st));
+	st->filenames = filenames;
+	st->num_files = num_files;
+	st->run_len = num_files;
+	st->owns_inputs = 1;
+	st->inputs = calloc((size_t)num_files, sizeof(*st->inputs));
+	if (!st->inputs) {
+		LOG_ERROR_WITH_ERRNO("Memory allocation failed for the benchmark");
+		return -1;
+	}
+
+	for (i = 0; i < num_files; i++) {
+		if (file_input_open(&st->inputs[i], filenames[i], 0))
+			return -1;
+		st->total_size += st->inputs[i].size;
+		if (st->inputs[i].size > st->max_size)
+			st->max_size = st->inputs[i].size;
+	}
+	return 0;
+}
+
+
+void bench_share(struct bench_state *st, const struct bench_state *src)
+{
+	memset(st, 0, sizeof(*st));
+	st->filenames = src->filenames;
+	st->inputs = src->inputs;
+	st->num_files = src->num_files;
+	st->run_len = src->run_len;
+	st->total_size = src->total_size;
+	st->max_size = src->max_size;
+	st->opt = src->opt;
+}
+
+
+void bench_free(struct bench_state *st)
+{
+	int i;
+
+	if (st->owns_inputs && st->inputs) {
+		for (i = 0; i < st->num_files; i++)
+			file_input_free(&st->inputs[i]);
+		free(st->inputs);
+	}
+	st->inputs = NULL;
+	file_buffer_free(&st->work_buf);
+	file_buffer_free(&st->dst);
+	free(st->times);
+	st->times = NULL;
+}
+
+
+int bench_prepare(struct bench_state *st, const struct cmp_params *params,
+		  struct cmp_context *ctx)
+{
+	uint32_t work_size, ret;
+
+	work_size = cmp_cal_work_buf_size(params, st->max_size);
+	if (cmp_is_error(work_size)) {
+		if (bench_is_invalid(work_size))
+			return 1;
+		LOG_ERROR_CMP(work_size, "Can't calculate the work buffer size");
+		return -1;
+	}
+	if (file_buffer_reserve(&st->work_buf, work_size) ||
+	    file_buffer_reserve(&st->dst, file_compress_bound(params, st->max_size)))
+		return -1;
+
+	ret = cmp_initialise(ctx, params, st->work_buf.data, work_size);
+	if (cmp_is_error(ret)) {
+		if (bench_is_invalid(ret))
+			return 1;
+		LOG_ERROR_CMP(ret, "Compression initialisation failed");
+		return -1;
+	}
+	return 0;
+}
+
+
+int bench_iteration(struct bench_state *st, struct cmp_context *ctx,
+		    const struct bench_hists *hists, uint64_t *compressed_size)
+{
+	uint64_t sum = 0;
+	int i;
+
+	for (i = 0; i < st->num_files; i++) {
+		unsigned int const k = (unsigned int)(i % st->run_len);
+		uint32_t ret;
+
+		if (k == 0) {
+			ret = cmp_reset(ctx);
+			if (cmp_is_error(ret)) {
+				LOG_ERROR_CMP(ret, "Can't reset the compression context");
+				return -1;
+			}
+		}
+		if (hists) {
+			uint32_t *const hist = k % (hists->secondary_iterations + 1)
+						       ? hists->secondary
+						       : hists->primary;
+
+			ret = cmp_set_residual_hist(ctx, hist, CMP_RESIDUAL_HIST_SIZE);
+			if (cmp_is_error(ret)) {
+				LOG_ERROR_CMP(ret, "Can't count the residuals");
+				return -1;
+			}
+		}
+		ret = cmp_compress_u16(ctx, st->dst.data, st->dst.capacity, st->inputs[i].buf.data,
+				       st->inputs[i].size);
+		if (cmp_is_error(ret)) {
+			if (bench_is_invalid(ret))
+				return 1;
+			LOG_ERROR_CMP(ret, "Compression failed for %s", st->filenames[i]);
+			return -1;
+		}
+		sum += ret;
+	}
+	*compressed_size = sum;
+	return 0;
+}
+
+
+/* grows the buffer for the times of the iterations */
+static int bench_reserve_times(struct bench_state *st, size_t n)
+{
+	if (n > st->times_capacity) {
+		size_t const new_capacity = st->times_capacity ? 2 * st->times_capacity : 64;
+		double *new_times = realloc(st->times, new_capacity * sizeof(*new_times));
+
+		if (!new_times) {
+			LOG_ERROR_WITH_ERRNO("Memory allocation failed for the benchmark");
+			return -1;
+		}
+		st->times = new_times;
+		st->times_capacity = new_capacity;
+	}
+	return 0;
+}
+
+
+int bench_setting(struct bench_state *st, const struct cmp_params *params,
+		  struct bench_result *result)
+{
+	struct cmp_context ctx;
+	double start, elapsed = 0;
+	unsigned int n = 0;
+	int err;
+
+	err = bench_prepare(st, params, &ctx);
+	if (err)
+		return err;
+
+	/* the untimed first iteration warms up the caches and gives the size */
+	err = bench_iteration(st, &ctx, NULL, &result->compressed_size);
+	if (err) {
+		cmp_deinitialise(&ctx);
+		return err;
+	}
+
+	start = util_get_time();
+	do {
+		uint64_t size;
+		double t;
+
+		if (bench_reserve_times(st, n + 1)) {
+			err = -1;
+			break;
+		}
+		t = util_get_time();
+		err = bench_iteration(st, &ctx, NULL, &size);
+		st->times[n++] = util_get_time() - t;
+		if (err)
+			break;
+		elapsed = util_get_time() - start;
+	} while (st->opt->iterations ? n < st->opt->iterations : elapsed < st->opt->min_time);
+	cmp_deinitialise(&ctx);
+	if (err)
+		return err;
+
+	qsort(st->times, n, sizeof(*st->times), compare_double);
+	{
+		double const median = n % 2 ? st->times[n / 2]
+					    : (st->times[n / 2 - 1] + st->times[n / 2]) / 2;
+		double const slowest = st->times[n - 1];
+		double const size = (double)st->total_size;
+
+		result->iterations = n;
+		result->min_speed = slowest > 0 ? size / slowest / 1e6 : 0;
+		result->median_speed = median > 0 ? size / median / 1e6 : 0;
+		result->ns_per_sample = median * 1e9 / (size / sizeof(uint16_t));
+	}
+	return 0;
+}
+
+
+/* prints a string as a JSON string */
+static void print_json_string(const char *s)
+{
+	LOG_STDOUT("\"");
+	for (; *s; s++) {
+		unsigned char const c = (unsigned char)*s;
+
+		if (c == '"' || c == '\\')
+			LOG_STDOUT("\\%c", c);
+		else if (c < 0x20)
+			LOG_STDOUT("\\u%04x", c);
+		else
+			LOG_STDOUT("%c", c);
+	}
+	LOG_STDOUT("\"");
+}
+
+
+static void print_header(const struct bench_state *st)
+{
+	int i;
+
+	if (st->opt->json) {
+		LOG_STDOUT("{\n  \"files\": [");
+		for (i = 0; i < st->num_files; i++) {
+			LOG_STDOUT(i ? ", " : "");
+			print_json_string(st->filenames[i]);
+		}
+		LOG_STDOUT("],\n  \"input_size\": %llu,\n  \"num_samples\": %llu,\n"
+			   "  \"results\": [",
+			   (unsigned long long)st->total_size,
+			   (unsigned long long)(st->total_size / sizeof(uint16_t)));
+		return;
+	}
+	{
+		struct hr_fmt const hr = util_make_human_readable(st->total_size, 0);
+
+		LOG_STDOUT("%d files, %.*f%s, %llu samples\n", st->num_files, hr.precision,
+			   hr.value, hr.suffix,
+			   (unsigned long long)(st->total_size / sizeof(uint16_t)));
+	}
+	LOG_STDOUT("%-16s %-12s %6s %7s %8s %10s %10s %9s %6s\n", "preprocess", "encoder",
+		   "g_par", "outlier", "ratio", "MB/s min", "MB/s med", "ns/sample", "iter");
+}
+
+
+static void print_result(struct bench_state *st, const struct cmp_params *params,
+			 const struct bench_result *result)
+{
+	double const ratio = (double)result->compressed_size / (double)st->total_size * 100.0;
+
+	if (st->opt->json) {
+		LOG_STDOUT("%s\n    {\"primary_preprocessing\": \"%s\", "
+			   "\"primary_encoder_type\": \"%s\", \"primary_encoder_param\": %lu, "
+			   "\"primary_encoder_outlier\": %lu, \"secondary_iterations\": %lu, "
+			   "\"secondary_preprocessing\": \"%s\", \"secondary_encoder_type\": "
+			   "\"%s\", \"secondary_encoder_param\": %lu, "
+			   "\"secondary_encoder_outlier\": %lu, \"model_rate\": %lu, "
+			   "\"compressed_size\": %llu, \"ratio_percent\": %.3f, "
+			   "\"iterations\": %u, \"mb_per_s_min\": %.2f, \"mb_per_s_median\": "
+			   "%.2f, \"ns_per_sample\": %.3f}",
+			   st->num_results ? "," : "",
+			   cmp_preprocessing_name(params->primary_preprocessing),
+			   cmp_encoder_type_name(params->primary_encoder_type),
+			   (unsigned long)params->primary_encoder_param,
+			   (unsigned long)params->primary_encoder_outlier,
+			   (unsigned long)params->secondary_iterations,
+			   cmp_preprocessing_name(params->secondary_preprocessing),
+			   cmp_encoder_type_name(params->secondary_encoder_type),
+			   (unsigned long)params->secondary_encoder_param,
+			   (unsigned long)params->secondary_encoder_outlier,
+			   (unsigned long)params->model_rate,
+			   (unsigned long long)result->compressed_size, ratio, result->iterations,
+			   result->min_speed, result->median_speed, result->ns_per_sample);
+	} else {
+		char preprocess[32];
+
+		if (params->secondary_iterations)
+			sprintf(preprocess, "%.12s+%.12s",
+				cmp_preprocessing_name(params->primary_preprocessing),
+				cmp_preprocessing_name(params->secondary_preprocessing));
+		else
+			sprintf(preprocess, "%.16s",
+				cmp_preprocessing_name(params->primary_preprocessing));
+		LOG_STDOUT("%-16s %-12s %6lu %7lu %7.2f%% %10.2f %10.2f %9.3f %6u\n", preprocess,
+			   cmp_encoder_type_name(params->primary_encoder_type),
+			   (unsigned long)params->primary_encoder_param,
+			   (unsigned long)params->primary_encoder_outlier, ratio,
+			   result->min_speed, result->median_speed, result->ns_per_sample,
+			   result->iterations);
+	}
+	st->num_results++;
+	fflush(stdout);
+}
+
+
+/* benchmarks and prints one setting; invalid parameters are skipped */
+static int bench_run(struct bench_state *st, const struct cmp_params *params)
+{
+	struct bench_result result;
+	int const ret = bench_setting(st, params, &result);
+
+	if (ret < 0)
+		return -1;
+	if (ret > 0) {
+		LOG_DEBUG("Skipping invalid parameters");
+		return 0;
+	}
+	print_result(st, params, &result);
+	return 0;
+}
+
+
+static int bench_sweep(struct bench_state *st, const struct cmp_params *params)
+{
+	static const enum cmp_preprocessing preprocessings[] = {
+		CMP_PREPROCESS_NONE, CMP_PREPROCESS_DIFF, CMP_PREPROCESS_IWT, CMP_PREPROCESS_MODEL
+	};
+	static const enum cmp_encoder_type encoders[] = { CMP_ENCODER_GOLOMB_ZERO,
+							  CMP_ENCODER_GOLOMB_MULTI };
+	uint32_t const outlier = params->primary_encoder_outlier ? params->primary_encoder_outlier
+								 : BENCH_DEFAULT_OUTLIER;
+	struct cmp_params p = *params;
+	size_t i, e;
+
+	/* uncompressed baseline */
+	p.primary_preprocessing = CMP_PREPROCESS_NONE;
+	p.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	p.primary_encoder_param = 0;
+	p.primary_encoder_outlier = 0;
+	p.secondary_iterations = 0;
+	if (bench_run(st, &p))
+		return -1;
+
+	for (i = 0; i < sizeof(preprocessings) / sizeof(preprocessings[0]); i++) {
+		int const is_model = preprocessings[i] == CMP_PREPROCESS_MODEL;
+
+		/* the model needs data of previous files */
+		if (is_model && st->num_files < 2)
+			continue;
+		p.primary_preprocessing = is_model ? CMP_PREPROCESS_DIFF : preprocessings[i];
+		p.secondary_iterations = 0;
+		if (is_model) {
+			p.secondary_iterations = params->secondary_iterations;
+			if (!p.secondary_iterations)
+				p.secondary_iterations = (uint32_t)st->num_files - 1;
+			if (p.secondary_iterations > BENCH_MAX_MODEL_ITERATIONS)
+				p.secondary_iterations = BENCH_MAX_MODEL_ITERATIONS;
+			p.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+		}
+		for (e = 0; e < sizeof(encoders) / sizeof(encoders[0]); e++) {
+			uint32_t g_par;
+
+			for (g_par = 1; g_par <= BENCH_MAX_G_PAR; g_par *= 2) {
+				p.primary_encoder_type = encoders[e];
+				p.primary_encoder_param = g_par;
+				p.primary_encoder_outlier =
+					encoders[e] == CMP_ENCODER_GOLOMB_MULTI ? outlier : 0;
+				p.secondary_encoder_type = p.primary_encoder_type;
+				p.secondary_encoder_param = p.primary_encoder_param;
+				p.secondary_encoder_outlier = p.primary_encoder_outlier;
+				if (bench_run(st, &p))
+					return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+
+int bench_files(const char **input_files, int num_files, const struct cmp_params *params,
+		const struct bench_options *opt)
+{
+	struct bench_state st;
+	int result = 0;
+
+	assert(input_files);
+	assert(params);
+	assert(opt);
+	assert(num_files > 0);
+
+	/* the samples are loaded once in host byte order */
+	if (bench_load(&st, input_files, num_files)) {
+		result = -1;
+		goto end;
+	}
+	st.opt = opt;
+	if (st.total_size == 0) {
+		LOG_ERROR("Nothing to benchmark, the input is empty");
+		result = -1;
+		goto end;
+	}
+
+	print_header(&st);
+	if (opt->sweep) {
+		result = bench_sweep(&st, params);
+	} else {
+		struct bench_result res;
+		int const ret = bench_setting(&st, params, &res);
+
+		if (ret > 0)
+			LOG_ERROR("The compression parameters do not fit the input");
+		if (ret)
+			result = -1;
+		else
+			print_result(&st, params, &res);
+	}
+	if (opt->json)
+		LOG_STDOUT("\n  ]\n}\n");
+
+end:
+	bench_free(&st);
+	return result;
+}
@@ -0,0 +1,181 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief In-memory compression benchmark of the CLI
+ *
+ * The input files are loaded once; one iteration compresses all of them in
+ * order with a reset context, like one CLI run, so model frame chains are
+ * included. The iterations are repeated for a minimum time or a fixed count.
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../lib/cmp.h"
+#include "file.h"
+
+
+/**
+ * @brief options of a benchmark run
+ */
+
+struct bench_options {
+	double min_time;          /**< minimum measuring time of every setting in seconds */
+	unsigned int iterations;  /**< fixed number of iterations; 0 to use min_time */
+	int sweep;                /**< set to sweep preprocessing x encoder x Golomb parameter */
+	int json;                 /**< set to print JSON instead of a table */
+};
+
+
+/**
+ * @brief loaded inputs and buffers shared by all benchmarked settings
+ */
+
+struct bench_state {
+	const char **filenames;
+	struct file_input *inputs;
+	int num_files;
+	int run_len;                /**< files per model chain; a chain starts with a reset */
+	int owns_inputs;            /**< set if bench_free() frees the inputs */
+	uint64_t total_size;        /**< sum of all input sizes in bytes */
+	uint32_t max_size;          /**< size of the largest input in bytes */
+	struct file_buffer work_buf;
+	struct file_buffer dst;
+	double *times;              /**< time of every iteration of a setting */
+	size_t times_capacity;
+	const struct bench_options *opt;
+	unsigned int num_results;
+};
+
+
+/**
+ * @brief measurement of one compression setting
+ */
+
+struct bench_result {
+	uint64_t compressed_size; /**< compressed size of all inputs in bytes */
+	unsigned int iterations;  /**< number of timed iterations */
+	double min_speed;         /**< compression speed of the slowest iteration in MB/s */
+	double median_speed;      /**< median compression speed in MB/s */
+	double ns_per_sample;     /**< median time per sample in nanoseconds */
+};
+
+
+/**
+ * @brief residual histograms filled during an iteration
+ *
+ * See cmp_set_residual_hist(); the primary and the secondary frames of the
+ * model chains are counted separately.
+ */
+
+struct bench_hists {
+	uint32_t *primary;             /**< histogram of the primary frames */
+	uint32_t *secondary;           /**< histogram of the secondary frames */
+	uint32_t secondary_iterations; /**< secondary frames after every primary frame */
+};
+
+
+/**
+ * @brief loads the inputs of a benchmark in host byte order
+ *
+ * All files form one model chain; run_len can be lowered afterwards.
+ *
+ * @param st		state to set up; released with bench_free()
+ * @param filenames	files to load; must remain valid while st is used
+ * @param num_files	number of files
+ *
+ * @returns 0 on success or -1 on error
+ */
+
+int bench_load(struct bench_state *st, const char **filenames, int num_files);
+
+
+/**
+ * @brief sets up a state sharing the inputs of another one
+ *
+ * The buffers are not shared, so both states can be used in parallel.
+ *
+ * @param st	state to set up; released with bench_free()
+ * @param src	state with loaded inputs; must outlive st
+ */
+
+void bench_share(struct bench_state *st, const struct bench_state *src);
+
+
+/**
+ * @brief releases the buffers of a state and the inputs it loaded
+ *
+ * @param st	state to release
+ */
+
+void bench_free(struct bench_state *st);
+
+
+/**
+ * @brief initialises a context and reserves the buffers for a parameter set
+ *
+ * @returns 0 on success, 1 if the parameters are invalid or -1 on error
+ */
+
+int bench_prepare(struct bench_state *st, const struct cmp_params *params,
+		  struct cmp_context *ctx);
+
+
+/**
+ * @brief compresses all inputs in order; every run starts a new model chain
+ *
+ * @param st			loaded state
+ * @param ctx			context initialised with bench_prepare()
+ * @param hists			histograms to fill; NULL if not counted
+ * @param compressed_size	pointer to store the compressed size of all
+ *				inputs in bytes
+ *
+ * @returns 0 on success, 1 if the parameters do not fit the inputs or -1 on
+ *	error
+ */
+
+int bench_iteration(struct bench_state *st, struct cmp_context *ctx,
+		    const struct bench_hists *hists, uint64_t *compressed_size);
+
+
+/**
+ * @brief measures the compression with one set of parameters
+ *
+ * After an untimed warm-up, the iterations are repeated for the minimum time
+ * or the fixed count of the options of the state.
+ *
+ * @returns 0 on success, 1 if the parameters do not fit the inputs or -1 on
+ *	error
+ */
+
+int bench_setting(struct bench_state *st, const struct cmp_params *params,
+		  struct bench_result *result);
+
+
+/**
+ * @brief benchmarks the compression of files
+ *
+ * Without sweep, the given parameters are measured. With sweep, every
+ * preprocessing method is combined with both Golomb encoders and power of two
+ * Golomb parameters; the other parameters, e.g., the outlier of the multi
+ * escape encoder or the model rate, are taken from the given parameters. Model
+ * preprocessing is only swept with more than one file.
+ *
+ * @param input_files	files to compress
+ * @param num_files	number of files
+ * @param params	compression parameters
+ * @param opt		benchmark options
+ *
+ * @returns 0 on success or -1 on error
+ */
+
+int bench_files(const char **input_files, int num_files, const struct cmp_params *params,
+		const struct bench_options *opt);
+
+#endif /* BENCHMARK_H */
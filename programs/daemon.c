@@ -0,0 +1,385 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Compression daemon of the CLI
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "daemon.h"
+#include "../lib/cmp.h"
+#include "file.h"
+#include "log.h"
+#include "util.h"
+#include "watch.h"
+
+
+/**
+ * @brief compression context of a channel of the daemon
+ *
+ * The files of a channel are compressed one after the other with the same
+ * context, so their model frame chains continue from file to file.
+ */
+
+struct daemon_channel {
+	char *name;             /**< file name without its last number */
+	struct cmp_context ctx;
+	void *work_buf;
+	uint32_t work_buf_size;
+	uint32_t model_size;    /**< size of the last file of the channel; 0 for none */
+	int initialised;        /**< set if ctx is initialised with the current parameters */
+};
+
+
+/**
+ * @brief state of the compression daemon
+ */
+
+struct compress_daemon {
+	const char *output_dir;        /**< directory for the compressed files; NULL for next to the input */
+	const char *params_file;       /**< file to (re)load the parameters from; may be NULL */
+	struct cmp_params base_params; /**< parameters of the command line */
+	struct cmp_params params;      /**< current parameters */
+	struct daemon_channel *channels;
+	unsigned int num_channels;
+	struct file_input src;
+	struct file_buffer dst;
+	char *name_buf;
+	size_t name_buf_size;
+
+	/* statistics */
+	unsigned long num_files;
+	unsigned long num_failed;
+	uint64_t sum_input_size;
+	uint64_t sum_output_size;
+	double busy_time;              /**< time spent compressing and writing */
+	double sum_latency;            /**< sum of the times from detection to written output */
+	double max_latency;
+};
+
+
+/**
+ * @brief finds the channel of a file; the channel is created if needed
+ *
+ * The channel name is the file name without its directory and without its
+ * last run of digits, so "det1_0001.dat" and "det1_0002.dat" share the
+ * channel "det1_.dat".
+ *
+ * @returns the channel of the file or NULL on error
+ */
+
+static struct daemon_channel *daemon_get_channel(struct compress_daemon *d, const char *filename)
+{
+	const char *base = filename;
+	const char *digits_end = NULL;
+	const char *digits_start = NULL;
+	struct daemon_channel *ch;
+	char *ch_name;
+	const char *p;
+	size_t len;
+	unsigned int i;
+
+	for (p = filename; *p != '\0'; p++)
+		if (*p == '/' || *p == '\\')
+			base = p + 1;
+	for (p = base; *p != '\0'; p++) {
+		if (*p >= '0' && *p <= '9') {
+			if (p == base || p[-1] < '0' || p[-1] > '9')
+				digits_start = p;
+			digits_end = p + 1;
+		}
+	}
+	if (!digits_start)
+		digits_start = digits_end = base;
+
+	len = strlen(base) - (size_t)(digits_end - digits_start);
+	for (i = 0; i < d->num_channels; i++) {
+		const char *name = d->channels[i].name;
+		size_t const head = (size_t)(digits_start - base);
+
+		if (strlen(name) == len && !memcmp(name, base, head) &&
+		    !strcmp(name + head, digits_end))
+			return &d->channels[i];
+	}
+
+	ch_name = malloc(len + 1);
+	ch = realloc(d->channels, (d->num_channels + 1) * sizeof(*d->channels));
+	if (!ch_name || !ch) {
+		LOG_ERROR_WITH_ERRNO("Memory allocation failed for a channel");
+		free(ch_name);
+		if (ch)
+			d->channels = ch;
+		return NULL;
+	}
+	d->channels = ch;
+	ch = &d->channels[d->num_channels++];
+	memset(ch, 0, sizeof(*ch));
+	ch->name = ch_name;
+	memcpy(ch->name, base, (size_t)(digits_start - base));
+	strcpy(ch->name + (digits_start - base), digits_end);
+	LOG_DEBUG("New channel %s", ch->name);
+
+	return ch;
+}
+
+
+/**
+ * @brief prepares the context of a channel for a file
+ *
+ * The context is (re)initialised if the parameters changed or the work buffer
+ * is too small; it is reset if the file size differs from the model size.
+ *
+ * @returns 0 on success or -1 on error
+ */
+
+static int daemon_channel_prepare(struct compress_daemon *d, struct daemon_channel *ch,
+				  uint32_t src_size)
+{
+	uint32_t const work_buf_size = cmp_cal_work_buf_size(&d->params, src_size);
+	uint32_t ret;
+
+	if (cmp_is_error(work_buf_size)) {
+		LOG_ERROR_CMP(work_buf_size, "Error calculating work buffer size");
+		return -1;
+	}
+
+	if (!ch->initialised || work_buf_size > ch->work_buf_size) {
+		if (work_buf_size > ch->work_buf_size) {
+			free(ch->work_buf);
+			ch->work_buf_size = 0;
+			ch->initialised = 0;
+			ch->work_buf = malloc(work_buf_size);
+			if (!ch->work_buf) {
+				LOG_ERROR_WITH_ERRNO("Memory allocation failed for size %lu",
+						     (unsigned long)work_buf_size);
+				return -1;
+			}
+			ch->work_buf_size = work_buf_size;
+		}
+		ret = cmp_initialise(&ch->ctx, &d->params, ch->work_buf, ch->work_buf_size);
+		if (cmp_is_error(ret)) {
+			LOG_ERROR_CMP(ret, "Compression initialization failed");
+			return -1;
+		}
+		ch->initialised = 1;
+	} else if (ch->model_size != src_size) {
+		/* a model frame needs a model of its size */
+		ret = cmp_reset(&ch->ctx);
+		if (cmp_is_error(ret)) {
+			LOG_ERROR_CMP(ret, "Compression reset failed");
+			return -1;
+		}
+	}
+	ch->model_size = src_size;
+	return 0;
+}
+
+
+/**
+ * @brief builds the name of the compressed file of an input file
+ *
+ * @returns the output name or NULL on error
+ */
+
+static const char *daemon_output_name(struct compress_daemon *d, const char *filename)
+{
+	const char *base = filename;
+	const char *p;
+	size_t need;
+
+	if (d->output_dir)
+		for (p = filename; *p != '\0'; p++)
+			if (*p == '/' || *p == '\\')
+				base = p + 1;
+	need = strlen(base) + sizeof(AIRSPACE_EXTENSION);
+	if (d->output_dir)
+		need += strlen(d->output_dir) + 1;
+	if (need > d->name_buf_size) {
+		free(d->name_buf);
+		d->name_buf_size = 0;
+		d->name_buf = malloc(need);
+		if (!d->name_buf) {
+			LOG_ERROR_WITH_ERRNO("Memory allocation failed for size %lu",
+					     (unsigned long)need);
+			return NULL;
+		}
+		d->name_buf_size = need;
+	}
+	d->name_buf[0] = '\0';
+	if (d->output_dir) {
+		strcpy(d->name_buf, d->output_dir);
+		strcat(d->name_buf, "/");
+	}
+	strcat(d->name_buf, base);
+	strcat(d->name_buf, AIRSPACE_EXTENSION);
+	return d->name_buf;
+}
+
+
+/**
+ * @brief compresses a new file with the context of its channel
+ *
+ * @param d		daemon state
+ * @param filename	name of the new file
+ * @param found_time	time the file was reported; used for the latency
+ *
+ * @returns 0 on success or -1 on error; the daemon goes on after an error
+ */
+
+static int daemon_compress_file(struct compress_daemon *d, const char *filename,
+				double found_time)
+{
+	struct daemon_channel *ch;
+	const char *output_name;
+	uint32_t input_size, output_size;
+	double latency;
+	int const verbose = log_get_level() > LOG_LEVEL_DEBUG;
+
+	if (file_input_open(&d->src, filename, !d->params.iwt_in_place_enabled))
+		return -1;
+	input_size = d->src.size;
+	ch = daemon_get_channel(d, filename);
+	if (!ch || daemon_channel_prepare(d, ch, input_size)) {
+		file_input_close(&d->src);
+		return -1;
+	}
+
+	output_size = file_compress(&ch->ctx, &d->params, &d->src, &d->dst, filename);
+	file_input_close(&d->src);
+	output_name = daemon_output_name(d, filename);
+	if (cmp_is_error(output_size) || !output_name ||
+	    file_save(output_name, d->dst.data, output_size)) {
+		/* the model of the failed file is unknown to the decompressor */
+		ch->model_size = 0;
+		return -1;
+	}
+
+	latency = util_get_time() - found_time;
+	{
+		struct hr_fmt const hr_i = util_make_human_readable(input_size, verbose);
+		struct hr_fmt const hr_o = util_make_human_readable(output_size, verbose);
+
+		LOG_PLAIN(LOG_LEVEL_INFO, "%s: %.2f%% (%.*f%s => %.*f%s, %s) in %.1f ms\n",
+			  filename, (double)output_size / (double)input_size * 100.0,
+			  hr_i.precision, hr_i.value, hr_i.suffix,
+			  hr_o.precision, hr_o.value, hr_o.suffix, output_name, latency * 1000.0);
+	}
+	d->num_files++;
+	d->sum_input_size += input_size;
+	d->sum_output_size += output_size;
+	d->sum_latency += latency;
+	if (latency > d->max_latency)
+		d->max_latency = latency;
+	return 0;
+}
+
+
+/**
+ * @brief reloads the parameters; the channels are reinitialised before their
+ *	next file, so every file is compressed with one set of parameters
+ */
+
+static void daemon_reload(struct compress_daemon *d)
+{
+	struct cmp_params params = d->base_params;
+	unsigned int i;
+
+	if (!d->params_file) {
+		LOG_WARNING("No parameter file to reload (--params-file)");
+		return;
+	}
+	if (file_load_params(d->params_file, &params)) {
+		LOG_WARNING("Keeping the previous parameters");
+		return;
+	}
+
+	d->params = params;
+	for (i = 0; i < d->num_channels; i++) {
+		cmp_deinitialise(&d->channels[i].ctx);
+		d->channels[i].initialised = 0;
+	}
+	LOG_PLAIN(LOG_LEVEL_INFO, "Reloaded the parameters from %s\n", d->params_file);
+}
+
+
+int compress_daemon(const char *watch_path, const char *output_dir,
+		    const struct cmp_params *params, const char *params_file)
+{
+	int result = EXIT_FAILURE;
+	struct compress_daemon d;
+	struct watch w;
+	double const start_time = util_get_time();
+	unsigned int i;
+
+	memset(&d, 0, sizeof(d));
+	d.output_dir = output_dir;
+	d.params_file = params_file;
+	d.base_params = *params;
+	d.params = *params;
+	if (params_file && file_load_params(params_file, &d.params))
+		return EXIT_FAILURE;
+	if (output_dir && !util_is_directory(output_dir)) {
+		LOG_ERROR("The output of --watch has to be a directory: '%s'", output_dir);
+		return EXIT_FAILURE;
+	}
+	if (watch_open(&w, watch_path))
+		return EXIT_FAILURE;
+	LOG_PLAIN(LOG_LEVEL_INFO, "Watching %s\n", watch_path);
+
+	while (1) {
+		const char *filename;
+		int const event = watch_next(&w, &filename);
+
+		if (event == WATCH_FILE) {
+			double const found_time = util_get_time();
+
+			if (daemon_compress_file(&d, filename, found_time))
+				d.num_failed++;
+			d.busy_time += util_get_time() - found_time;
+		} else if (event == WATCH_RELOAD) {
+			daemon_reload(&d);
+		} else {
+			result = event == WATCH_STOP ? EXIT_SUCCESS : EXIT_FAILURE;
+			break;
+		}
+	}
+	watch_close(&w);
+
+	{
+		int const verbose = log_get_level() > LOG_LEVEL_DEBUG;
+		struct hr_fmt const hr_i = util_make_human_readable(d.sum_input_size, verbose);
+		struct hr_fmt const hr_o = util_make_human_readable(d.sum_output_size, verbose);
+		struct hr_fmt const hr_speed = util_make_human_readable(
+			d.busy_time > 0 ? (uint64_t)((double)d.sum_input_size / d.busy_time) : 0,
+			0);
+
+		LOG_PLAIN(LOG_LEVEL_INFO, "%lu files compressed, %lu failed: %.2f%% (%.*f%s => "
+			  "%.*f%s) in %.0f s\n", d.num_files, d.num_failed,
+			  d.sum_input_size ? (double)d.sum_output_size /
+					     (double)d.sum_input_size * 100.0 : 0.0,
+			  hr_i.precision, hr_i.value, hr_i.suffix,
+			  hr_o.precision, hr_o.value, hr_o.suffix, util_get_time() - start_time);
+		LOG_PLAIN(LOG_LEVEL_INFO, "Throughput %.*f%s/s, latency mean %.1f ms, max %.1f ms\n",
+			  hr_speed.precision, hr_speed.value, hr_speed.suffix,
+			  d.num_files ? d.sum_latency / (double)d.num_files * 1000.0 : 0.0,
+			  d.max_latency * 1000.0);
+	}
+
+	for (i = 0; i < d.num_channels; i++) {
+		cmp_deinitialise(&d.channels[i].ctx);
+		free(d.channels[i].work_buf);
+		free(d.channels[i].name);
+	}
+	free(d.channels);
+	file_input_free(&d.src);
+	file_buffer_free(&d.dst);
+	free(d.name_buf);
+
+	return result;
+}
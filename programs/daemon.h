@@ -0,0 +1,43 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Compression daemon of the CLI
+ *
+ * The daemon compresses every new file of a watch (see watch.h) into its own
+ * compressed file. The files are grouped into channels by their names without
+ * the last number, e.g., "det1_0001.dat" and "det1_0002.dat" form the channel
+ * "det1_.dat". Every channel keeps its context and model between the files,
+ * so the model frame chains are not restarted for every file.
+ */
+
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include "../lib/cmp.h"
+
+
+/**
+ * @brief compresses files as they appear in a directory or a FIFO until
+ *	SIGINT or SIGTERM
+ *
+ * SIGHUP reloads the parameters from the parameter file between two files.
+ * The frames of the channels need unique identifiers, so the caller has to set
+ * a timestamp function (see cmp_set_timestamp_func()) which never repeats.
+ *
+ * @param watch_path	directory or FIFO to watch
+ * @param output_dir	directory for the compressed files; NULL to write them
+ *			next to the input files
+ * @param params	compression parameters of the command line
+ * @param params_file	file to (re)load the parameters from on top of params;
+ *			NULL for none
+ *
+ * @returns EXIT_SUCCESS after a stop request or EXIT_FAILURE on error
+ */
+
+int compress_daemon(const char *watch_path, const char *output_dir,
+		    const struct cmp_params *params, const char *params_file);
+
+#endif /* DAEMON_H */
@@ -0,0 +1,203 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Generator of synthetic AIRS-like detector frames
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "datagen.h"
+#include "log.h"
+
+#define DATAGEN_MAX_PIXELS (UINT32_MAX / 2)
+
+
+/* splitmix64; small, fast and the same on every platform */
+static uint64_t next_random(uint64_t *state)
+{
+	uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+
+/* uniformly distributed in [0, 1) */
+static double next_uniform(uint64_t *state)
+{
+	return (double)(next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+/* approximately normally distributed with a standard deviation of 1 (Irwin-Hall) */
+static double next_gaussian(uint64_t *state)
+{
+	double sum = 0;
+	int i;
+
+	for (i = 0; i < 12; i++)
+		sum += next_uniform(state);
+	return sum - 6;
+}
+
+
+/* rounds and clips a signal to the range of a pixel */
+static uint16_t to_pixel(double value, uint16_t saturation)
+{
+	if (value <= 0)
+		return 0;
+	if (value >= saturation)
+		return saturation;
+	return (uint16_t)(value + 0.5);
+}
+
+
+void datagen_default_params(struct datagen_params *params)
+{
+	assert(params);
+
+	params->seed = 1;
+	params->width = 512;
+	params->height = 64;
+	params->noise = 8;
+	params->background = 1000;
+	params->gradient = 200;
+	params->drift = 2;
+	params->spectrum = 20000;
+	params->num_lines = 16;
+	params->hot_pixels = 0.001;
+	params->cosmic_rays = 4;
+	params->saturation = UINT16_MAX;
+}
+
+
+int datagen_init(struct datagen *g, const struct datagen_params *params)
+{
+	uint64_t state;
+	uint32_t num_pixels, i, c;
+	double centre, scale;
+
+	assert(g);
+	assert(params);
+
+	memset(g, 0, sizeof(*g));
+	if (params->width == 0 || params->height == 0 ||
+	    (uint64_t)params->width * params->height > DATAGEN_MAX_PIXELS) {
+		LOG_ERROR("Invalid frame dimensions %lux%lu", (unsigned long)params->width,
+			  (unsigned long)params->height);
+		return -1;
+	}
+	if (!(params->noise >= 0) || !(params->hot_pixels >= 0 && params->hot_pixels <= 1)) {
+		LOG_ERROR("Invalid noise level or hot pixel fraction");
+		return -1;
+	}
+	g->params = *params;
+	num_pixels = params->width * params->height;
+
+	g->spectrum = malloc(params->width * sizeof(*g->spectrum));
+	g->profile = malloc(params->height * sizeof(*g->profile));
+	g->hot = malloc(num_pixels * sizeof(*g->hot));
+	if (!g->spectrum || !g->profile || !g->hot) {
+		LOG_ERROR_WITH_ERRNO("Memory allocation failed for the data generator");
+		datagen_free(g);
+		return -1;
+	}
+
+	/* a smooth continuum with Lorentzian absorption lines */
+	for (c = 0; c < params->width; c++) {
+		double const x = params->width > 1 ? (double)c / (params->width - 1) : 0.5;
+
+		g->spectrum[c] = params->spectrum * (0.5 + 2 * x * (1 - x));
+	}
+	state = params->seed;
+	for (i = 0; i < params->num_lines; i++) {
+		double const line_centre = next_uniform(&state) * params->width;
+		double const line_width = 0.5 + 3.5 * next_uniform(&state);
+		double const depth = 0.1 + 0.7 * next_uniform(&state);
+
+		for (c = 0; c < params->width; c++) {
+			double const d = ((double)c - line_centre) / line_width;
+
+			g->spectrum[c] *= 1 - depth / (1 + d * d);
+		}
+	}
+
+	/* spatial profile of the dispersed light across the rows */
+	centre = (params->height - 1) / 2.0;
+	scale = params->height / 8.0 < 1 ? 1 : params->height / 8.0;
+	for (i = 0; i < params->height; i++) {
+		double const d = ((double)i - centre) / scale;
+
+		g->profile[i] = 1 / (1 + d * d);
+	}
+
+	/* the hot pixels are the same in every frame */
+	for (i = 0; i < num_pixels; i++) {
+		g->hot[i] = 0;
+		if (next_uniform(&state) < params->hot_pixels)
+			g->hot[i] = (uint16_t)(2000 + 30000 * next_uniform(&state));
+	}
+	return 0;
+}
+
+
+void datagen_frame(const struct datagen *g, uint32_t frame, uint16_t *samples)
+{
+	const struct datagen_params *p;
+	uint64_t state;
+	uint32_t r, c, i;
+
+	assert(g);
+	assert(g->spectrum);
+	assert(samples);
+
+	p = &g->params;
+	state = p->seed ^ ((uint64_t)(frame + 1) * 0xD1B54A32D192ED03ULL);
+	(void)next_random(&state);
+
+	for (r = 0; r < p->height; r++) {
+		double const row_pos = p->height > 1 ? (double)r / (p->height - 1) : 0;
+		double const background = p->background + p->gradient * row_pos + p->drift * frame;
+		uint16_t *row = samples + (size_t)r * p->width;
+		const uint16_t *hot = g->hot + (size_t)r * p->width;
+
+		for (c = 0; c < p->width; c++) {
+			double const signal = background + g->spectrum[c] * g->profile[r] + hot[c] +
+					      p->noise * next_gaussian(&state);
+
+			row[c] = to_pixel(signal, p->saturation);
+		}
+	}
+
+	/* cosmic rays leave a short track along a row, fading with every pixel */
+	for (i = 0; i < p->cosmic_rays; i++) {
+		uint32_t const pos = (uint32_t)(next_random(&state) % (p->width * p->height));
+		uint32_t const len = 1 + (uint32_t)(next_random(&state) % 4);
+		double energy = 3000 + 40000 * next_uniform(&state);
+
+		for (c = 0; c < len && pos % p->width + c < p->width; c++) {
+			samples[pos + c] = to_pixel(samples[pos + c] + energy, p->saturation);
+			energy /= 2;
+		}
+	}
+}
+
+
+void datagen_free(struct datagen *g)
+{
+	assert(g);
+
+	free(g->spectrum);
+	free(g->profile);
+	free(g->hot);
+	g->spectrum = NULL;
+	g->profile = NULL;
+	g->hot = NULL;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Generator of synthetic AIRS-like detector frames
+ *
+ * A frame is a height x width image: the spectrum is dispersed along a row
+ * (the spectral axis) and spread over the rows by a spatial profile. On top of
+ * a background with a gradient across the rows come read noise, a fixed set
+ * of hot pixels, cosmic ray tracks and saturation. The background drifts
+ * slowly from frame to frame, so consecutive frames are similar, like the
+ * frames a model is built from.
+ *
+ * The frames only depend on the parameters and the frame number, so every
+ * frame can be generated on its own, and the same parameters give bit-identical
+ * frames on every machine with IEEE 754 arithmetic; no floating point library
+ * functions are used.
+ */
+
+#ifndef DATAGEN_H
+#define DATAGEN_H
+
+#include <stdint.h>
+
+
+/**
+ * @brief parameters of the generated frames
+ */
+
+struct datagen_params {
+	uint64_t seed;        /**< seed of all random structures */
+	uint32_t width;       /**< spectral pixels per row */
+	uint32_t height;      /**< spatial rows per frame */
+	double noise;         /**< standard deviation of the read noise in DN */
+	double background;    /**< background level of the first row in DN */
+	double gradient;      /**< background increase from the first to the last row in DN */
+	double drift;         /**< background change from one frame to the next in DN */
+	double spectrum;      /**< peak signal of the spectrum in DN */
+	uint32_t num_lines;   /**< number of absorption lines in the spectrum */
+	double hot_pixels;    /**< fraction of hot pixels, from 0 to 1 */
+	uint32_t cosmic_rays; /**< cosmic ray hits per frame */
+	uint16_t saturation;  /**< largest value of a pixel */
+};
+
+
+/**
+ * @brief state of a generator; holds the structures shared by all frames
+ */
+
+struct datagen {
+	struct datagen_params params;
+	double *spectrum;     /**< signal along a row */
+	double *profile;      /**< relative signal of every row */
+	uint16_t *hot;        /**< additional signal of every pixel; 0 for most pixels */
+};
+
+
+/** @brief sets the default parameters: a 512 x 64 frame with typical features */
+void datagen_default_params(struct datagen_params *params);
+
+/**
+ * @brief initialises a generator
+ *
+ * @param g		generator to initialise
+ * @param params	parameters of the frames
+ *
+ * @returns 0 on success or -1 on error
+ */
+int datagen_init(struct datagen *g, const struct datagen_params *params);
+
+/**
+ * @brief generates a frame
+ *
+ * @param g		initialised generator
+ * @param frame		number of the frame, starting at 0
+ * @param samples	buffer for width * height samples in host byte order
+ */
+void datagen_frame(const struct datagen *g, uint32_t frame, uint16_t *samples);
+
+/** @brief frees a generator */
+void datagen_free(struct datagen *g);
+
+#endif /* DATAGEN_H */
@@ -14,10 +14,19 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <assert.h>
+#if !defined(MSDOS) && !defined(OS2) && !defined(_WIN32)
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  define FILE_HAVE_MMAP 1
+#else
+#  define FILE_HAVE_MMAP 0
+#endif
 
 #include "file.h"
 #include "log.h"
-#include "../lib/common/byteorder.h"
+#include "params_parse.h"
+#include "../lib/common/byteorder_bulk.h"
 #include "../lib/cmp.h"
 #include "../lib/cmp_header.h"
 #include "../lib/common/err_private.h"
@@ -92,7 +101,7 @@ static FILE *file_open(const char *filename, const char *mode)
  * @return 0 on success, -1 on error
  */
 
-static int file_close(FILE *fp, const char *filename)
+int file_close(FILE *fp, const char *filename)
 {
 	assert(fp);
 	assert(filename);
@@ -109,26 +118,28 @@ static int file_close(FILE *fp, const char *filename)
 
 
 /**
- * @brief read stdin into a static allocated buffer
+ * @brief read stdin once into a static allocated buffer
+ *
+ * The first call reads the whole stdin; later calls return the same buffer,
+ * so only the first call must not run concurrently with other calls.
  *
- * @param blob		blob to put the stdin content
- * @param blob_size	blob size
+ * @param data	pointer to store the address of the stdin content
+ * @param size	pointer to store the size of the stdin content
  *
  * @returns 0 on success or -1 on error
  */
 
-static int file_read_stdin(void *blob, size_t *blob_size)
+static int stdin_get_buffer(const uint8_t **data, size_t *size)
 {
 	static uint8_t *buffer;
 	static size_t buffer_size;
 
 	size_t buffer_capacity = 4096; /* Start with 4KB */
 
-	assert(blob_size);
+	assert(data);
+	assert(size);
 
 	if (!buffer) {
-		*blob_size = 0;
-
 		buffer = malloc(buffer_capacity);
 		if (!buffer) {
 			LOG_ERROR_WITH_ERRNO("Failed to allocate memory for stdin buffer");
@@ -152,6 +163,7 @@ static int file_read_stdin(void *blob, size_t *blob_size)
 
 				if (!new_buffer) {
 					free(buffer);
+					buffer = NULL;
 					LOG_ERROR_WITH_ERRNO(
 						"Failed to reallocate memory for stdin");
 					buffer_size = 0;
@@ -165,13 +177,14 @@ static int file_read_stdin(void *blob, size_t *blob_size)
 
 		if (ferror(stdin)) {
 			free(buffer);
+			buffer = NULL;
 			LOG_ERROR("Error reading from stdin");
 			buffer_size = 0;
 			return -1;
 		}
 
 		/* Trim buffer to exact size if needed */
-		if (buffer_size < buffer_capacity) {
+		if (buffer_size < buffer_capacity && buffer_size > 0) {
 			void *trimmed_buffer = realloc(buffer, buffer_size);
 
 			if (trimmed_buffer) /* It's okay if trimming fails */
@@ -179,16 +192,43 @@ static int file_read_stdin(void *blob, size_t *blob_size)
 		}
 	}
 
+	*data = buffer;
+	*size = buffer_size;
+	return 0;
+}
+
+
+/**
+ * @brief read stdin into a buffer
+ *
+ * @param blob		blob to put the stdin content; NULL to only get the size
+ * @param blob_size	blob size; filled with the size of the stdin content
+ *
+ * @returns 0 on success or -1 on error
+ */
+
+static int file_read_stdin(void *blob, size_t *blob_size)
+{
+	const uint8_t *data;
+	size_t size;
+
+	assert(blob_size);
+
+	if (stdin_get_buffer(&data, &size)) {
+		*blob_size = 0;
+		return -1;
+	}
+
 	/* Return the results */
 	if (blob) {
-		if (buffer_size > *blob_size) {
+		if (size > *blob_size) {
 			*blob_size = 0;
 			return -1;
 		}
-		memcpy(blob, buffer, buffer_size);
+		memcpy(blob, data, size);
 	}
-	*blob_size = buffer_size;
-	return buffer_size == 0;
+	*blob_size = size;
+	return size == 0;
 }
 
 
@@ -336,7 +376,6 @@ static int file_load(const char *filename, void *buffer, size_t buffer_size)
 
 static int file_load_be16(const char *filename, uint16_t *buffer, size_t buffer_size)
 {
-	size_t i;
 	int error;
 
 	assert(filename);
@@ -350,8 +389,7 @@ static int file_load_be16(const char *filename, uint16_t *buffer, size_t buffer_
 			return -1;
 		}
 
-		for (i = 0; i < (size_t)buffer_size / sizeof(*buffer); i++)
-			be16_to_cpus(&buffer[i]);
+		be16_to_cpu_bulk(buffer, buffer, buffer_size / sizeof(*buffer));
 	}
 
 	return error;
@@ -359,54 +397,252 @@ static int file_load_be16(const char *filename, uint16_t *buffer, size_t buffer_
 
 
 /**
- * @brief save memory contents to a file
+ * @brief read the beginning of a file
  *
- * @param filename	name of file to save to
- * @param buffer	buffer containing data to save
- * @param size		number of bytes to save
+ * @param filename	name of a file to read
+ * @param buffer	buffer to store the read bytes
+ * @param size		number of bytes to read
+ * @param read_size	pointer to store the number of read bytes; smaller than
+ *			size if the file is shorter
  *
- * @return 0 on success, -1 on error
+ * @returns 0 on success or -1 on error
  */
 
-static int file_save(const char *filename, const void *buffer, size_t size)
+int file_peek(const char *filename, void *buffer, uint32_t size, uint32_t *read_size)
 {
 	FILE *fp;
-	size_t written;
-	int write_err = 0;
+	size_t n;
+	int read_error;
 
 	assert(filename);
 	assert(buffer);
+	assert(read_size);
+
+	*read_size = 0;
+	fp = file_open(filename, "rb");
+	if (!fp)
+		return -1;
+
+	if (fp == stdin) {
+		const uint8_t *data;
+
+		if (stdin_get_buffer(&data, &n))
+			return -1;
+		if (n > size)
+			n = size;
+		memcpy(buffer, data, n);
+		*read_size = (uint32_t)n;
+		return 0;
+	}
+
+	n = fread(buffer, 1, size, fp);
+	read_error = ferror(fp);
+	if (read_error)
+		LOG_ERROR_WITH_ERRNO("Can't read '%s'", filename);
+	if (file_close(fp, filename) || read_error)
+		return -1;
+
+	*read_size = (uint32_t)n;
+	return 0;
+}
+
+
+int file_buffer_reserve(struct file_buffer *buf, uint32_t size)
+{
+	assert(buf);
+
+	if (size <= buf->capacity)
+		return 0;
+
+	free(buf->data);
+	buf->data = malloc(size);
+	if (!buf->data) {
+		LOG_ERROR_WITH_ERRNO("Memory allocation failed for size %lu",
+				     (unsigned long)size);
+		buf->capacity = 0;
+		return -1;
+	}
+	buf->capacity = size;
+	return 0;
+}
+
+
+void file_buffer_free(struct file_buffer *buf)
+{
+	assert(buf);
+
+	free(buf->data);
+	buf->data = NULL;
+	buf->capacity = 0;
+}
+
+
+/**
+ * @brief load a file into a reusable buffer
+ *
+ * @param filename	name of a file to load
+ * @param buf		buffer to load the file into; grown if needed
+ * @param size		pointer to store the size of the file
+ *
+ * @returns 0 on success or -1 on error
+ */
+
+static int file_load_to_buffer(const char *filename, struct file_buffer *buf, uint32_t *size)
+{
+	assert(filename);
+	assert(buf);
+	assert(size);
+
+	if (file_get_size_u32(filename, size))
+		return -1;
+	if (file_buffer_reserve(buf, *size))
+		return -1;
+	return file_load(filename, buf->data, *size);
+}
+
+
+/**
+ * @brief create a new file for writing
+ *
+ * Refuses to overwrite an existing file or directory. The standard output and
+ * the null device are accepted as they are.
+ *
+ * @param filename	name of file to create or special marker for stdout
+ *
+ * @returns file handle or NULL on error
+ */
+
+FILE *file_create(const char *filename)
+{
+	assert(filename);
 
 	if (!strcmp(filename, STD_OUT_MARK)) {
-		fp = stdout;
 		SET_BINARY_MODE(stdout);
-	} else {
-		if (strcmp(filename, NULL_MARK)) {
-			struct stat st;
+		return stdout;
+	}
 
-			/* Check if destination is a directory */
-			if (stat(filename, &st) == 0 && S_ISDIR(st.st_mode)) {
-				LOG_ERROR("'%s' is a directory\n", filename);
-				return -1;
-			}
+	if (strcmp(filename, NULL_MARK)) {
+		struct stat st;
+		FILE *fp;
 
-			/* Check if destination file already exists */
-			fp = fopen(filename, "rb");
-			if (fp) {
-				fclose(fp);
-				LOG_ERROR("'%s' already exists\n", filename);
-				return -1;
-			}
+		/* Check if destination is a directory */
+		if (stat(filename, &st) == 0 && S_ISDIR(st.st_mode)) {
+			LOG_ERROR("'%s' is a directory\n", filename);
+			return NULL;
+		}
+
+		/* Check if destination file already exists */
+		fp = fopen(filename, "rb");
+		if (fp) {
+			fclose(fp);
+			LOG_ERROR("'%s' already exists\n", filename);
+			return NULL;
 		}
-		fp = file_open(filename, "wb");
-		if (!fp)
-			return -1;
 	}
-	written = fwrite(buffer, 1, size, fp);
-	if (written != size) {
+	return file_open(filename, "wb");
+}
+
+
+/**
+ * @brief write memory contents to an open file
+ *
+ * @param fp		file to write to
+ * @param filename	name of the file; used for error messages
+ * @param buffer	buffer containing data to write
+ * @param size		number of bytes to write
+ *
+ * @return 0 on success, -1 on error
+ */
+
+int file_write(FILE *fp, const char *filename, const void *buffer, size_t size)
+{
+	assert(fp);
+	assert(filename);
+	assert(buffer || size == 0);
+
+	if (fwrite(buffer, 1, size, fp) != size) {
 		LOG_ERROR_WITH_ERRNO("Error writing '%s':", filename);
-		write_err = -1;
+		return -1;
+	}
+	return 0;
+}
+
+
+/**
+ * @brief opens a file to read it piece by piece
+ *
+ * @param filename	name of the file to open or special marker for stdin
+ *
+ * @returns file handle or NULL on error
+ */
+
+FILE *file_open_input(const char *filename)
+{
+	assert(filename);
+
+	if (!strcmp(filename, STD_IN_MARK)) {
+		SET_BINARY_MODE(stdin);
+		return stdin;
 	}
+	return file_open(filename, "rb");
+}
+
+
+/**
+ * @brief reads the next piece of an open file
+ *
+ * Waits until the buffer is full or the end of the file is reached, so a pipe
+ * is read in pieces of the buffer size.
+ *
+ * @param fp		file to read from
+ * @param filename	name of the file; used for error messages
+ * @param buffer	buffer to read into
+ * @param size		size of the buffer in bytes
+ * @param read_size	pointer to store the number of read bytes; smaller than
+ *			size only at the end of the file
+ *
+ * @return 0 on success, -1 on error
+ */
+
+int file_read(FILE *fp, const char *filename, void *buffer, size_t size, size_t *read_size)
+{
+	assert(fp);
+	assert(filename);
+	assert(buffer || size == 0);
+	assert(read_size);
+
+	*read_size = fread(buffer, 1, size, fp);
+	if (*read_size != size && ferror(fp)) {
+		LOG_ERROR_WITH_ERRNO("Error reading '%s'", filename);
+		return -1;
+	}
+	return 0;
+}
+
+
+/**
+ * @brief save memory contents to a file
+ *
+ * @param filename	name of file to save to
+ * @param buffer	buffer containing data to save
+ * @param size		number of bytes to save
+ *
+ * @return 0 on success, -1 on error
+ */
+
+int file_save(const char *filename, const void *buffer, size_t size)
+{
+	FILE *fp;
+	int write_err;
+
+	assert(filename);
+	assert(buffer);
+
+	fp = file_create(filename);
+	if (!fp)
+		return -1;
+
+	write_err = file_write(fp, filename, buffer, size);
 
 	if (file_close(fp, filename) && !write_err)
 		LOG_WARNING("File '%s' saved successfully but close failed", filename);
@@ -416,73 +652,482 @@ static int file_save(const char *filename, const void *buffer, size_t size)
 
 
 /**
- * @brief compresses a source file and saves the compressed data to a destination file
+ * @brief load a file of 16-bit big-endian samples into a reusable buffer
  *
- * This function reads the contents of a source file, compresses the data,
- * and writes the compressed data to a destination file. It uses a specified
- * compression context for the operation and manages all memory allocation
- * internally.
+ * The samples are converted to host endianness.
  *
- * @param ctx		pointer to a compression context initialised using `cmp_initialise()`
- * @param dst_filename	name of the destination file where compressed data will be saved
- * @param src_filename	name of the source file to be compressed
+ * @param filename	name of a file to load
+ * @param buf		buffer to load the samples into; grown if needed
+ * @param size		pointer to store the size of the file in bytes
+ *
+ * @returns 0 on success or -1 on error
+ */
+
+static int file_load_be16_to_buffer(const char *filename, struct file_buffer *buf,
+				    uint32_t *size)
+{
+	assert(filename);
+	assert(buf);
+	assert(size);
+
+	if (file_get_size_u32(filename, size))
+		return -1;
+	if (file_buffer_reserve(buf, *size))
+		return -1;
+	return file_load_be16(filename, buf->data, *size);
+}
+
+
+#if FILE_HAVE_MMAP
+/**
+ * @brief memory-map a whole regular file read-only
+ *
+ * The kernel is asked to read the file ahead, so the pages are mostly in
+ * memory when they are accessed.
  *
- * @returns the size of the compressed data written to the destination file on
- *	success or an error code, which can be checked with `cmp_is_error()`
+ * @param filename	name of the file to map
+ * @param addr		pointer to store the address of the mapping
+ * @param size		pointer to store the size of the file
  *
+ * @returns 0 if the file is mapped or 1 if the file can not be mapped (e.g., it
+ *	is not a regular file or it is empty)
  */
 
-uint32_t file_compress(struct cmp_context *ctx, const char *dst_filename, const char *src_filename)
+static int file_map_readonly(const char *filename, const void **addr, size_t *size)
 {
-	uint32_t return_val = CMP_ERROR(GENERIC);
+	struct stat st;
+	void *map;
+	int fd;
 
-	uint32_t src_size;
-	uint32_t dst_capacity;
-	uint32_t dst_size;
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return 1; /* let the load path report the error */
 
-	void *src_buf = NULL;
-	void *dst_buf = NULL;
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0 ||
+	    (uint64_t)st.st_size > SIZE_MAX) {
+		close(fd);
+		return 1;
+	}
 
-	assert(ctx);
-	assert(dst_filename);
-	assert(src_filename);
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return 1;
+	(void)posix_madvise(map, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+	(void)posix_madvise(map, (size_t)st.st_size, POSIX_MADV_WILLNEED);
+
+	*addr = map;
+	*size = (size_t)st.st_size;
+	return 0;
+}
+
+
+/**
+ * @brief memory-map a regular file of 16-bit big-endian samples
+ *
+ * @param in		input to store the mapping in
+ * @param filename	name of the file to map
+ *
+ * @returns 0 if the file is mapped, 1 if the file can not be mapped (e.g., it
+ *	is not a regular file) or -1 on error
+ */
+
+static int file_map(struct file_input *in, const char *filename)
+{
+	const void *addr;
+	size_t size;
+
+	if (file_map_readonly(filename, &addr, &size))
+		return 1;
+
+	if (size > UINT32_MAX || size % sizeof(uint16_t)) {
+		if (size > UINT32_MAX)
+			LOG_ERROR("File '%s' is too large to read in (size: %llu bytes)",
+				  filename, (unsigned long long)size);
+		else
+			LOG_ERROR("%s: file size not a multiple of %lu", filename,
+				  (unsigned long)sizeof(uint16_t));
+		(void)munmap((void *)(uintptr_t)addr, size);
+		return -1;
+	}
+
+	in->map = addr;
+	in->size = (uint32_t)size;
+	return 0;
+}
+#endif
+
+
+/**
+ * @brief opens a file of 16-bit big-endian samples for compression
+ *
+ * Regular files are memory-mapped, if allowed, so the samples can be
+ * compressed directly from the page cache without a copy and byte swapping
+ * pass. Other files, e.g., stdin, are loaded into the buffer of the input and
+ * converted to host endianness.
+ *
+ * @param in		input to open; the buffer is reused
+ * @param filename	name of the file to open
+ * @param may_map	non-zero if the file may be memory-mapped
+ *
+ * @returns 0 on success or -1 on error
+ */
+
+int file_input_open(struct file_input *in, const char *filename, int may_map)
+{
+	assert(in);
+	assert(filename);
+
+	file_input_close(in);
+#if FILE_HAVE_MMAP
+	if (may_map && strcmp(filename, STD_IN_MARK)) {
+		int const ret = file_map(in, filename);
+
+		if (ret <= 0)
+			return ret;
+	}
+#else
+	(void)may_map;
+#endif
+	return file_load_be16_to_buffer(filename, &in->buf, &in->size);
+}
+
+
+void file_input_close(struct file_input *in)
+{
+	assert(in);
+
+#if FILE_HAVE_MMAP
+	if (in->map)
+		(void)munmap((void *)(uintptr_t)in->map, in->size);
+#endif
+	in->map = NULL;
+	in->size = 0;
+}
+
+
+void file_input_free(struct file_input *in)
+{
+	assert(in);
+
+	file_input_close(in);
+	file_buffer_free(&in->buf);
+}
+
+
+/**
+ * @brief opens the whole content of a file for reading
+ *
+ * Regular files are memory-mapped, so files larger than the memory, or larger
+ * than 4 GiB on 64-bit systems, can be read. Other files, e.g., stdin, are
+ * loaded into the buffer of the view.
+ *
+ * @param view		view to open; the buffer is reused
+ * @param filename	name of the file to open
+ *
+ * @returns 0 on success or -1 on error
+ */
+
+int file_view_open(struct file_view *view, const char *filename)
+{
+	uint32_t size;
+
+	assert(view);
+	assert(filename);
 
-	if (file_get_size_u32(src_filename, &src_size))
-		goto fail;
-	src_buf = malloc(src_size);
-	if (!src_buf) {
-		LOG_ERROR_WITH_ERRNO("Memory allocation failed for '%s':", src_filename);
-		goto fail;
+	file_view_close(view);
+#if FILE_HAVE_MMAP
+	if (strcmp(filename, STD_IN_MARK) &&
+	    file_map_readonly(filename, &view->data, &view->size) == 0) {
+		view->mapped = 1;
+		return 0;
 	}
-	if (file_load_be16(src_filename, src_buf, src_size))
-		goto fail;
+#endif
+	if (file_load_to_buffer(filename, &view->buf, &size))
+		return -1;
+	view->data = view->buf.data;
+	view->size = size;
+	return 0;
+}
+
+
+void file_view_close(struct file_view *view)
+{
+	assert(view);
 
-	dst_capacity = cmp_compress_bound(src_size);
+#if FILE_HAVE_MMAP
+	if (view->mapped)
+		(void)munmap((void *)(uintptr_t)view->data, view->size);
+#endif
+	view->data = NULL;
+	view->size = 0;
+	view->mapped = 0;
+}
+
+
+void file_view_free(struct file_view *view)
+{
+	assert(view);
+
+	file_view_close(view);
+	file_buffer_free(&view->buf);
+}
+
+
+/**
+ * @brief reads compression parameters from a file
+ *
+ * The file holds "key=value" pairs separated by commas, e.g., the output of
+ * -v. The parameters are applied on top of the given parameters.
+ *
+ * @param filename	name of the parameter file
+ * @param params	parameters to update; unchanged on error
+ *
+ * @returns 0 on success or -1 on error
+ */
+
+int file_load_params(const char *filename, struct cmp_params *params)
+{
+	struct file_view view;
+	struct cmp_params new_params = *params;
+	char *str;
+	int result = -1;
+
+	memset(&view, 0, sizeof(view));
+	if (file_view_open(&view, filename))
+		return -1;
+	str = malloc(view.size + 1);
+	if (!str) {
+		LOG_ERROR_WITH_ERRNO("Memory allocation failed for size %lu",
+				     (unsigned long)view.size + 1);
+		file_view_free(&view);
+		return -1;
+	}
+	memcpy(str, view.data, view.size);
+	str[view.size] = '\0';
+
+	if (cmp_params_parse(str, &new_params) == CMP_PARSE_OK) {
+		*params = new_params;
+		result = 0;
+	} else {
+		LOG_ERROR("Incorrect parameters in %s", filename);
+	}
+
+	free(str);
+	file_view_free(&view);
+	return result;
+}
+
+
+/**
+ * @brief calculates the size of a buffer, which is large enough for the
+ *	compressed data of a source file
+ *
+ * @param params	compression parameters
+ * @param src_size	size of the source data in bytes
+ *
+ * @returns the compressed data buffer size; the maximum frame size if the
+ *	size can not be calculated
+ */
+
+uint32_t file_compress_bound(const struct cmp_params *params, uint32_t src_size)
+{
+	uint32_t dst_capacity;
+
+	assert(params);
+
+	dst_capacity = cmp_compress_bound_params(params, src_size);
 	if (cmp_is_error(dst_capacity)) {
 		LOG_WARNING("Can't calculating compressed data buffer size, use maximum size");
 		dst_capacity = (1ULL << CMP_HDR_BITS_COMPRESSED_SIZE) - 1;
 	}
-	dst_buf = malloc(dst_capacity);
-	if (!dst_buf) {
-		LOG_ERROR_WITH_ERRNO("Memory allocation failed for compressed data buffer");
-		goto fail;
-	}
+	return dst_capacity;
+}
+
+
+/**
+ * @brief compresses an opened input into a buffer
+ *
+ * This function compresses the samples of an input opened with
+ * `file_input_open()` into the dst buffer. It uses a specified compression
+ * context for the operation. The dst buffer is grown if needed and can be
+ * reused for the next file.
+ *
+ * @param ctx		pointer to a compression context initialised using `cmp_initialise()`
+ * @param params	compression parameters the context was initialised with;
+ *			used to size the compressed data buffer
+ * @param src		opened input; loaded samples are overwritten during
+ *			compression
+ * @param dst_buf	buffer for the compressed data
+ * @param src_filename	name of the source file; used for error messages
+ *
+ * @returns the size of the compressed data in dst_buf on success or an error
+ *	code, which can be checked with `cmp_is_error()`
+ */
 
-	dst_size = cmp_compress_u16(ctx, dst_buf, dst_capacity, src_buf, src_size);
-	if (cmp_is_error(dst_size)) {
+uint32_t file_compress(struct cmp_context *ctx, const struct cmp_params *params,
+		       struct file_input *src, struct file_buffer *dst_buf,
+		       const char *src_filename)
+{
+	uint32_t dst_capacity;
+	uint32_t dst_size;
+
+	assert(ctx);
+	assert(params);
+	assert(src);
+	assert(dst_buf);
+	assert(src_filename);
+
+	dst_capacity = file_compress_bound(params, src->size);
+	if (file_buffer_reserve(dst_buf, dst_capacity))
+		return CMP_ERROR(GENERIC);
+
+	if (src->map)
+		dst_size = cmp_compress_u16_be(ctx, dst_buf->data, dst_capacity, src->map,
+					       src->size);
+	else /* the loaded data are discarded anyway, so they may be overwritten */
+		dst_size = cmp_compress_u16_in_place(ctx, dst_buf->data, dst_capacity,
+						     src->buf.data, src->size);
+	if (cmp_is_error(dst_size))
 		LOG_ERROR_CMP(dst_size, "Compression failed for %s", src_filename);
-		return_val = dst_size;
-		goto fail;
+
+	return dst_size;
+}
+
+
+void file_decompressor_init(struct file_decompressor *dec)
+{
+	assert(dec);
+
+	memset(dec, 0, sizeof(*dec));
+	(void)cmp_decompress_initialise(&dec->dctx, NULL, 0);
+}
+
+
+void file_decompressor_free(struct file_decompressor *dec)
+{
+	assert(dec);
+
+	cmp_decompress_deinitialise(&dec->dctx);
+	file_buffer_free(&dec->src);
+	file_buffer_free(&dec->dst);
+	file_buffer_free(&dec->model);
+}
+
+
+/**
+ * @brief decompresses all frames in the src buffer of a decompressor
+ *
+ * The decompressed data are stored as 16-bit big-endian values in the dst
+ * buffer of the decompressor. The model of the last frame is kept in the
+ * decompressor, so the next frames of a model frame chain can be decompressed
+ * with the same decompressor.
+ *
+ * @param dec		pointer to a decompressor initialised using
+ *			`file_decompressor_init()`
+ * @param src_size	size of the compressed data in the src buffer
+ * @param src_name	name of the compressed data; used for error messages
+ *
+ * @returns the size of the decompressed data on success or an error code,
+ *	which can be checked with `cmp_is_error()`
+ */
+
+uint32_t file_decompress_buffer(struct file_decompressor *dec, uint32_t src_size,
+				const char *src_name)
+{
+	const uint8_t *src;
+	uint16_t *dst;
+	uint32_t pos, frame_size, dst_size = 0;
+	uint32_t i;
+
+	assert(dec);
+	assert(src_name);
+
+	src = dec->src.data;
+
+	/* validate the frame sizes and sum up the decompressed size */
+	for (pos = 0; pos < src_size; pos += frame_size) {
+		uint32_t original_size;
+
+		frame_size = cmp_get_compressed_size(src + pos, src_size - pos);
+		if (cmp_is_error(frame_size)) {
+			LOG_ERROR_CMP(frame_size, "%s: Invalid frame at offset %lu", src_name,
+				      (unsigned long)pos);
+			return frame_size;
+		}
+		original_size = cmp_get_original_size(src + pos, src_size - pos);
+		if (frame_size > src_size - pos) {
+			LOG_ERROR("%s: Frame at offset %lu is truncated", src_name,
+				  (unsigned long)pos);
+			return CMP_ERROR(SRC_SIZE_WRONG);
+		}
+		if (original_size > UINT32_MAX - dst_size) {
+			LOG_ERROR("%s: Decompressed data too large", src_name);
+			return CMP_ERROR(SRC_SIZE_WRONG);
+		}
+		dst_size += original_size;
 	}
+	if (file_buffer_reserve(&dec->dst, dst_size))
+		return CMP_ERROR(GENERIC);
+	dst = dec->dst.data;
+
+	for (pos = 0, i = 0; pos < src_size; pos += frame_size) {
+		uint32_t const original_size = cmp_get_original_size(src + pos, src_size - pos);
+		uint32_t ret;
+
+		frame_size = cmp_get_compressed_size(src + pos, src_size - pos);
+
+		/* a model frame needs a model of its size, so only a new model can be lost */
+		if (original_size > dec->model.capacity) {
+			if (file_buffer_reserve(&dec->model, original_size))
+				return CMP_ERROR(GENERIC);
+			ret = cmp_decompress_initialise(&dec->dctx, dec->model.data,
+							dec->model.capacity);
+			if (cmp_is_error(ret)) {
+				LOG_ERROR_CMP(ret, "Decompression initialization failed");
+				return ret;
+			}
+		}
 
-	if (file_save(dst_filename, dst_buf, dst_size))
-		goto fail; /* printing log message is already done */
+		ret = cmp_decompress_u16(&dec->dctx, dst + i, dst_size - i * (uint32_t)sizeof(*dst),
+					 src + pos, frame_size);
+		if (cmp_is_error(ret)) {
+			LOG_ERROR_CMP(ret, "Decompression failed for %s", src_name);
+			return ret;
+		}
+		i += ret / sizeof(*dst);
+	}
 
-	return_val = dst_size;
+	cpu_to_be16_bulk(dst, dst, dst_size / sizeof(*dst));
+
+	return dst_size;
+}
+
+
+/**
+ * @brief decompresses all frames of a compressed file
+ *
+ * Same as `file_decompress_buffer()`, but the compressed data are loaded from
+ * a file first.
+ *
+ * @param dec		pointer to a decompressor initialised using
+ *			`file_decompressor_init()`
+ * @param src_filename	name of the file to decompress
+ * @param src_size	pointer to store the size of the compressed file
+ *
+ * @returns the size of the decompressed data on success or an error code,
+ *	which can be checked with `cmp_is_error()`
+ */
+
+uint32_t file_decompress(struct file_decompressor *dec, const char *src_filename,
+			 uint32_t *src_size)
+{
+	assert(dec);
+	assert(src_filename);
+	assert(src_size);
 
-fail:
-	free(src_buf);
-	free(dst_buf);
+	if (file_load_to_buffer(src_filename, &dec->src, src_size))
+		return CMP_ERROR(GENERIC);
 
-	return return_val;
+	return file_decompress_buffer(dec, *src_size, src_filename);
 }
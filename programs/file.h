@@ -11,15 +11,123 @@
 #define FILE_H
 
 #include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
 #include "../lib/cmp.h"
+#include "../lib/cmp_decompress.h"
 
 
 #define STD_OUT_MARK "//*-stdout-*//" /**< Marker for output redirection to standard output */
 #define STD_IN_MARK  "//*-stdin-*//"  /**< Marker for input redirection from standard input */
 #define NULL_MARK    "/dev/null"      /**< Marker for null output (discarding data) */
 
+#define AIRSPACE_EXTENSION ".air" /**< Suffix of the compressed files */
+
+/**
+ * @brief growable buffer, which can be reused for several files
+ */
+
+struct file_buffer {
+	void *data;        /**< pointer to the buffer; NULL if not allocated */
+	uint32_t capacity; /**< size of the buffer in bytes */
+};
+
+
+/**
+ * @brief samples of a file to compress; reused for several files
+ */
+
+struct file_input {
+	struct file_buffer buf; /**< loaded samples in host byte order */
+	const void *map;        /**< memory-mapped big-endian samples; NULL if loaded into buf */
+	uint32_t size;          /**< size of the samples in bytes */
+};
+
+
+/**
+ * @brief read-only content of a whole file; reused for several files
+ */
+
+struct file_view {
+	struct file_buffer buf; /**< loaded file content; unused if mapped */
+	const void *data;       /**< content of the file */
+	size_t size;            /**< size of the file in bytes */
+	int mapped;             /**< non-zero if data is memory-mapped */
+};
+
+
+/**
+ * @brief state to decompress files; reused for several files
+ */
+
+struct file_decompressor {
+	struct cmp_decompress_context dctx; /**< decompression context */
+	struct file_buffer src;             /**< compressed file content */
+	struct file_buffer dst;             /**< decompressed data */
+	struct file_buffer model;           /**< model of the decompression context */
+};
+
 int file_get_size_u32(const char *filename, uint32_t *file_size32);
 
-uint32_t file_compress(struct cmp_context *ctx, const char *dst_filename, const char *src_filename);
+int file_peek(const char *filename, void *buffer, uint32_t size, uint32_t *read_size);
+
+/**
+ * @brief makes sure a buffer has at least the given capacity; the buffer
+ *	content is not preserved when the buffer grows
+ *
+ * @returns 0 on success or -1 on error
+ */
+int file_buffer_reserve(struct file_buffer *buf, uint32_t size);
+
+/** @brief frees a buffer */
+void file_buffer_free(struct file_buffer *buf);
+
+FILE *file_create(const char *filename);
+
+int file_write(FILE *fp, const char *filename, const void *buffer, size_t size);
+
+int file_close(FILE *fp, const char *filename);
+
+FILE *file_open_input(const char *filename);
+
+int file_read(FILE *fp, const char *filename, void *buffer, size_t size, size_t *read_size);
+
+int file_save(const char *filename, const void *buffer, size_t size);
+
+int file_input_open(struct file_input *in, const char *filename, int may_map);
+
+/** @brief releases the samples of an input; the buffer is kept for reuse */
+void file_input_close(struct file_input *in);
+
+/** @brief closes an input and frees its buffer */
+void file_input_free(struct file_input *in);
+
+int file_view_open(struct file_view *view, const char *filename);
+
+/** @brief releases the content of a view; the buffer is kept for reuse */
+void file_view_close(struct file_view *view);
+
+/** @brief closes a view and frees its buffer */
+void file_view_free(struct file_view *view);
+
+int file_load_params(const char *filename, struct cmp_params *params);
+
+uint32_t file_compress_bound(const struct cmp_params *params, uint32_t src_size);
+
+uint32_t file_compress(struct cmp_context *ctx, const struct cmp_params *params,
+		       struct file_input *src, struct file_buffer *dst_buf,
+		       const char *src_filename);
+
+/** @brief initialises a decompressor without any buffers */
+void file_decompressor_init(struct file_decompressor *dec);
+
+/** @brief frees the buffers of a decompressor */
+void file_decompressor_free(struct file_decompressor *dec);
+
+uint32_t file_decompress_buffer(struct file_decompressor *dec, uint32_t src_size,
+				const char *src_name);
+
+uint32_t file_decompress(struct file_decompressor *dec, const char *src_filename,
+			 uint32_t *src_size);
 
 #endif /* FILE_H */
@@ -8,6 +8,7 @@
  */
 
 #include <stdlib.h>
+#include <pthread.h>
 
 #include "util.h"
 #include "log.h"
@@ -20,6 +21,21 @@ static struct log_state {
 	enum log_color_status color_status;
 } g_log_state = { LOG_LEVEL_DEFAULT, LOG_COLOR_DEFAULT };
 
+/** Serialises log messages written by several threads */
+static pthread_mutex_t g_log_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+void log_lock(void)
+{
+	pthread_mutex_lock(&g_log_mutex);
+}
+
+
+void log_unlock(void)
+{
+	pthread_mutex_unlock(&g_log_mutex);
+}
+
 
 void log_setup_color(void)
 {
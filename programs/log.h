@@ -13,7 +13,9 @@
  * Color support can be enabled or disabled at runtime. When enabled, different
  * log levels will be displayed with distinct colors to improve readability.
  *
- * @warning this is not thread safe
+ * Messages are written under a lock, so the lines of messages logged from
+ * several threads do not interleave. The log configuration must not be changed
+ * while other threads are logging.
  */
 
 #ifndef LOG_H
@@ -77,8 +79,10 @@ __extension__
 
 #define LOG_MSG(level, level_name, color, ...)                     \
 	do {                                                       \
+		log_lock();                                        \
 		LOG_PREFIX(level, level_name, color, __VA_ARGS__); \
 		LOG_PLAIN(level, "\n");                            \
+		log_unlock();                                      \
 	} while (0)
 
 /* Logging functions for various log levels with color support. */
@@ -94,8 +98,12 @@ __extension__
  */
 #define LOG_ERROR_WITH_ERRNO(...)                                                            \
 	do {                                                                                 \
+		int const log_errno = errno;                                                 \
+		log_lock();                                                                  \
 		LOG_PREFIX(LOG_LEVEL_ERROR, "error", LOG_COLOR_ERROR, __VA_ARGS__);          \
-		LOG_PLAIN(LOG_LEVEL_ERROR, ": %s (os error: %d)\n", strerror(errno), errno); \
+		LOG_PLAIN(LOG_LEVEL_ERROR, ": %s (os error: %d)\n", strerror(log_errno),     \
+			  log_errno);                                                        \
+		log_unlock();                                                                \
 	} while (0)
 
 /**
@@ -105,12 +113,20 @@ __extension__
  */
 #define LOG_ERROR_CMP(cmp_ret_val, ...)                                                         \
 	do {                                                                                    \
+		log_lock();                                                                     \
 		LOG_PREFIX(LOG_LEVEL_ERROR, "error", LOG_COLOR_ERROR, __VA_ARGS__);             \
 		LOG_PLAIN(LOG_LEVEL_ERROR, ": %s (compression error: %d)\n",                    \
 			  cmp_get_error_message(cmp_ret_val), cmp_get_error_code(cmp_ret_val)); \
+		log_unlock();                                                                   \
 	} while (0)
 
 
+/** @brief serialises the output of log messages between threads */
+void log_lock(void);
+
+/** @brief releases the lock taken with log_lock() */
+void log_unlock(void);
+
 /** @brief increases the verbosity level by one step */
 void log_increase_verbosity(void);
 
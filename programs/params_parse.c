@@ -103,7 +103,8 @@ static const struct param_def {
 
 	/* Feature flags */
 	{ S8("checksum_enabled"),              PARAM_FIELD(checksum_enabled),              &bool_map          },
-	{ S8("uncompressed_fallback_enabled"), PARAM_FIELD(uncompressed_fallback_enabled), &bool_map          }
+	{ S8("uncompressed_fallback_enabled"), PARAM_FIELD(uncompressed_fallback_enabled), &bool_map          },
+	{ S8("iwt_in_place_enabled"),          PARAM_FIELD(iwt_in_place_enabled),          &bool_map          }
 };
 #undef PARAM_FIELD
 
@@ -365,6 +366,31 @@ static struct s8 concat_value_as_string(struct arena *a, struct s8 head,
 }
 
 
+/* S8 string literals are NUL-terminated, so the names can be used as C strings */
+static const char *value_name(const struct value_map *map, uint32_t value_num)
+{
+	size_t i;
+
+	for (i = 0; i < map->entry_count; i++)
+		if (value_num == map->entries[i].value)
+			return (const char *)map->entries[i].name.s;
+
+	return "INVALID";
+}
+
+
+const char *cmp_preprocessing_name(uint32_t preprocessing)
+{
+	return value_name(&preprocessing_map, preprocessing);
+}
+
+
+const char *cmp_encoder_type_name(uint32_t encoder_type)
+{
+	return value_name(&encoder_type_map, encoder_type);
+}
+
+
 const char *cmp_params_to_string(struct arena *a, const struct cmp_params *par)
 {
 	static const struct s8 eq = S8(" = ");
@@ -55,4 +55,18 @@ enum cmp_parse_status cmp_params_parse(const char *str, struct cmp_params *param
  */
 const char *cmp_params_to_string(struct arena *perm, const struct cmp_params *par);
 
+/**
+ * @brief returns the name of a preprocessing method, e.g., "MODEL"
+ *
+ * @returns a static string; "INVALID" for an unknown method
+ */
+const char *cmp_preprocessing_name(uint32_t preprocessing);
+
+/**
+ * @brief returns the name of an encoder type, e.g., "GOLOMB_ZERO"
+ *
+ * @returns a static string; "INVALID" for an unknown encoder type
+ */
+const char *cmp_encoder_type_name(uint32_t encoder_type);
+
 #endif /* PARAMS_PARSE_H */
@@ -0,0 +1,257 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Worker pool implementation
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <assert.h>
+
+#include "pool.h"
+#include "log.h"
+
+
+/**
+ * @brief state shared by all workers of a pool
+ */
+
+struct pool_state {
+	pthread_mutex_t mutex;
+	unsigned int next_job; /**< next job to hand out */
+	unsigned int num_jobs; /**< total number of jobs */
+	int failed;            /**< set if a job failed */
+	pool_job_fn job_fn;
+	void *shared;
+};
+
+
+/**
+ * @brief argument of a worker thread
+ */
+
+struct pool_worker {
+	struct pool_state *state;
+	void *worker;
+	pthread_t thread;
+};
+
+
+static void *pool_worker_main(void *arg)
+{
+	struct pool_worker *w = arg;
+	struct pool_state *st = w->state;
+
+	while (1) {
+		unsigned int job;
+		int err;
+
+		pthread_mutex_lock(&st->mutex);
+		if (st->failed || st->next_job >= st->num_jobs) {
+			pthread_mutex_unlock(&st->mutex);
+			break;
+		}
+		job = st->next_job++;
+		pthread_mutex_unlock(&st->mutex);
+
+		err = st->job_fn(st->shared, w->worker, job);
+		if (err) {
+			pthread_mutex_lock(&st->mutex);
+			st->failed = 1;
+			pthread_mutex_unlock(&st->mutex);
+		}
+	}
+	return NULL;
+}
+
+
+int pool_run(unsigned int num_workers, unsigned int num_jobs, pool_job_fn job_fn, void *shared,
+	     void *workers, size_t worker_size)
+{
+	struct pool_state st;
+	struct pool_worker *w;
+	unsigned int i;
+
+	assert(num_workers >= 1);
+	assert(job_fn);
+	assert(workers);
+
+	memset(&st, 0, sizeof(st));
+	st.num_jobs = num_jobs;
+	st.job_fn = job_fn;
+	st.shared = shared;
+
+	w = malloc(num_workers * sizeof(*w));
+	if (!w) {
+		LOG_ERROR_WITH_ERRNO("Memory allocation failed for the worker pool");
+		return -1;
+	}
+	if (pthread_mutex_init(&st.mutex, NULL)) {
+		LOG_ERROR("Can't initialise the worker pool");
+		free(w);
+		return -1;
+	}
+
+	for (i = 0; i < num_workers; i++) {
+		w[i].state = &st;
+		w[i].worker = (char *)workers + i * worker_size;
+	}
+	for (i = 1; i < num_workers; i++) {
+		if (pthread_create(&w[i].thread, NULL, pool_worker_main, &w[i])) {
+			LOG_WARNING("Can't create worker thread %u, continuing with %u threads",
+				    i + 1, i);
+			break;
+		}
+	}
+	num_workers = i;
+
+	(void)pool_worker_main(&w[0]);
+	for (i = 1; i < num_workers; i++)
+		pthread_join(w[i].thread, NULL);
+
+	pthread_mutex_destroy(&st.mutex);
+	free(w);
+
+	return st.failed ? -1 : 0;
+}
+
+
+void pool_sequencer_init(struct pool_sequencer *seq)
+{
+	assert(seq);
+
+	pthread_mutex_init(&seq->mutex, NULL);
+	pthread_cond_init(&seq->cond, NULL);
+	seq->next = 0;
+	seq->aborted = 0;
+}
+
+
+int pool_sequencer_wait(struct pool_sequencer *seq, unsigned int ticket)
+{
+	int aborted;
+
+	assert(seq);
+
+	pthread_mutex_lock(&seq->mutex);
+	while (seq->next != ticket && !seq->aborted)
+		pthread_cond_wait(&seq->cond, &seq->mutex);
+	aborted = seq->aborted;
+	pthread_mutex_unlock(&seq->mutex);
+
+	return aborted ? -1 : 0;
+}
+
+
+void pool_sequencer_done(struct pool_sequencer *seq)
+{
+	assert(seq);
+
+	pthread_mutex_lock(&seq->mutex);
+	seq->next++;
+	pthread_cond_broadcast(&seq->cond);
+	pthread_mutex_unlock(&seq->mutex);
+}
+
+
+void pool_sequencer_abort(struct pool_sequencer *seq)
+{
+	assert(seq);
+
+	pthread_mutex_lock(&seq->mutex);
+	seq->aborted = 1;
+	pthread_cond_broadcast(&seq->cond);
+	pthread_mutex_unlock(&seq->mutex);
+}
+
+
+void pool_sequencer_destroy(struct pool_sequencer *seq)
+{
+	assert(seq);
+
+	pthread_cond_destroy(&seq->cond);
+	pthread_mutex_destroy(&seq->mutex);
+}
+
+
+int pool_pipeline_init(struct pool_pipeline *pl, unsigned int num_slots,
+		       unsigned int num_stages)
+{
+	assert(pl);
+	assert(num_slots >= 1);
+	assert(num_stages >= 1);
+
+	memset(pl, 0, sizeof(*pl));
+	pl->passes = calloc(num_slots, sizeof(*pl->passes));
+	if (!pl->passes) {
+		LOG_ERROR_WITH_ERRNO("Memory allocation failed for the pipeline");
+		return -1;
+	}
+	pl->num_slots = num_slots;
+	pl->num_stages = num_stages;
+	pthread_mutex_init(&pl->mutex, NULL);
+	pthread_cond_init(&pl->cond, NULL);
+
+	return 0;
+}
+
+
+int pool_pipeline_wait(struct pool_pipeline *pl, unsigned int item, unsigned int stage)
+{
+	unsigned int slot, passes;
+	int aborted;
+
+	assert(pl);
+	assert(stage < pl->num_stages);
+
+	slot = item % pl->num_slots;
+	/* every earlier item of the slot has to pass all stages first */
+	passes = item / pl->num_slots * pl->num_stages + stage;
+
+	pthread_mutex_lock(&pl->mutex);
+	while (pl->passes[slot] != passes && !pl->aborted)
+		pthread_cond_wait(&pl->cond, &pl->mutex);
+	aborted = pl->aborted;
+	pthread_mutex_unlock(&pl->mutex);
+
+	return aborted ? -1 : 0;
+}
+
+
+void pool_pipeline_pass(struct pool_pipeline *pl, unsigned int item)
+{
+	assert(pl);
+
+	pthread_mutex_lock(&pl->mutex);
+	pl->passes[item % pl->num_slots]++;
+	pthread_cond_broadcast(&pl->cond);
+	pthread_mutex_unlock(&pl->mutex);
+}
+
+
+void pool_pipeline_abort(struct pool_pipeline *pl)
+{
+	assert(pl);
+
+	pthread_mutex_lock(&pl->mutex);
+	pl->aborted = 1;
+	pthread_cond_broadcast(&pl->cond);
+	pthread_mutex_unlock(&pl->mutex);
+}
+
+
+void pool_pipeline_destroy(struct pool_pipeline *pl)
+{
+	assert(pl);
+
+	if (!pl->passes)
+		return;
+	pthread_cond_destroy(&pl->cond);
+	pthread_mutex_destroy(&pl->mutex);
+	free(pl->passes);
+	pl->passes = NULL;
+}
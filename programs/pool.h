@@ -0,0 +1,146 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Minimal worker pool to process independent jobs in parallel
+ *
+ * The jobs are numbered from 0 and handed out in increasing order to the
+ * workers, each of which owns a private state. A sequencer lets the workers
+ * finish their jobs (e.g., write output or log progress) in job order. A
+ * pipeline passes items through several stages, which can run in different
+ * threads, with a fixed set of recycled slots.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+/** Maximum number of worker threads */
+#define POOL_MAX_THREADS 256
+
+
+/**
+ * @brief function processing a job
+ *
+ * @param shared	pointer to the state shared by all workers
+ * @param worker	pointer to the private state of the worker
+ * @param job		number of the job to process
+ *
+ * @returns 0 on success; on failure no further jobs are started
+ */
+
+typedef int (*pool_job_fn)(void *shared, void *worker, unsigned int job);
+
+
+/**
+ * @brief processes jobs with a pool of worker threads
+ *
+ * The calling thread works as the first worker, so no thread is created for a
+ * single worker. If a thread can not be created, the remaining workers
+ * process the jobs.
+ *
+ * @param num_workers	number of workers; at least 1
+ * @param num_jobs	number of jobs to process
+ * @param job_fn	function processing a job
+ * @param shared	pointer passed to every job_fn call
+ * @param workers	array of num_workers private worker states
+ * @param worker_size	size of a private worker state in bytes
+ *
+ * @returns 0 if all jobs were successfully processed, otherwise -1
+ */
+
+int pool_run(unsigned int num_workers, unsigned int num_jobs, pool_job_fn job_fn, void *shared,
+	     void *workers, size_t worker_size);
+
+
+/**
+ * @brief hands out turns in ticket order to the workers
+ */
+
+struct pool_sequencer {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	unsigned int next; /**< ticket of the current turn */
+	int aborted;       /**< set if a worker gave up */
+};
+
+
+/** @brief initialises a sequencer; the first turn has ticket 0 */
+void pool_sequencer_init(struct pool_sequencer *seq);
+
+/**
+ * @brief waits for the turn of a ticket
+ *
+ * @param seq		pointer to an initialised sequencer
+ * @param ticket	ticket to wait for
+ *
+ * @returns 0 when it is the turn of the ticket, -1 if the sequencer was aborted
+ */
+int pool_sequencer_wait(struct pool_sequencer *seq, unsigned int ticket);
+
+/** @brief ends the current turn and hands the turn to the next ticket */
+void pool_sequencer_done(struct pool_sequencer *seq);
+
+/** @brief aborts the sequencer; wakes up all waiting workers */
+void pool_sequencer_abort(struct pool_sequencer *seq);
+
+/** @brief releases the resources of a sequencer */
+void pool_sequencer_destroy(struct pool_sequencer *seq);
+
+
+/**
+ * @brief passes items in order through a number of stages
+ *
+ * Item i uses slot i % num_slots, e.g., an index into an array of buffers. The
+ * stages of an item are processed one after the other, and the first stage of
+ * an item starts after the last stage of the item which used the slot before.
+ */
+
+struct pool_pipeline {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	unsigned int num_slots;  /**< number of slots */
+	unsigned int num_stages; /**< number of stages of every item */
+	unsigned int *passes;    /**< number of passed stages of every slot */
+	int aborted;             /**< set if a stage gave up */
+};
+
+
+/**
+ * @brief initialises a pipeline
+ *
+ * @param pl		pipeline to initialise
+ * @param num_slots	number of slots; at least 1
+ * @param num_stages	number of stages of every item; at least 1
+ *
+ * @returns 0 on success, -1 on error
+ */
+int pool_pipeline_init(struct pool_pipeline *pl, unsigned int num_slots,
+		       unsigned int num_stages);
+
+/**
+ * @brief waits until an item is ready for a stage
+ *
+ * @param pl		pointer to an initialised pipeline
+ * @param item		number of the item
+ * @param stage		stage of the item to wait for
+ *
+ * @returns 0 when the stage of the item can be processed, -1 if the pipeline
+ *	was aborted
+ */
+int pool_pipeline_wait(struct pool_pipeline *pl, unsigned int item, unsigned int stage);
+
+/** @brief passes an item from its current stage on to the next one */
+void pool_pipeline_pass(struct pool_pipeline *pl, unsigned int item);
+
+/** @brief aborts the pipeline; wakes up all waiting stages */
+void pool_pipeline_abort(struct pool_pipeline *pl);
+
+/** @brief releases the resources of a pipeline */
+void pool_pipeline_destroy(struct pool_pipeline *pl);
+
+#endif /* POOL_H */
@@ -0,0 +1,127 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Trace of the compression stages in the Chrome trace event format
+ */
+
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+
+#include "trace.h"
+#include "file.h"
+#include "log.h"
+
+
+static const char *const stage_names[CMP_NUM_STAGES] = {
+	"setup", "preprocess_init", "encode", "checksum", "header"
+};
+
+
+/* monotonic clock in nanoseconds */
+static uint64_t trace_clock_ns(void *opaque)
+{
+	struct timespec ts;
+
+	(void)opaque;
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		return 0;
+	return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+
+/* converts a clock value to the microseconds since the opening of the trace */
+static double trace_us(const struct trace_file *tf, uint64_t t)
+{
+	return t > tf->start ? (double)(t - tf->start) / 1000.0 : 0.0;
+}
+
+
+/* writes the separator before an event; the caller holds the mutex */
+static void trace_next_event(struct trace_file *tf)
+{
+	if (tf->num_events++ && fputs(",\n", tf->fp) < 0)
+		tf->err = 1;
+}
+
+
+static void trace_stage_done(void *opaque, enum cmp_stage stage, uint64_t start, uint64_t end)
+{
+	struct trace_track *track = opaque;
+	struct trace_file *tf = track->file;
+	const char *name = (unsigned int)stage < CMP_NUM_STAGES ? stage_names[stage] : "unknown";
+
+	pthread_mutex_lock(&tf->mutex);
+	trace_next_event(tf);
+	if (fprintf(tf->fp,
+		    "{\"name\":\"%s\",\"cat\":\"compress\",\"ph\":\"X\",\"ts\":%.3f,"
+		    "\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+		    name, trace_us(tf, start), (double)(end - start) / 1000.0, track->tid) < 0)
+		tf->err = 1;
+	pthread_mutex_unlock(&tf->mutex);
+}
+
+
+int trace_file_open(struct trace_file *tf, const char *filename)
+{
+	assert(tf);
+	assert(filename);
+
+	tf->fp = file_create(filename);
+	if (!tf->fp)
+		return -1;
+	tf->filename = filename;
+	pthread_mutex_init(&tf->mutex, NULL);
+	tf->start = trace_clock_ns(NULL);
+	tf->num_events = 0;
+	tf->err = fputs("{\"traceEvents\":[\n", tf->fp) < 0;
+	return 0;
+}
+
+
+int trace_file_close(struct trace_file *tf)
+{
+	int err;
+
+	assert(tf);
+	assert(tf->fp);
+
+	err = tf->err || fputs("\n]}\n", tf->fp) < 0 || fflush(tf->fp);
+	if (err)
+		LOG_ERROR_WITH_ERRNO("Error writing '%s'", tf->filename);
+	if (file_close(tf->fp, tf->filename))
+		err = 1;
+	pthread_mutex_destroy(&tf->mutex);
+	tf->fp = NULL;
+	return err ? -1 : 0;
+}
+
+
+void trace_track_attach(struct trace_track *track, struct trace_file *tf, unsigned int tid,
+			struct cmp_context *ctx)
+{
+	assert(track);
+	assert(tf);
+	assert(ctx);
+
+	track->trace.clock = trace_clock_ns;
+	track->trace.stage_done = trace_stage_done;
+	track->trace.opaque = track;
+	track->file = tf;
+	track->tid = tid;
+
+	/* names the thread of the track in the viewer */
+	pthread_mutex_lock(&tf->mutex);
+	trace_next_event(tf);
+	if (fprintf(tf->fp,
+		    "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+		    "\"args\":{\"name\":\"context %u\"}}",
+		    tid, tid) < 0)
+		tf->err = 1;
+	pthread_mutex_unlock(&tf->mutex);
+
+	cmp_set_trace(ctx, &track->trace);
+}
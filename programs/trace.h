@@ -0,0 +1,86 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Trace of the compression stages in the Chrome trace event format
+ *
+ * The stages reported by the compression contexts (see cmp_set_trace()) are
+ * written as complete events into a JSON file, which can be viewed with
+ * chrome://tracing or Perfetto. Every context is shown as a thread of its own;
+ * the events of several threads are serialised with a mutex.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#include "../lib/cmp.h"
+
+
+/**
+ * @brief trace file shared by all traced contexts
+ */
+
+struct trace_file {
+	FILE *fp;
+	const char *filename;
+	pthread_mutex_t mutex;
+	uint64_t start;           /**< clock value at the opening; origin of the event times */
+	unsigned long num_events; /**< number of events written */
+	int err;                  /**< set if writing failed */
+};
+
+
+/**
+ * @brief trace of a single compression context
+ */
+
+struct trace_track {
+	struct cmp_trace trace; /**< callbacks set in the context */
+	struct trace_file *file;
+	unsigned int tid;       /**< thread id of the events */
+};
+
+
+/**
+ * @brief creates a trace file
+ *
+ * @param tf		pointer to the trace file to initialise
+ * @param filename	name of the file to create
+ *
+ * @returns 0 on success, -1 on error
+ */
+
+int trace_file_open(struct trace_file *tf, const char *filename);
+
+
+/**
+ * @brief completes and closes a trace file
+ *
+ * @param tf	pointer to an opened trace file
+ *
+ * @returns 0 on success, -1 if writing the file failed
+ */
+
+int trace_file_close(struct trace_file *tf);
+
+
+/**
+ * @brief traces the stages of a compression context into a trace file
+ *
+ * @param track	pointer to the track of the context; must not be moved or
+ *		freed while the context is traced
+ * @param tf	pointer to an opened trace file
+ * @param tid	thread id under which the stages are shown
+ * @param ctx	pointer to an initialised compression context
+ */
+
+void trace_track_attach(struct trace_track *track, struct trace_file *tf, unsigned int tid,
+			struct cmp_context *ctx);
+
+#endif /* TRACE_H */
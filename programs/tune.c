@@ -0,0 +1,583 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Search for compression parameters of the CLI
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tune.h"
+#include "../lib/cmp.h"
+#include "../lib/cmp_errors.h"
+#include "arena.h"
+#include "benchmark.h"
+#include "file.h"
+#include "log.h"
+#include "params_parse.h"
+#include "pool.h"
+
+#define TUNE_MAX_SAMPLE_FILES 16 /**< files of a sample taken completely */
+#define TUNE_NUM_RUNS 4          /**< runs of consecutive files of a larger sample */
+#define TUNE_ITERATIONS 3        /**< timed compressions of a candidate */
+#define TUNE_MAX_G_PAR 4096U     /**< largest Golomb parameter searched */
+#define TUNE_MAX_OUTLIER 32768U  /**< largest multi escape outlier searched */
+#define TUNE_G_PAR_NEIGHBOURS 2  /**< g_par steps searched around the best zero escape one */
+#define TUNE_MAX_G_PARS 32
+#define TUNE_MAX_CANDIDATES 64
+
+
+static const enum cmp_preprocessing tune_preprocessings[] = { CMP_PREPROCESS_NONE,
+							      CMP_PREPROCESS_DIFF,
+							      CMP_PREPROCESS_IWT };
+static const uint32_t tune_model_rates[] = { 4, 8, 12, 16 };
+static const uint32_t tune_secondary_iterations[] = { 1, 3, 7, 15 };
+
+#define NUM_PREPROCESSINGS (sizeof(tune_preprocessings) / sizeof(tune_preprocessings[0]))
+#define NUM_MODEL_RATES (sizeof(tune_model_rates) / sizeof(tune_model_rates[0]))
+#define NUM_SECONDARY_ITERATIONS \
+	(sizeof(tune_secondary_iterations) / sizeof(tune_secondary_iterations[0]))
+/* setups of a primary preprocessing: one without and the others with a model */
+#define SETUPS_PER_PREPROCESSING (1 + NUM_MODEL_RATES * NUM_SECONDARY_ITERATIONS)
+
+/* frames of the passes, which are encoded differently */
+enum { PASS_PRIMARY, PASS_SECONDARY, NUM_PASSES };
+
+/* encoder choices of a pass */
+enum { CHOICE_ZERO, CHOICE_MULTI, CHOICE_BEST, NUM_CHOICES };
+
+
+/**
+ * @brief encoder of a pass chosen with its residual histogram
+ */
+
+struct tune_encoder {
+	enum cmp_encoder_type type;
+	uint32_t param;
+	uint32_t outlier;
+	uint64_t bits; /**< estimated encoded size of the pass in bits */
+};
+
+
+/**
+ * @brief preprocessing setup analysed with the residual histograms
+ */
+
+struct tune_setup {
+	enum cmp_preprocessing preprocessing;
+	uint32_t secondary_iterations;
+	uint32_t model_rate;
+	int valid; /**< set if the sample could be compressed with the setup */
+	struct tune_encoder best[NUM_PASSES][CHOICE_BEST];
+	uint64_t estimate; /**< estimated encoded size with the best encoders in bits */
+};
+
+
+/**
+ * @brief parameters compressed and timed
+ */
+
+struct tune_candidate {
+	struct cmp_params params;
+	int valid;                /**< set if the sample could be compressed */
+	uint64_t compressed_size; /**< compressed size of the sample in bytes */
+	double speed;             /**< median compression speed in MB/s */
+};
+
+
+/**
+ * @brief private state of a worker
+ */
+
+struct tune_worker {
+	struct bench_state st; /**< shares the inputs of the sample */
+	uint32_t *hist[NUM_PASSES];
+};
+
+
+/**
+ * @brief state shared by all workers
+ */
+
+struct tune_shared {
+	const struct cmp_params *base;
+	struct tune_setup *setups;
+};
+
+
+/* parameters of a setup with placeholder encoders */
+static void tune_setup_params(const struct cmp_params *base, const struct tune_setup *setup,
+			      struct cmp_params *params)
+{
+	*params = *base;
+	params->primary_preprocessing = setup->preprocessing;
+	params->primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params->primary_encoder_param = 16;
+	params->primary_encoder_outlier = 0;
+	params->secondary_iterations = setup->secondary_iterations;
+	if (setup->secondary_iterations) {
+		params->secondary_preprocessing = CMP_PREPROCESS_MODEL;
+		params->secondary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+		params->secondary_encoder_param = 16;
+		params->model_rate = setup->model_rate;
+	} else {
+		params->secondary_preprocessing = CMP_PREPROCESS_NONE;
+		params->secondary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+		params->secondary_encoder_param = 0;
+		params->model_rate = 0;
+	}
+	params->secondary_encoder_outlier = 0;
+	/* the sample is read-only and the histograms must see every frame */
+	params->iwt_in_place_enabled = 0;
+	params->uncompressed_fallback_enabled = 0;
+}
+
+
+/* keeps an encoder if it needs fewer bits than the best one so far */
+static void tune_try_encoder(const uint32_t *hist, struct tune_encoder *best,
+			     enum cmp_encoder_type type, uint32_t param, uint32_t outlier)
+{
+	uint64_t bits;
+
+	if (cmp_is_error(cmp_estimate_encoded_bits(hist, type, param, outlier, &bits)) ||
+	    bits >= best->bits)
+		return;
+	best->type = type;
+	best->param = param;
+	best->outlier = outlier;
+	best->bits = bits;
+}
+
+
+/* chooses the best zero and multi escape encoders for a residual histogram */
+static void tune_search_encoders(const uint32_t *hist, struct tune_encoder *best)
+{
+	uint32_t g_pars[TUNE_MAX_G_PARS];
+	int num_g_pars = 0, best_g = 0;
+	int i;
+	uint32_t g;
+
+	/* powers of two and the values halfway between them */
+	for (g = 1; g <= TUNE_MAX_G_PAR; g *= 2) {
+		g_pars[num_g_pars++] = g;
+		if (g >= 2 && g + g / 2 <= TUNE_MAX_G_PAR)
+			g_pars[num_g_pars++] = g + g / 2;
+	}
+	assert(num_g_pars <= TUNE_MAX_G_PARS);
+
+	best[CHOICE_ZERO].bits = UINT64_MAX;
+	for (i = 0; i < num_g_pars; i++) {
+		uint64_t const old_bits = best[CHOICE_ZERO].bits;
+
+		tune_try_encoder(hist, &best[CHOICE_ZERO], CMP_ENCODER_GOLOMB_ZERO, g_pars[i], 0);
+		if (best[CHOICE_ZERO].bits < old_bits)
+			best_g = i;
+	}
+
+	/* the outliers only move the best parameter a little */
+	best[CHOICE_MULTI].bits = UINT64_MAX;
+	for (i = best_g - TUNE_G_PAR_NEIGHBOURS; i <= best_g + TUNE_G_PAR_NEIGHBOURS; i++) {
+		uint32_t outlier;
+
+		if (i < 0 || i >= num_g_pars)
+			continue;
+		for (outlier = 2; outlier <= TUNE_MAX_OUTLIER; outlier *= 2)
+			tune_try_encoder(hist, &best[CHOICE_MULTI], CMP_ENCODER_GOLOMB_MULTI,
+					 g_pars[i], outlier);
+	}
+}
+
+
+/* analyses the residuals of a setup; job function of pool_run() */
+static int tune_analyse(void *shared, void *worker, unsigned int job)
+{
+	struct tune_shared *sh = shared;
+	struct tune_worker *w = worker;
+	struct tune_setup *setup = &sh->setups[job];
+	struct cmp_params params;
+	struct cmp_context ctx;
+	struct bench_hists hists;
+	uint64_t size;
+	int pass, err;
+
+	tune_setup_params(sh->base, setup, &params);
+	err = bench_prepare(&w->st, &params, &ctx);
+	if (err)
+		return err < 0 ? -1 : 0;
+
+	for (pass = 0; pass < NUM_PASSES; pass++)
+		memset(w->hist[pass], 0, CMP_RESIDUAL_HIST_SIZE * sizeof(*w->hist[pass]));
+	hists.primary = w->hist[PASS_PRIMARY];
+	hists.secondary = w->hist[PASS_SECONDARY];
+	hists.secondary_iterations = setup->secondary_iterations;
+	err = bench_iteration(&w->st, &ctx, &hists, &size);
+	cmp_deinitialise(&ctx);
+	if (err)
+		return err < 0 ? -1 : 0;
+
+	setup->estimate = 0;
+	for (pass = 0; pass < NUM_PASSES; pass++) {
+		struct tune_encoder *best = setup->best[pass];
+
+		tune_search_encoders(w->hist[pass], best);
+		setup->estimate += best[CHOICE_ZERO].bits < best[CHOICE_MULTI].bits
+					   ? best[CHOICE_ZERO].bits
+					   : best[CHOICE_MULTI].bits;
+	}
+	setup->valid = 1;
+	return 0;
+}
+
+
+/* compresses and times a candidate alone, so it does not compete with other work */
+static int tune_measure(struct bench_state *sample, struct tune_candidate *cand)
+{
+	struct cmp_params params = cand->params;
+	struct bench_result result;
+	int err;
+
+	/* the sample is compressed several times */
+	params.iwt_in_place_enabled = 0;
+	err = bench_setting(sample, &params, &result);
+	if (err)
+		return err < 0 ? -1 : 0;
+
+	cand->compressed_size = result.compressed_size;
+	cand->speed = result.median_speed;
+	cand->valid = 1;
+	return 0;
+}
+
+
+/* adds a candidate unless it is already in the list */
+static void tune_add_candidate(struct tune_candidate *cands, unsigned int *num_cands,
+			       const struct cmp_params *params)
+{
+	unsigned int i;
+
+	for (i = 0; i < *num_cands; i++)
+		if (!memcmp(&cands[i].params, params, sizeof(*params)))
+			return;
+	assert(*num_cands < TUNE_MAX_CANDIDATES);
+	memset(&cands[*num_cands], 0, sizeof(cands[*num_cands]));
+	cands[*num_cands].params = *params;
+	(*num_cands)++;
+}
+
+
+/* selects the encoder of a pass for an encoder choice */
+static const struct tune_encoder *tune_choose(const struct tune_setup *setup, int pass, int choice)
+{
+	const struct tune_encoder *best = setup->best[pass];
+
+	if (choice == CHOICE_BEST)
+		return best[CHOICE_ZERO].bits <= best[CHOICE_MULTI].bits ? &best[CHOICE_ZERO]
+									 : &best[CHOICE_MULTI];
+	return &best[choice];
+}
+
+
+/* adds the candidates of the encoder choices of a setup */
+static void tune_add_setup(struct tune_candidate *cands, unsigned int *num_cands,
+			   const struct cmp_params *base, const struct tune_setup *setup)
+{
+	int choice;
+
+	for (choice = 0; choice < NUM_CHOICES; choice++) {
+		const struct tune_encoder *primary = tune_choose(setup, PASS_PRIMARY, choice);
+		struct cmp_params params;
+
+		if (primary->bits == UINT64_MAX)
+			continue;
+		tune_setup_params(base, setup, &params);
+		params.primary_encoder_type = primary->type;
+		params.primary_encoder_param = primary->param;
+		params.primary_encoder_outlier = primary->outlier;
+		if (setup->secondary_iterations) {
+			const struct tune_encoder *secondary =
+				tune_choose(setup, PASS_SECONDARY, choice);
+
+			if (secondary->bits == UINT64_MAX)
+				continue;
+			params.secondary_encoder_type = secondary->type;
+			params.secondary_encoder_param = secondary->param;
+			params.secondary_encoder_outlier = secondary->outlier;
+		}
+		params.iwt_in_place_enabled = base->iwt_in_place_enabled;
+		params.uncompressed_fallback_enabled = base->uncompressed_fallback_enabled;
+		tune_add_candidate(cands, num_cands, &params);
+	}
+}
+
+
+/* creates the analysed setups; returns their number */
+static unsigned int tune_make_setups(struct tune_setup *setups, int run_len)
+{
+	unsigned int n = 0;
+	size_t p, r, s;
+
+	for (p = 0; p < NUM_PREPROCESSINGS; p++) {
+		setups[n++].preprocessing = tune_preprocessings[p];
+		for (r = 0; r < NUM_MODEL_RATES; r++) {
+			for (s = 0; s < NUM_SECONDARY_ITERATIONS; s++) {
+				/* the sample has to contain secondary frames */
+				if (tune_secondary_iterations[s] >= (uint32_t)run_len)
+					continue;
+				setups[n].preprocessing = tune_preprocessings[p];
+				setups[n].secondary_iterations = tune_secondary_iterations[s];
+				setups[n].model_rate = tune_model_rates[r];
+				n++;
+			}
+		}
+	}
+	return n;
+}
+
+
+/* picks the candidates from the analysed setups; returns their number */
+static unsigned int tune_make_candidates(struct tune_candidate *cands,
+					 const struct cmp_params *base,
+					 const struct tune_setup *setups, unsigned int num_setups)
+{
+	unsigned int num_cands = 0;
+	struct cmp_params params = *base;
+	size_t p;
+
+	/* the uncompressed storage is always on the front */
+	params.primary_preprocessing = CMP_PREPROCESS_NONE;
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.primary_encoder_param = 0;
+	params.primary_encoder_outlier = 0;
+	params.secondary_iterations = 0;
+	params.secondary_preprocessing = CMP_PREPROCESS_NONE;
+	params.secondary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.secondary_encoder_param = 0;
+	params.secondary_encoder_outlier = 0;
+	params.model_rate = 0;
+	tune_add_candidate(cands, &num_cands, &params);
+
+	/* for every preprocessing, the setup without and the best one with a model */
+	for (p = 0; p < NUM_PREPROCESSINGS; p++) {
+		const struct tune_setup *best_model = NULL;
+		unsigned int i;
+
+		for (i = 0; i < num_setups; i++) {
+			const struct tune_setup *setup = &setups[i];
+
+			if (!setup->valid || setup->preprocessing != tune_preprocessings[p])
+				continue;
+			if (!setup->secondary_iterations)
+				tune_add_setup(cands, &num_cands, base, setup);
+			else if (!best_model || setup->estimate < best_model->estimate)
+				best_model = setup;
+		}
+		if (best_model)
+			tune_add_setup(cands, &num_cands, base, best_model);
+	}
+	return num_cands;
+}
+
+
+/* describes a pass in a line of the front */
+static void tune_describe_pass(char *buf, enum cmp_preprocessing preprocessing,
+			       enum cmp_encoder_type type, uint32_t param, uint32_t outlier)
+{
+	int n = sprintf(buf, "%.16s %.16s", cmp_preprocessing_name(preprocessing),
+			cmp_encoder_type_name(type));
+
+	if (type == CMP_ENCODER_GOLOMB_ZERO || type == CMP_ENCODER_GOLOMB_MULTI)
+		n += sprintf(buf + n, " g=%lu", (unsigned long)param);
+	if (type == CMP_ENCODER_GOLOMB_MULTI)
+		sprintf(buf + n, " o=%lu", (unsigned long)outlier);
+}
+
+
+/* prints the candidates which are not beaten in both ratio and speed; returns the best ratio */
+static const struct tune_candidate *tune_print_front(const struct bench_state *sample,
+						     struct tune_candidate *cands,
+						     unsigned int num_cands)
+{
+	const struct tune_candidate *best = NULL;
+	unsigned int i, j;
+
+	/* sorts by speed, fastest first */
+	for (i = 1; i < num_cands; i++) {
+		struct tune_candidate const c = cands[i];
+
+		for (j = i; j > 0 && cands[j - 1].speed < c.speed; j--)
+			cands[j] = cands[j - 1];
+		cands[j] = c;
+	}
+
+	LOG_STDOUT("%8s %10s  %-36s %s\n", "ratio", "MB/s", "primary", "secondary");
+	for (i = 0; i < num_cands; i++) {
+		const struct tune_candidate *c = &cands[i];
+		const struct cmp_params *par = &c->params;
+		char primary[64], secondary[80];
+
+		if (!c->valid || (best && c->compressed_size >= best->compressed_size))
+			continue;
+		best = c;
+
+		tune_describe_pass(primary, par->primary_preprocessing, par->primary_encoder_type,
+				   par->primary_encoder_param, par->primary_encoder_outlier);
+		secondary[0] = '\0';
+		if (par->secondary_iterations) {
+			int const n = sprintf(secondary, " %lux r=%lu ",
+					      (unsigned long)par->secondary_iterations,
+					      (unsigned long)par->model_rate);
+
+			tune_describe_pass(secondary + n, par->secondary_preprocessing,
+					   par->secondary_encoder_type,
+					   par->secondary_encoder_param,
+					   par->secondary_encoder_outlier);
+		}
+		LOG_STDOUT("%7.2f%% %10.2f  %-*s%s\n",
+			   (double)c->compressed_size / (double)sample->total_size * 100.0, c->speed,
+			   secondary[0] ? 36 : 0, primary, secondary);
+	}
+	return best;
+}
+
+
+/* loads the runs of consecutive files spread over the inputs */
+static int tune_load_sample(struct bench_state *sample, const char ***filenames,
+			    const char **input_files, int num_files)
+{
+	int const num_runs = num_files <= TUNE_MAX_SAMPLE_FILES ? 1 : TUNE_NUM_RUNS;
+	int const run_len = num_runs == 1 ? num_files : TUNE_MAX_SAMPLE_FILES / TUNE_NUM_RUNS;
+	int r, k;
+
+	*filenames = calloc((size_t)(num_runs * run_len), sizeof(**filenames));
+	if (!*filenames) {
+		LOG_ERROR_WITH_ERRNO("Memory allocation failed for the tuning");
+		return -1;
+	}
+	for (r = 0; r < num_runs; r++) {
+		int const first = num_runs == 1 ? 0 : r * (num_files - run_len) / (num_runs - 1);
+
+		for (k = 0; k < run_len; k++)
+			(*filenames)[r * run_len + k] = input_files[first + k];
+	}
+
+	/* the samples are loaded once in host byte order */
+	if (bench_load(sample, *filenames, num_runs * run_len))
+		return -1;
+	sample->run_len = run_len;
+	if (sample->total_size == 0) {
+		LOG_ERROR("Nothing to tune for, the input is empty");
+		return -1;
+	}
+	return 0;
+}
+
+
+/* prints the parameters with the best ratio in the format of a parameters file */
+static int tune_print_best(const struct cmp_params *params, const char *output_name)
+{
+	uint8_t mem[4096];
+	struct arena perm;
+	const char *str;
+
+	perm.beg = mem;
+	perm.end = mem + sizeof(mem);
+	str = cmp_params_to_string(&perm, params);
+	if (!str) {
+		LOG_ERROR("Can't print the compression parameters");
+		return -1;
+	}
+
+	LOG_STDOUT("\nBest ratio:\n%s", str);
+	if (output_name && file_save(output_name, str, strlen(str)))
+		return -1;
+	return 0;
+}
+
+
+int tune_files(const char **input_files, int num_files, const struct cmp_params *params,
+	       unsigned int num_threads, const char *output_name)
+{
+	static const struct bench_options bench_opt = { 0, TUNE_ITERATIONS, 0, 0 };
+	struct bench_state sample;
+	const char **filenames = NULL;
+	struct tune_setup setups[NUM_PREPROCESSINGS * SETUPS_PER_PREPROCESSING];
+	struct tune_candidate cands[TUNE_MAX_CANDIDATES];
+	struct tune_worker *workers = NULL;
+	struct tune_shared shared;
+	const struct tune_candidate *best;
+	unsigned int num_setups, num_cands, i;
+	int result = -1;
+
+	assert(input_files);
+	assert(params);
+	assert(num_files > 0);
+	assert(num_threads > 0);
+
+	if (num_threads > POOL_MAX_THREADS)
+		num_threads = POOL_MAX_THREADS;
+	memset(&sample, 0, sizeof(sample));
+	memset(setups, 0, sizeof(setups));
+	if (tune_load_sample(&sample, &filenames, input_files, num_files))
+		goto end;
+	sample.opt = &bench_opt;
+
+	workers = calloc(num_threads, sizeof(*workers));
+	if (!workers) {
+		LOG_ERROR_WITH_ERRNO("Memory allocation failed for the tuning");
+		goto end;
+	}
+	for (i = 0; i < num_threads; i++) {
+		int pass;
+
+		bench_share(&workers[i].st, &sample);
+		for (pass = 0; pass < NUM_PASSES; pass++) {
+			workers[i].hist[pass] = malloc(CMP_RESIDUAL_HIST_SIZE *
+						       sizeof(*workers[i].hist[pass]));
+			if (!workers[i].hist[pass]) {
+				LOG_ERROR_WITH_ERRNO("Memory allocation failed for the tuning");
+				goto end;
+			}
+		}
+	}
+
+	shared.base = params;
+	shared.setups = setups;
+
+	/* one compression per setup; the encoders are chosen with the histograms */
+	num_setups = tune_make_setups(setups, sample.run_len);
+	if (pool_run(num_threads, num_setups, tune_analyse, &shared, workers, sizeof(*workers)))
+		goto end;
+
+	num_cands = tune_make_candidates(cands, params, setups, num_setups);
+	for (i = 0; i < num_cands; i++)
+		if (tune_measure(&sample, &cands[i]))
+			goto end;
+
+	LOG_STDOUT("%d of %d files sampled, %u setups analysed, threads: %u, %u candidates timed\n",
+		   sample.num_files, num_files, num_setups, num_threads, num_cands);
+	best = tune_print_front(&sample, cands, num_cands);
+	if (!best) {
+		LOG_ERROR("No parameters fit the input");
+		goto end;
+	}
+	result = tune_print_best(&best->params, output_name);
+
+end:
+	if (workers) {
+		for (i = 0; i < num_threads; i++) {
+			free(workers[i].hist[PASS_PRIMARY]);
+			free(workers[i].hist[PASS_SECONDARY]);
+			bench_free(&workers[i].st);
+		}
+		free(workers);
+	}
+	bench_free(&sample);
+	free((void *)filenames);
+	return result;
+}
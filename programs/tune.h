@@ -0,0 +1,42 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Search for compression parameters of the CLI
+ *
+ * A sample of the input files is analysed once for every preprocessing setup,
+ * i.e., primary preprocessing, model rate and secondary iterations, with a
+ * residual histogram (see cmp_set_residual_hist()). The encoder parameters are
+ * chosen from the histograms without compressing again. Only the best
+ * candidates are compressed and timed, one after the other; the ones which are
+ * not beaten in both ratio and speed form the Pareto front.
+ */
+
+#ifndef TUNE_H
+#define TUNE_H
+
+#include "../lib/cmp.h"
+
+
+/**
+ * @brief searches the compression parameters for a set of files
+ *
+ * Prints the Pareto front of ratio against compression speed and the
+ * parameters with the best ratio in the format of a parameters file. The
+ * parameters not searched, e.g., checksum_enabled, are taken from params.
+ *
+ * @param input_files	files to tune for
+ * @param num_files	number of files
+ * @param params	base compression parameters
+ * @param num_threads	number of threads analysing the setups
+ * @param output_name	file to save the best parameters to; NULL for none
+ *
+ * @returns 0 on success or -1 on error
+ */
+
+int tune_files(const char **input_files, int num_files, const struct cmp_params *params,
+	       unsigned int num_threads, const char *output_name);
+
+#endif /* TUNE_H */
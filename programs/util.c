@@ -11,7 +11,9 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <assert.h>
 
 #include "util.h"
@@ -28,6 +30,16 @@ static int g_force_stdin_console;
 static int g_force_stdout_console;
 
 
+int util_is_directory(const char *path)
+{
+	struct stat st;
+
+	assert(path);
+
+	return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+
 void util_force_stdin_console(void)
 {
 	g_force_stdin_console = 1;
@@ -111,3 +123,21 @@ struct hr_fmt util_make_human_readable(uint64_t size, int verbose)
 
 	return hrs;
 }
+
+
+double util_get_time(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		return 0;
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+
+unsigned int util_count_cores(void)
+{
+	long const n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return n > 0 ? (unsigned int)n : 1;
+}
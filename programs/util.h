@@ -44,6 +44,17 @@ void util_force_stdin_console(void);
 void util_force_stdout_console(void);
 
 
+/**
+ * @brief checks if a path names an existing directory
+ *
+ * @param path	path to check
+ *
+ * @returns non-zero if the path is a directory, otherwise 0.
+ */
+
+int util_is_directory(const char *path);
+
+
 /**
  * @brief represents a human-readable formatted value
  */
@@ -77,4 +88,22 @@ struct hr_fmt {
 
 struct hr_fmt util_make_human_readable(uint64_t size, int verbose);
 
+
+/**
+ * @brief gets the time of a monotonic clock
+ *
+ * @returns the time in seconds since an arbitrary starting point
+ */
+
+double util_get_time(void);
+
+
+/**
+ * @brief counts the online processor cores
+ *
+ * @returns the number of cores; at least 1
+ */
+
+unsigned int util_count_cores(void);
+
 #endif /* UTIL_H */
@@ -0,0 +1,361 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Directory and FIFO watch implementation
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#  include <sys/inotify.h>
+#  define WATCH_HAVE_INOTIFY 1
+#else
+#  define WATCH_HAVE_INOTIFY 0
+#endif
+
+#include "watch.h"
+#include "log.h"
+
+#define WATCH_MIN_BUF_SIZE 4096
+
+
+/* the signal handler wakes up a waiting watch through this pipe */
+static int signal_pipe[2] = { -1, -1 };
+static volatile sig_atomic_t reload_requested;
+static volatile sig_atomic_t stop_requested;
+
+
+static void watch_signal_handler(int sig)
+{
+	int const saved_errno = errno;
+	char const c = 0;
+
+	if (sig == SIGHUP)
+		reload_requested = 1;
+	else
+		stop_requested = 1;
+	if (write(signal_pipe[1], &c, 1) < 0) {
+		/* the pipe is full, so the watch wakes up anyway */
+	}
+	errno = saved_errno;
+}
+
+
+static int watch_set_signals(void (*handler)(int))
+{
+	static const int signals[] = { SIGHUP, SIGINT, SIGTERM };
+	struct sigaction sa;
+	size_t i;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = handler;
+	sigemptyset(&sa.sa_mask);
+	for (i = 0; i < sizeof(signals) / sizeof(signals[0]); i++)
+		if (sigaction(signals[i], &sa, NULL))
+			return -1;
+	return 0;
+}
+
+
+static int watch_open_signal_pipe(void)
+{
+	int i;
+
+	if (pipe(signal_pipe)) {
+		LOG_ERROR_WITH_ERRNO("Can't create a pipe");
+		return -1;
+	}
+	for (i = 0; i < 2; i++) {
+		int const flags = fcntl(signal_pipe[i], F_GETFL);
+
+		if (flags < 0 || fcntl(signal_pipe[i], F_SETFL, flags | O_NONBLOCK) < 0) {
+			LOG_ERROR_WITH_ERRNO("Can't set up the signal pipe");
+			return -1;
+		}
+	}
+	reload_requested = 0;
+	stop_requested = 0;
+	if (watch_set_signals(watch_signal_handler)) {
+		LOG_ERROR_WITH_ERRNO("Can't install the signal handlers");
+		return -1;
+	}
+	return 0;
+}
+
+
+static int watch_open_fifo(struct watch *w)
+{
+	/* a non-blocking open does not wait for a writer */
+	w->fd = open(w->path, O_RDONLY | O_NONBLOCK);
+	if (w->fd < 0) {
+		LOG_ERROR_WITH_ERRNO("Can't open '%s'", w->path);
+		return -1;
+	}
+	/* with an own writer, the FIFO stays open when the last writer leaves */
+	w->fifo_writer = open(w->path, O_WRONLY);
+	if (w->fifo_writer < 0) {
+		LOG_ERROR_WITH_ERRNO("Can't open '%s'", w->path);
+		return -1;
+	}
+	return 0;
+}
+
+
+static int watch_open_directory(struct watch *w)
+{
+#if WATCH_HAVE_INOTIFY
+	w->fd = inotify_init();
+	if (w->fd < 0) {
+		LOG_ERROR_WITH_ERRNO("Can't watch '%s'", w->path);
+		return -1;
+	}
+	if (inotify_add_watch(w->fd, w->path, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		LOG_ERROR_WITH_ERRNO("Can't watch '%s'", w->path);
+		return -1;
+	}
+	return 0;
+#else
+	LOG_ERROR("Watching the directory '%s' is not supported on this platform, use a FIFO",
+		  w->path);
+	return -1;
+#endif
+}
+
+
+int watch_open(struct watch *w, const char *path)
+{
+	struct stat st;
+
+	assert(w);
+	assert(path);
+
+	memset(w, 0, sizeof(*w));
+	w->path = path;
+	w->fd = -1;
+	w->fifo_writer = -1;
+
+	if (stat(path, &st)) {
+		LOG_ERROR_WITH_ERRNO("Can't watch '%s'", path);
+		return -1;
+	}
+	if (!S_ISDIR(st.st_mode) && !S_ISFIFO(st.st_mode)) {
+		LOG_ERROR("'%s' is neither a directory nor a FIFO", path);
+		return -1;
+	}
+	w->is_fifo = S_ISFIFO(st.st_mode);
+
+	if (watch_open_signal_pipe() ||
+	    (w->is_fifo ? watch_open_fifo(w) : watch_open_directory(w))) {
+		watch_close(w);
+		return -1;
+	}
+	return 0;
+}
+
+
+void watch_close(struct watch *w)
+{
+	int i;
+
+	assert(w);
+
+	(void)watch_set_signals(SIG_DFL);
+	for (i = 0; i < 2; i++) {
+		if (signal_pipe[i] >= 0)
+			close(signal_pipe[i]);
+		signal_pipe[i] = -1;
+	}
+	if (w->fd >= 0)
+		close(w->fd);
+	if (w->fifo_writer >= 0)
+		close(w->fifo_writer);
+	w->fd = -1;
+	w->fifo_writer = -1;
+	free(w->buf);
+	free(w->name);
+	w->buf = NULL;
+	w->name = NULL;
+}
+
+
+/* copies a file name into the name buffer of a watch */
+static int watch_set_name(struct watch *w, const char *dir, const char *name, size_t name_len)
+{
+	size_t const dir_len = dir ? strlen(dir) + 1 : 0;
+	size_t const need = dir_len + name_len + 1;
+
+	if (need > w->name_size) {
+		char *new_name = realloc(w->name, need);
+
+		if (!new_name) {
+			LOG_ERROR_WITH_ERRNO("Memory allocation failed for a file name");
+			return -1;
+		}
+		w->name = new_name;
+		w->name_size = need;
+	}
+	if (dir) {
+		memcpy(w->name, dir, dir_len - 1);
+		w->name[dir_len - 1] = '/';
+	}
+	memcpy(w->name + dir_len, name, name_len);
+	w->name[dir_len + name_len] = '\0';
+	return 0;
+}
+
+
+/* checks if a file in a watched directory is ignored */
+static int watch_ignores(const char *name, size_t name_len)
+{
+	static const char suffix[] = ".air";
+	size_t const suffix_len = sizeof(suffix) - 1;
+
+	if (name_len == 0 || name[0] == '.')
+		return 1;
+	return name_len >= suffix_len && !memcmp(name + name_len - suffix_len, suffix, suffix_len);
+}
+
+
+/**
+ * @brief takes the next file name out of the buffered data
+ *
+ * @returns 1 if a file name was found, 0 if more data are needed or -1 on error
+ */
+
+static int watch_take_name(struct watch *w)
+{
+	while (w->buf_pos < w->buf_len) {
+		const char *p = w->buf + w->buf_pos;
+		size_t const avail = w->buf_len - w->buf_pos;
+
+		if (w->is_fifo) {
+			const char *nl = memchr(p, '\n', avail);
+			size_t len;
+
+			if (!nl)
+				return 0;
+			len = (size_t)(nl - p);
+			w->buf_pos += len + 1;
+			if (len > 0 && p[len - 1] == '\r')
+				len--;
+			if (len == 0)
+				continue;
+			return watch_set_name(w, NULL, p, len) ? -1 : 1;
+		}
+#if WATCH_HAVE_INOTIFY
+		{
+			struct inotify_event ev;
+			size_t name_len;
+
+			/* the kernel only returns whole events */
+			assert(avail >= sizeof(ev));
+			memcpy(&ev, p, sizeof(ev));
+			w->buf_pos += sizeof(ev) + ev.len;
+
+			if (ev.mask & IN_Q_OVERFLOW)
+				LOG_WARNING("Too many new files in '%s', some files are missed",
+					    w->path);
+			if (ev.mask & IN_IGNORED) {
+				LOG_ERROR("'%s' is no longer watched", w->path);
+				return -1;
+			}
+			name_len = ev.len ? strlen(p + sizeof(ev)) : 0;
+			if (ev.mask & IN_ISDIR || watch_ignores(p + sizeof(ev), name_len))
+				continue;
+			return watch_set_name(w, w->path, p + sizeof(ev), name_len) ? -1 : 1;
+		}
+#endif
+	}
+	return 0;
+}
+
+
+/* reads more data from the watched file descriptor into the buffer */
+static int watch_fill(struct watch *w)
+{
+	ssize_t n;
+
+	/* drop the reported data */
+	memmove(w->buf, w->buf + w->buf_pos, w->buf_len - w->buf_pos);
+	w->buf_len -= w->buf_pos;
+	w->buf_pos = 0;
+
+	if (w->buf_size - w->buf_len < WATCH_MIN_BUF_SIZE) {
+		size_t const new_size = w->buf_size ? 2 * w->buf_size : 4 * WATCH_MIN_BUF_SIZE;
+		char *new_buf = realloc(w->buf, new_size);
+
+		if (!new_buf) {
+			LOG_ERROR_WITH_ERRNO("Memory allocation failed for the watch of '%s'",
+					     w->path);
+			return -1;
+		}
+		w->buf = new_buf;
+		w->buf_size = new_size;
+	}
+
+	n = read(w->fd, w->buf + w->buf_len, w->buf_size - w->buf_len);
+	if (n < 0) {
+		if (errno == EINTR || errno == EAGAIN)
+			return 0;
+		LOG_ERROR_WITH_ERRNO("Can't read '%s'", w->path);
+		return -1;
+	}
+	w->buf_len += (size_t)n;
+	return 0;
+}
+
+
+int watch_next(struct watch *w, const char **filename)
+{
+	assert(w);
+	assert(filename);
+
+	while (1) {
+		struct pollfd fds[2];
+		int ret;
+
+		if (stop_requested)
+			return WATCH_STOP;
+		if (reload_requested) {
+			reload_requested = 0;
+			return WATCH_RELOAD;
+		}
+
+		ret = watch_take_name(w);
+		if (ret < 0)
+			return -1;
+		if (ret > 0) {
+			*filename = w->name;
+			return WATCH_FILE;
+		}
+
+		fds[0].fd = w->fd;
+		fds[0].events = POLLIN;
+		fds[1].fd = signal_pipe[0];
+		fds[1].events = POLLIN;
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			LOG_ERROR_WITH_ERRNO("Can't wait for '%s'", w->path);
+			return -1;
+		}
+		if (fds[1].revents & POLLIN) {
+			char drain[16];
+
+			while (read(signal_pipe[0], drain, sizeof(drain)) > 0)
+				;
+		}
+		if (fds[0].revents & (POLLIN | POLLHUP | POLLERR) && watch_fill(w))
+			return -1;
+	}
+}
@@ -0,0 +1,82 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Source of new files for a long-running process
+ *
+ * A watch reports the files to process one after the other. The files come
+ * either from a directory, in which case every file written and closed or moved
+ * into the directory is reported (Linux only), or from a FIFO, from which one
+ * file name per line is read. A FIFO is kept open, so writers can come and go.
+ *
+ * While a watch is open, SIGHUP is reported as a reload request and SIGINT and
+ * SIGTERM as a stop request; the signals are only delivered between two files.
+ */
+
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <stddef.h>
+
+
+/**
+ * @brief events reported by a watch
+ */
+
+enum watch_event {
+	WATCH_FILE,   /**< a new file is ready */
+	WATCH_RELOAD, /**< SIGHUP was received */
+	WATCH_STOP    /**< SIGINT or SIGTERM was received */
+};
+
+
+/**
+ * @brief state of a watch
+ */
+
+struct watch {
+	const char *path;   /**< watched directory or FIFO */
+	int is_fifo;        /**< set if the file names are read from a FIFO */
+	int fd;             /**< inotify instance or read end of the FIFO */
+	int fifo_writer;    /**< own write end of the FIFO, so it never reaches EOF */
+	char *buf;          /**< events or file names read but not yet reported */
+	size_t buf_len;     /**< number of bytes in buf */
+	size_t buf_pos;     /**< number of bytes in buf already reported */
+	size_t buf_size;    /**< capacity of buf */
+	char *name;         /**< name of the last reported file */
+	size_t name_size;   /**< capacity of name */
+};
+
+
+/**
+ * @brief starts watching a directory or a FIFO
+ *
+ * Files in a directory which exist before the watch is opened are not
+ * reported. Files whose names start with '.' or end with ".air" are ignored,
+ * so a writer can create a file under a hidden name and rename it when it is
+ * complete, and compressed files can be written into the watched directory.
+ *
+ * @param w	watch to initialise
+ * @param path	directory or FIFO to watch
+ *
+ * @returns 0 on success or -1 on error
+ */
+int watch_open(struct watch *w, const char *path);
+
+/**
+ * @brief waits for the next event of a watch
+ *
+ * @param w		opened watch
+ * @param filename	pointer to store the name of a new file; valid until the
+ *			next call
+ *
+ * @returns an enum watch_event or -1 on error
+ */
+int watch_next(struct watch *w, const char **filename);
+
+/** @brief stops watching and restores the default signal handling */
+void watch_close(struct watch *w);
+
+#endif /* WATCH_H */
@@ -8,7 +8,12 @@
 @brief AIRSPACE CLI Compression Tests
 """
 
+import json
 import os
+import signal
+import subprocess
+import sys
+import time
 import unittest
 from pathlib import Path
 
@@ -190,6 +195,438 @@ class TestCompression(unittest.TestCase):
             stderr_match_mode="contains",
         )
 
+    def test_compress_files_in_parallel_to_stdout_in_order(self):
+        files = []
+        for i in range(8):
+            f = self.test_dir / f"file_{i}.bin"
+            f.write_bytes(bytes([i]) * (2 * (i + 1)))
+            files.append(f)
+
+        result = self.airspace(["-c", "-T", "4", "--stdout"] + files)
+
+        self.assertEqual(RETURN_SUCCESS, result.returncode, result.stderr)
+        offset = 0
+        for f in files:
+            data = f.read_bytes()
+            offset += self.CMP_HDR_SIZE
+            self.assertEqual(data, result.stdout[offset : offset + len(data)])
+            offset += len(data)
+        self.assertEqual(offset, len(result.stdout))
+
+    def test_compress_model_chains_in_parallel(self):
+        params = (
+            "primary_preprocessing=DIFF,primary_encoder_type=GOLOMB_ZERO,"
+            "primary_encoder_param=8,secondary_iterations=2,"
+            "secondary_preprocessing=MODEL,secondary_encoder_type=GOLOMB_MULTI,"
+            "secondary_encoder_param=4,secondary_encoder_outlier=20,model_rate=8"
+        )
+        files = []
+        for i in range(7):
+            f = self.test_dir / f"file_{i}.bin"
+            f.write_bytes(bytes((i * 3 + j) % 7 for j in range(200)))
+            files.append(f)
+        originals = [f.read_bytes() for f in files]
+
+        result = self.airspace(["-c", "--threads=3", "--params", params, "-q"] + files)
+
+        self.assertCli(result)
+        for f in files:
+            f.unlink()
+        result = self.airspace(["-q"] + [f.with_name(f.name + ".air") for f in files])
+        self.assertCli(result)
+        for f, data in zip(files, originals):
+            self.assertEqual(data, f.read_bytes())
+
+    def test_compress_files_of_different_sizes_to_one_file(self):
+        files = []
+        for i, size in enumerate([2000, 2, 60, 1000, 4]):
+            f = self.test_dir / f"file_{i}.bin"
+            f.write_bytes(bytes(j % 5 for j in range(size)))
+            files.append(f)
+        cmp_file = self.test_dir / "all.air"
+
+        result = self.airspace(["-c", "-q", "-o", cmp_file] + files)
+
+        self.assertCli(result)
+        result = self.airspace([cmp_file, "--stdout"])
+        self.assertCli(result, stdout_exp=b"".join(f.read_bytes() for f in files))
+
+    def test_failed_file_stops_after_the_files_before_it(self):
+        odd_size_file = self.test_dir / "file_odd.bin"
+        odd_size_file.write_bytes(bytes(3))
+        files = [self.file1, odd_size_file, self.file2]
+
+        for threads in ["1", "3"]:
+            with self.subTest(threads=threads):
+                for f in files:
+                    f.with_name(f.name + ".air").unlink(missing_ok=True)
+
+                result = self.airspace(["-c", "-T", threads] + files)
+
+                self.assertEqual(RETURN_FAILURE, result.returncode)
+                self.assertIn(b"not a multiple of 2", result.stderr)
+                self.assertTrue(self.file1.with_name(self.file1.name + ".air").exists())
+                self.assertFalse(self.file2.with_name(self.file2.name + ".air").exists())
+
+    def test_compress_files_into_an_archive_and_append_to_it(self):
+        file3 = self.test_dir / "file_3.bin"
+        file3.write_bytes(bytes.fromhex("0005 0006 0007"))
+        archive = self.test_dir / "archive.air"
+
+        result = self.airspace(
+            ["-c", "-q", "--archive", self.file1, self.file2, "-o", archive]
+        )
+        self.assertCli(result)
+        old_archive = archive.read_bytes()
+        result = self.airspace(["-c", "-q", "--append", file3, "-o", archive])
+        self.assertCli(result)
+
+        data = archive.read_bytes()
+        # the old archive with its index is kept in front of the new frames
+        self.assertEqual(old_archive, data[: len(old_archive)])
+        magic, index_offset, num_entries, names_size = (
+            data[-4:],
+            int.from_bytes(data[-24:-16], "big"),
+            int.from_bytes(data[-16:-12], "big"),
+            int.from_bytes(data[-12:-8], "big"),
+        )
+        self.assertEqual(b"AIRA", magic)
+        self.assertEqual(3, num_entries)
+        names = data[index_offset + 32 * num_entries :][:names_size]
+        for i, f in enumerate([self.file1, self.file2, file3]):
+            entry = data[index_offset + 32 * i : index_offset + 32 * (i + 1)]
+            offset = int.from_bytes(entry[0:8], "big")
+            size = int.from_bytes(entry[8:12], "big")
+            name_offset = int.from_bytes(entry[24:28], "big")
+            name_len = int.from_bytes(entry[28:30], "big")
+            self.assertEqual(
+                f.name.encode(), names[name_offset : name_offset + name_len]
+            )
+            frame = data[offset : offset + size]
+            self.assertEqual(f.read_bytes(), frame[self.CMP_HDR_SIZE :])
+
+        originals = [f.read_bytes() for f in [self.file1, self.file2, file3]]
+        for f in [self.file1, self.file2, file3]:
+            f.unlink()
+        result = self.airspace(["-q", archive])
+        self.assertCli(result)
+        for f, original in zip([self.file1, self.file2, file3], originals):
+            self.assertEqual(original, f.read_bytes())
+
+    def test_list_an_appended_archive(self):
+        file3 = self.test_dir / "file_3.bin"
+        file3.write_bytes(bytes.fromhex("0005 0006 0007"))
+        archive = self.test_dir / "archive.air"
+        result = self.airspace(
+            ["-c", "-q", "--archive", self.file1, self.file2, "-o", archive]
+        )
+        self.assertCli(result)
+        result = self.airspace(["-c", "-q", "--append", file3, "-o", archive])
+        self.assertCli(result)
+
+        # the frames are listed through the index, past the old index and footer
+        result = self.airspace(["-l", archive])
+
+        self.assertCli(result, stdout_exp=b" 3 frames", stdout_match_mode="contains")
+        for f in [self.file1, self.file2, file3]:
+            self.assertIn(f" {f.name}\n".encode(), result.stdout)
+
+    def test_append_only_to_an_archive(self):
+        not_an_archive = self.test_dir / "plain.air"
+        not_an_archive.write_bytes(bytes(100))
+
+        result = self.airspace(["-c", "--append", self.file1, "-o", not_an_archive])
+
+        self.assertCli(
+            result,
+            returncode_exp=RETURN_FAILURE,
+            stderr_exp="is not an archive",
+            stderr_match_mode="contains",
+        )
+        self.assertEqual(bytes(100), not_an_archive.read_bytes())
+
+    def test_archive_needs_an_output_file(self):
+        result = self.airspace(["-c", "--archive", self.file1, self.file2])
+
+        self.assertCli(
+            result,
+            returncode_exp=RETURN_FAILURE,
+            stderr_exp="needs an output file",
+            stderr_match_mode="contains",
+        )
+
+    def test_compress_stdin_in_frames(self):
+        data = bytes(range(10))
+
+        result = self.airspace(["-c", "--frame-size=4", "-"], stdin=data)
+
+        self.assertCli(result, stdout_exp=result.stdout)
+        listing = self.airspace(["-l"], stdin=result.stdout)
+        self.assertCli(
+            listing, stdout_exp=b"stdin: 3 frames", stdout_match_mode="contains"
+        )
+        self.assertCli(
+            self.airspace(["--stdout"], stdin=result.stdout), stdout_exp=data
+        )
+
+    def test_frame_size_with_odd_last_frame(self):
+        result = self.airspace(["-c", "--frame-size=4", "-"], stdin=bytes(5))
+
+        self.assertCli(
+            result,
+            stdout_exp=result.stdout,
+            returncode_exp=RETURN_FAILURE,
+            stderr_exp="last frame size of 1 bytes is not a multiple of 2",
+            stderr_match_mode="contains",
+        )
+        self.assertCli(
+            self.airspace(["--stdout"], stdin=result.stdout), stdout_exp=bytes(4)
+        )
+
+    def test_invalid_frame_size(self):
+        for size in ["0", "3", "-2", "4k", "16777216"]:
+            with self.subTest(size=size):
+                result = self.airspace(["-c", "--frame-size", size, self.file1])
+
+                self.assertCli(
+                    result,
+                    returncode_exp=RETURN_FAILURE,
+                    stderr_exp="Invalid frame size",
+                    stderr_match_mode="contains",
+                )
+
+    def test_trace_compression_stages(self):
+        trace_file = self.test_dir / "trace.json"
+
+        result = self.airspace(
+            [
+                "-c",
+                "-T2",
+                f"--trace={trace_file}",
+                "--params=primary_preprocessing=IWT, primary_encoder_type=GOLOMB_ZERO, "
+                "primary_encoder_param=4, checksum_enabled=1",
+                self.file1,
+                self.file2,
+                "-o",
+                os.devnull,
+                "--quiet",
+            ]
+        )
+
+        self.assertCli(result)
+        events = json.loads(trace_file.read_text())["traceEvents"]
+        stages = [e for e in events if e["ph"] == "X"]
+        expected = ["setup", "preprocess_init", "encode", "checksum", "header"]
+        # the threads compress at the same time, so only their own stages are ordered
+        self.assertEqual(len(stages), len(expected) * 2)
+        for tid in (1, 2):
+            names = [e["name"] for e in stages if e["tid"] == tid]
+            self.assertEqual(names, expected * (len(names) // len(expected)))
+        self.assertEqual({e["tid"] for e in events if e["ph"] == "M"}, {1, 2})
+        for e in stages:
+            self.assertGreaterEqual(e["dur"], 0)
+
+    def test_trace_only_for_compression(self):
+        self.assertCli(
+            self.airspace(["--trace=trace.json", self.file1]),
+            returncode_exp=RETURN_FAILURE,
+            stderr_exp="--trace is only supported for the compression",
+            stderr_match_mode="contains",
+        )
+        self.assertFalse((self.test_dir / "trace.json").exists())
+
+    def start_daemon(self, args):
+        daemon = subprocess.Popen(
+            [str(self.cli_test.cli_path), "-c"] + [str(a) for a in args],
+            cwd=self.test_dir,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.PIPE,
+        )
+        # the watch is set up when it is announced
+        self.assertIn(b"Watching", daemon.stderr.readline())
+        return daemon
+
+    def wait_for(self, path: Path):
+        for _ in range(500):
+            if path.exists():
+                return
+            time.sleep(0.01)
+        self.fail(f"{path} was not created")
+
+    def stop_daemon(self, daemon, sig=signal.SIGTERM):
+        daemon.send_signal(sig)
+        _, stderr = daemon.communicate(timeout=10)
+        self.assertEqual(RETURN_SUCCESS, daemon.returncode, stderr)
+        return stderr
+
+    @unittest.skipUnless(sys.platform.startswith("linux"), "needs inotify")
+    def test_watch_directory_keeps_the_model_between_files(self):
+        watch_dir = self.test_dir / "incoming"
+        out_dir = self.test_dir / "out"
+        watch_dir.mkdir()
+        out_dir.mkdir()
+        params_file = self.test_dir / "params.txt"
+        params_file.write_text(
+            "primary_preprocessing=DIFF, primary_encoder_type=GOLOMB_ZERO,\n"
+            "primary_encoder_param=4, secondary_iterations=9,\n"
+            "secondary_preprocessing=MODEL, secondary_encoder_type=GOLOMB_ZERO,\n"
+            "secondary_encoder_param=2, model_rate=8\n"
+        )
+        data = [bytes([0, 7, 0, 9, 0, i]) * 100 for i in range(3)]
+        daemon = self.start_daemon(
+            ["--watch", watch_dir, "-o", out_dir, "--params-file", params_file]
+        )
+
+        for i, d in enumerate(data):
+            tmp = watch_dir / ".tmp"
+            tmp.write_bytes(d)
+            tmp.rename(watch_dir / f"ch_{i}.bin")
+            self.wait_for(out_dir / f"ch_{i}.bin.air")
+        params_file.write_text(
+            "primary_preprocessing=NONE, primary_encoder_type=UNCOMPRESSED"
+        )
+        daemon.send_signal(signal.SIGHUP)
+        while b"Reloaded" not in daemon.stderr.readline():
+            pass
+        (watch_dir / "ch_3.bin").write_bytes(DATA_FILE1)
+        self.wait_for(out_dir / "ch_3.bin.air")
+        stderr = self.stop_daemon(daemon)
+
+        self.assertIn(b"4 files compressed, 0 failed", stderr)
+        self.assertIn(b"latency mean", stderr)
+        cmp_files = [out_dir / f"ch_{i}.bin.air" for i in range(3)]
+        listing = self.airspace(["-l", "-q"] + cmp_files)
+        self.assertCli(
+            listing,
+            stdout_exp=b"0 model chains, 0 broken",
+            stdout_match_mode="contains",
+        )
+        self.assertCli(
+            self.airspace(["--stdout"] + cmp_files), stdout_exp=b"".join(data)
+        )
+        cmp_file = (out_dir / "ch_3.bin.air").read_bytes()
+        self.assertEqual(DATA_FILE1, cmp_file[self.CMP_HDR_SIZE :])
+
+    @unittest.skipUnless(hasattr(os, "mkfifo"), "needs FIFOs")
+    def test_watch_fifo_with_file_names(self):
+        fifo = self.test_dir / "names"
+        os.mkfifo(fifo)
+        daemon = self.start_daemon(["--watch", fifo])
+
+        # writers may come and go
+        for name in [self.file1.name, "missing.bin\n\n" + self.file2.name]:
+            with open(fifo, "w") as f:
+                f.write(name + "\n")
+        self.wait_for(self.file2.with_name(self.file2.name + ".air"))
+        stderr = self.stop_daemon(daemon, signal.SIGINT)
+
+        self.assertTrue(self.file1.with_name(self.file1.name + ".air").exists())
+        self.assertIn(b"2 files compressed, 1 failed", stderr)
+
+    def test_watch_takes_no_input_files(self):
+        result = self.airspace(["-c", "--watch", self.test_dir, self.file1])
+
+        self.assertCli(
+            result,
+            returncode_exp=RETURN_FAILURE,
+            stderr_exp="--watch takes no input files",
+            stderr_match_mode="contains",
+        )
+
+    def test_compress_with_params_file(self):
+        params_file = self.test_dir / "params.txt"
+        params_file.write_text(
+            "primary_preprocessing = NONE,\nprimary_encoder_type = UNCOMPRESSED,\n"
+        )
+
+        result = self.airspace(
+            ["-c", "--params-file", params_file, "--stdout", self.file1]
+        )
+
+        self.assertEqual(DATA_FILE1, result.stdout[self.CMP_HDR_SIZE :])
+        params_file.write_text("primary_preprocessing = WRONG")
+        self.assertCli(
+            self.airspace(["-c", "--params-file", params_file, self.file1]),
+            returncode_exp=RETURN_FAILURE,
+            stderr_exp="Incorrect parameters in",
+            stderr_match_mode="contains",
+        )
+
+    def test_benchmark_as_json(self):
+        result = self.airspace(
+            [
+                "-b",
+                "--bench-iter=2",
+                "--json",
+                "--params=primary_preprocessing=DIFF, primary_encoder_type=GOLOMB_ZERO, "
+                "primary_encoder_param=4",
+                self.file1,
+                self.file2,
+            ]
+        )
+
+        self.assertEqual(result.returncode, RETURN_SUCCESS)
+        bench = json.loads(result.stdout)
+        self.assertEqual(bench["files"], [str(self.file1), str(self.file2)])
+        self.assertEqual(bench["input_size"], len(DATA_FILE1) + len(DATA_FILE2))
+        self.assertEqual(len(bench["results"]), 1)
+        self.assertEqual(bench["results"][0]["primary_preprocessing"], "DIFF")
+        self.assertEqual(bench["results"][0]["primary_encoder_param"], 4)
+        self.assertEqual(bench["results"][0]["iterations"], 2)
+
+    def test_benchmark_sweep(self):
+        # uncompressed baseline + preprocessing x 2 encoders x 13 g_par
+        for files, num_results in [
+            ([self.file1], 1 + 3 * 2 * 13),
+            ([self.file1, self.file2], 1 + 4 * 2 * 13),
+        ]:
+            with self.subTest(num_files=len(files)):
+                result = self.airspace(
+                    ["-b", "--bench-sweep", "--bench-iter=1", "--json"] + files
+                )
+
+                self.assertEqual(result.returncode, RETURN_SUCCESS)
+                results = json.loads(result.stdout)["results"]
+                self.assertEqual(len(results), num_results)
+                self.assertEqual(
+                    results[-1]["secondary_preprocessing"] == "MODEL", len(files) > 1
+                )
+
+    def test_benchmark_takes_no_output(self):
+        self.assertCli(
+            self.airspace(["-b", self.file1, "-o", self.test_dir / "out.air"]),
+            returncode_exp=RETURN_FAILURE,
+            stderr_exp="takes no output options",
+            stderr_match_mode="contains",
+        )
+
+    def test_tune_saves_the_best_params(self):
+        params_file = self.test_dir / "params.txt"
+        file3 = self.test_dir / "file_3.bin"
+        file3.write_bytes(DATA_FILE1)
+
+        result = self.airspace(
+            ["--tune", "-T2", self.file1, self.file2, file3, "-o", params_file]
+        )
+
+        self.assertEqual(result.returncode, RETURN_SUCCESS)
+        front, best = result.stdout.split(b"Best ratio:\n")
+        self.assertIn(b"3 of 3 files sampled", front)
+        self.assertIn(b"NONE UNCOMPRESSED", front)
+        self.assertEqual(params_file.read_bytes(), best)
+        result = self.airspace(
+            ["-c", "--params-file", params_file, "--stdout", self.file1]
+        )
+        self.assertEqual(result.returncode, RETURN_SUCCESS)
+
+    def test_tune_takes_no_archive(self):
+        self.assertCli(
+            self.airspace(["--tune", "--archive", self.file1, "-o", "out.air"]),
+            returncode_exp=RETURN_FAILURE,
+            stderr_exp="--tune takes no archive",
+            stderr_match_mode="contains",
+        )
+
 
 if __name__ == "__main__":
     clitest.main()
@@ -0,0 +1,257 @@
+#!/usr/bin/env python3
+"""
+@file
+@author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+@date   2025
+@copyright GPL-2.0
+
+@brief AIRSPACE CLI Decompression Tests
+"""
+
+import unittest
+
+import clitest
+from clitest import RETURN_FAILURE, CliTest
+
+MODEL_PARAMS = (
+    "primary_preprocessing=DIFF,primary_encoder_type=GOLOMB_ZERO,"
+    "primary_encoder_param=8,secondary_iterations=2,secondary_preprocessing=MODEL,"
+    "secondary_encoder_type=GOLOMB_MULTI,secondary_encoder_param=4,"
+    "secondary_encoder_outlier=20,model_rate=8,checksum_enabled=1"
+)
+
+
+def make_data(seed: int, num_samples: int = 1000) -> bytes:
+    samples = [(1000 + (i * 7 + seed * 13) % 50) for i in range(num_samples)]
+    return b"".join(s.to_bytes(2, "big") for s in samples)
+
+
+class TestDecompression(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        cls.cli_test = CliTest()
+        cls.airspace = cls.cli_test.run_cli
+
+    def setUp(self):
+        test_name = self.id().split(".")[-1]
+        self.test_dir = self.cli_test.change_test_directory(test_name)
+
+    def compress_files(self, num_files: int, params=None):
+        files = []
+        for i in range(num_files):
+            data_file = self.test_dir / f"file_{i}.bin"
+            data_file.write_bytes(make_data(i))
+            files.append(data_file)
+
+        args = ["-c", "--quiet"] + files
+        if params:
+            args += ["--params", params]
+        self.assertCli(self.airspace(args))
+
+        originals = [f.read_bytes() for f in files]
+        for f in files:
+            f.unlink()
+        return [f.with_name(f.name + ".air") for f in files], originals
+
+    def test_decompress_file(self):
+        cmp_files, originals = self.compress_files(1)
+
+        result = self.airspace(cmp_files + ["--quiet"])
+
+        self.assertCli(result)
+        self.assertEqual(originals[0], (self.test_dir / "file_0.bin").read_bytes())
+
+    def test_decompress_model_chains_with_threads(self):
+        cmp_files, originals = self.compress_files(7, MODEL_PARAMS)
+
+        for threads in ["1", "4", "0"]:
+            with self.subTest(threads=threads):
+                for i in range(len(cmp_files)):
+                    (self.test_dir / f"file_{i}.bin").unlink(missing_ok=True)
+
+                result = self.airspace(["-T", threads, "--quiet"] + cmp_files)
+
+                self.assertCli(result)
+                for i, data in enumerate(originals):
+                    self.assertEqual(data, (self.test_dir / f"file_{i}.bin").read_bytes())
+
+    def test_decompress_files_to_stdout_in_order(self):
+        cmp_files, originals = self.compress_files(5, MODEL_PARAMS)
+
+        result = self.airspace(["--threads=3", "--stdout"] + cmp_files)
+
+        self.assertCli(result, stdout_exp=b"".join(originals))
+
+    def test_decompress_data_from_stdin(self):
+        cmp_files, originals = self.compress_files(1)
+
+        result = self.airspace([], stdin=cmp_files[0].read_bytes())
+
+        self.assertCli(result, stdout_exp=originals[0])
+
+    def test_decompress_model_chains_from_an_archive(self):
+        files = []
+        for i in range(5):
+            data_file = self.test_dir / f"file_{i}.bin"
+            data_file.write_bytes(make_data(i))
+            files.append(data_file)
+        originals = [f.read_bytes() for f in files]
+        archive = self.test_dir / "archive.air"
+        self.assertCli(
+            self.airspace(
+                [
+                    "-c",
+                    "-q",
+                    "-T",
+                    "3",
+                    "--archive",
+                    "--params",
+                    MODEL_PARAMS,
+                    "-o",
+                    archive,
+                ]
+                + files[:3]
+            )
+        )
+        self.assertCli(
+            self.airspace(
+                ["-c", "-q", "--append", "--params", MODEL_PARAMS, "-o", archive]
+                + files[3:]
+            )
+        )
+
+        result = self.airspace([archive, "--stdout", "-T", "2"])
+        self.assertCli(result, stdout_exp=b"".join(originals))
+
+        for f in files:
+            f.unlink()
+        self.assertCli(self.airspace(["-q", "-T", "3", archive]))
+        for f, data in zip(files, originals):
+            self.assertEqual(data, f.read_bytes())
+
+    def test_archives_and_compressed_files_are_not_mixed(self):
+        cmp_files, _ = self.compress_files(2)
+        archive = self.test_dir / "archive.air"
+        data_file = self.test_dir / "data.bin"
+        data_file.write_bytes(make_data(0))
+        self.assertCli(
+            self.airspace(["-c", "-q", "--archive", data_file, "-o", archive])
+        )
+
+        result = self.airspace([archive, cmp_files[0], "--stdout"])
+
+        self.assertCli(
+            result,
+            returncode_exp=RETURN_FAILURE,
+            stderr_exp="can't be decompressed together",
+            stderr_match_mode="contains",
+        )
+
+    def test_list_frames_without_decompressing(self):
+        files = []
+        for i in range(3):
+            data_file = self.test_dir / f"file_{i}.bin"
+            data_file.write_bytes(make_data(i))
+            files.append(data_file)
+        frames = self.test_dir / "frames.air"
+        self.assertCli(
+            self.airspace(["-c", "-q", "--params", MODEL_PARAMS, "-o", frames] + files)
+        )
+
+        result = self.airspace(["-l", frames])
+
+        self.assertCli(
+            result,
+            stdout_exp=b"3 frames",
+            stdout_match_mode="contains",
+        )
+        lines = result.stdout.decode().splitlines()
+        self.assertEqual(6, len(lines))
+        self.assertIn("DIFF       GOLOMB_ZERO", lines[2])
+        self.assertIn("MODEL      GOLOMB_MULTI", lines[3])
+        self.assertIn("1 model chains, 0 broken", lines[5])
+
+        result = self.airspace(["-l", "-q"], stdin=frames.read_bytes())
+        self.assertCli(
+            result, stdout_exp=b"stdin: 3 frames", stdout_match_mode="contains"
+        )
+        self.assertEqual(1, len(result.stdout.splitlines()))
+
+        truncated = self.test_dir / "truncated.air"
+        truncated.write_bytes(frames.read_bytes()[:-1])
+        self.assertCli(
+            self.airspace(["-l", "-q", truncated]),
+            returncode_exp=RETURN_FAILURE,
+            stdout_exp=b"2 frames",
+            stdout_match_mode="contains",
+            stderr_exp=b"invalid frame at offset",
+            stderr_match_mode="contains",
+        )
+
+    def test_list_names_of_archived_frames(self):
+        data_file = self.test_dir / "data.bin"
+        data_file.write_bytes(make_data(0))
+        archive = self.test_dir / "archive.air"
+        self.assertCli(
+            self.airspace(["-c", "-q", "--archive", data_file, "-o", archive])
+        )
+
+        result = self.airspace(["--list", archive])
+
+        self.assertCli(result, stdout_exp=b" data.bin\n", stdout_match_mode="contains")
+
+    def test_model_frame_without_its_model_fails(self):
+        cmp_files, _ = self.compress_files(2, MODEL_PARAMS)
+
+        result = self.airspace([cmp_files[1]])
+
+        self.assertCli(
+            result,
+            returncode_exp=RETURN_FAILURE,
+            stderr_exp="No matching model",
+            stderr_match_mode="contains",
+        )
+
+    def test_corrupted_frame_fails(self):
+        cmp_files, _ = self.compress_files(1, "checksum_enabled=1")
+        data = bytearray(cmp_files[0].read_bytes())
+        data[-5] ^= 0xFF
+        cmp_files[0].write_bytes(data)
+
+        result = self.airspace([cmp_files[0]])
+
+        self.assertCli(
+            result,
+            returncode_exp=RETURN_FAILURE,
+            stderr_exp="Decompression failed",
+            stderr_match_mode="contains",
+        )
+
+    def test_unknown_suffix_fails(self):
+        data_file = self.test_dir / "file.bin"
+        data_file.write_bytes(make_data(0))
+
+        result = self.airspace([data_file])
+
+        self.assertCli(
+            result,
+            returncode_exp=RETURN_FAILURE,
+            stderr_exp="unknown suffix",
+            stderr_match_mode="contains",
+        )
+
+    def test_invalid_number_of_threads(self):
+        for arg in [["-T", "abc"], ["-T", "-1"], ["--threads=100000"]]:
+            with self.subTest(arg=arg):
+                result = self.airspace(arg + ["file.air"])
+
+                self.assertCli(
+                    result,
+                    returncode_exp=RETURN_FAILURE,
+                    stderr_exp="Invalid number of threads",
+                    stderr_match_mode="contains",
+                )
+
+
+if __name__ == "__main__":
+    clitest.main()
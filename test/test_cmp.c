@@ -157,6 +157,49 @@ void test_compression_in_uncompressed_mode(compress_func_t compress_func, const
 }
 
 
+TEST_CASE(compress_u16_wrapper, 0)
+TEST_CASE(compress_i16_wrapper, 0)
+TEST_CASE(compress_u16_be_wrapper, 1)
+void test_uncompressed_frame_is_a_big_endian_copy(compress_func_t compress_func, int src_is_be)
+{
+	enum { NUM_SAMPLES = 37 };
+	uint16_t samples[NUM_SAMPLES];
+	uint8_t be_bytes[2 * NUM_SAMPLES];
+	DST_ALIGNED_U8 dst[CMP_UNCOMPRESSED_BOUND(sizeof(samples))];
+	struct cmp_context ctx;
+	struct cmp_params par = { 0 };
+	struct cmp_hdr hdr;
+	uint32_t cmp_size;
+	size_t i;
+
+	for (i = 0; i < NUM_SAMPLES; i++) {
+		uint16_t const v = (uint16_t)(0x8001 + i * 0x0102);
+
+		be_bytes[2 * i] = (uint8_t)(v >> 8);
+		be_bytes[2 * i + 1] = (uint8_t)v;
+		if (src_is_be)
+			memcpy(&samples[i], &be_bytes[2 * i], sizeof(samples[i]));
+		else
+			samples[i] = v;
+	}
+	par.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	par.primary_preprocessing = CMP_PREPROCESS_NONE;
+	par.checksum_enabled = 1;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &par, NULL, 0));
+
+	cmp_size = compress_func(&ctx, dst, sizeof(dst), samples, sizeof(samples));
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_size);
+	TEST_ASSERT_EQUAL(CMP_HDR_SIZE + sizeof(be_bytes) + CMP_CHECKSUM_SIZE, cmp_size);
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(be_bytes, cmp_hdr_get_cmp_data(dst), sizeof(be_bytes));
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(dst, cmp_size, &hdr));
+	TEST_ASSERT_EQUAL(cmp_size, hdr.compressed_size);
+	/* the source is left untouched */
+	if (!src_is_be)
+		TEST_ASSERT_EQUAL_HEX16(0x8001, samples[0]);
+}
+
+
 TEST_CASE(compress_u16_wrapper, ARRAY_AND_SIZE(test_dummy_u16),
 	  CMP_UNCOMPRESSED_BOUND(sizeof(test_dummy_u16)) - CMP_CHECKSUM_SIZE - 1)
 TEST_CASE(compress_i16_wrapper, ARRAY_AND_SIZE(test_dummy_i16),
@@ -210,7 +253,8 @@ void test_compression_detects_missing_dst_buffer(compress_func_t compress_func,
 }
 
 
-TEST_MATRIX([compress_u16_wrapper, compress_i16_wrapper, compress_i16_in_i32_wrapper])
+TEST_MATRIX([compress_u16_wrapper, compress_i16_wrapper, compress_i16_in_i32_wrapper,
+	     compress_u16_be_wrapper])
 void test_compression_detects_missing_src_data(compress_func_t compress_func)
 {
 	struct cmp_context ctx_uncompressed = create_uncompressed_context();
@@ -224,7 +268,8 @@ void test_compression_detects_missing_src_data(compress_func_t compress_func)
 }
 
 
-TEST_MATRIX([compress_u16_wrapper, compress_i16_wrapper, compress_i16_in_i32_wrapper])
+TEST_MATRIX([compress_u16_wrapper, compress_i16_wrapper, compress_i16_in_i32_wrapper,
+	     compress_u16_be_wrapper])
 void test_compression_detects_src_size_is_0(compress_func_t compress_func)
 {
 	struct cmp_context ctx_uncompressed = create_uncompressed_context();
@@ -237,7 +282,8 @@ void test_compression_detects_src_size_is_0(compress_func_t compress_func)
 }
 
 
-TEST_MATRIX([compress_u16_wrapper, compress_i16_wrapper, compress_i16_in_i32_wrapper])
+TEST_MATRIX([compress_u16_wrapper, compress_i16_wrapper, compress_i16_in_i32_wrapper,
+	     compress_u16_be_wrapper])
 void test_compression_detects_src_size_is_not_multiple_of_2(compress_func_t compress_func)
 {
 	struct cmp_context ctx_uncompressed = create_uncompressed_context();
@@ -476,6 +522,95 @@ void test_bound_size_calculation_detects_too_large_src_size(void)
 }
 
 
+void test_params_bound_is_tight_for_worst_case_data(void)
+{
+	uint64_t dst[5];
+	const uint16_t worst_case_data[2] = { 0xAAAA, 0xBBBB };
+	struct cmp_context ctx;
+	struct cmp_params worst_case_params = { 0 };
+	uint32_t bound;
+
+	worst_case_params.primary_encoder_type = CMP_ENCODER_GOLOMB_MULTI;
+	worst_case_params.primary_encoder_param = 1;
+	worst_case_params.primary_encoder_outlier = 32;
+	worst_case_params.checksum_enabled = 1;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &worst_case_params, NULL, 0));
+
+	bound = cmp_compress_bound_params(&worst_case_params, sizeof(worst_case_data));
+
+	/* the outlier is capped at 24; escape symbol 24+7 -> 32 bit + 16 raw bits */
+	TEST_ASSERT_EQUAL_UINT32(CMP_HDR_MAX_SIZE + 2 * 48 / 8 + CMP_CHECKSUM_SIZE, bound);
+	TEST_ASSERT_LESS_OR_EQUAL(sizeof(dst), bound);
+	TEST_ASSERT_EQUAL_UINT32(bound, cmp_compress_u16(&ctx, dst, bound, worst_case_data,
+							 sizeof(worst_case_data)));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_TOO_SMALL,
+				    cmp_compress_u16(&ctx, dst, bound - 1, worst_case_data,
+						     sizeof(worst_case_data)));
+}
+
+
+void test_params_bound_uses_larger_pass(void)
+{
+	struct cmp_params params = { 0 };
+	uint32_t bound_primary, bound;
+
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 1;
+	bound_primary = cmp_compress_bound_params(&params, 100);
+	/* zero escape: 1 bit escape symbol + 16 raw bits */
+	TEST_ASSERT_EQUAL_UINT32(CMP_HDR_MAX_SIZE + (50 * 17 + 7) / 8, bound_primary);
+
+	params.secondary_iterations = 3;
+	params.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+	params.secondary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.secondary_encoder_param = 1000;
+	bound = cmp_compress_bound_params(&params, 100);
+
+	TEST_ASSERT_CMP_SUCCESS(bound);
+	TEST_ASSERT_GREATER_THAN_UINT32(bound_primary, bound);
+	TEST_ASSERT_LESS_THAN_UINT32(cmp_compress_bound(100), bound);
+}
+
+
+void test_params_bound_is_uncompressed_size_with_fallback(void)
+{
+	struct cmp_params params = { 0 };
+
+	params.primary_preprocessing = CMP_PREPROCESS_IWT;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_MULTI;
+	params.primary_encoder_param = 1;
+	params.primary_encoder_outlier = 2;
+	params.uncompressed_fallback_enabled = 1;
+	TEST_ASSERT_EQUAL_UINT32(CMP_HDR_SIZE + 100, cmp_compress_bound_params(&params, 100));
+
+	params.checksum_enabled = 1;
+	TEST_ASSERT_EQUAL_UINT32(CMP_UNCOMPRESSED_BOUND(100),
+				 cmp_compress_bound_params(&params, 100));
+
+	params.primary_preprocessing = CMP_PREPROCESS_NONE;
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.uncompressed_fallback_enabled = 0;
+	TEST_ASSERT_EQUAL_UINT32(CMP_UNCOMPRESSED_BOUND(100),
+				 cmp_compress_bound_params(&params, 100));
+}
+
+
+void test_params_bound_detects_invalid_input(void)
+{
+	struct cmp_params params = { 0 };
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_GENERIC, cmp_compress_bound_params(NULL, 2));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_HDR_ORIGINAL_TOO_LARGE,
+				    cmp_compress_bound_params(&params,
+							      CMP_HDR_MAX_ORIGINAL_SIZE + 1));
+
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 0;
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID, cmp_compress_bound_params(&params, 2));
+}
+
+
 static uint32_t g_coarse_time;
 static uint16_t g_fine_time;
 static void timestamp_stub(uint32_t *coarse, uint16_t *fine)
@@ -631,6 +766,100 @@ void test_checksum_is_same_for_same_inputs_of_every_compression_function(void)
 }
 
 
+void test_big_endian_samples_give_the_same_frames(void)
+{
+	enum cmp_preprocessing const preprocessings[] = { CMP_PREPROCESS_NONE, CMP_PREPROCESS_DIFF,
+							  CMP_PREPROCESS_IWT };
+	uint16_t data[101];
+	uint8_t data_be[sizeof(data) + 1];
+	struct cmp_params params = { 0 };
+	struct test_env *e, *e_be;
+	uint32_t i, p, size, size_be;
+
+	cmp_set_timestamp_func(constant_timestamp);
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_MULTI;
+	params.primary_encoder_param = 3;
+	params.primary_encoder_outlier = 40;
+	params.secondary_iterations = 2;
+	params.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+	params.secondary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.secondary_encoder_param = 2;
+	params.secondary_encoder_outlier = 20;
+	params.model_rate = 5;
+	params.checksum_enabled = 1;
+
+	for (p = 0; p < ARRAY_SIZE(preprocessings); p++) {
+		params.primary_preprocessing = preprocessings[p];
+		e = make_env(&params, sizeof(data));
+		e_be = make_env(&params, sizeof(data));
+
+		for (i = 0; i < 3 * ARRAY_SIZE(data); i++) {
+			uint32_t const j = i % ARRAY_SIZE(data);
+
+			data[j] = (uint16_t)(0xF000 + (i * 37) % 13 + i / ARRAY_SIZE(data));
+			/* odd address to check that no alignment is needed */
+			data_be[1 + 2 * j] = (uint8_t)(data[j] >> 8);
+			data_be[2 + 2 * j] = (uint8_t)data[j];
+			if (j != ARRAY_SIZE(data) - 1)
+				continue;
+
+			size = cmp_compress_u16(&e->ctx, e->dst, e->dst_cap, data, sizeof(data));
+			size_be = cmp_compress_u16_be(&e_be->ctx, e_be->dst, e_be->dst_cap,
+						      data_be + 1, sizeof(data));
+
+			TEST_ASSERT_CMP_SUCCESS(size);
+			TEST_ASSERT_EQUAL_UINT32(size, size_be);
+			TEST_ASSERT_EQUAL_HEX8_ARRAY(e->dst, e_be->dst, size);
+		}
+		free_env(e);
+		free_env(e_be);
+	}
+	cmp_set_timestamp_func(NULL);
+}
+
+
+void test_big_endian_signed_samples_are_compressed_as_signed(void)
+{
+	const int16_t data[] = { -3, 100, -32768, 32767, 0, -1200 };
+	uint8_t data_be[sizeof(data)];
+	struct cmp_params params = { 0 };
+	struct test_env *e, *e_be;
+	uint32_t i, size, size_be;
+
+	for (i = 0; i < ARRAY_SIZE(data); i++) {
+		data_be[2 * i] = (uint8_t)((uint16_t)data[i] >> 8);
+		data_be[2 * i + 1] = (uint8_t)data[i];
+	}
+	cmp_set_timestamp_func(constant_timestamp);
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 7;
+	params.secondary_iterations = 3;
+	params.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+	params.secondary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.secondary_encoder_param = 7;
+	params.model_rate = 9;
+	params.checksum_enabled = 1;
+	e = make_env(&params, sizeof(data));
+	e_be = make_env(&params, sizeof(data));
+
+	/* the model of signed samples is updated differently than of unsigned ones */
+	for (i = 0; i < 4; i++) {
+		size = cmp_compress_i16(&e->ctx, e->dst, e->dst_cap, data, sizeof(data));
+		size_be = cmp_compress_i16_be(&e_be->ctx, e_be->dst, e_be->dst_cap, data_be,
+					      sizeof(data_be));
+
+		TEST_ASSERT_CMP_SUCCESS(size);
+		TEST_ASSERT_EQUAL_UINT32(size, size_be);
+		TEST_ASSERT_EQUAL_HEX8_ARRAY(e->dst, e_be->dst, size);
+	}
+
+	cmp_set_timestamp_func(NULL);
+	free_env(e);
+	free_env(e_be);
+}
+
+
 TEST_MATRIX([compress_u16_wrapper, compress_i16_wrapper])
 void test_primary_compression_fallback_for_incompressible_data(compress_func_t compress_func)
 {
@@ -55,6 +55,8 @@ static const char *cmp_error_enum_to_str(enum cmp_error error)
 		return "CMP_ERR_PARAMS_INVALID";
 	case CMP_ERR_CONTEXT_INVALID:
 		return "CMP_ERR_CONTEXT_INVALID";
+	case CMP_ERR_STREAM_INVALID:
+		return "CMP_ERR_STREAM_INVALID";
 	case CMP_ERR_WORK_BUF_NULL:
 		return "CMP_ERR_WORK_BUF_NULL";
 	case CMP_ERR_WORK_BUF_TOO_SMALL:
@@ -65,6 +67,8 @@ static const char *cmp_error_enum_to_str(enum cmp_error error)
 		return "CMP_ERR_DST_NULL";
 	case CMP_ERR_DST_UNALIGNED:
 		return "CMP_ERR_DST_UNALIGNED";
+	case CMP_ERR_DST_SINK_FAILED:
+		return "CMP_ERR_DST_SINK_FAILED";
 	case CMP_ERR_SRC_NULL:
 		return "CMP_ERR_SRC_NULL";
 	case CMP_ERR_SRC_SIZE_WRONG:
@@ -79,10 +83,20 @@ static const char *cmp_error_enum_to_str(enum cmp_error error)
 		return "CMP_ERR_INT_ENCODER";
 	case CMP_ERR_INT_BITSTREAM:
 		return "CMP_ERR_INT_BITSTREAM";
+	case CMP_ERR_INT_DECODER:
+		return "CMP_ERR_INT_DECODER";
 	case CMP_ERR_HDR_CMP_SIZE_TOO_LARGE:
 		return "CMP_ERR_HDR_CMP_SIZE_TOO_LARGE";
 	case CMP_ERR_HDR_ORIGINAL_TOO_LARGE:
 		return "CMP_ERR_HDR_ORIGINAL_TOO_LARGE";
+	case CMP_ERR_HDR_VERSION_UNSUPPORTED:
+		return "CMP_ERR_HDR_VERSION_UNSUPPORTED";
+	case CMP_ERR_FRAME_CORRUPTED:
+		return "CMP_ERR_FRAME_CORRUPTED";
+	case CMP_ERR_CHECKSUM_MISMATCH:
+		return "CMP_ERR_CHECKSUM_MISMATCH";
+	case CMP_ERR_MODEL_MISMATCH:
+		return "CMP_ERR_MODEL_MISMATCH";
 	case CMP_ERR_MAX_CODE:
 	default:
 		TEST_FAIL_MESSAGE("Missing error name");
@@ -140,6 +154,26 @@ void *t_malloc(size_t size)
 }
 
 
+void constant_timestamp(uint32_t *coarse, uint16_t *fine)
+{
+	*coarse = 0x12345678;
+	*fine = 0x9ABC;
+}
+
+
+void fill_test_data(uint16_t *data, uint32_t num_samples, uint32_t seed)
+{
+	uint32_t i;
+
+	for (i = 0; i < num_samples; i++) {
+		seed = seed * 1103515245 + 12345;
+		data[i] = (uint16_t)(1000 + i % 17 + ((seed >> 16) & 0x1F));
+		if ((seed >> 8) % 97 == 0)
+			data[i] = (uint16_t)(seed >> 5); /* add an outlier */
+	}
+}
+
+
 /* Create and initialize a test environment with compression context and buffers */
 struct test_env *make_env(struct cmp_params *params, uint32_t src_len)
 {
@@ -200,3 +234,10 @@ uint32_t compress_i16_in_i32_wrapper(struct cmp_context *ctx, void *dst, uint32_
 {
 	return cmp_compress_i16_in_i32(ctx, dst, cap, src, src_size);
 }
+
+
+uint32_t compress_u16_be_wrapper(struct cmp_context *ctx, void *dst, uint32_t cap,
+				 const void *src, uint32_t src_size)
+{
+	return cmp_compress_u16_be(ctx, dst, cap, src, src_size);
+}
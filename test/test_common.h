@@ -126,6 +126,22 @@ const void *cmp_hdr_get_cmp_data(const void *header);
 void *t_malloc(size_t size);
 
 
+/**
+ * Timestamp function for cmp_set_timestamp_func() with a constant time, so
+ * that independent contexts create identical headers.
+ */
+
+void constant_timestamp(uint32_t *coarse, uint16_t *fine);
+
+
+/**
+ * Fills a buffer with pseudo-random samples around 1000 with a few outliers;
+ * the same seed gives the same samples.
+ */
+
+void fill_test_data(uint16_t *data, uint32_t num_samples, uint32_t seed);
+
+
 struct test_env {
 	void *dst;
 	void *work;
@@ -142,6 +158,8 @@ uint32_t compress_i16_wrapper(struct cmp_context *ctx, void *dst, uint32_t cap,
 			      uint32_t n);
 uint32_t compress_i16_in_i32_wrapper(struct cmp_context *ctx, void *dst, uint32_t cap,
 				     const void *src, uint32_t n);
+uint32_t compress_u16_be_wrapper(struct cmp_context *ctx, void *dst, uint32_t cap,
+				 const void *src, uint32_t n);
 
 typedef uint32_t (*compress_func_t)(struct cmp_context *ctx, void *dst, uint32_t dst_capacity,
 				    const void *src, uint32_t src_size);
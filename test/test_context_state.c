@@ -0,0 +1,218 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Compression context save and restore tests
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <unity.h>
+#include "test_common.h"
+
+#include "../lib/cmp.h"
+#include "../lib/cmp_decompress.h"
+#include "../lib/cmp_errors.h"
+
+#define NUM_SAMPLES 300
+
+
+static void make_frame(uint16_t *data, uint32_t frame)
+{
+	uint32_t i;
+
+	for (i = 0; i < NUM_SAMPLES; i++)
+		data[i] = (uint16_t)(2000 + 3 * i + (i * 7 + frame * 13) % 5);
+}
+
+
+static void set_model_params(struct cmp_params *params)
+{
+	memset(params, 0, sizeof(*params));
+	params->primary_preprocessing = CMP_PREPROCESS_IWT;
+	params->primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params->primary_encoder_param = 4;
+	params->secondary_iterations = 5;
+	params->secondary_preprocessing = CMP_PREPROCESS_MODEL;
+	params->secondary_encoder_type = CMP_ENCODER_GOLOMB_MULTI;
+	params->secondary_encoder_param = 2;
+	params->secondary_encoder_outlier = 12;
+	params->model_rate = 10;
+	params->checksum_enabled = 1;
+}
+
+
+void test_restored_context_continues_the_chain(void)
+{
+	uint16_t data[NUM_SAMPLES];
+	uint16_t out[NUM_SAMPLES];
+	uint16_t model_buf[NUM_SAMPLES];
+	uint8_t state[CMP_CONTEXT_STATE_HDR_SIZE + sizeof(data) + CMP_CHECKSUM_SIZE];
+	struct cmp_decompress_context dctx;
+	struct cmp_params params;
+	struct test_env *env, *standby;
+	uint32_t i, state_size;
+
+	set_model_params(&params);
+	env = make_env(&params, sizeof(data));
+	standby = make_env(&params, sizeof(data));
+	TEST_ASSERT_CMP_SUCCESS(cmp_decompress_initialise(&dctx, model_buf, sizeof(model_buf)));
+
+	for (i = 0; i < 4; i++) {
+		uint32_t cmp_size;
+
+		make_frame(data, i);
+		if (i < 2) {
+			cmp_size = cmp_compress_u16(&env->ctx, env->dst, env->dst_cap, data,
+						    sizeof(data));
+		} else {
+			uint32_t const standby_size = cmp_compress_u16(&standby->ctx, standby->dst,
+								       standby->dst_cap, data,
+								       sizeof(data));
+
+			/* both contexts produce the same frames */
+			cmp_size = cmp_compress_u16(&env->ctx, env->dst, env->dst_cap, data,
+						    sizeof(data));
+			TEST_ASSERT_EQUAL(cmp_size, standby_size);
+			TEST_ASSERT_EQUAL_HEX8_ARRAY(env->dst, standby->dst, cmp_size);
+		}
+		TEST_ASSERT_CMP_SUCCESS(cmp_size);
+		TEST_ASSERT_EQUAL(sizeof(data), cmp_decompress_u16(&dctx, out, sizeof(out),
+								   env->dst, cmp_size));
+		TEST_ASSERT_EQUAL_HEX16_ARRAY(data, out, NUM_SAMPLES);
+
+		if (i == 1) {
+			TEST_ASSERT_EQUAL(sizeof(state), cmp_context_save_bound(&env->ctx));
+			state_size = cmp_context_save(&env->ctx, state, sizeof(state));
+			TEST_ASSERT_EQUAL(sizeof(state), state_size);
+			TEST_ASSERT_CMP_SUCCESS(cmp_context_restore(&standby->ctx, state,
+								    state_size));
+		}
+	}
+
+	cmp_decompress_deinitialise(&dctx);
+	free_env(standby);
+	free_env(env);
+}
+
+
+void test_state_before_the_first_frame_has_no_model(void)
+{
+	uint8_t state[CMP_CONTEXT_STATE_HDR_SIZE];
+	struct cmp_params params;
+	struct test_env *env;
+
+	set_model_params(&params);
+	env = make_env(&params, NUM_SAMPLES * sizeof(uint16_t));
+
+	TEST_ASSERT_EQUAL(CMP_CONTEXT_STATE_HDR_SIZE, cmp_context_save_bound(&env->ctx));
+	TEST_ASSERT_EQUAL(CMP_CONTEXT_STATE_HDR_SIZE,
+			  cmp_context_save(&env->ctx, state, sizeof(state)));
+	TEST_ASSERT_CMP_SUCCESS(cmp_context_restore(&env->ctx, state, sizeof(state)));
+	free_env(env);
+}
+
+
+void test_restore_detects_invalid_states(void)
+{
+	uint16_t data[NUM_SAMPLES];
+	uint8_t state[CMP_CONTEXT_STATE_HDR_SIZE + sizeof(data) + CMP_CHECKSUM_SIZE];
+	uint8_t broken[sizeof(state)];
+	struct cmp_params params, diff_params;
+	struct test_env *env, *diff_env;
+	struct cmp_frame_info info;
+	uint32_t state_size, cmp_size;
+
+	set_model_params(&params);
+	env = make_env(&params, sizeof(data));
+	make_frame(data, 0);
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_u16(&env->ctx, env->dst, env->dst_cap, data,
+						 sizeof(data)));
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_TOO_SMALL,
+				    cmp_context_save(&env->ctx, state, sizeof(state) - 1));
+	state_size = cmp_context_save(&env->ctx, state, sizeof(state));
+	TEST_ASSERT_CMP_SUCCESS(state_size);
+
+	memcpy(broken, state, state_size);
+	broken[0] ^= 1;
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_FRAME_CORRUPTED,
+				    cmp_context_restore(&env->ctx, broken, state_size));
+	memcpy(broken, state, state_size);
+	broken[4]++;
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_HDR_VERSION_UNSUPPORTED,
+				    cmp_context_restore(&env->ctx, broken, state_size));
+	memcpy(broken, state, state_size);
+	broken[5] |= 0x80;
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_FRAME_CORRUPTED,
+				    cmp_context_restore(&env->ctx, broken, state_size));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_SIZE_WRONG,
+				    cmp_context_restore(&env->ctx, state, state_size - 1));
+
+	/* a corrupted model resets the context, so a primary frame follows */
+	memcpy(broken, state, state_size);
+	broken[CMP_CONTEXT_STATE_HDR_SIZE + 10] ^= 0x40;
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_CHECKSUM_MISMATCH,
+				    cmp_context_restore(&env->ctx, broken, state_size));
+	cmp_size = cmp_compress_u16(&env->ctx, env->dst, env->dst_cap, data, sizeof(data));
+	TEST_ASSERT_CMP_SUCCESS(cmp_get_frame_info(env->dst, cmp_size, &info));
+	TEST_ASSERT_EQUAL(0, info.sequence_number);
+
+	/* a chain without a model can not be continued with a model */
+	memset(&diff_params, 0, sizeof(diff_params));
+	diff_params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	diff_params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	diff_params.primary_encoder_param = 4;
+	diff_params.secondary_iterations = 3;
+	diff_params.secondary_preprocessing = CMP_PREPROCESS_DIFF;
+	diff_params.secondary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	diff_params.secondary_encoder_param = 4;
+	diff_env = make_env(&diff_params, sizeof(data));
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_u16(&diff_env->ctx, diff_env->dst,
+						 diff_env->dst_cap, data, sizeof(data)));
+	state_size = cmp_context_save(&diff_env->ctx, state, sizeof(state));
+	TEST_ASSERT_EQUAL(CMP_CONTEXT_STATE_HDR_SIZE, state_size);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID,
+				    cmp_context_restore(&env->ctx, state, state_size));
+
+	free_env(diff_env);
+	free_env(env);
+}
+
+
+void test_restored_context_keeps_the_loaded_model(void)
+{
+	uint16_t reference[NUM_SAMPLES];
+	uint16_t data[NUM_SAMPLES];
+	uint8_t state[CMP_CONTEXT_STATE_HDR_SIZE + sizeof(data) + CMP_CHECKSUM_SIZE];
+	struct cmp_params params;
+	struct test_env *env, *standby;
+	struct cmp_frame_info info;
+	uint32_t cmp_size;
+
+	set_model_params(&params);
+	env = make_env(&params, sizeof(data));
+	standby = make_env(&params, sizeof(data));
+	make_frame(reference, 7);
+	TEST_ASSERT_CMP_SUCCESS(cmp_load_model_u16(&env->ctx, reference, sizeof(reference),
+						   0xCA11B2A7E5ULL));
+
+	TEST_ASSERT_EQUAL(sizeof(state), cmp_context_save(&env->ctx, state, sizeof(state)));
+	TEST_ASSERT_CMP_SUCCESS(cmp_context_restore(&standby->ctx, state, sizeof(state)));
+
+	make_frame(data, 0);
+	cmp_size = cmp_compress_u16(&standby->ctx, standby->dst, standby->dst_cap, data,
+				    sizeof(data));
+	TEST_ASSERT_CMP_SUCCESS(cmp_get_frame_info(standby->dst, cmp_size, &info));
+	TEST_ASSERT_EQUAL(1, info.sequence_number);
+	TEST_ASSERT_TRUE(info.model_preloaded);
+	TEST_ASSERT_EQUAL(cmp_size, cmp_compress_u16(&env->ctx, env->dst, env->dst_cap, data,
+						     sizeof(data)));
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(env->dst, standby->dst, cmp_size);
+
+	free_env(standby);
+	free_env(env);
+}
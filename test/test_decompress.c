@@ -0,0 +1,579 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Decompression tests
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <unity.h>
+#include "test_common.h"
+
+#include "../lib/cmp.h"
+#include "../lib/cmp_decompress.h"
+#include "../lib/cmp_errors.h"
+#include "../lib/common/header_private.h"
+
+
+static struct cmp_decompress_context dctx;
+
+
+static uint32_t compress_frame(struct test_env *env, const uint16_t *data, uint32_t size)
+{
+	uint32_t const cmp_size = cmp_compress_u16(&env->ctx, env->dst, env->dst_cap, data, size);
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_size);
+	return cmp_size;
+}
+
+
+TEST_CASE(CMP_PREPROCESS_NONE, CMP_ENCODER_UNCOMPRESSED, 1, 0)
+TEST_CASE(CMP_PREPROCESS_NONE, CMP_ENCODER_GOLOMB_ZERO, 1, 0)
+TEST_CASE(CMP_PREPROCESS_DIFF, CMP_ENCODER_GOLOMB_ZERO, 4, 0)
+TEST_CASE(CMP_PREPROCESS_DIFF, CMP_ENCODER_GOLOMB_MULTI, 7, 9)
+TEST_CASE(CMP_PREPROCESS_DIFF, CMP_ENCODER_UNCOMPRESSED, 1, 0)
+TEST_CASE(CMP_PREPROCESS_IWT, CMP_ENCODER_GOLOMB_MULTI, 16, 60)
+TEST_CASE(CMP_PREPROCESS_IWT, CMP_ENCODER_GOLOMB_ZERO, 3, 0)
+void test_round_trip_with_model(enum cmp_preprocessing preprocessing,
+				enum cmp_encoder_type encoder_type, int param, int outlier)
+{
+	uint16_t data[1001];
+	uint16_t out[ARRAY_SIZE(data)];
+	struct cmp_params params = { 0 };
+	struct test_env *env;
+	uint32_t i;
+
+	params.primary_preprocessing = preprocessing;
+	params.primary_encoder_type = encoder_type;
+	params.primary_encoder_param = (uint32_t)param;
+	params.primary_encoder_outlier = (uint32_t)outlier;
+	params.secondary_iterations = 3;
+	params.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+	params.secondary_encoder_type = CMP_ENCODER_GOLOMB_MULTI;
+	params.secondary_encoder_param = 2;
+	params.secondary_encoder_outlier = 16;
+	params.model_rate = 11;
+	params.checksum_enabled = 1;
+	env = make_env(&params, sizeof(data));
+	TEST_ASSERT_CMP_SUCCESS(
+		cmp_decompress_initialise(&dctx, t_malloc(sizeof(data)), sizeof(data)));
+
+	for (i = 0; i < 9; i++) {
+		uint32_t cmp_size, size;
+
+		fill_test_data(data, ARRAY_SIZE(data), i);
+		cmp_size = compress_frame(env, data, sizeof(data));
+
+		TEST_ASSERT_EQUAL(sizeof(data), cmp_get_original_size(env->dst, cmp_size));
+		TEST_ASSERT_EQUAL(cmp_size, cmp_get_compressed_size(env->dst, cmp_size));
+		memset(out, 0, sizeof(out));
+		size = cmp_decompress_u16(&dctx, out, sizeof(out), env->dst, cmp_size);
+		TEST_ASSERT_EQUAL(sizeof(data), size);
+		TEST_ASSERT_EQUAL_HEX16_ARRAY(data, out, ARRAY_SIZE(data));
+	}
+
+	free(dctx.work_buf);
+	free_env(env);
+}
+
+
+TEST_CASE(CMP_PREPROCESS_NONE)
+TEST_CASE(CMP_PREPROCESS_DIFF)
+TEST_CASE(CMP_PREPROCESS_IWT)
+void test_round_trip_i16_in_i32_with_model(enum cmp_preprocessing preprocessing)
+{
+	int32_t data[999];
+	int32_t out[ARRAY_SIZE(data)];
+	struct cmp_params params = { 0 };
+	struct test_env *env;
+	uint32_t i, j, seed = 7;
+
+	params.primary_preprocessing = preprocessing;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_MULTI;
+	params.primary_encoder_param = 8;
+	params.primary_encoder_outlier = 40;
+	params.secondary_iterations = 2;
+	params.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+	params.secondary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.secondary_encoder_param = 4;
+	params.model_rate = 5;
+	params.checksum_enabled = 1;
+	env = make_env(&params, ARRAY_SIZE(data) * sizeof(int16_t));
+	TEST_ASSERT_CMP_SUCCESS(cmp_decompress_initialise(
+		&dctx, t_malloc(ARRAY_SIZE(data) * sizeof(int16_t)),
+		ARRAY_SIZE(data) * sizeof(int16_t)));
+
+	for (i = 0; i < 3; i++) {
+		uint32_t cmp_size;
+
+		/* negative samples check the sign extension */
+		for (j = 0; j < ARRAY_SIZE(data); j++) {
+			seed = seed * 1103515245 + 12345;
+			data[j] = (int16_t)((int32_t)(j * 16) - 8000 + (int32_t)(seed >> 28));
+		}
+		data[0] = INT16_MIN;
+		data[1] = INT16_MAX;
+		cmp_size = cmp_compress_i16_in_i32(&env->ctx, env->dst, env->dst_cap, data,
+						   sizeof(data));
+		TEST_ASSERT_CMP_SUCCESS(cmp_size);
+
+		memset(out, 0xA5, sizeof(out));
+		TEST_ASSERT_EQUAL(sizeof(out), cmp_decompress_i16_in_i32(&dctx, out, sizeof(out),
+									 env->dst, cmp_size));
+		TEST_ASSERT_EQUAL_INT32_ARRAY(data, out, ARRAY_SIZE(data));
+	}
+
+	free(dctx.work_buf);
+	free_env(env);
+}
+
+
+TEST_CASE(1)
+TEST_CASE(2)
+TEST_CASE(3)
+TEST_CASE(4)
+TEST_CASE(7)
+TEST_CASE(8)
+TEST_CASE(9)
+TEST_CASE(255)
+TEST_CASE(256)
+TEST_CASE(1234)
+TEST_CASE(32767)
+TEST_CASE(65535)
+void test_round_trip_golomb_parameter(int param)
+{
+	int16_t data[2000];
+	int16_t out[ARRAY_SIZE(data)];
+	int32_t data32[ARRAY_SIZE(data)];
+	int32_t out32[ARRAY_SIZE(data)];
+	enum cmp_encoder_type encoder_type;
+	uint32_t i, seed = (uint32_t)param;
+
+	/* small values with some outliers over the whole range */
+	for (i = 0; i < ARRAY_SIZE(data); i++) {
+		seed = seed * 1103515245 + 12345;
+		if (i % 50 == 0)
+			data[i] = (int16_t)(seed >> 8);
+		else
+			data[i] = (int16_t)((int32_t)((seed >> 16) % (uint32_t)(2 * param + 1)) - param);
+		data32[i] = data[i];
+	}
+	data[0] = INT16_MIN;
+	data[1] = INT16_MAX;
+
+	for (encoder_type = CMP_ENCODER_GOLOMB_ZERO; encoder_type <= CMP_ENCODER_GOLOMB_MULTI;
+	     encoder_type++) {
+		struct cmp_params params = { 0 };
+		struct test_env *env;
+		uint32_t cmp_size;
+
+		params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+		params.primary_encoder_type = encoder_type;
+		params.primary_encoder_param = (uint32_t)param;
+		params.primary_encoder_outlier = (uint32_t)param * 3 + 1;
+		env = make_env(&params, sizeof(data));
+		TEST_ASSERT_CMP_SUCCESS(cmp_decompress_initialise(&dctx, NULL, 0));
+
+		cmp_size = cmp_compress_i16(&env->ctx, env->dst, env->dst_cap, data, sizeof(data));
+		TEST_ASSERT_CMP_SUCCESS(cmp_size);
+		TEST_ASSERT_EQUAL(sizeof(out),
+				  cmp_decompress_i16(&dctx, out, sizeof(out), env->dst, cmp_size));
+		TEST_ASSERT_EQUAL_INT16_ARRAY(data, out, ARRAY_SIZE(data));
+
+		cmp_size = cmp_compress_i16_in_i32(&env->ctx, env->dst, env->dst_cap, data32,
+						   sizeof(data32));
+		TEST_ASSERT_CMP_SUCCESS(cmp_size);
+		TEST_ASSERT_EQUAL(sizeof(out32), cmp_decompress_i16_in_i32(&dctx, out32,
+									   sizeof(out32), env->dst,
+									   cmp_size));
+		TEST_ASSERT_EQUAL_INT32_ARRAY(data32, out32, ARRAY_SIZE(data32));
+
+		free_env(env);
+	}
+}
+
+
+TEST_CASE(1)
+TEST_CASE(2)
+TEST_CASE(3)
+TEST_CASE(5)
+TEST_CASE(64)
+TEST_CASE(1023)
+void test_round_trip_iwt_frame_sizes(int num_samples)
+{
+	uint16_t data[1023];
+	uint16_t out[ARRAY_SIZE(data)];
+	uint32_t const size = (uint32_t)num_samples * sizeof(data[0]);
+	struct cmp_params params = { 0 };
+	struct test_env *env;
+	uint32_t cmp_size;
+
+	fill_test_data(data, ARRAY_SIZE(data), 42);
+
+	params.primary_preprocessing = CMP_PREPROCESS_IWT;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 6;
+	env = make_env(&params, size);
+	TEST_ASSERT_CMP_SUCCESS(cmp_decompress_initialise(&dctx, NULL, 0));
+
+	cmp_size = compress_frame(env, data, size);
+	memset(out, 0, sizeof(out));
+	TEST_ASSERT_EQUAL(size, cmp_decompress_u16(&dctx, out, size, env->dst, cmp_size));
+	TEST_ASSERT_EQUAL_HEX16_ARRAY(data, out, num_samples);
+
+	free_env(env);
+}
+
+
+void test_round_trip_uncompressed_fallback(void)
+{
+	uint16_t data[300];
+	uint16_t out[ARRAY_SIZE(data)];
+	struct cmp_params params = { 0 };
+	struct test_env *env;
+	struct cmp_hdr hdr;
+	uint32_t cmp_size, i;
+
+	/* random data does not compress */
+	for (i = 0; i < ARRAY_SIZE(data); i++)
+		data[i] = (uint16_t)(i * 40503U);
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 1;
+	params.uncompressed_fallback_enabled = 1;
+	params.checksum_enabled = 1;
+	env = make_env(&params, sizeof(data));
+	TEST_ASSERT_CMP_SUCCESS(cmp_decompress_initialise(&dctx, NULL, 0));
+
+	cmp_size = compress_frame(env, data, sizeof(data));
+	TEST_ASSERT_CMP_SUCCESS(cmp_hdr_deserialize(env->dst, cmp_size, &hdr));
+	TEST_ASSERT_EQUAL(CMP_ENCODER_UNCOMPRESSED, hdr.encoder_type);
+
+	TEST_ASSERT_EQUAL(sizeof(data),
+			  cmp_decompress_u16(&dctx, out, sizeof(out), env->dst, cmp_size));
+	TEST_ASSERT_EQUAL_HEX16_ARRAY(data, out, ARRAY_SIZE(data));
+
+	free_env(env);
+}
+
+
+void test_decompress_detects_corrupted_frames(void)
+{
+	uint16_t data[200];
+	uint16_t out[ARRAY_SIZE(data)];
+	struct cmp_params params = { 0 };
+	struct test_env *env;
+	uint8_t *frame;
+	uint32_t cmp_size;
+
+	fill_test_data(data, ARRAY_SIZE(data), 7);
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_MULTI;
+	params.primary_encoder_param = 4;
+	params.primary_encoder_outlier = 20;
+	params.checksum_enabled = 1;
+	env = make_env(&params, sizeof(data));
+	frame = env->dst;
+	TEST_ASSERT_CMP_SUCCESS(cmp_decompress_initialise(&dctx, NULL, 0));
+	cmp_size = compress_frame(env, data, sizeof(data));
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_SIZE_WRONG,
+				    cmp_decompress_u16(&dctx, out, sizeof(out), frame,
+						       cmp_size - 1));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_TOO_SMALL,
+				    cmp_decompress_u16(&dctx, out, sizeof(out) - 1, frame,
+						       cmp_size));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_NULL,
+				    cmp_decompress_u16(&dctx, out, sizeof(out), NULL, cmp_size));
+
+	/* a flipped bit in the encoded data */
+	frame[CMP_HDR_MAX_SIZE + 10] ^= 0x10;
+	TEST_ASSERT_CMP_FAILURE(cmp_decompress_u16(&dctx, out, sizeof(out), frame, cmp_size));
+	frame[CMP_HDR_MAX_SIZE + 10] ^= 0x10;
+
+	/* a flipped bit in the checksum */
+	frame[cmp_size - 1] ^= 0x01;
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_CHECKSUM_MISMATCH,
+				    cmp_decompress_u16(&dctx, out, sizeof(out), frame, cmp_size));
+	frame[cmp_size - 1] ^= 0x01;
+
+	/* an unknown version */
+	frame[CMP_HDR_OFFSET_VERSION + 1] ^= 0x01;
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_HDR_VERSION_UNSUPPORTED,
+				    cmp_decompress_u16(&dctx, out, sizeof(out), frame, cmp_size));
+	frame[CMP_HDR_OFFSET_VERSION + 1] ^= 0x01;
+
+	TEST_ASSERT_EQUAL(sizeof(data), cmp_decompress_u16(&dctx, out, sizeof(out), frame,
+							   cmp_size));
+	TEST_ASSERT_EQUAL_HEX16_ARRAY(data, out, ARRAY_SIZE(data));
+
+	free_env(env);
+}
+
+
+void test_decompress_model_frame_needs_its_model(void)
+{
+	uint16_t data[100];
+	uint16_t out[ARRAY_SIZE(data)];
+	uint16_t model_buf[ARRAY_SIZE(data)];
+	struct cmp_params params = { 0 };
+	struct test_env *env;
+	uint8_t primary[512], secondary[512];
+	uint32_t primary_size, secondary_size;
+
+	fill_test_data(data, ARRAY_SIZE(data), 3);
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 4;
+	params.secondary_iterations = 5;
+	params.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+	params.secondary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.secondary_encoder_param = 2;
+	params.model_rate = 8;
+	env = make_env(&params, sizeof(data));
+
+	primary_size = compress_frame(env, data, sizeof(data));
+	TEST_ASSERT_LESS_OR_EQUAL(sizeof(primary), primary_size);
+	memcpy(primary, env->dst, primary_size);
+	secondary_size = compress_frame(env, data, sizeof(data));
+	TEST_ASSERT_LESS_OR_EQUAL(sizeof(secondary), secondary_size);
+	memcpy(secondary, env->dst, secondary_size);
+
+	/* no work buffer to store the model */
+	TEST_ASSERT_CMP_SUCCESS(cmp_decompress_initialise(&dctx, NULL, 0));
+	TEST_ASSERT_CMP_SUCCESS(cmp_decompress_u16(&dctx, out, sizeof(out), primary,
+						   primary_size));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_MODEL_MISMATCH,
+				    cmp_decompress_u16(&dctx, out, sizeof(out), secondary,
+						       secondary_size));
+
+	/* model frame without the primary frame */
+	TEST_ASSERT_CMP_SUCCESS(cmp_decompress_initialise(&dctx, model_buf, sizeof(model_buf)));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_MODEL_MISMATCH,
+				    cmp_decompress_u16(&dctx, out, sizeof(out), secondary,
+						       secondary_size));
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_decompress_u16(&dctx, out, sizeof(out), primary,
+						   primary_size));
+	TEST_ASSERT_EQUAL(sizeof(data), cmp_decompress_u16(&dctx, out, sizeof(out), secondary,
+							   secondary_size));
+	TEST_ASSERT_EQUAL_HEX16_ARRAY(data, out, ARRAY_SIZE(data));
+
+	/* the same model frame cannot be applied twice */
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_MODEL_MISMATCH,
+				    cmp_decompress_u16(&dctx, out, sizeof(out), secondary,
+						       secondary_size));
+
+	/* after a reset the model is gone */
+	TEST_ASSERT_CMP_SUCCESS(cmp_decompress_u16(&dctx, out, sizeof(out), primary,
+						   primary_size));
+	TEST_ASSERT_CMP_SUCCESS(cmp_decompress_reset(&dctx));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_MODEL_MISMATCH,
+				    cmp_decompress_u16(&dctx, out, sizeof(out), secondary,
+						       secondary_size));
+
+	cmp_decompress_deinitialise(&dctx);
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_CONTEXT_INVALID,
+				    cmp_decompress_u16(&dctx, out, sizeof(out), primary,
+						       primary_size));
+	free_env(env);
+}
+
+
+void test_round_trip_with_a_preloaded_model(void)
+{
+	uint64_t const reference_id = 0xCA11B2A7E5ULL;
+	uint16_t reference[200];
+	uint16_t data[ARRAY_SIZE(reference)];
+	uint16_t out[ARRAY_SIZE(data)];
+	uint8_t frames[5][1024];
+	uint32_t frame_sizes[ARRAY_SIZE(frames)];
+	struct cmp_params params = { 0 };
+	struct cmp_frame_info info;
+	struct test_env *env;
+	uint32_t i;
+
+	params.primary_preprocessing = CMP_PREPROCESS_IWT;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_MULTI;
+	params.primary_encoder_param = 6;
+	params.primary_encoder_outlier = 20;
+	params.secondary_iterations = 3;
+	params.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+	params.secondary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.secondary_encoder_param = 2;
+	params.model_rate = 11;
+	params.checksum_enabled = 1;
+	env = make_env(&params, sizeof(data));
+	fill_test_data(reference, ARRAY_SIZE(reference), 42);
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID,
+				    cmp_load_model_u16(&env->ctx, reference, sizeof(reference),
+						       1ULL << CMP_HDR_BITS_IDENTIFIER));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_SIZE_WRONG,
+				    cmp_load_model_u16(&env->ctx, reference, 3, reference_id));
+	TEST_ASSERT_CMP_SUCCESS(cmp_load_model_u16(&env->ctx, reference, sizeof(reference),
+						   reference_id));
+
+	/* the chain starts with model frames; a primary frame follows it */
+	for (i = 0; i < ARRAY_SIZE(frames); i++) {
+		fill_test_data(data, ARRAY_SIZE(data), i);
+		frame_sizes[i] = compress_frame(env, data, sizeof(data));
+		TEST_ASSERT_LESS_OR_EQUAL(sizeof(frames[i]), frame_sizes[i]);
+		memcpy(frames[i], env->dst, frame_sizes[i]);
+
+		TEST_ASSERT_CMP_SUCCESS(cmp_get_frame_info(frames[i], frame_sizes[i], &info));
+		if (i < params.secondary_iterations) {
+			TEST_ASSERT_EQUAL(CMP_PREPROCESS_MODEL, info.preprocessing);
+			TEST_ASSERT_EQUAL(i + 1, info.sequence_number);
+			TEST_ASSERT_TRUE(info.identifier == reference_id);
+			TEST_ASSERT_TRUE(info.model_preloaded);
+		} else {
+			/* the primary frame starts a new chain with a new identifier */
+			TEST_ASSERT_EQUAL(i == params.secondary_iterations ? CMP_PREPROCESS_IWT
+									   : CMP_PREPROCESS_MODEL,
+					  info.preprocessing);
+			TEST_ASSERT_EQUAL(i - params.secondary_iterations, info.sequence_number);
+			TEST_ASSERT_TRUE(info.identifier != reference_id);
+			TEST_ASSERT_FALSE(info.model_preloaded);
+		}
+	}
+
+	/* without the reference the model is missing */
+	TEST_ASSERT_CMP_SUCCESS(
+		cmp_decompress_initialise(&dctx, t_malloc(sizeof(data)), sizeof(data)));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_MODEL_MISMATCH,
+				    cmp_decompress_u16(&dctx, out, sizeof(out), frames[0],
+						       frame_sizes[0]));
+	/* nor does a reference with another identifier fit */
+	TEST_ASSERT_CMP_SUCCESS(cmp_decompress_load_model_u16(&dctx, reference, sizeof(reference),
+							      reference_id + 1));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_MODEL_MISMATCH,
+				    cmp_decompress_u16(&dctx, out, sizeof(out), frames[0],
+						       frame_sizes[0]));
+
+	/* a model frame without the preloaded model flag does not fit a loaded model */
+	TEST_ASSERT_CMP_SUCCESS(cmp_decompress_load_model_u16(&dctx, reference, sizeof(reference),
+							      reference_id));
+	frames[0][CMP_HDR_OFFSET_METHOD] ^= CMP_HDR_METHOD_MODEL_PRELOADED_FLAG;
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_MODEL_MISMATCH,
+				    cmp_decompress_u16(&dctx, out, sizeof(out), frames[0],
+						       frame_sizes[0]));
+	frames[0][CMP_HDR_OFFSET_METHOD] ^= CMP_HDR_METHOD_MODEL_PRELOADED_FLAG;
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_decompress_load_model_u16(&dctx, reference, sizeof(reference),
+							      reference_id));
+	for (i = 0; i < ARRAY_SIZE(frames); i++) {
+		fill_test_data(data, ARRAY_SIZE(data), i);
+		memset(out, 0, sizeof(out));
+		TEST_ASSERT_EQUAL(sizeof(data), cmp_decompress_u16(&dctx, out, sizeof(out),
+								   frames[i], frame_sizes[i]));
+		TEST_ASSERT_EQUAL_HEX16_ARRAY(data, out, ARRAY_SIZE(data));
+	}
+
+	/* the reference has to fit into the working buffer */
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_WORK_BUF_TOO_SMALL,
+				    cmp_decompress_load_model_u16(&dctx, reference,
+								  dctx.work_buf_size + 2,
+								  reference_id));
+
+	free(dctx.work_buf);
+	free_env(env);
+}
+
+
+void test_load_model_needs_model_preprocessing(void)
+{
+	uint16_t reference[8] = { 0 };
+	struct cmp_params params = { 0 };
+	struct test_env *env;
+
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 4;
+	env = make_env(&params, sizeof(reference));
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID,
+				    cmp_load_model_u16(&env->ctx, reference, sizeof(reference),
+						       1));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_GENERIC,
+				    cmp_load_model_i16(NULL, NULL, sizeof(reference), 1));
+	free_env(env);
+}
+
+void test_frame_iterator_walks_concatenated_frames(void)
+{
+	uint16_t data[100];
+	uint8_t stream[3 * 512];
+	uint32_t frame_size[3];
+	struct cmp_params params = { 0 };
+	struct cmp_frame_iterator it;
+	struct cmp_frame_info info;
+	struct test_env *env;
+	size_t stream_size = 0;
+	uint32_t i;
+
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 4;
+	params.secondary_iterations = 2;
+	params.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+	params.secondary_encoder_type = CMP_ENCODER_GOLOMB_MULTI;
+	params.secondary_encoder_param = 3;
+	params.secondary_encoder_outlier = 20;
+	params.model_rate = 5;
+	params.checksum_enabled = 1;
+	env = make_env(&params, sizeof(data));
+	for (i = 0; i < 3; i++) {
+		fill_test_data(data, ARRAY_SIZE(data), i);
+		frame_size[i] = compress_frame(env, data, sizeof(data));
+		TEST_ASSERT_LESS_OR_EQUAL(sizeof(stream) - stream_size, frame_size[i]);
+		memcpy(stream + stream_size, env->dst, frame_size[i]);
+		stream_size += frame_size[i];
+	}
+
+	cmp_frame_iterator_init(&it, stream, stream_size);
+	stream_size = 0;
+	for (i = 0; i < 3; i++) {
+		TEST_ASSERT_EQUAL(frame_size[i], cmp_frame_iterator_next(&it, &info));
+		TEST_ASSERT_EQUAL(stream_size, info.offset);
+		TEST_ASSERT_EQUAL(frame_size[i], info.compressed_size);
+		TEST_ASSERT_EQUAL(sizeof(data), info.original_size);
+		TEST_ASSERT_EQUAL(i, info.sequence_number);
+		TEST_ASSERT_TRUE(info.checksum_enabled);
+		if (i == 0) {
+			TEST_ASSERT_EQUAL(CMP_PREPROCESS_DIFF, info.preprocessing);
+			TEST_ASSERT_EQUAL(CMP_ENCODER_GOLOMB_ZERO, info.encoder_type);
+			TEST_ASSERT_EQUAL(4, info.encoder_param);
+		} else {
+			TEST_ASSERT_EQUAL(CMP_PREPROCESS_MODEL, info.preprocessing);
+			TEST_ASSERT_EQUAL(CMP_ENCODER_GOLOMB_MULTI, info.encoder_type);
+			TEST_ASSERT_EQUAL(3, info.encoder_param);
+			TEST_ASSERT_EQUAL(20, info.encoder_outlier);
+			TEST_ASSERT_EQUAL(5, info.model_rate);
+		}
+		stream_size += frame_size[i];
+	}
+	TEST_ASSERT_EQUAL(0, cmp_frame_iterator_next(&it, &info));
+	TEST_ASSERT_EQUAL(0, cmp_frame_iterator_next(&it, &info));
+
+	/* a truncated last frame is an error, which sticks */
+	cmp_frame_iterator_init(&it, stream, stream_size - 1);
+	TEST_ASSERT_EQUAL(frame_size[0], cmp_frame_iterator_next(&it, &info));
+	TEST_ASSERT_EQUAL(frame_size[1], cmp_frame_iterator_next(&it, &info));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_SIZE_WRONG, cmp_frame_iterator_next(&it, &info));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_SIZE_WRONG, cmp_frame_iterator_next(&it, &info));
+
+	/* a cut header */
+	TEST_ASSERT_TRUE(cmp_is_error(cmp_get_frame_info(stream, CMP_HDR_SIZE - 1, &info)));
+
+	/* an empty stream has no frames */
+	cmp_frame_iterator_init(&it, NULL, 0);
+	TEST_ASSERT_EQUAL(0, cmp_frame_iterator_next(&it, &info));
+
+	free_env(env);
+}
@@ -16,6 +16,7 @@
 #include "../lib/cmp_errors.h"
 #include "../lib/common/header_private.h"
 #include "../lib/common/bitstream_writer.h"
+#include "../lib/common/byteorder_bulk.h"
 
 
 void test_bitstream_write_nothing(void)
@@ -103,6 +104,88 @@ void test_detect_bitstream_overflow(void)
 }
 
 
+void test_bitstream_raw_bytes_between_bits(void)
+{
+	uint32_t size;
+	uint8_t *raw;
+	struct bitstream_writer bsw;
+	DST_ALIGNED_U8 buffer[16];
+	uint8_t const raw_bytes[] = { 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18 };
+	uint8_t const expected_bs[] = { 0xAB, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+					0x16, 0x17, 0x18, 0xCD, 0xEF };
+
+	memset(buffer, 0xFF, sizeof(buffer));
+	TEST_ASSERT_CMP_SUCCESS(bitstream_writer_init(&bsw, buffer, sizeof(buffer)));
+
+	bitstream_add_bits32(&bsw, 0xAB, 8);
+	raw = bitstream_raw_begin(&bsw, sizeof(raw_bytes));
+	TEST_ASSERT_NOT_NULL(raw);
+	memcpy(raw, raw_bytes, sizeof(raw_bytes));
+	bitstream_raw_end(&bsw, sizeof(raw_bytes));
+	bitstream_add_bits32(&bsw, 0xCDEF, 16);
+	size = bitstream_flush(&bsw);
+
+	TEST_ASSERT_EQUAL(sizeof(expected_bs), size);
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(expected_bs, buffer, sizeof(expected_bs));
+}
+
+
+void test_bitstream_raw_bytes_detect_overflow(void)
+{
+	struct bitstream_writer bsw;
+	DST_ALIGNED_U8 buffer[8];
+
+	TEST_ASSERT_CMP_SUCCESS(bitstream_writer_init(&bsw, buffer, sizeof(buffer)));
+
+	bitstream_add_bits32(&bsw, 0xAB, 8);
+	TEST_ASSERT_NULL(bitstream_raw_begin(&bsw, sizeof(buffer)));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_TOO_SMALL, bitstream_flush(&bsw));
+}
+
+
+void test_bitstream_raw_bytes_need_byte_alignment(void)
+{
+	struct bitstream_writer bsw;
+	DST_ALIGNED_U8 buffer[8];
+
+	TEST_ASSERT_CMP_SUCCESS(bitstream_writer_init(&bsw, buffer, sizeof(buffer)));
+
+	bitstream_add_bits32(&bsw, 1, 1);
+	TEST_ASSERT_NULL(bitstream_raw_begin(&bsw, 1));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_INT_BITSTREAM, bitstream_flush(&bsw));
+}
+
+
+void test_bswap16_bulk_swaps_all_lengths_and_alignments(void)
+{
+	uint8_t src[2 * 40 + 2], dst[2 * 40 + 2], in_place[2 * 40 + 2];
+	size_t n, offset, i;
+
+	for (i = 0; i < sizeof(src); i++)
+		src[i] = (uint8_t)(i * 7 + 1);
+
+	for (offset = 0; offset < 2; offset++) {
+		for (n = 0; n <= 40; n++) {
+			memset(dst, 0, sizeof(dst));
+			memcpy(in_place, src, sizeof(src));
+
+			bswap16_bulk(dst + offset, src + offset, n);
+			bswap16_bulk(in_place + offset, in_place + offset, n);
+
+			for (i = 0; i < n; i++) {
+				TEST_ASSERT_EQUAL_HEX8(src[offset + 2 * i + 1], dst[offset + 2 * i]);
+				TEST_ASSERT_EQUAL_HEX8(src[offset + 2 * i], dst[offset + 2 * i + 1]);
+			}
+			TEST_ASSERT_EQUAL_HEX8_ARRAY(dst + offset, in_place + offset, 2 * n);
+			/* nothing behind the values is touched */
+			TEST_ASSERT_EQUAL_HEX8(0, dst[offset + 2 * n]);
+			TEST_ASSERT_EQUAL_HEX8_ARRAY(src + offset + 2 * n, in_place + offset + 2 * n,
+						     sizeof(src) - offset - 2 * n);
+		}
+	}
+}
+
+
 static void run_encoder_test(enum cmp_encoder_type type, uint32_t encoder_param,
 			     uint32_t encoder_outlier, const int16_t *input_data,
 			     uint32_t input_size, const uint8_t *expected, uint32_t expected_size,
@@ -128,6 +128,38 @@ void test_deserialize_header_with_extended_header(void)
 }
 
 
+void test_preloaded_model_flag_does_not_change_the_model_rate(void)
+{
+	DST_ALIGNED_U8 buf[CMP_HDR_SIZE + CMP_EXT_HDR_SIZE];
+	struct cmp_hdr hdr = { 0 };
+	struct bitstream_writer bs;
+
+	TEST_ASSERT_CMP_SUCCESS(bitstream_writer_init(&bs, buf, sizeof(buf)));
+	hdr.model_preloaded = 1;
+	hdr.preprocessing = CMP_PREPROCESS_MODEL;
+	hdr.encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	hdr.model_rate = 0xC8;
+	TEST_ASSERT_EQUAL(CMP_HDR_SIZE + CMP_EXT_HDR_SIZE, cmp_hdr_serialize(&bs, &hdr));
+	TEST_ASSERT_EQUAL_HEX8(CMP_HDR_METHOD_MODEL_PRELOADED_FLAG | CMP_PREPROCESS_MODEL << 4 |
+			       CMP_ENCODER_GOLOMB_ZERO, buf[CMP_HDR_OFFSET_METHOD]);
+	TEST_ASSERT_EQUAL_HEX8(0xC8, buf[CMP_EXT_HDR_OFFSET_MODEL_RATE]);
+
+	memset(&hdr, 0, sizeof(hdr));
+	TEST_ASSERT_EQUAL(CMP_HDR_SIZE + CMP_EXT_HDR_SIZE,
+			  cmp_hdr_deserialize(buf, sizeof(buf), &hdr));
+	TEST_ASSERT_EQUAL(1, hdr.model_preloaded);
+	TEST_ASSERT_EQUAL(CMP_PREPROCESS_MODEL, hdr.preprocessing);
+	TEST_ASSERT_EQUAL_HEX(0xC8, hdr.model_rate);
+
+	/* a model rate with its top bit set is not the flag */
+	buf[CMP_HDR_OFFSET_METHOD] &= (uint8_t)~CMP_HDR_METHOD_MODEL_PRELOADED_FLAG;
+	TEST_ASSERT_EQUAL(CMP_HDR_SIZE + CMP_EXT_HDR_SIZE,
+			  cmp_hdr_deserialize(buf, sizeof(buf), &hdr));
+	TEST_ASSERT_EQUAL(0, hdr.model_preloaded);
+	TEST_ASSERT_EQUAL_HEX(0xC8, hdr.model_rate);
+}
+
+
 void test_deserialize_header_without_extended_header(void)
 {
 	DST_ALIGNED_U8 buf[CMP_HDR_SIZE + CMP_EXT_HDR_SIZE];
@@ -200,6 +232,8 @@ void test_hdr_serialize_detects_when_a_field_is_too_big(void)
 	TEST_HDR_FIELD_TOO_BIG(original_size, CMP_HDR_BITS_ORIGINAL_SIZE,
 			       CMP_ERR_HDR_ORIGINAL_TOO_LARGE);
 	TEST_HDR_FIELD_TOO_BIG(identifier, CMP_HDR_BITS_IDENTIFIER, CMP_ERR_INT_BITSTREAM);
+	TEST_HDR_FIELD_TOO_BIG(model_preloaded, CMP_HDR_BITS_METHOD_MODEL_PRELOADED,
+			       CMP_ERR_INT_BITSTREAM);
 	TEST_HDR_FIELD_TOO_BIG(preprocessing, CMP_HDR_BITS_METHOD_PREPROCESSING,
 			       CMP_ERR_INT_BITSTREAM);
 	TEST_HDR_FIELD_TOO_BIG(checksum_enabled, CMP_HDR_BITS_METHOD_CHECKSUM_ENABLED,
@@ -207,8 +241,7 @@ void test_hdr_serialize_detects_when_a_field_is_too_big(void)
 	TEST_HDR_FIELD_TOO_BIG(encoder_type, CMP_HDR_BITS_METHOD_ENCODER_TYPE,
 			       CMP_ERR_INT_BITSTREAM);
 
-	TEST_HDR_FIELD_TOO_BIG(model_rate, CMP_EXT_HDR_BITS_MODEL_ADAPTATION,
-			       CMP_ERR_INT_BITSTREAM);
+	TEST_HDR_FIELD_TOO_BIG(model_rate, CMP_EXT_HDR_BITS_MODEL_RATE, CMP_ERR_INT_BITSTREAM);
 	TEST_HDR_FIELD_TOO_BIG(encoder_param, CMP_EXT_HDR_BITS_ENCODER_PARAM,
 			       CMP_ERR_INT_BITSTREAM);
 	TEST_HDR_FIELD_TOO_BIG(encoder_outlier, CMP_EXT_HDR_BITS_ENCODER_OUTLIER,
@@ -294,6 +294,7 @@ void test_parse_all_compression_parameters(void)
 
 		"checksum_enabled = FALSE,"
 		"uncompressed_fallback_enabled = TRUE,"
+		"iwt_in_place_enabled = TRUE,"
 	};
 
 	par_exp.primary_preprocessing = CMP_PREPROCESS_IWT;
@@ -310,6 +311,7 @@ void test_parse_all_compression_parameters(void)
 
 	par_exp.checksum_enabled = 0;
 	par_exp.uncompressed_fallback_enabled = 1;
+	par_exp.iwt_in_place_enabled = 1;
 
 	/* act */
 	status = cmp_params_parse(str, &par);
@@ -445,6 +447,7 @@ void test_stringify_all_parameters(void)
 
 	par.checksum_enabled = 0;
 	par.uncompressed_fallback_enabled = 1;
+	par.iwt_in_place_enabled = 0;
 
 	/* act */
 	str = cmp_params_to_string(a, &par);
@@ -463,7 +466,8 @@ void test_stringify_all_parameters(void)
 	TEST_ASSERT_TRUE_MESSAGE(strstr(str, "model_rate = 16,"), str);
 
 	TEST_ASSERT_TRUE_MESSAGE(strstr(str, "checksum_enabled = FALSE,"), str);
-	TEST_ASSERT_TRUE_MESSAGE(strstr(str, "uncompressed_fallback_enabled = TRUE\n"), str);
+	TEST_ASSERT_TRUE_MESSAGE(strstr(str, "uncompressed_fallback_enabled = TRUE,"), str);
+	TEST_ASSERT_TRUE_MESSAGE(strstr(str, "iwt_in_place_enabled = FALSE\n"), str);
 	/* no ',' on last line*/
 }
 
@@ -144,6 +144,119 @@ void test_iwt_transform(compress_func_t compress_func, const void *input, uint32
 }
 
 
+void test_in_place_iwt_gives_the_same_frames_without_work_buf(void)
+{
+	uint16_t data[100], src[ARRAY_SIZE(data)];
+	struct cmp_params params = { 0 };
+	struct test_env *e;
+	struct cmp_context ctx_in_place;
+	uint8_t *dst;
+	uint32_t i, size, size_in_place;
+
+	cmp_set_timestamp_func(constant_timestamp);
+	for (i = 0; i < ARRAY_SIZE(data); i++)
+		data[i] = (uint16_t)(500 + (i * 37) % 11);
+	params.primary_preprocessing = CMP_PREPROCESS_IWT;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 2;
+	params.primary_encoder_outlier = 64;
+	params.secondary_iterations = 2;
+	params.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+	params.secondary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.secondary_encoder_param = 1;
+	params.secondary_encoder_outlier = 16;
+	params.model_rate = 4;
+	params.checksum_enabled = 1;
+	e = make_env(&params, sizeof(data));
+
+	params.iwt_in_place_enabled = 1;
+	params.secondary_iterations = 0;
+	TEST_ASSERT_EQUAL_UINT32(0, cmp_cal_work_buf_size(&params, sizeof(data)));
+	/* only the model is needed */
+	params.secondary_iterations = 2;
+	TEST_ASSERT_EQUAL_UINT32(sizeof(data), cmp_cal_work_buf_size(&params, sizeof(data)));
+	ctx_in_place = e->ctx;
+	ctx_in_place.params.iwt_in_place_enabled = 1;
+	ctx_in_place.work_buf = t_malloc(sizeof(data));
+	ctx_in_place.work_buf_size = sizeof(data);
+	dst = t_malloc(e->dst_cap);
+
+	for (i = 0; i < 3; i++) {
+		data[i] = (uint16_t)(data[i] + 3);
+		size = cmp_compress_u16(&e->ctx, e->dst, e->dst_cap, data, sizeof(data));
+		TEST_ASSERT_CMP_SUCCESS(size);
+
+		memcpy(src, data, sizeof(src));
+		size_in_place = cmp_compress_u16_in_place(&ctx_in_place, dst, e->dst_cap, src,
+							  sizeof(src));
+
+		TEST_ASSERT_EQUAL_UINT32(size, size_in_place);
+		TEST_ASSERT_EQUAL_HEX8_ARRAY(e->dst, dst, size);
+	}
+
+	cmp_set_timestamp_func(NULL);
+	free(dst);
+	free(ctx_in_place.work_buf);
+	free_env(e);
+}
+
+
+void test_in_place_iwt_leaves_coefficients_in_source(void)
+{
+	int16_t src[ARRAY_SIZE(g_iwt_input_8)];
+	uint64_t dst[8];
+	struct cmp_params params = { 0 };
+	struct cmp_context ctx;
+
+	params.primary_preprocessing = CMP_PREPROCESS_IWT;
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.iwt_in_place_enabled = 1;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+	memcpy(src, g_iwt_input_8, sizeof(src));
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_i16_in_place(&ctx, dst, sizeof(dst), src,
+							  sizeof(src)));
+
+	TEST_ASSERT_EQUAL_INT16_ARRAY(g_iwt_exp_out_8, src, ARRAY_SIZE(src));
+	assert_preprocessing_data(g_iwt_exp_out_8, ARRAY_SIZE(g_iwt_exp_out_8),
+				  (const uint8_t *)dst);
+	/* without a work buffer the source can not be kept */
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_WORK_BUF_NULL,
+				    cmp_compress_i16(&ctx, dst, sizeof(dst), src, sizeof(src)));
+}
+
+
+void test_in_place_iwt_restores_source_on_failure(void)
+{
+	int16_t src[ARRAY_SIZE(g_iwt_input_7)];
+	uint64_t dst[8];
+	struct cmp_params params = { 0 };
+	struct cmp_context ctx;
+	uint32_t size;
+
+	params.primary_preprocessing = CMP_PREPROCESS_IWT;
+	params.primary_encoder_type = CMP_ENCODER_UNCOMPRESSED;
+	params.iwt_in_place_enabled = 1;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+	memcpy(src, g_iwt_input_7, sizeof(src));
+
+	size = cmp_compress_i16_in_place(&ctx, dst, CMP_HDR_MAX_SIZE + 2, src, sizeof(src));
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_TOO_SMALL, size);
+	TEST_ASSERT_EQUAL_INT16_ARRAY(g_iwt_input_7, src, ARRAY_SIZE(src));
+
+	/* the uncompressed fallback stores the original data */
+	params.uncompressed_fallback_enabled = 1;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	size = cmp_compress_i16_in_place(&ctx, dst, sizeof(dst), src, sizeof(src));
+
+	TEST_ASSERT_EQUAL_UINT32(CMP_HDR_SIZE + sizeof(src), size);
+	TEST_ASSERT_EQUAL_INT16_ARRAY(g_iwt_input_7, src, ARRAY_SIZE(src));
+	assert_preprocessing_data(g_iwt_input_7, ARRAY_SIZE(g_iwt_input_7), (const uint8_t *)dst);
+}
+
+
 TEST_CASE(compress_u16_wrapper)
 TEST_CASE(compress_i16_wrapper)
 void test_model_preprocessing_for_multiple_values(compress_func_t compress_func)
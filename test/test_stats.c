@@ -0,0 +1,276 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Compression statistics tests
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <unity.h>
+#include "test_common.h"
+
+#include "../lib/cmp.h"
+#include "../lib/cmp_errors.h"
+#include "../lib/common/header_private.h"
+
+
+static uint32_t sum_of(const uint32_t *counts, size_t n)
+{
+	uint32_t sum = 0;
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		sum += counts[i];
+	return sum;
+}
+
+
+static void init_context(struct cmp_context *ctx, enum cmp_preprocessing preprocessing,
+			 enum cmp_encoder_type encoder_type, uint32_t encoder_param,
+			 uint32_t outlier, void *work_buf, uint32_t work_buf_size)
+{
+	struct cmp_params params;
+
+	memset(&params, 0, sizeof(params));
+	params.primary_preprocessing = preprocessing;
+	params.primary_encoder_type = encoder_type;
+	params.primary_encoder_param = encoder_param;
+	params.primary_encoder_outlier = outlier;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(ctx, &params, work_buf, work_buf_size));
+}
+
+
+static void assert_parts_add_up(const struct cmp_stats *stats, uint32_t cmp_size)
+{
+	TEST_ASSERT_EQUAL_UINT32(stats->num_samples,
+				 sum_of(stats->codeword_len_hist,
+					CMP_STATS_MAX_CODEWORD_BITS + 1));
+	TEST_ASSERT_EQUAL_UINT32(cmp_size * 8, stats->header_bits + stats->payload_bits +
+						       stats->checksum_bits);
+}
+
+
+void test_stats_do_not_change_the_compressed_data(void)
+{
+	const enum cmp_preprocessing preprocessing[] = { CMP_PREPROCESS_NONE, CMP_PREPROCESS_DIFF,
+							 CMP_PREPROCESS_IWT };
+	const enum cmp_encoder_type encoder[] = { CMP_ENCODER_UNCOMPRESSED,
+						  CMP_ENCODER_GOLOMB_ZERO,
+						  CMP_ENCODER_GOLOMB_MULTI };
+	uint16_t src[200];
+	uint16_t work_buf[200];
+	DST_ALIGNED_U8 dst[CMP_UNCOMPRESSED_BOUND(sizeof(src)) * 3];
+	DST_ALIGNED_U8 dst_stats[sizeof(dst)];
+	struct cmp_context ctx;
+	struct cmp_stats stats;
+	size_t p, e;
+	uint32_t i;
+
+	for (i = 0; i < ARRAY_SIZE(src); i++)
+		src[i] = (uint16_t)(1000 + (i * 37) % 101 + (i % 17 == 0 ? 20000 : 0));
+
+	cmp_set_timestamp_func(constant_timestamp);
+	for (p = 0; p < ARRAY_SIZE(preprocessing); p++) {
+		for (e = 0; e < ARRAY_SIZE(encoder); e++) {
+			uint32_t size, size_stats;
+
+			init_context(&ctx, preprocessing[p], encoder[e], 4, 8, work_buf,
+				     sizeof(work_buf));
+			size = cmp_compress_u16(&ctx, dst, sizeof(dst), src, sizeof(src));
+			TEST_ASSERT_CMP_SUCCESS(size);
+
+			init_context(&ctx, preprocessing[p], encoder[e], 4, 8, work_buf,
+				     sizeof(work_buf));
+			cmp_set_stats(&ctx, &stats);
+			size_stats = cmp_compress_u16(&ctx, dst_stats, sizeof(dst_stats), src,
+						      sizeof(src));
+
+			TEST_ASSERT_EQUAL_UINT32(size, size_stats);
+			TEST_ASSERT_EQUAL_HEX8_ARRAY(dst, dst_stats, size);
+			TEST_ASSERT_EQUAL_UINT32(ARRAY_SIZE(src), stats.num_samples);
+			assert_parts_add_up(&stats, size);
+		}
+	}
+	cmp_set_timestamp_func(NULL);
+}
+
+
+void test_stats_count_the_zero_escapes(void)
+{
+	/* with a Golomb parameter of 1, mapped values from 16 on are escaped */
+	const int16_t src[] = { 0, 1, 8, 100, -100 };
+	DST_ALIGNED_U8 dst[CMP_HDR_MAX_SIZE + 16];
+	struct cmp_context ctx;
+	struct cmp_stats stats;
+	uint32_t size;
+
+	init_context(&ctx, CMP_PREPROCESS_NONE, CMP_ENCODER_GOLOMB_ZERO, 1, 0, NULL, 0);
+	cmp_set_stats(&ctx, &stats);
+	size = cmp_compress_i16(&ctx, dst, sizeof(dst), src, sizeof(src));
+	TEST_ASSERT_CMP_SUCCESS(size);
+
+	TEST_ASSERT_EQUAL_UINT32(5, stats.num_samples);
+	TEST_ASSERT_EQUAL_UINT32(3, stats.num_zero_escapes);
+	TEST_ASSERT_EQUAL_UINT32(0, sum_of(stats.num_multi_escapes, CMP_STATS_NUM_ESCAPE_LEVELS));
+	/* unary codes of mapped + 1 and escape symbol plus 16 raw bits */
+	TEST_ASSERT_EQUAL_UINT32(1, stats.codeword_len_hist[2]);
+	TEST_ASSERT_EQUAL_UINT32(1, stats.codeword_len_hist[4]);
+	TEST_ASSERT_EQUAL_UINT32(3, stats.codeword_len_hist[17]);
+	TEST_ASSERT_EQUAL_INT16(-100, stats.min_residual);
+	TEST_ASSERT_EQUAL_INT16(100, stats.max_residual);
+	TEST_ASSERT_EQUAL_UINT32(CMP_HDR_MAX_SIZE * 8, stats.header_bits);
+	TEST_ASSERT_EQUAL_UINT32(64, stats.payload_bits); /* 57 bits padded to bytes */
+	TEST_ASSERT_EQUAL_UINT32(0, stats.checksum_bits);
+	TEST_ASSERT_EQUAL_UINT8(0, stats.uncompressed_fallback);
+	assert_parts_add_up(&stats, size);
+}
+
+
+void test_stats_count_the_multi_escapes_per_level(void)
+{
+	/* mapped values: 0, outlier + 0, outlier + 4, outlier + 300 and 65535 */
+	const int16_t src[] = { 0, 2, 4, 152, INT16_MIN };
+	DST_ALIGNED_U8 dst[CMP_HDR_MAX_SIZE + 16];
+	struct cmp_context ctx;
+	struct cmp_stats stats;
+	uint32_t size;
+
+	init_context(&ctx, CMP_PREPROCESS_NONE, CMP_ENCODER_GOLOMB_MULTI, 1, 4, NULL, 0);
+	cmp_set_stats(&ctx, &stats);
+	size = cmp_compress_i16(&ctx, dst, sizeof(dst), src, sizeof(src));
+	TEST_ASSERT_CMP_SUCCESS(size);
+
+	TEST_ASSERT_EQUAL_UINT32(0, stats.num_zero_escapes);
+	TEST_ASSERT_EQUAL_UINT32(1, stats.num_multi_escapes[0]);
+	TEST_ASSERT_EQUAL_UINT32(1, stats.num_multi_escapes[1]);
+	TEST_ASSERT_EQUAL_UINT32(1, stats.num_multi_escapes[4]);
+	TEST_ASSERT_EQUAL_UINT32(1, stats.num_multi_escapes[7]);
+	TEST_ASSERT_EQUAL_UINT32(4, sum_of(stats.num_multi_escapes, CMP_STATS_NUM_ESCAPE_LEVELS));
+	/* escape symbol outlier + 7 with a unary code and 16 raw bits */
+	TEST_ASSERT_EQUAL_UINT32(1, stats.codeword_len_hist[12 + 16]);
+	TEST_ASSERT_EQUAL_INT16(INT16_MIN, stats.min_residual);
+	TEST_ASSERT_EQUAL_INT16(152, stats.max_residual);
+	assert_parts_add_up(&stats, size);
+}
+
+
+void test_stats_report_the_checksum_and_the_uncompressed_fallback(void)
+{
+	const uint16_t src_incompressible[] = { 0xAAAA, 0xBBBB, 0xCCCC };
+	const uint16_t src_compressible[32] = { 0 };
+	DST_ALIGNED_U8 dst[CMP_UNCOMPRESSED_BOUND(sizeof(src_compressible)) + CMP_CHECKSUM_SIZE];
+	struct cmp_params params;
+	struct cmp_context ctx;
+	struct cmp_stats stats;
+	uint32_t size;
+
+	memset(&params, 0, sizeof(params));
+	params.uncompressed_fallback_enabled = 1;
+	params.checksum_enabled = 1;
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 1;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+	cmp_set_stats(&ctx, &stats);
+
+	size = cmp_compress_u16(&ctx, dst, sizeof(dst), ARRAY_AND_SIZE(src_incompressible));
+	TEST_ASSERT_CMP_SUCCESS(size);
+	TEST_ASSERT_EQUAL_UINT8(1, stats.uncompressed_fallback);
+	TEST_ASSERT_EQUAL_UINT32(3, stats.num_samples);
+	TEST_ASSERT_EQUAL_UINT32(3, stats.codeword_len_hist[16]);
+	TEST_ASSERT_EQUAL_UINT32(CMP_HDR_SIZE * 8, stats.header_bits);
+	TEST_ASSERT_EQUAL_UINT32(sizeof(src_incompressible) * 8, stats.payload_bits);
+	TEST_ASSERT_EQUAL_UINT32(32, stats.checksum_bits);
+	assert_parts_add_up(&stats, size);
+
+	size = cmp_compress_u16(&ctx, dst, sizeof(dst), ARRAY_AND_SIZE(src_compressible));
+	TEST_ASSERT_CMP_SUCCESS(size);
+	TEST_ASSERT_EQUAL_UINT8(0, stats.uncompressed_fallback);
+	TEST_ASSERT_EQUAL_UINT32(32, stats.codeword_len_hist[2]);
+	TEST_ASSERT_EQUAL_UINT32(CMP_HDR_MAX_SIZE * 8, stats.header_bits);
+	TEST_ASSERT_EQUAL_UINT32(32, stats.checksum_bits);
+	assert_parts_add_up(&stats, size);
+}
+
+
+void test_stats_collection_can_be_stopped(void)
+{
+	const int16_t src_a[] = { 1, 2, 3 };
+	const int16_t src_b[] = { -5, 7 };
+	DST_ALIGNED_U8 dst[CMP_UNCOMPRESSED_BOUND(sizeof(src_a))];
+	struct cmp_context ctx;
+	struct cmp_stats stats;
+
+	init_context(&ctx, CMP_PREPROCESS_NONE, CMP_ENCODER_UNCOMPRESSED, 0, 0, NULL, 0);
+	cmp_set_stats(&ctx, &stats);
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_i16(&ctx, dst, sizeof(dst), ARRAY_AND_SIZE(src_a)));
+	TEST_ASSERT_EQUAL_UINT32(3, stats.num_samples);
+
+	cmp_set_stats(&ctx, NULL);
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_i16(&ctx, dst, sizeof(dst), ARRAY_AND_SIZE(src_b)));
+	TEST_ASSERT_EQUAL_UINT32(3, stats.num_samples);
+	TEST_ASSERT_EQUAL_INT16(3, stats.max_residual);
+
+	/* a new initialisation also stops the collection */
+	cmp_set_stats(&ctx, &stats);
+	init_context(&ctx, CMP_PREPROCESS_NONE, CMP_ENCODER_UNCOMPRESSED, 0, 0, NULL, 0);
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_i16(&ctx, dst, sizeof(dst), ARRAY_AND_SIZE(src_b)));
+	TEST_ASSERT_EQUAL_UINT32(3, stats.num_samples);
+}
+
+
+void test_stats_residual_histogram_gives_the_encoded_size(void)
+{
+	static uint32_t hist[CMP_RESIDUAL_HIST_SIZE];
+	uint16_t src[200];
+	DST_ALIGNED_U8 dst[CMP_UNCOMPRESSED_BOUND(sizeof(src)) * 3];
+	struct cmp_context ctx;
+	struct cmp_stats stats;
+	uint64_t bits, len_bits = 0;
+	uint32_t i, size;
+
+	for (i = 0; i < ARRAY_SIZE(src); i++)
+		src[i] = (uint16_t)(1000 + (i * 37) % 101 + (i % 17 == 0 ? 20000 : 0));
+
+	memset(hist, 0, sizeof(hist));
+	init_context(&ctx, CMP_PREPROCESS_DIFF, CMP_ENCODER_GOLOMB_MULTI, 4, 8, NULL, 0);
+	cmp_set_stats(&ctx, &stats);
+	TEST_ASSERT_CMP_SUCCESS(cmp_set_residual_hist(&ctx, hist, CMP_RESIDUAL_HIST_SIZE));
+	size = cmp_compress_u16(&ctx, dst, sizeof(dst), src, sizeof(src));
+	TEST_ASSERT_CMP_SUCCESS(size);
+	TEST_ASSERT_EQUAL_UINT32(ARRAY_SIZE(src), sum_of(hist, CMP_RESIDUAL_HIST_SIZE));
+	/* the first residual of 21000 is mapped to 42000 */
+	TEST_ASSERT_EQUAL_UINT32(1, hist[42000]);
+
+	/* same size as the encoded frame without padding */
+	TEST_ASSERT_CMP_SUCCESS(cmp_estimate_encoded_bits(hist, CMP_ENCODER_GOLOMB_MULTI, 4, 8,
+							  &bits));
+	for (i = 0; i <= CMP_STATS_MAX_CODEWORD_BITS; i++)
+		len_bits += (uint64_t)stats.codeword_len_hist[i] * i;
+	TEST_ASSERT_EQUAL_UINT32(len_bits, bits);
+	TEST_ASSERT_EQUAL_UINT32((bits + 7) / 8 * 8, stats.payload_bits);
+
+	/* other encoder parameters without compressing again */
+	init_context(&ctx, CMP_PREPROCESS_DIFF, CMP_ENCODER_GOLOMB_ZERO, 32, 0, NULL, 0);
+	size = cmp_compress_u16(&ctx, dst, sizeof(dst), src, sizeof(src));
+	TEST_ASSERT_CMP_SUCCESS(size);
+	TEST_ASSERT_CMP_SUCCESS(cmp_estimate_encoded_bits(hist, CMP_ENCODER_GOLOMB_ZERO, 32, 0,
+							  &bits));
+	TEST_ASSERT_EQUAL_UINT32(CMP_HDR_MAX_SIZE + (bits + 7) / 8, size);
+
+	/* a second frame adds up, also without statistics */
+	init_context(&ctx, CMP_PREPROCESS_DIFF, CMP_ENCODER_GOLOMB_MULTI, 4, 8, NULL, 0);
+	TEST_ASSERT_CMP_SUCCESS(cmp_set_residual_hist(&ctx, hist, CMP_RESIDUAL_HIST_SIZE));
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_u16(&ctx, dst, sizeof(dst), src, sizeof(src)));
+	TEST_ASSERT_EQUAL_UINT32(2 * ARRAY_SIZE(src), sum_of(hist, CMP_RESIDUAL_HIST_SIZE));
+
+	TEST_ASSERT_EQUAL_INT(CMP_ERR_PARAMS_INVALID,
+			      cmp_get_error_code(cmp_estimate_encoded_bits(
+				      hist, CMP_ENCODER_GOLOMB_ZERO, 0, 0, &bits)));
+	TEST_ASSERT_EQUAL_INT(CMP_ERR_PARAMS_INVALID,
+			      cmp_get_error_code(cmp_set_residual_hist(&ctx, hist, 256)));
+}
@@ -0,0 +1,376 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Streaming compression tests
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <unity.h>
+#include "test_common.h"
+
+#include "../lib/cmp.h"
+#include "../lib/cmp_errors.h"
+#include "../lib/common/header_private.h"
+
+
+#define TEST_MAX_FRAME_SIZE 4096
+
+/** Output sink collecting all chunks in one buffer */
+struct collector {
+	uint8_t frame[TEST_MAX_FRAME_SIZE];
+	uint32_t size;
+	uint32_t num_chunks;
+	uint32_t max_chunk_size;
+	int fail_after; /**< number of chunks until the sink fails; -1 never fails */
+	int hdr_finalised;
+};
+
+
+static int collect_chunk(const void *chunk, uint32_t chunk_size, void *opaque)
+{
+	struct collector *c = opaque;
+
+	if (c->fail_after >= 0 && c->num_chunks >= (uint32_t)c->fail_after)
+		return -1;
+
+	TEST_ASSERT_LESS_OR_EQUAL(sizeof(c->frame), c->size + chunk_size);
+	memcpy(c->frame + c->size, chunk, chunk_size);
+	c->size += chunk_size;
+	c->num_chunks++;
+	if (chunk_size > c->max_chunk_size)
+		c->max_chunk_size = chunk_size;
+	return 0;
+}
+
+
+static int collect_header(const void *hdr, uint32_t hdr_size, void *opaque)
+{
+	struct collector *c = opaque;
+
+	TEST_ASSERT_LESS_OR_EQUAL(c->size, hdr_size);
+	memcpy(c->frame, hdr, hdr_size);
+	c->hdr_finalised = 1;
+	return 0;
+}
+
+
+static struct cmp_sink make_sink(struct collector *c, void *chunk_buf, uint32_t chunk_buf_size)
+{
+	struct cmp_sink sink;
+
+	memset(c, 0, sizeof(*c));
+	c->fail_after = -1;
+
+	sink.chunk_buf = chunk_buf;
+	sink.chunk_buf_size = chunk_buf_size;
+	sink.write_chunk = collect_chunk;
+	sink.finalise_header = collect_header;
+	sink.opaque = c;
+	return sink;
+}
+
+
+void tearDown(void)
+{
+	cmp_set_timestamp_func(NULL);
+}
+
+
+TEST_CASE(CMP_PREPROCESS_NONE, CMP_ENCODER_UNCOMPRESSED, 8)
+TEST_CASE(CMP_PREPROCESS_DIFF, CMP_ENCODER_GOLOMB_ZERO, 8)
+TEST_CASE(CMP_PREPROCESS_IWT, CMP_ENCODER_GOLOMB_MULTI, 16)
+TEST_CASE(CMP_PREPROCESS_DIFF, CMP_ENCODER_GOLOMB_MULTI, 21)
+void test_sink_output_is_identical_to_buffer_output(enum cmp_preprocessing preprocessing,
+						    enum cmp_encoder_type encoder_type,
+						    int chunk_size)
+{
+	uint16_t data[301];
+	uint64_t chunk_buf[4];
+	struct collector c;
+	struct cmp_sink sink = make_sink(&c, chunk_buf, (uint32_t)chunk_size);
+	struct cmp_params params = { 0 };
+	struct test_env *env;
+	struct cmp_context ctx_sink;
+	uint32_t size_buf, size_sink, i;
+
+	cmp_set_timestamp_func(constant_timestamp);
+	fill_test_data(data, ARRAY_SIZE(data), 12345);
+	params.primary_preprocessing = preprocessing;
+	params.primary_encoder_type = encoder_type;
+	params.primary_encoder_param = 7;
+	params.primary_encoder_outlier = 300;
+	params.secondary_iterations = 2;
+	params.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+	params.secondary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.secondary_encoder_param = 3;
+	params.model_rate = 8;
+	params.checksum_enabled = 1;
+	env = make_env(&params, sizeof(data));
+	ctx_sink = env->ctx;
+	ctx_sink.work_buf = t_malloc(env->ctx.work_buf_size);
+
+	for (i = 0; i < 4; i++) {
+		data[i * 7] = (uint16_t)(data[i * 7] + i);
+		size_buf = cmp_compress_u16(&env->ctx, env->dst, env->dst_cap, data, sizeof(data));
+		TEST_ASSERT_CMP_SUCCESS(size_buf);
+
+		sink = make_sink(&c, chunk_buf, (uint32_t)chunk_size);
+		size_sink = cmp_compress_u16_to_sink(&ctx_sink, &sink, data, sizeof(data));
+
+		TEST_ASSERT_EQUAL_UINT32(size_buf, size_sink);
+		TEST_ASSERT_EQUAL_UINT32(size_buf, c.size);
+		TEST_ASSERT_TRUE(c.hdr_finalised);
+		TEST_ASSERT_LESS_OR_EQUAL(chunk_size, c.max_chunk_size);
+		TEST_ASSERT_EQUAL_HEX8_ARRAY(env->dst, c.frame, size_buf);
+	}
+
+	free(ctx_sink.work_buf);
+	free_env(env);
+}
+
+
+void test_sink_reports_failing_write(void)
+{
+	uint16_t data[64];
+	uint64_t chunk_buf[1];
+	struct collector c;
+	struct cmp_sink sink = make_sink(&c, chunk_buf, sizeof(chunk_buf));
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	uint32_t ret;
+
+	fill_test_data(data, ARRAY_SIZE(data), 12345);
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+	c.fail_after = 3;
+
+	ret = cmp_compress_u16_to_sink(&ctx, &sink, data, sizeof(data));
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_SINK_FAILED, ret);
+	TEST_ASSERT_EQUAL(3, c.num_chunks);
+	TEST_ASSERT_FALSE(c.hdr_finalised);
+}
+
+
+void test_sink_detects_invalid_arguments(void)
+{
+	uint16_t data[4] = { 0 };
+	uint64_t chunk_buf[2];
+	struct collector c;
+	struct cmp_sink sink = make_sink(&c, chunk_buf, sizeof(chunk_buf));
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_NULL,
+				    cmp_compress_u16_to_sink(&ctx, NULL, data, sizeof(data)));
+	sink.chunk_buf_size = 7;
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_TOO_SMALL,
+				    cmp_compress_u16_to_sink(&ctx, &sink, data, sizeof(data)));
+	sink.chunk_buf_size = sizeof(chunk_buf);
+	sink.chunk_buf = (uint8_t *)chunk_buf + 1;
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_UNALIGNED,
+				    cmp_compress_u16_to_sink(&ctx, &sink, data, sizeof(data)));
+	sink.chunk_buf = chunk_buf;
+	sink.finalise_header = NULL;
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_DST_NULL,
+				    cmp_compress_u16_to_sink(&ctx, &sink, data, sizeof(data)));
+	TEST_ASSERT_EQUAL(0, c.num_chunks);
+}
+
+
+void test_sink_rejects_uncompressed_fallback(void)
+{
+	uint16_t data[4] = { 0 };
+	uint64_t chunk_buf[2];
+	struct collector c;
+	struct cmp_sink sink = make_sink(&c, chunk_buf, sizeof(chunk_buf));
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+
+	params.uncompressed_fallback_enabled = 1;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID,
+				    cmp_compress_u16_to_sink(&ctx, &sink, data, sizeof(data)));
+}
+
+
+/* pushes the data in pieces of increasing size to exercise the piece boundaries */
+static uint32_t push_in_pieces(struct cmp_stream *stream, const uint16_t *data,
+			       uint32_t num_samples)
+{
+	uint32_t pos = 0, piece = 1;
+
+	while (pos < num_samples) {
+		uint32_t const n = piece < num_samples - pos ? piece : num_samples - pos;
+		uint32_t const ret = cmp_compress_push_u16(stream, data + pos,
+							   n * sizeof(*data));
+
+		if (cmp_is_error(ret))
+			return ret;
+		pos += n;
+		piece = piece * 3 % 37;
+	}
+	return cmp_compress_end(stream);
+}
+
+
+TEST_CASE(CMP_PREPROCESS_NONE, CMP_ENCODER_UNCOMPRESSED, 0)
+TEST_CASE(CMP_PREPROCESS_NONE, CMP_ENCODER_GOLOMB_ZERO, 1)
+TEST_CASE(CMP_PREPROCESS_DIFF, CMP_ENCODER_GOLOMB_ZERO, 0)
+TEST_CASE(CMP_PREPROCESS_DIFF, CMP_ENCODER_GOLOMB_MULTI, 1)
+TEST_CASE(CMP_PREPROCESS_IWT, CMP_ENCODER_GOLOMB_MULTI, 0)
+TEST_CASE(CMP_PREPROCESS_IWT, CMP_ENCODER_GOLOMB_ZERO, 1)
+void test_pushed_frames_are_identical_to_single_call(enum cmp_preprocessing preprocessing,
+						      enum cmp_encoder_type encoder_type,
+						      int checksum_enabled)
+{
+	uint16_t data[301];
+	struct cmp_params params = { 0 };
+	struct test_env *env;
+	struct cmp_context ctx_stream;
+	struct cmp_stream stream;
+	uint8_t *dst_stream;
+	uint32_t size_buf, size_stream, i;
+
+	cmp_set_timestamp_func(constant_timestamp);
+	fill_test_data(data, ARRAY_SIZE(data), 12345);
+	params.primary_preprocessing = preprocessing;
+	params.primary_encoder_type = encoder_type;
+	params.primary_encoder_param = 7;
+	params.primary_encoder_outlier = 300;
+	params.secondary_iterations = 2;
+	params.secondary_preprocessing = CMP_PREPROCESS_MODEL;
+	params.secondary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.secondary_encoder_param = 3;
+	params.model_rate = 8;
+	params.checksum_enabled = checksum_enabled;
+	env = make_env(&params, sizeof(data));
+	ctx_stream = env->ctx;
+	ctx_stream.work_buf = t_malloc(env->ctx.work_buf_size);
+	dst_stream = t_malloc(env->dst_cap);
+
+	/* two complete model cycles */
+	for (i = 0; i < 6; i++) {
+		data[i * 7] = (uint16_t)(data[i * 7] + i);
+		size_buf = cmp_compress_u16(&env->ctx, env->dst, env->dst_cap, data, sizeof(data));
+		TEST_ASSERT_CMP_SUCCESS(size_buf);
+
+		TEST_ASSERT_CMP_SUCCESS(cmp_compress_begin(&stream, &ctx_stream, dst_stream,
+							   env->dst_cap, sizeof(data)));
+		size_stream = push_in_pieces(&stream, data, ARRAY_SIZE(data));
+
+		TEST_ASSERT_EQUAL_UINT32(size_buf, size_stream);
+		TEST_ASSERT_EQUAL_HEX8_ARRAY(env->dst, dst_stream, size_buf);
+	}
+
+	free(dst_stream);
+	free(ctx_stream.work_buf);
+	free_env(env);
+}
+
+
+void test_pushed_frame_into_sink_is_identical_to_single_call(void)
+{
+	int32_t data[200];
+	uint64_t chunk_buf[2];
+	struct collector c;
+	struct cmp_sink sink = make_sink(&c, chunk_buf, sizeof(chunk_buf));
+	struct cmp_params params = { 0 };
+	struct test_env *env;
+	struct cmp_context ctx_stream;
+	struct cmp_stream stream;
+	uint32_t size_buf, i;
+
+	cmp_set_timestamp_func(constant_timestamp);
+	for (i = 0; i < ARRAY_SIZE(data); i++)
+		data[i] = (int32_t)(i * 7 % 23) - 11;
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 4;
+	params.primary_encoder_outlier = 40;
+	params.checksum_enabled = 1;
+	env = make_env(&params, sizeof(data) / 2);
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx_stream, &params, NULL, 0));
+
+	size_buf = cmp_compress_i16_in_i32(&env->ctx, env->dst, env->dst_cap, data, sizeof(data));
+	TEST_ASSERT_CMP_SUCCESS(size_buf);
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_begin_sink(&stream, &ctx_stream, &sink,
+							sizeof(data) / 2));
+	for (i = 0; i < ARRAY_SIZE(data); i += 40)
+		TEST_ASSERT_CMP_SUCCESS(cmp_compress_push_i16_in_i32(&stream, data + i,
+								     40 * sizeof(*data)));
+
+	TEST_ASSERT_EQUAL_UINT32(size_buf, cmp_compress_end(&stream));
+	TEST_ASSERT_TRUE(c.hdr_finalised);
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(env->dst, c.frame, size_buf);
+	free_env(env);
+}
+
+
+void test_stream_detects_misuse(void)
+{
+	int16_t data[8] = { 0 };
+	uint64_t dst[8];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	struct cmp_stream stream;
+
+	memset(&stream, 0, sizeof(stream));
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	/* not started */
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_STREAM_INVALID,
+				    cmp_compress_push_i16(&stream, data, sizeof(data)));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_STREAM_INVALID, cmp_compress_end(&stream));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_SIZE_WRONG,
+				    cmp_compress_begin(&stream, &ctx, dst, sizeof(dst), 3));
+
+	/* more data than announced */
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_begin(&stream, &ctx, dst, sizeof(dst), 8));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_SIZE_WRONG,
+				    cmp_compress_push_i16(&stream, data, sizeof(data)));
+	/* the stream is aborted after an error */
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_STREAM_INVALID,
+				    cmp_compress_push_i16(&stream, data, 2));
+
+	/* mixed sample types */
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_begin(&stream, &ctx, dst, sizeof(dst), 8));
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_push_i16(&stream, data, 2));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_STREAM_INVALID,
+				    cmp_compress_push_u16(&stream, (uint16_t *)data, 2));
+
+	/* less data than announced */
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_begin(&stream, &ctx, dst, sizeof(dst), 8));
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_push_i16(&stream, data, 6));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_SRC_SIZE_WRONG, cmp_compress_end(&stream));
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_STREAM_INVALID, cmp_compress_end(&stream));
+
+	/* a complete frame */
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_begin(&stream, &ctx, dst, sizeof(dst), 8));
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_push_i16(&stream, data, 8));
+	TEST_ASSERT_EQUAL_UINT32(CMP_HDR_SIZE + 8, cmp_compress_end(&stream));
+}
+
+
+void test_stream_rejects_uncompressed_fallback(void)
+{
+	uint64_t dst[8];
+	struct cmp_context ctx;
+	struct cmp_params params = { 0 };
+	struct cmp_stream stream;
+
+	params.uncompressed_fallback_enabled = 1;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+
+	TEST_ASSERT_EQUAL_CMP_ERROR(CMP_ERR_PARAMS_INVALID,
+				    cmp_compress_begin(&stream, &ctx, dst, sizeof(dst), 8));
+}
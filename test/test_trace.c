@@ -0,0 +1,195 @@
+/**
+ * @file
+ * @author Dominik Loidolt (dominik.loidolt@univie.ac.at)
+ * @date   2025
+ * @copyright GPL-2.0
+ *
+ * @brief Compression stage trace tests
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <unity.h>
+#include "test_common.h"
+
+#include "../lib/cmp.h"
+#include "../lib/cmp_errors.h"
+#include "../lib/common/header_private.h"
+
+#define MAX_RECORDED_STAGES 16
+
+
+struct stage_recorder {
+	uint64_t now;
+	int num_stages;
+	enum cmp_stage stage[MAX_RECORDED_STAGES];
+	uint64_t start[MAX_RECORDED_STAGES];
+	uint64_t end[MAX_RECORDED_STAGES];
+};
+
+
+/* every clock reading advances the time by one tick */
+static uint64_t fake_clock(void *opaque)
+{
+	struct stage_recorder *rec = opaque;
+
+	return ++rec->now;
+}
+
+
+static void record_stage(void *opaque, enum cmp_stage stage, uint64_t start, uint64_t end)
+{
+	struct stage_recorder *rec = opaque;
+
+	TEST_ASSERT_LESS_THAN(MAX_RECORDED_STAGES, rec->num_stages);
+	rec->stage[rec->num_stages] = stage;
+	rec->start[rec->num_stages] = start;
+	rec->end[rec->num_stages] = end;
+	rec->num_stages++;
+}
+
+
+static void init_trace(struct cmp_trace *trace, struct stage_recorder *rec)
+{
+	memset(rec, 0, sizeof(*rec));
+	trace->clock = fake_clock;
+	trace->stage_done = record_stage;
+	trace->opaque = rec;
+}
+
+
+static void assert_stages(const struct stage_recorder *rec, const enum cmp_stage *expected,
+			  int num_expected)
+{
+	int i;
+
+	TEST_ASSERT_EQUAL_INT(num_expected, rec->num_stages);
+	for (i = 0; i < num_expected; i++) {
+		TEST_ASSERT_EQUAL_INT(expected[i], rec->stage[i]);
+		TEST_ASSERT_LESS_THAN_UINT32(rec->end[i], rec->start[i]);
+		/* the stages follow each other without gaps */
+		if (i > 0)
+			TEST_ASSERT_EQUAL_UINT32(rec->end[i - 1], rec->start[i]);
+	}
+}
+
+
+void test_trace_reports_the_stages_in_order(void)
+{
+	const enum cmp_stage expected[] = { CMP_STAGE_SETUP, CMP_STAGE_PREPROCESS_INIT,
+					    CMP_STAGE_ENCODE, CMP_STAGE_CHECKSUM,
+					    CMP_STAGE_HEADER };
+	const uint16_t src[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	uint16_t work_buf[ARRAY_SIZE(src)];
+	DST_ALIGNED_U8 dst[CMP_UNCOMPRESSED_BOUND(sizeof(src)) + CMP_CHECKSUM_SIZE];
+	struct cmp_params params;
+	struct cmp_context ctx;
+	struct cmp_trace trace;
+	struct stage_recorder rec;
+
+	memset(&params, 0, sizeof(params));
+	params.primary_preprocessing = CMP_PREPROCESS_IWT;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 1;
+	params.checksum_enabled = 1;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, work_buf, sizeof(work_buf)));
+	init_trace(&trace, &rec);
+	cmp_set_trace(&ctx, &trace);
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_u16(&ctx, dst, sizeof(dst), ARRAY_AND_SIZE(src)));
+	assert_stages(&rec, expected, ARRAY_SIZE(expected));
+}
+
+
+void test_trace_reports_the_in_place_checksum_first(void)
+{
+	const enum cmp_stage expected[] = { CMP_STAGE_SETUP, CMP_STAGE_CHECKSUM,
+					    CMP_STAGE_PREPROCESS_INIT, CMP_STAGE_ENCODE,
+					    CMP_STAGE_HEADER };
+	uint16_t src[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	DST_ALIGNED_U8 dst[CMP_UNCOMPRESSED_BOUND(sizeof(src)) + CMP_CHECKSUM_SIZE];
+	struct cmp_params params;
+	struct cmp_context ctx;
+	struct cmp_trace trace;
+	struct stage_recorder rec;
+
+	memset(&params, 0, sizeof(params));
+	params.primary_preprocessing = CMP_PREPROCESS_IWT;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_ZERO;
+	params.primary_encoder_param = 1;
+	params.checksum_enabled = 1;
+	params.iwt_in_place_enabled = 1;
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+	init_trace(&trace, &rec);
+	cmp_set_trace(&ctx, &trace);
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_u16_in_place(&ctx, dst, sizeof(dst),
+							  ARRAY_AND_SIZE(src)));
+	assert_stages(&rec, expected, ARRAY_SIZE(expected));
+}
+
+
+void test_trace_does_not_change_the_compressed_data(void)
+{
+	const enum cmp_stage expected[] = { CMP_STAGE_SETUP, CMP_STAGE_PREPROCESS_INIT,
+					    CMP_STAGE_ENCODE, CMP_STAGE_HEADER };
+	const int16_t src[] = { 0, -3, 100, 7, 7, 7, 42, -1000 };
+	DST_ALIGNED_U8 dst[CMP_UNCOMPRESSED_BOUND(sizeof(src)) * 2];
+	DST_ALIGNED_U8 dst_traced[sizeof(dst)];
+	struct cmp_params params;
+	struct cmp_context ctx;
+	struct cmp_trace trace;
+	struct stage_recorder rec;
+	uint32_t size, size_traced;
+
+	memset(&params, 0, sizeof(params));
+	params.primary_preprocessing = CMP_PREPROCESS_DIFF;
+	params.primary_encoder_type = CMP_ENCODER_GOLOMB_MULTI;
+	params.primary_encoder_param = 2;
+	params.primary_encoder_outlier = 8;
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+	size = cmp_compress_i16(&ctx, dst, sizeof(dst), ARRAY_AND_SIZE(src));
+	TEST_ASSERT_CMP_SUCCESS(size);
+
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+	init_trace(&trace, &rec);
+	cmp_set_trace(&ctx, &trace);
+	size_traced = cmp_compress_i16(&ctx, dst_traced, sizeof(dst_traced), ARRAY_AND_SIZE(src));
+
+	TEST_ASSERT_EQUAL_UINT32(size, size_traced);
+	/* the identifiers differ in the headers */
+	TEST_ASSERT_EQUAL_HEX8_ARRAY(dst + CMP_HDR_MAX_SIZE, dst_traced + CMP_HDR_MAX_SIZE,
+				     size - CMP_HDR_MAX_SIZE);
+	assert_stages(&rec, expected, ARRAY_SIZE(expected));
+}
+
+
+void test_trace_can_be_stopped(void)
+{
+	const int16_t src[] = { 1, 2, 3 };
+	DST_ALIGNED_U8 dst[CMP_UNCOMPRESSED_BOUND(sizeof(src))];
+	struct cmp_params params;
+	struct cmp_context ctx;
+	struct cmp_trace trace;
+	struct stage_recorder rec;
+
+	memset(&params, 0, sizeof(params));
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+	init_trace(&trace, &rec);
+	cmp_set_trace(&ctx, &trace);
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_i16(&ctx, dst, sizeof(dst), ARRAY_AND_SIZE(src)));
+	TEST_ASSERT_EQUAL_INT(4, rec.num_stages);
+
+	cmp_set_trace(&ctx, NULL);
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_i16(&ctx, dst, sizeof(dst), ARRAY_AND_SIZE(src)));
+	TEST_ASSERT_EQUAL_INT(4, rec.num_stages);
+
+	/* a new initialisation also stops the trace */
+	cmp_set_trace(&ctx, &trace);
+	TEST_ASSERT_CMP_SUCCESS(cmp_initialise(&ctx, &params, NULL, 0));
+	TEST_ASSERT_CMP_SUCCESS(cmp_compress_i16(&ctx, dst, sizeof(dst), ARRAY_AND_SIZE(src)));
+	TEST_ASSERT_EQUAL_INT(4, rec.num_stages);
+	TEST_ASSERT_EQUAL_UINT32(5, rec.now);
+}